@@ -10,12 +10,13 @@ class Context:
         return
 
     def reset(self):
-        self.halt()
-        #set general regs to 0
+        #halt, set general regs to 0 and reset in a single batch
+        ops = [('w', self._DCR, bytes([0x09]))]
         for reg in range(64):
-            self.CREG_GPREG[reg] = 0
-        #reset
-        self._rvd.writeInt(self._DCR, 1, 0x80)
+            ops.append(('w', self._CREG_GPREG + reg*4, bytes(4)))
+        ops.append(('w', self._DCR, bytes([0x80])))
+        if None in self._rvd.batch(ops):
+            raise RuntimeError('write access failed')
 
     def resume(self):
         self._rvd.writeInt(self._DCR, 1, 0x0c)
@@ -27,8 +28,9 @@ class Context:
         d = self._rvd.readIntMultiple(addr, 4, 2)
         if len(d) != 2:
             raise RuntimeError('read access failed')
-        lo = d[0]
-        hi = d[1]
+        return self._combine_perf_counter(d[0], d[1])
+    
+    def _combine_perf_counter(self, lo, hi):
         res = 0
         if self._core.FIELD_EXT0_P > 4:
             if (lo >> 24) != (hi & 0xff):
@@ -46,9 +48,15 @@ class Context:
                  'NOP', 'NOPH', 'IACC', 'IACCH', 'IMISS', 'IMISSH', 'DRACC',
                  'DRACCH', 'DRMISS', 'DRMISSH', 'DWACC', 'DWACCH', 'DWMISS',
                  'DWMISSH', 'DBYPASS', 'DBYPASSH', 'DWBUF', 'DWBUFH']
+        data = self._rvd.batch([('r', getattr(self, '_{}'.format(name)), 8)
+                                for name in names])
         result = OrderedDict()
-        for name in names:
-            result[name] = self.get_perf_counter(getattr(self, '_{}'.format(name)))
+        for name, d in zip(names, data):
+            if d is None:
+                raise RuntimeError('read access failed')
+            result[name] = self._combine_perf_counter(
+                int.from_bytes(d[0:4], byteorder='big'),
+                int.from_bytes(d[4:8], byteorder='big'))
         return result
 
     class GPREGS:
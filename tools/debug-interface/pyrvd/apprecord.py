@@ -0,0 +1,63 @@
+"""Reader for application stream recordings made with rvsrv --record.
+
+A recording consists of records with the following format, with all integers
+big-endian:
+
+    8 bytes: time at which the data was received, in microseconds since the
+             epoch.
+    4 bytes: number of data bytes which follow.
+    n bytes: application data.
+
+By default the records are printed with timestamps relative to the first
+record. Example usage:
+
+    python3 pyrvd/apprecord.py app.rec
+    python3 pyrvd/apprecord.py --raw app.rec > app.txt
+"""
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct('>QI')
+
+
+def records(f):
+    """Yields (timestamp in microseconds, data) for each record in f."""
+    while True:
+        header = f.read(HEADER.size)
+        if len(header) < HEADER.size:
+            return
+        usec, size = HEADER.unpack(header)
+        data = f.read(size)
+        if len(data) < size:
+            return
+        yield usec, data
+
+
+def main():
+    parser = argparse.ArgumentParser(
+            description='Print or extract an rvsrv application stream recording')
+    parser.add_argument('file', type=str,
+            help="""Recording file written by rvsrv --record.""")
+    parser.add_argument('--raw', action='store_true',
+            help="""Write only the application data to stdout, without
+            timestamps.""")
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        if args.raw:
+            for usec, data in records(f):
+                sys.stdout.buffer.write(data)
+            return
+        start = None
+        total = 0
+        for usec, data in records(f):
+            if start is None:
+                start = usec
+            total += len(data)
+            print('{:12.6f} {:6d} {!r}'.format((usec - start) / 1e6, len(data), data))
+        print('{} bytes'.format(total))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,139 @@
+"""Throughput benchmark for rvsrv.
+
+Starts rvsrv with the PCIe backend pointed at a regular file, which stands in
+for the character device, and measures how fast memory can be uploaded,
+downloaded and read by several clients at once. With --daemon, rvsrv is
+started in its default daemon mode instead of in the foreground, which also
+checks that the backend still works after rvsrv has forked. Example usage:
+
+    python3 pyrvd/benchmark.py --size 64 --clients 4
+"""
+import argparse
+import os
+import socket
+import subprocess
+import tempfile
+import threading
+import time
+
+from rvd import Rvd
+
+
+def wait_for_server(port, timeout=5.0):
+    """Wait until rvsrv accepts connections on the given port."""
+    deadline = time.time() + timeout
+    while True:
+        try:
+            socket.create_connection(('localhost', port)).close()
+            return
+        except OSError:
+            if time.time() > deadline:
+                raise
+            time.sleep(0.05)
+
+
+def wait_for_shutdown(port, timeout=5.0):
+    """Wait until rvsrv no longer accepts connections on the given port."""
+    deadline = time.time() + timeout
+    while True:
+        try:
+            socket.create_connection(('localhost', port)).close()
+        except OSError:
+            return
+        if time.time() > deadline:
+            raise RuntimeError('rvsrv did not stop')
+        time.sleep(0.05)
+
+
+def report(name, size, seconds):
+    """Print the throughput of a single test."""
+    print('{:<24} {:8.1f} MiB in {:7.3f} s = {:8.1f} MiB/s'.format(
+        name, size / 2**20, seconds, size / 2**20 / seconds))
+
+
+def run(args):
+    size = args.size * 2**20
+    data = os.urandom(size)
+
+    # Upload the image with a single client.
+    with Rvd(port=args.port) as rvd:
+        print('Maximum transfer size: {} bytes'.format(rvd.page_size))
+        start = time.time()
+        if rvd.write(0, data) != size:
+            raise RuntimeError('upload failed')
+        report('upload', size, time.time() - start)
+
+        # Download it again and check it.
+        start = time.time()
+        result = rvd.read(0, size)
+        report('download', size, time.time() - start)
+        if result != data:
+            raise RuntimeError('downloaded data does not match')
+
+    # Read it with several clients at once, each reading its own part.
+    part = size // args.clients
+    errors = []
+    def reader(index):
+        with Rvd(port=args.port) as rvd:
+            if rvd.read(index * part, part) != data[index * part:(index + 1) * part]:
+                errors.append(index)
+    threads = [threading.Thread(target=reader, args=(i,))
+            for i in range(args.clients)]
+    start = time.time()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    report('download, {} clients'.format(args.clients), part * args.clients,
+            time.time() - start)
+    if errors:
+        raise RuntimeError('downloaded data does not match')
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description='Benchmark rvsrv throughput')
+    parser.add_argument('--size', type=int, default=64,
+            help="""Size of the memory image in MiB.""")
+    parser.add_argument('--clients', type=int, default=4,
+            help="""Number of clients for the concurrent test.""")
+    parser.add_argument('--port', type=int, default=21179,
+            help="""Debug port to start rvsrv on. The next lower port is used
+            for the application port.""")
+    parser.add_argument('--rvsrv', type=str,
+            default=os.path.join(here, '..', 'bin', 'rvsrv'),
+            help="""Path to the rvsrv executable.""")
+    parser.add_argument('--daemon', action='store_true',
+            help="""Let rvsrv fork into daemon mode instead of running it in
+            the foreground.""")
+    args = parser.parse_args()
+
+    with tempfile.NamedTemporaryFile() as image:
+        image.truncate(args.size * 2**20)
+        command = [args.rvsrv, '--port', '/dev/null', '--pcie', image.name,
+                '--app', str(args.port - 1), '--debug', str(args.port)]
+        if not args.daemon:
+            command.insert(1, '--foreground')
+        server = subprocess.Popen(command,
+                stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            # In daemon mode, the process we started exits once the daemon
+            # has been forked off.
+            if args.daemon:
+                server.wait(5)
+            wait_for_server(args.port)
+            run(args)
+        finally:
+            try:
+                with Rvd(port=args.port) as rvd:
+                    rvd.stop()
+                if args.daemon:
+                    wait_for_shutdown(args.port)
+                else:
+                    server.wait(5)
+            except Exception:
+                server.kill()
+
+
+if __name__ == "__main__":
+    main()
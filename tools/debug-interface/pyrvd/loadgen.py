@@ -0,0 +1,197 @@
+"""Load generator for rvsrv.
+
+Drives many concurrent debug clients, each issuing a random mix of small
+reads, small writes and bulk transfers for a fixed amount of time, and reports
+the number of operations per second and latency percentiles for each kind of
+operation. Every client runs in its own process and has its own connection.
+
+By default rvsrv is started with the simulated backend, so this works on any
+Linux machine. Example usage:
+
+    python3 pyrvd/loadgen.py --clients 16 --duration 10
+    python3 pyrvd/loadgen.py --sim 5:0x100000:0x1000 --mix read=1,bulk=1
+    python3 pyrvd/loadgen.py --connect --port 21079
+"""
+import argparse
+import multiprocessing
+import os
+import random
+import socket
+import subprocess
+import time
+
+from rvd import Rvd
+
+OPS = ('read', 'write', 'bulk-read', 'bulk-write')
+
+
+def wait_for_server(port, timeout=5.0):
+    """Wait until rvsrv accepts connections on the given port."""
+    deadline = time.time() + timeout
+    while True:
+        try:
+            socket.create_connection(('localhost', port)).close()
+            return
+        except OSError:
+            if time.time() > deadline:
+                raise
+            time.sleep(0.05)
+
+
+def parse_mix(mix):
+    """Parses the --mix argument into a list of weights, one per entry of OPS.
+    bulk selects both bulk reads and bulk writes."""
+    weights = dict.fromkeys(OPS, 0)
+    for item in mix.split(','):
+        name, _, weight = item.partition('=')
+        weight = float(weight) if weight else 1.0
+        if name == 'bulk':
+            weights['bulk-read'] = weights['bulk-write'] = weight / 2
+        elif name in weights:
+            weights[name] = weight
+        else:
+            raise ValueError('unknown operation {}'.format(name))
+    return [weights[op] for op in OPS]
+
+
+def client(index, args, weights, deadline, results):
+    """Runs a single client until the deadline and puts a dict mapping each
+    operation to a list of latencies in seconds, and the number of errors,
+    in the results queue."""
+    latencies = {op: [] for op in OPS}
+    errors = 0
+    rng = random.Random(index)
+    base = args.base + index * args.region
+    payload = os.urandom(args.bulk_size)
+    try:
+        with Rvd(host=args.host, port=args.port, binary=not args.text) as rvd:
+            while time.time() < deadline:
+                op = rng.choices(OPS, weights)[0]
+                if op.startswith('bulk'):
+                    size = args.bulk_size
+                else:
+                    size = 4
+                address = base + rng.randrange(0, args.region - size + 1, 4)
+                start = time.perf_counter()
+                if op in ('read', 'bulk-read'):
+                    ok = len(rvd.read(address, size)) == size
+                else:
+                    ok = rvd.write(address, payload[:size]) == size
+                latency = time.perf_counter() - start
+                if ok:
+                    latencies[op].append(latency)
+                else:
+                    errors += 1
+    except OSError as e:
+        print('client {}: {}'.format(index, e))
+        errors += 1
+    results.put((latencies, errors))
+
+
+def percentile(values, fraction):
+    """Returns the given percentile of a sorted list."""
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def report(latencies, errors, duration, bulk_size):
+    """Prints the results of a run."""
+    print('{:<11} {:>9} {:>10} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9}'.format(
+        'operation', 'ops', 'ops/s', 'MiB/s', 'p50 us', 'p90 us', 'p99 us',
+        'p99.9 us', 'max us'))
+    total = 0
+    for op in OPS:
+        values = sorted(latencies[op])
+        if not values:
+            continue
+        total += len(values)
+        size = bulk_size if op.startswith('bulk') else 4
+        print('{:<11} {:>9} {:>10.1f} {:>9.2f} {:>9.0f} {:>9.0f} {:>9.0f} {:>9.0f} {:>9.0f}'.format(
+            op, len(values), len(values) / duration,
+            len(values) * size / duration / 2**20,
+            percentile(values, 0.5) * 1e6, percentile(values, 0.9) * 1e6,
+            percentile(values, 0.99) * 1e6, percentile(values, 0.999) * 1e6,
+            values[-1] * 1e6))
+    print('total: {:.1f} ops/s, {} errors'.format(total / duration, errors))
+
+
+def run(args):
+    weights = parse_mix(args.mix)
+    results = multiprocessing.Queue()
+    deadline = time.time() + args.duration
+    processes = [multiprocessing.Process(target=client,
+            args=(i, args, weights, deadline, results))
+            for i in range(args.clients)]
+    start = time.time()
+    for process in processes:
+        process.start()
+    latencies = {op: [] for op in OPS}
+    errors = 0
+    for _ in processes:
+        client_latencies, client_errors = results.get()
+        for op in OPS:
+            latencies[op].extend(client_latencies[op])
+        errors += client_errors
+    for process in processes:
+        process.join()
+    report(latencies, errors, time.time() - start, args.bulk_size)
+    return errors
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description='Generate load on rvsrv')
+    parser.add_argument('--clients', type=int, default=8,
+            help="""Number of concurrent clients.""")
+    parser.add_argument('--duration', type=float, default=5.0,
+            help="""Number of seconds to run for.""")
+    parser.add_argument('--mix', type=str, default='read=8,write=1,bulk=1',
+            help="""Relative weights of the operations, as a comma-separated
+            list of read, write, bulk-read, bulk-write or bulk (both bulk
+            operations) with optional =<weight>.""")
+    parser.add_argument('--bulk-size', type=int, default=65536,
+            help="""Number of bytes transferred by a bulk operation.""")
+    parser.add_argument('--base', type=lambda x: int(x, 0), default=0,
+            help="""Start of the memory region used by the clients.""")
+    parser.add_argument('--region', type=lambda x: int(x, 0), default=2**20,
+            help="""Size of the memory region used by each client.""")
+    parser.add_argument('--text', action='store_true',
+            help="""Use the text protocol instead of the binary protocol.""")
+    parser.add_argument('--host', type=str, default='localhost',
+            help="""Host to connect to with --connect.""")
+    parser.add_argument('--port', type=int, default=21179,
+            help="""Debug port to connect to or start rvsrv on. When rvsrv is
+            started, the next lower port is used for the application port.""")
+    parser.add_argument('--connect', action='store_true',
+            help="""Connect to an rvsrv instance which is already running
+            instead of starting one.""")
+    parser.add_argument('--sim', type=str, default='0',
+            help="""Specification for the simulated backend of the rvsrv
+            instance which is started, see rvsrv --help.""")
+    parser.add_argument('--rvsrv', type=str,
+            default=os.path.join(here, '..', 'bin', 'rvsrv'),
+            help="""Path to the rvsrv executable.""")
+    args = parser.parse_args()
+    if args.region < args.bulk_size:
+        parser.error('--region must be at least --bulk-size')
+
+    if args.connect:
+        return run(args)
+
+    server = subprocess.Popen([args.rvsrv, '--foreground',
+            '--port', '/dev/null', '--sim', args.sim,
+            '--app', str(args.port - 1), '--debug', str(args.port)],
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        wait_for_server(args.port)
+        return run(args)
+    finally:
+        try:
+            with Rvd(port=args.port) as rvd:
+                rvd.stop()
+            server.wait(5)
+        except Exception:
+            server.kill()
+
+
+if __name__ == "__main__":
+    exit(1 if main() else 0)
@@ -1,6 +1,11 @@
 import socket
 import re
+import struct
 import argparse
+import array
+import mmap
+import os
+import time
 
 class Rvd:
     """A class for handling the communication protocol with rvsrv.
@@ -55,6 +60,12 @@ class Rvd:
     <data> is a hex array, <count>*2 in length, specifying the read/write data.
     <code> is an 8-digit hex number specifying the bus fault code.
 
+    Any command may be prefixed with "Tag,<tag>," where <tag> is a 1-8 digit hex
+    number. The reply to a tagged command is prefixed with "Tag,<tag>," as well,
+    with the tag as an 8-digit hex number. rvsrv may complete tagged commands
+    out of order; untagged commands from a connection are always replied to in
+    order.
+
     1, 2 and 4 byte read/writes are guaranteed to be in-order and atomic. Larger
     read/writes may be read/written one or more times in any order, and bus fault
     detection is best-effort only.
@@ -63,8 +74,87 @@ class Rvd:
     debug support unit ROM instead of the bus. This ROM is supposed to contain
     version information stuff.
 
+    Binary protocol
+    ---------------
+
+    Binary command:    "Binary;"
+      OK reply:        "OK,Binary,<version>,<max transfer size>;"
+
+    After a successful Binary command, the connection switches to length-prefixed
+    binary frames (see src/common/binaryProtocol.h). All integers are
+    big-endian.
+
+    Request: length(4) opcode(1) reserved(3) tag(4) address(4) count(4) [data]
+    Reply:   length(4) opcode(1) status(1) reserved(2) tag(4) address(4)
+             count(4) fault(4) [data or error name]
+
+    length counts the bytes following the length field. The opcodes are 1 for
+    reads, 2 for writes, 3 for stop and 4 for batches. The status is 0 for OK,
+    1 for a bus fault and 2 for an error. Servers which don't support the
+    binary protocol reply to the Binary command with an UnknownCommand error, in
+    which case the text protocol is used.
+
+    The maximum transfer size is the number of bytes a single binary read or
+    write may access. It is a power of two of at least 4096, and depends on the
+    backend rvsrv is using. Older servers don't report it, in which case it is
+    4096. Text commands and batch entries are always limited to 4096 bytes.
+
+    A batch request carries a list of reads and writes in its payload and count
+    set to the number of entries. Each entry is opcode(1) reserved(3)
+    address(4) count(4) [write data]. The reply payload contains a result for
+    every entry: status(1) reserved(3) fault(4) [read data]. The read data is
+    present for failed reads as well, but is zero in that case.
+
+    Wait command:      "WaitFor,<addr>,<mask>,<value>,<timeout>[,<interval>];"
+      OK reply:        "OK,WaitFor,OK,<addr>,<word>;"
+      Timeout reply:   "OK,WaitFor,Timeout,<addr>,<word>;"
+      Fault reply:     "OK,WaitFor,Fault,<addr>,4,<code>;"
+
+    rvsrv polls the word at <addr> until (word & <mask>) == <value> or until
+    <timeout> milliseconds have passed, and replies once. <mask>, <value> and
+    <word> are hex numbers, <word> being the last word that was read.
+    <timeout> is a decimal number of at most 600000, <interval> the decimal
+    number of microseconds between polls. The binary opcode is 5, with count
+    set to the timeout and a payload of mask(4) value(4) interval(4); the
+    reply has status 0 if the condition was met or 3 if the timeout expired,
+    with the last word read as payload. WaitFor requires binary protocol
+    version 2.
+
+    Local access
+    ------------
+
+    When rvsrv is started with --mmio and --local <path>, clients on the same
+    machine can connect to the Unix-domain socket at <path>. rvsrv replies with
+    "OK,Share,<offset>,<length>;" and passes the file descriptor of the
+    memory-mapped file along with it (SCM_RIGHTS). <offset> and <length> are
+    hex numbers specifying where address 0 is within the file and how many
+    bytes are accessible. Reads and writes within that range are then done
+    directly on the mapped memory. See src/common/localShare.h.
+
     """
 
+    # Binary protocol constants, see src/common/binaryProtocol.h.
+    OP_READ = 0x01
+    OP_WRITE = 0x02
+    OP_STOP = 0x03
+    OP_BATCH = 0x04
+    OP_WAIT = 0x05
+    OP_STATS = 0x07
+    STATUS_OK = 0x00
+    STATUS_FAULT = 0x01
+    STATUS_ERROR = 0x02
+    STATUS_TIMEOUT = 0x03
+    REQUEST_HEADER = struct.Struct('>IB3xIII')
+    REPLY_HEADER = struct.Struct('>IBB2xIIII')
+    BATCH_ENTRY = struct.Struct('>B3xII')
+    BATCH_RESULT = struct.Struct('>B3xI')
+    MAX_BATCH_ENTRIES = 256
+    MAX_BATCH_SIZE = 8192
+    MIN_TRANSFER_SIZE = 4096
+    MAX_TRANSFER_SIZE = 1024*1024
+    WAIT_PAYLOAD = struct.Struct('>III')
+    MAX_WAIT_TIMEOUT = 600000
+
     def recv_all(self):
         """Receive all data from the socket until there is no more data to
         receive and return it as a string.
@@ -81,9 +171,94 @@ class Rvd:
         return re.sub(r'[^,;a-zA-Z0-9]','', msg.decode('utf-8'))
 
 
+    def recv_exact(self, count):
+        """Receive exactly count bytes from the socket and return them as a
+        bytes object. Raises an exception if the connection is closed.
+        """
+        msg = bytearray()
+        while len(msg) < count:
+            chunk = self.socket.recv(count - len(msg))
+            if len(chunk) == 0:
+                raise RuntimeError('rvsrv closed the connection')
+            msg.extend(chunk)
+        return bytes(msg)
+
+    def negotiate_binary(self):
+        """Try to switch the connection to the binary protocol. Returns True
+        if rvsrv supports it. Sets page_size to the maximum transfer size
+        and version to the protocol version reported by rvsrv.
+        """
+        self.socket.sendall(b'Binary;')
+        reply = bytearray()
+        while not reply.endswith(b'\n'):
+            reply.extend(self.recv_exact(1))
+        reply = re.sub(r'[^,;a-zA-Z0-9]', '', reply.decode('utf-8'))
+        match = re.match(r'OK,Binary,(?P<version>[0-9]+)', reply)
+        if match:
+            self.version = int(match.group('version'))
+        match = re.match(r'OK,Binary,[0-9]+,(?P<size>[0-9]+);', reply)
+        if match:
+            size = int(match.group('size'))
+            if (self.MIN_TRANSFER_SIZE <= size <= self.MAX_TRANSFER_SIZE and
+                    not size & (size - 1)):
+                self.page_size = size
+        return reply.startswith('OK,Binary,')
+
+    def transfer(self, opcode, address=0, count=0, data=b''):
+        """Send a binary request and return the reply as a (status, fault,
+        payload) tuple.
+        """
+        self.tag = (self.tag + 1) & 0xFFFFFFFF
+        self.socket.sendall(self.REQUEST_HEADER.pack(
+            self.REQUEST_HEADER.size - 4 + len(data), opcode, self.tag,
+            address, count) + bytes(data))
+        length, op, status, tag, _, _, fault = self.REPLY_HEADER.unpack(
+                self.recv_exact(self.REPLY_HEADER.size))
+        payload = self.recv_exact(length - (self.REPLY_HEADER.size - 4))
+        if op != opcode or tag != self.tag:
+            raise RuntimeError('malformed reply from rvsrv')
+        return status, fault, payload
+
+    def open_local(self, path):
+        """Connect to the rvsrv local socket at path and map the memory it
+        shares.
+        """
+        fds = array.array('i')
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+            sock.connect(path)
+            msg, ancdata, _, _ = sock.recvmsg(64,
+                    socket.CMSG_LEN(fds.itemsize))
+        for level, kind, data in ancdata:
+            if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                fds.frombytes(data[:fds.itemsize])
+        match = re.match(r'OK,Share,(?P<offset>[0-9a-fA-F]+),'
+                r'(?P<length>[0-9a-fA-F]+);',
+                re.sub(r'[^,;a-zA-Z0-9]', '', msg.decode('utf-8')))
+        if not match or not fds:
+            raise RuntimeError('malformed reply from rvsrv local socket')
+        offset = int(match.group('offset'), 16)
+        length = int(match.group('length'), 16)
+        page_offset = offset % mmap.ALLOCATIONGRANULARITY
+        try:
+            self.local = mmap.mmap(fds[0], page_offset + length,
+                    mmap.MAP_SHARED, mmap.PROT_READ | mmap.PROT_WRITE,
+                    offset=offset - page_offset)
+        finally:
+            os.close(fds[0])
+        self.local_offset = page_offset
+        self.local_length = length
+
+    def is_local(self, address, count):
+        """Returns whether the given range can be accessed directly.
+        """
+        return self.local is not None and address + count <= self.local_length
+
     def stop(self):
         """Send the stop command to rvsrv.
         """
+        if self.binary:
+            status, _, _ = self.transfer(self.OP_STOP)
+            return status == self.STATUS_OK
         command = "Stop;".encode('utf-8')
         res = self.socket.send(command)
         res = self.recv_all()
@@ -92,15 +267,46 @@ class Rvd:
             return False
         return True
 
+    def stats(self):
+        """Request the statistics rvsrv keeps for the target, and return them
+        as a dict mapping each name to its integer value. Latencies are in
+        microseconds.
+        """
+        if self.binary and self.version >= 4:
+            status, _, text = self.transfer(self.OP_STATS)
+            if status != self.STATUS_OK:
+                raise RuntimeError('Stats command failed')
+            text = text.decode('utf-8')
+        else:
+            self.socket.sendall(b'Stats;')
+            reply = bytearray()
+            while not reply.endswith(b'\n'):
+                reply.extend(self.recv_exact(1))
+            match = re.match(r'OK, Stats, (?P<text>[^;]*);',
+                    reply.decode('utf-8'))
+            if not match:
+                raise RuntimeError('Stats command failed')
+            text = match.group('text')
+        result = {}
+        for item in text.split(', '):
+            name, _, value = item.partition('=')
+            if value:
+                result[name] = int(value)
+        return result
+
 
     def write(self, address, data):
         """Write the bytearray data to rvsrv.
         Returns the number of bytes successfully written.
 
-        Split the data into chunks of size 4096 before sending, because that is
-        what rvsrv expects.
+        Split the data into aligned chunks of page_size bytes before sending,
+        because that is what rvsrv expects.
         """
-        chunk_size = 4*1024
+        if self.is_local(address, len(data)):
+            start = self.local_offset + address
+            self.local[start:start + len(data)] = bytes(data)
+            return len(data)
+        chunk_size = self.page_size
         bytes_sent = 0
         while len(data) - bytes_sent > 0:
             # offset from start of alignment
@@ -108,6 +314,13 @@ class Rvd:
             # number of bytes in chunk
             bytes_to_send = min(chunk_size - offset, len(data) - bytes_sent)
             chunk = data[bytes_sent:bytes_sent + bytes_to_send]
+            if self.binary:
+                status, _, _ = self.transfer(self.OP_WRITE,
+                        address + bytes_sent, len(chunk), chunk)
+                if status != self.STATUS_OK:
+                    break
+                bytes_sent += len(chunk)
+                continue
             command = "Write,{:08x},{:d},{};".format(address + bytes_sent,
                     len(chunk),
                     ''.join('{:02x}'.format(x) for x in chunk)).encode('utf-8')
@@ -136,15 +349,25 @@ class Rvd:
     def read(self, address, count):
         """Reads count bytes from address over rvd.
 
-        The read request is split into 4096 byte alligned chunks, and the
+        The read request is split into page_size byte alligned chunks, and the
         result is return as a bytearray. If the length of the result is not
         equal to count, it means there was an error while reading.
         """
-        chunk_size = 4*1024
+        if self.is_local(address, count):
+            start = self.local_offset + address
+            return bytearray(self.local[start:start + count])
+        chunk_size = self.page_size
         result = bytearray()
         while count - len(result) > 0:
             offset = (address + len(result)) % chunk_size
             bytes_to_read = min(chunk_size - offset, count - len(result))
+            if self.binary:
+                status, _, payload = self.transfer(self.OP_READ,
+                        address + len(result), bytes_to_read)
+                if status != self.STATUS_OK:
+                    break
+                result.extend(payload)
+                continue
             command = "Read,{:08x},{:d};".format(address + len(result),
                                                  bytes_to_read).encode('utf-8')
             res = self.socket.send(command)
@@ -183,15 +406,131 @@ class Rvd:
             result.append(int.from_bytes(res[i*size:(i+1)*size], byteorder='big'))
         return result
 
-    def __init__(self, host='localhost', port=21079):
+    def wait_for(self, address, mask, value, timeout=None, interval=0):
+        """Wait until (word & mask) == value holds for the 32-bit word at
+        address, or until timeout seconds have passed. Waits indefinitely if
+        timeout is None. interval is the time between polls in microseconds,
+        or 0 for the default of rvsrv.
+
+        rvsrv does the polling if it supports it, so only a single round trip
+        is needed. Returns a (met, word) tuple, where met is False if the
+        timeout expired and word is the last word that was read. Raises an
+        exception if the read access failed.
+        """
+        value &= mask
+        if (self.is_local(address, 4) or not self.binary or
+                self.version < 2):
+            deadline = None if timeout is None else time.time() + timeout
+            while True:
+                word = self.readInt(address, 4)
+                if word & mask == value:
+                    return True, word
+                if deadline is not None and time.time() >= deadline:
+                    return False, word
+                time.sleep((interval or 1000) / 1e6)
+
+        remaining = None if timeout is None else int(timeout * 1000)
+        payload = self.WAIT_PAYLOAD.pack(mask, value, interval)
+        while True:
+            chunk = self.MAX_WAIT_TIMEOUT
+            if remaining is not None:
+                chunk = min(chunk, remaining)
+                remaining -= chunk
+            status, _, reply = self.transfer(self.OP_WAIT, address, chunk,
+                    payload)
+            if status == self.STATUS_OK:
+                return True, int.from_bytes(reply, byteorder='big')
+            if status != self.STATUS_TIMEOUT:
+                raise RuntimeError('read access failed')
+            if remaining == 0:
+                return False, int.from_bytes(reply, byteorder='big')
+
+    def batch(self, ops):
+        """Perform a list of accesses with as few round trips as possible.
+
+        Each operation is either ('r', address, count) or ('w', address, data).
+        Returns a list with the read data as a bytearray for reads and True for
+        writes, or None for accesses which failed. Each access should not cross
+        a 4096 byte boundary.
+        """
+        local = all(self.is_local(op[1], op[2] if op[0] == 'r' else len(op[2]))
+                    for op in ops)
+        if local or not self.binary:
+            results = []
+            for op in ops:
+                if op[0] == 'r':
+                    res = self.read(op[1], op[2])
+                    results.append(res if len(res) == op[2] else None)
+                else:
+                    res = self.write(op[1], op[2])
+                    results.append(True if res == len(op[2]) else None)
+            return results
+
+        results = []
+        start = 0
+        while start < len(ops):
+
+            # Take as many operations as fit in a single batch.
+            payload = bytearray()
+            read_size = 0
+            end = start
+            while end < len(ops) and end - start < self.MAX_BATCH_ENTRIES:
+                op = ops[end]
+                if op[0] == 'r':
+                    entry = self.BATCH_ENTRY.pack(self.OP_READ, op[1], op[2])
+                    size = op[2]
+                else:
+                    entry = self.BATCH_ENTRY.pack(self.OP_WRITE, op[1],
+                            len(op[2])) + bytes(op[2])
+                    size = 0
+                if end > start and (
+                        len(payload) + len(entry) > self.MAX_BATCH_SIZE or
+                        read_size + size > self.MAX_BATCH_SIZE):
+                    break
+                payload.extend(entry)
+                read_size += size
+                end += 1
+
+            status, _, reply = self.transfer(self.OP_BATCH, 0, end - start,
+                    payload)
+            if status != self.STATUS_OK:
+                raise RuntimeError('batch access failed')
+
+            # Split the reply into the results of the individual operations.
+            offset = 0
+            for op in ops[start:end]:
+                status, _ = self.BATCH_RESULT.unpack_from(reply, offset)
+                offset += self.BATCH_RESULT.size
+                if op[0] == 'r':
+                    if status == self.STATUS_OK:
+                        results.append(bytearray(reply[offset:offset+op[2]]))
+                    else:
+                        results.append(None)
+                    offset += op[2]
+                else:
+                    results.append(True if status == self.STATUS_OK else None)
+            start = end
+
+        return results
+
+    def __init__(self, host='localhost', port=21079, binary=True, local=None):
         self.socket = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
         self.socket.connect((host, port))
+        self.tag = 0
+        self.page_size = self.MIN_TRANSFER_SIZE
+        self.version = 0
+        self.binary = binary and self.negotiate_binary()
+        self.local = None
+        if local is not None:
+            self.open_local(local)
 
     def __enter__(self):
         return self
 
 
     def __exit__(self, exc_type, exc_val, exc_tb):
+        if self.local is not None:
+            self.local.close()
         self.socket.close()
 
 
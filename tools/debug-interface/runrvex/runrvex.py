@@ -3,7 +3,6 @@ import argparse
 import sys
 import elftools.elf.elffile as elffile
 from pyrvd import Rvd, Core
-from time import sleep
 import socket
 import datetime
 
@@ -36,12 +35,18 @@ def upload_child_args(rvd, args, argc, argv, argv_end):
         rvd.write(argv + offset, arg)
         offset += len(arg)
 
-def allDone(core):
-    """Return True if all active contexts are done."""
+def allDone(core, timeout=0):
+    """Return True if all active contexts are done. Waits at most timeout
+    seconds for each context which is not done yet; rvsrv does the polling, so
+    completion is noticed right away.
+    """
     cc = core.CC
     active = set('{:0{width}x}'.format(cc, width=len(core.context)))
     for c in active:
-        if core[int(c, 16)].FIELD_DCR_D == 0:
+        context = core[int(c, 16)]
+        done, _ = context._rvd.wait_for(context._DCR, 0x80000000, 0x80000000,
+                timeout)
+        if not done:
             return False
     return True
 
@@ -97,11 +102,11 @@ def main():
                 if len(data) > 0:
                     print(data.decode('latin-1'), end='')
                     continue
-                else:
-                    sleep(1)
             except BlockingIOError:
-                sleep(1)
-            if allDone(core):
+                pass
+            # Wait for the program to finish for a while before checking for
+            # application output again.
+            if allDone(core, 0.1):
                 break
         s.close()
         for context in core:
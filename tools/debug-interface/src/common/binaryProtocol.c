@@ -0,0 +1,66 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include "binaryProtocol.h"
+
+/**
+ * Stores a 32-bit big-endian value at the given location.
+ */
+void binProto_putU32(unsigned char *buf, uint32_t value) {
+  buf[0] = (value >> 24) & 0xFF;
+  buf[1] = (value >> 16) & 0xFF;
+  buf[2] = (value >>  8) & 0xFF;
+  buf[3] = (value >>  0) & 0xFF;
+}
+
+/**
+ * Loads a 32-bit big-endian value from the given location.
+ */
+uint32_t binProto_getU32(const unsigned char *buf) {
+  return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | (uint32_t)buf[3];
+}
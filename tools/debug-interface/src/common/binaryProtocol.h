@@ -0,0 +1,328 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _BINARY_PROTOCOL_H_
+#define _BINARY_PROTOCOL_H_
+
+#include <stdint.h>
+
+// Binary framing for the rvsrv debug port. A client which wants to use it
+// sends the text command "Binary;" right after connecting. rvsrv replies with
+// "OK, Binary, <version>, <max transfer size>;" and from then on expects
+// binary frames on that connection. Servers which do not support this reply
+// with an UnknownCommand error, in which case the client should just keep
+// using the text protocol.
+//
+// The maximum transfer size is the number of bytes which may be read or
+// written with a single binary Read or Write request. It depends on the
+// backend rvsrv is using, but is always a power of two between
+// BINPROTO_MIN_TRANSFER_SIZE and BINPROTO_MAX_TRANSFER_SIZE. Early versions
+// of rvsrv did not report it, in which case it is BINPROTO_MIN_TRANSFER_SIZE.
+// The text protocol and batch entries are always limited to
+// BINPROTO_MIN_TRANSFER_SIZE bytes per access.
+//
+// All integers are big-endian. Every frame starts with a 32-bit length, which
+// specifies the number of bytes in the frame following the length field.
+// rvsrv answers a frame which is shorter than a request header or longer than
+// a header plus the maximum transfer size (or a full batch) with a
+// PacketBufferOverrun error with tag zero, and then closes the connection.
+//
+// Request frame:
+//   0  length  (4)
+//   4  opcode  (1)  BINPROTO_OP_*
+//   5  reserved(3)  must be zero
+//   8  tag     (4)  echoed back in the reply; rvsrv may complete requests
+//                   out of order, so this identifies the request
+//  12  address (4)
+//  16  count   (4)  number of bytes to read or write
+//  20  payload      write data (count bytes) for writes, empty otherwise
+//
+// Reply frame:
+//   0  length  (4)
+//   4  opcode  (1)  same as the request
+//   5  status  (1)  BINPROTO_STATUS_*
+//   6  reserved(2)
+//   8  tag     (4)  copied from the request
+//  12  address (4)  copied from the request
+//  16  count   (4)  copied from the request
+//  20  fault   (4)  bus fault code if status is BINPROTO_STATUS_FAULT
+//  24  payload      read data (count bytes) for successful reads, the error
+//                   name (e.g. "CommunicationError") for errors, empty
+//                   otherwise
+//
+// Batch requests (BINPROTO_OP_BATCH) carry a list of reads and writes which
+// are all completed before a single reply is sent, so a client can for
+// instance access a register in every context with one round trip. The
+// address field of the request is ignored and count specifies the number of
+// entries. The entries within a batch are performed in order with respect to
+// each other. The payload of the request consists of count entries:
+//   0  opcode  (1)  BINPROTO_OP_READ or BINPROTO_OP_WRITE
+//   1  reserved(3)  must be zero
+//   4  address (4)
+//   8  count   (4)  number of bytes to read or write
+//  12  payload      write data (count bytes) for writes, empty for reads
+//
+// If the batch is accepted, the reply has status BINPROTO_STATUS_OK and count
+// set to the number of entries, and its payload contains a result for every
+// entry, in the same order:
+//   0  status  (1)  BINPROTO_STATUS_*
+//   1  reserved(3)
+//   4  fault   (4)  bus fault code if status is BINPROTO_STATUS_FAULT
+//   8  payload      read data (count bytes) for reads, zero if the read
+//                   failed; empty for writes
+// If the batch as a whole is malformed, an error reply is sent instead and
+// none of the entries are performed.
+//
+// WaitFor requests (BINPROTO_OP_WAIT) make rvsrv poll the 32-bit word at the
+// given address until (word & mask) == value, and reply only once that is the
+// case or the timeout expires. This saves a round trip per poll and lets
+// rvsrv poll at a much finer interval than a client reasonably could. count
+// specifies the timeout in milliseconds, at most BINPROTO_MAX_WAIT_TIMEOUT;
+// zero means the word is read only once. The payload of the request is:
+//   0  mask    (4)
+//   4  value   (4)
+//   8  interval(4)  microseconds between polls, zero for the default
+//
+// The reply has status BINPROTO_STATUS_OK if the condition was met, or
+// BINPROTO_STATUS_TIMEOUT if it was not met before the timeout expired. In
+// both cases count is 4 and the payload contains the last word that was read.
+// A bus fault or error ends the wait immediately. WaitFor is supported from
+// protocol version 2 onwards.
+//
+// TraceStream requests (BINPROTO_OP_TRACE) make rvsrv drain the double buffer
+// of a hardware trace peripheral (periph_trace.vhd) and stream its contents
+// to the client, until the client stops the stream or disconnects. address
+// specifies the start of the trace buffer and count its total size, which
+// must be even; each half must fit in a single transfer. rvsrv reads the two
+// halves alternately, as fast as the backend allows while the trace is
+// producing data, and once per interval while it is not. The first
+// BINPROTO_TRACE_COUNTER_SIZE bytes of a half hold the number of valid bytes
+// in it, including the counter itself, in their lower 16 bits. The payload of
+// the request is:
+//   0  interval(4)  microseconds between polls while no data is produced,
+//                   zero for the default
+//
+// For every half which contained data, rvsrv sends a frame with the opcode
+// and tag of the request, status BINPROTO_STATUS_OK, the address of the half
+// and count set to the number of trace bytes, followed by those bytes. Reading
+// is paused while the client has not received a lot of previously sent data,
+// which eventually stalls the traced core instead of losing data. The stream
+// ends with a frame without payload with count set to zero, or with a fault
+// or error frame if reading the trace buffer failed.
+//
+// A TraceStream request with count set to zero stops the stream running on
+// the same connection, if any. Its reply is sent after the final frame of the
+// stream. TraceStream is supported from protocol version 3 onwards and is not
+// available in the text protocol.
+//
+// Stats requests (BINPROTO_OP_STATS) return the statistics rvsrv keeps for
+// the target, such as traffic counters, latency percentiles and backend
+// specific counters. address and count are ignored. The reply has count set
+// to the size of the payload, which is the same text as in the reply to the
+// text command "Stats;": a comma-separated list of <name>=<value> pairs with
+// unsigned integer values. Latencies are in microseconds. Clients should
+// ignore names they do not know. Stats is supported from protocol version 4
+// onwards.
+//
+// Hash requests (BINPROTO_OP_HASH) make rvsrv read count bytes starting at
+// address through the backend and return the CRC-32 (as used by zlib) of
+// every page of the range, so a client can find out which parts of the
+// memory differ from an image without transferring the memory. Pages are
+// counted from address, not aligned; the last one may be partial. The
+// payload of the request is:
+//   0  pageSize(4)  a power of two between BINPROTO_MIN_HASH_PAGE_SIZE and
+//                   the maximum transfer size
+// The range may span at most BINPROTO_MAX_HASH_PAGES pages. If all reads
+// succeed, the reply has count set to the number of pages and its payload
+// contains their CRCs. If any read fails, the reply is a fault or error reply
+// for the first page range that failed; its address is the start of the
+// failing read. Hash is supported from protocol version 5 onwards and is not
+// available in the text protocol.
+//
+// Fill requests (BINPROTO_OP_FILL) make rvsrv set count bytes starting at
+// address to a repeating 32-bit pattern, so large regions can be cleared
+// without sending the data. The pattern is aligned to the address: the byte
+// at address a is set to byte (a & 3) of the big-endian pattern. count may be
+// larger than the maximum transfer size. The payload of the request is:
+//   0  pattern(4)
+// If the whole range was written, the reply has address and count set to
+// those of the request. Otherwise, the reply is a fault or error reply for
+// the first part of the range that failed; the rest of the range may or may
+// not have been written. Fill is supported from protocol version 6 onwards
+// and is not available in the text protocol.
+//
+// Checksum requests (BINPROTO_OP_CHECKSUM) make rvsrv read count bytes
+// starting at address through the backend and return the CRC-32 (as used by
+// zlib) of the whole range, so a client can check that memory matches an image
+// by transferring only four bytes. count may be larger than the maximum
+// transfer size. The request has no payload. If all reads succeed, the reply
+// has address and count set to those of the request and its payload contains
+// the CRC. If any read fails, the reply is a fault or error reply for the
+// first part of the range that failed; its address is the start of the
+// failing read. Hash requests can then be used to find out which pages
+// differ. Checksum is supported from protocol version 7 onwards and is not
+// available in the text protocol.
+
+/**
+ * Version reported in reply to the "Binary;" negotiation command.
+ */
+#define BINPROTO_VERSION 7
+
+/**
+ * Opcodes.
+ */
+#define BINPROTO_OP_READ     0x01
+#define BINPROTO_OP_WRITE    0x02
+#define BINPROTO_OP_STOP     0x03
+#define BINPROTO_OP_BATCH    0x04
+#define BINPROTO_OP_WAIT     0x05
+#define BINPROTO_OP_TRACE    0x06
+#define BINPROTO_OP_STATS    0x07
+#define BINPROTO_OP_HASH     0x08
+#define BINPROTO_OP_FILL     0x09
+#define BINPROTO_OP_CHECKSUM 0x0A
+
+/**
+ * Reply status codes.
+ */
+#define BINPROTO_STATUS_OK      0x00
+#define BINPROTO_STATUS_FAULT   0x01
+#define BINPROTO_STATUS_ERROR   0x02
+#define BINPROTO_STATUS_TIMEOUT 0x03
+
+/**
+ * Header sizes, including the length field.
+ */
+#define BINPROTO_REQUEST_HEADER_SIZE 20
+#define BINPROTO_REPLY_HEADER_SIZE   24
+
+/**
+ * Size of a batch request entry and a batch result, excluding the payload.
+ */
+#define BINPROTO_BATCH_ENTRY_SIZE  12
+#define BINPROTO_BATCH_RESULT_SIZE 8
+
+/**
+ * Bounds for the maximum transfer size reported by the server.
+ */
+#define BINPROTO_MIN_TRANSFER_SIZE 4096
+#define BINPROTO_MAX_TRANSFER_SIZE (1024*1024)
+
+/**
+ * Maximum number of entries in a batch.
+ */
+#define BINPROTO_MAX_BATCH_ENTRIES 256
+
+/**
+ * Maximum size of the payload of a batch request. The total number of bytes
+ * read by a batch is limited to the same amount.
+ */
+#define BINPROTO_MAX_BATCH_SIZE 8192
+
+/**
+ * Size of the payload of a WaitFor request.
+ */
+#define BINPROTO_WAIT_PAYLOAD_SIZE 12
+
+/**
+ * Maximum timeout of a WaitFor request in milliseconds. Clients which want to
+ * wait longer should send another request when this one times out.
+ */
+#define BINPROTO_MAX_WAIT_TIMEOUT 600000
+
+/**
+ * Default, minimum and maximum interval between polls of a WaitFor request in
+ * microseconds. Requested intervals outside this range are clamped.
+ */
+#define BINPROTO_DEFAULT_WAIT_INTERVAL 1000
+#define BINPROTO_MIN_WAIT_INTERVAL     100
+#define BINPROTO_MAX_WAIT_INTERVAL     1000000
+
+/**
+ * Size of the payload of a TraceStream request, and size of the byte counter
+ * at the start of each half of a trace buffer.
+ */
+#define BINPROTO_TRACE_PAYLOAD_SIZE 4
+#define BINPROTO_TRACE_COUNTER_SIZE 4
+
+/**
+ * Default interval between polls of an idle trace buffer in microseconds.
+ * Requested intervals are clamped to the WaitFor interval range.
+ */
+#define BINPROTO_DEFAULT_TRACE_INTERVAL 1000
+
+/**
+ * Size of the payload of a Hash request, the minimum page size and the
+ * maximum number of pages per request. The latter keeps the reply within
+ * BINPROTO_MIN_TRANSFER_SIZE bytes.
+ */
+#define BINPROTO_HASH_PAYLOAD_SIZE  4
+#define BINPROTO_MIN_HASH_PAGE_SIZE 256
+#define BINPROTO_MAX_HASH_PAGES     1024
+
+/**
+ * Size of the payload of a Fill request.
+ */
+#define BINPROTO_FILL_PAYLOAD_SIZE 4
+
+/**
+ * Size of the payload of the reply to a Checksum request.
+ */
+#define BINPROTO_CHECKSUM_REPLY_SIZE 4
+
+/**
+ * Stores a 32-bit big-endian value at the given location.
+ */
+void binProto_putU32(unsigned char *buf, uint32_t value);
+
+/**
+ * Loads a 32-bit big-endian value from the given location.
+ */
+uint32_t binProto_getU32(const unsigned char *buf);
+
+#endif
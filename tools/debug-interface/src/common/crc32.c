@@ -0,0 +1,188 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include "crc32.h"
+
+/**
+ * Lookup tables for the reflected polynomial 0xEDB88320, generated on first
+ * use. crcTable[0] is the usual byte-wise table; crcTable[k] advances the CRC
+ * over k additional zero bytes, so eight bytes can be processed at once.
+ */
+static uint32_t crcTable[8][256];
+static int crcTableValid = 0;
+
+/**
+ * Generates the lookup tables.
+ */
+static void initTable(void) {
+  uint32_t i, j, c;
+  
+  for (i = 0; i < 256; i++) {
+    c = i;
+    for (j = 0; j < 8; j++) {
+      c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+    }
+    crcTable[0][i] = c;
+  }
+  for (i = 0; i < 256; i++) {
+    for (j = 1; j < 8; j++) {
+      crcTable[j][i] = (crcTable[j-1][i] >> 8) ^ crcTable[0][crcTable[j-1][i] & 0xFF];
+    }
+  }
+  crcTableValid = 1;
+}
+
+/**
+ * Updates a CRC-32 (the one used by zlib, Ethernet and PNG) with size bytes
+ * of data. Start with crc set to 0; the result of one call can be passed to
+ * the next to compute the CRC of data which is not contiguous in memory.
+ */
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, uint32_t size) {
+  uint32_t lo, hi;
+  
+  if (!crcTableValid) {
+    initTable();
+  }
+  
+  crc = ~crc;
+  
+  // Process eight bytes at a time.
+  while (size >= 8) {
+    lo = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24));
+    hi = (uint32_t)data[4] | ((uint32_t)data[5] << 8) | ((uint32_t)data[6] << 16) | ((uint32_t)data[7] << 24);
+    crc = crcTable[7][lo & 0xFF] ^ crcTable[6][(lo >> 8) & 0xFF]
+        ^ crcTable[5][(lo >> 16) & 0xFF] ^ crcTable[4][lo >> 24]
+        ^ crcTable[3][hi & 0xFF] ^ crcTable[2][(hi >> 8) & 0xFF]
+        ^ crcTable[1][(hi >> 16) & 0xFF] ^ crcTable[0][hi >> 24];
+    data += 8;
+    size -= 8;
+  }
+  
+  // Process the remaining bytes one at a time.
+  while (size--) {
+    crc = crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+/**
+ * Multiplies the 32x32 matrix over GF(2) stored in mat (one column per entry)
+ * with vec.
+ */
+static uint32_t gf2MatrixTimes(const uint32_t *mat, uint32_t vec) {
+  uint32_t sum = 0;
+  
+  while (vec) {
+    if (vec & 1) {
+      sum ^= *mat;
+    }
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+/**
+ * Stores the square of the 32x32 matrix over GF(2) mat in square.
+ */
+static void gf2MatrixSquare(uint32_t *square, const uint32_t *mat) {
+  int n;
+  
+  for (n = 0; n < 32; n++) {
+    square[n] = gf2MatrixTimes(mat, mat[n]);
+  }
+}
+
+/**
+ * Returns the CRC-32 of two blocks of data appended to each other, given the
+ * CRC of the first block, the CRC of the second block and the size of the
+ * second block. This allows the CRCs of parts of a range to be computed in
+ * any order and combined afterwards.
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, uint32_t size2) {
+  uint32_t even[32];
+  uint32_t odd[32];
+  uint32_t row;
+  int n;
+  
+  if (!size2) {
+    return crc1;
+  }
+  
+  // Build the operator which advances the CRC over a single zero bit.
+  odd[0] = 0xEDB88320;
+  row = 1;
+  for (n = 1; n < 32; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+  
+  // Square it twice to get the operators for two and four zero bits.
+  gf2MatrixSquare(even, odd);
+  gf2MatrixSquare(odd, even);
+  
+  // Apply size2 zero bytes to crc1, squaring the operator for every bit of
+  // size2; the first squaring gives the operator for one zero byte.
+  do {
+    gf2MatrixSquare(even, odd);
+    if (size2 & 1) {
+      crc1 = gf2MatrixTimes(even, crc1);
+    }
+    size2 >>= 1;
+    if (!size2) {
+      break;
+    }
+    gf2MatrixSquare(odd, even);
+    if (size2 & 1) {
+      crc1 = gf2MatrixTimes(odd, crc1);
+    }
+    size2 >>= 1;
+  } while (size2);
+  
+  return crc1 ^ crc2;
+}
@@ -0,0 +1,277 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "localShare.h"
+
+/**
+ * Sends the share reply with the given file descriptor to a client which
+ * connected to the local socket. Returns -1 and prints an error if something
+ * went wrong, or 0 otherwise.
+ */
+int localShare_send(int sock, int fd, unsigned long offset, unsigned long length) {
+  char str[64];
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  
+  // Format the reply.
+  sprintf(str, "OK, Share, %lX, %lX;\n", offset, length);
+  iov.iov_base = str;
+  iov.iov_len = strlen(str);
+  
+  // Attach the file descriptor.
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  
+  if (sendmsg(sock, &msg, 0) != iov.iov_len) {
+    perror("Failed to send shared memory descriptor");
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Receives the share reply from rvsrv. Returns the received file descriptor,
+ * or -1 if an error occured.
+ */
+static int receiveShare(int sock, unsigned long *offset, unsigned long *length) {
+  char str[64];
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  int size, fd = -1;
+  
+  iov.iov_base = str;
+  iov.iov_len = sizeof(str) - 1;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  
+  size = recvmsg(sock, &msg, 0);
+  if (size < 0) {
+    perror("Failed to receive shared memory descriptor from rvsrv");
+    return -1;
+  }
+  str[size] = 0;
+  
+  // Get the file descriptor, if there is one.
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+      memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  
+  // Parse the reply.
+  if ((sscanf(str, "OK, Share, %lX, %lX;", offset, length) != 2) || (fd < 0)) {
+    fprintf(stderr, "Error: received a malformed reply from the rvsrv local socket: %s\n", str);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  
+  return fd;
+}
+
+/**
+ * Connects to the local socket of rvsrv at the given path and maps the target
+ * memory. Returns -1 and prints an error if something went wrong, or 0
+ * otherwise.
+ */
+int localShare_open(const char *path, localShare_t *share) {
+  struct sockaddr_un addr;
+  unsigned long offset, length, pageSize, pageOffset;
+  int sock, fd;
+  
+  share->mapAddr = 0;
+  share->mapLength = 0;
+  share->addr = 0;
+  share->length = 0;
+  
+  // Connect to rvsrv.
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Error: local socket path %s is too long.\n", path);
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) {
+    perror("Failed to create local socket");
+    return -1;
+  }
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "Error: failed to connect to rvsrv local socket %s: ", path);
+    perror("");
+    close(sock);
+    return -1;
+  }
+  
+  // Receive the file descriptor.
+  fd = receiveShare(sock, &offset, &length);
+  close(sock);
+  if (fd < 0) {
+    return -1;
+  }
+  
+  // Map the file the same way rvsrv does.
+  pageSize = sysconf(_SC_PAGESIZE);
+  pageOffset = offset % pageSize;
+  share->mapLength = (pageOffset + length + pageSize - 1) / pageSize * pageSize;
+  share->mapAddr = (unsigned char*)mmap(
+    NULL,
+    share->mapLength,
+    PROT_READ | PROT_WRITE,
+    MAP_SHARED,
+    fd,
+    offset - pageOffset
+  );
+  close(fd);
+  if (share->mapAddr == MAP_FAILED) {
+    perror("Failed to map memory shared by rvsrv");
+    share->mapAddr = 0;
+    share->mapLength = 0;
+    return -1;
+  }
+  share->addr = share->mapAddr + pageOffset;
+  share->length = length;
+  
+  return 0;
+}
+
+/**
+ * Unmaps memory mapped by localShare_open(), if any.
+ */
+void localShare_close(localShare_t *share) {
+  if (share->mapAddr) {
+    munmap(share->mapAddr, share->mapLength);
+  }
+  share->mapAddr = 0;
+  share->mapLength = 0;
+  share->addr = 0;
+  share->length = 0;
+}
+
+/**
+ * Returns nonzero if the given range of addresses is accessible through the
+ * given mapping.
+ */
+int localShare_contains(const localShare_t *share, uint32_t address, uint32_t size) {
+  return share->addr && ((uint64_t)address + (uint64_t)size <= (uint64_t)share->length);
+}
+
+/**
+ * Reads from the mapped memory.
+ */
+void localShare_read(const localShare_t *share, uint32_t address, unsigned char *buffer, uint32_t size) {
+  const unsigned char *ptr = share->addr + address;
+  const unsigned char *end = ptr + size;
+  
+  while (ptr < end) {
+    if (((long)ptr & 3) || (ptr + 4 > end)) {
+      // ptr misaligned or less than a word remaining.
+      *buffer++ = *ptr++;
+    } else {
+      // Can do a full word at once.
+      uint32_t word = *((volatile const uint32_t*)ptr);
+      memcpy(buffer, &word, 4);
+      ptr += 4;
+      buffer += 4;
+    }
+  }
+}
+
+/**
+ * Writes to the mapped memory.
+ */
+void localShare_write(const localShare_t *share, uint32_t address, const unsigned char *buffer, uint32_t size) {
+  unsigned char *ptr = share->addr + address;
+  unsigned char *end = ptr + size;
+  
+  while (ptr < end) {
+    if (((long)ptr & 3) || (ptr + 4 > end)) {
+      // ptr misaligned or less than a word remaining.
+      *ptr++ = *buffer++;
+    } else {
+      // Can do a full word at once.
+      uint32_t word;
+      memcpy(&word, buffer, 4);
+      *((volatile uint32_t*)ptr) = word;
+      ptr += 4;
+      buffer += 4;
+    }
+  }
+}
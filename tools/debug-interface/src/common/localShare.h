@@ -0,0 +1,115 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+#ifndef _LOCAL_SHARE_H_
+#define _LOCAL_SHARE_H_
+
+#include <stdint.h>
+
+// Local access to the memory which rvsrv maps when it is started with --mmio.
+// When rvsrv is started with --local <path>, it listens for connections on a
+// Unix-domain socket at that path. Every client which connects receives the
+// text reply "OK, Share, <offset>, <length>;" along with the file descriptor
+// of the memory-mapped file (as SCM_RIGHTS ancillary data), after which the
+// connection is closed. <offset> and <length> are hexadecimal and specify the
+// byte offset within the file at which address 0 starts and the number of
+// accessible bytes. The client can then map the file itself and access the
+// target memory directly, without any rvsrv round trips.
+
+/**
+ * Local mapping of the target memory obtained from rvsrv.
+ */
+typedef struct {
+  
+  /**
+   * Start address and size of the mapping, i.e. page aligned.
+   */
+  unsigned char *mapAddr;
+  unsigned long mapLength;
+  
+  /**
+   * Pointer to target address 0 and the number of accessible bytes.
+   */
+  unsigned char *addr;
+  unsigned long length;
+  
+} localShare_t;
+
+/**
+ * Sends the share reply with the given file descriptor to a client which
+ * connected to the local socket. Returns -1 and prints an error if something
+ * went wrong, or 0 otherwise.
+ */
+int localShare_send(int sock, int fd, unsigned long offset, unsigned long length);
+
+/**
+ * Connects to the local socket of rvsrv at the given path and maps the target
+ * memory. Returns -1 and prints an error if something went wrong, or 0
+ * otherwise.
+ */
+int localShare_open(const char *path, localShare_t *share);
+
+/**
+ * Unmaps memory mapped by localShare_open(), if any.
+ */
+void localShare_close(localShare_t *share);
+
+/**
+ * Returns nonzero if the given range of addresses is accessible through the
+ * given mapping.
+ */
+int localShare_contains(const localShare_t *share, uint32_t address, uint32_t size);
+
+/**
+ * Reads from or writes to the mapped memory. Accesses are done word by word
+ * where possible, because not all devices support byte accesses. The range
+ * must be checked using localShare_contains() first.
+ */
+void localShare_read(const localShare_t *share, uint32_t address, unsigned char *buffer, uint32_t size);
+void localShare_write(const localShare_t *share, uint32_t address, const unsigned char *buffer, uint32_t size);
+
+#endif
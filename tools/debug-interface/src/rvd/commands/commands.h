@@ -122,6 +122,11 @@ int runEvaluate(commandLineArgs_t *args);
  */
 int runStop(commandLineArgs_t *args);
 
+/**
+ * Executes the "rvd serve" command.
+ */
+int runServe(commandLineArgs_t *args);
+
 /**
  * Executes the "rvd write" command.
  */
@@ -147,6 +152,11 @@ int runUpload(commandLineArgs_t *args);
  */
 int runDownload(commandLineArgs_t *args);
 
+/**
+ * Executes the "rvd verify" command.
+ */
+int runVerify(commandLineArgs_t *args);
+
 /**
  * Executes the "rvd trace" command.
  */
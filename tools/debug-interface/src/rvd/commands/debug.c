@@ -55,6 +55,7 @@
 #include "main.h"
 #include "definitions.h"
 #include "parser.h"
+#include "rvsrvInterface.h"
 
 /**
  * Executes the debug commands (break, step, continue, etc.).
@@ -119,7 +120,9 @@ int runDebug(commandLineArgs_t *args) {
     return -1;
   }
   
-  // Execute the expression.
+  // Execute the expression. The writes for all contexts are batched, so
+  // something like "rvd reset" only needs a single round trip to rvsrv.
+  rvsrv_beginBatch();
   FOR_EACH_CONTEXT(
     value_t dummyValue;
     
@@ -132,6 +135,9 @@ int runDebug(commandLineArgs_t *args) {
     }
     
   );
+  if (rvsrv_endBatch() < 0) {
+    return -1;
+  }
   
   return 0;
   
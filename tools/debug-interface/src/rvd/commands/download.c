@@ -59,20 +59,84 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "definitions.h"
 
+/**
+ * State shared with the completion callback of the page reads.
+ */
+typedef struct {
+  
+  /**
+   * Image writer for the output file.
+   */
+  void *writer;
+  
+  /**
+   * Address range which is being downloaded, for the progress bar.
+   */
+  uint32_t start;
+  uint32_t count;
+  
+} downloadState_t;
+
+/**
+ * Completion callback for the page reads, which writes the page to the file.
+ * Bus faults are reported and the fault code is written instead of the data.
+ */
+static int downloadCompleted(
+  void *data,
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  int result,
+  uint32_t faultCode
+) {
+  downloadState_t *state = (downloadState_t*)data;
+  char prefix[16];
+  
+  if (!result) {
+    int k;
+    printf(
+      "\r\033[AWarning: bus fault 0x%08X occured while reading page 0x%08X..0x%08X.\n"
+      "Bus fault code will be written to file instead of actual data.\033[K\n\n",
+      faultCode,
+      address,
+      address + size - 1
+    );
+    for (k = 0; k < (size + 3) / 4; k++) {
+      buffer[k*4+0] = faultCode >> 24;
+      buffer[k*4+1] = faultCode >> 16;
+      buffer[k*4+2] = faultCode >> 8;
+      buffer[k*4+3] = faultCode;
+    }
+  }
+  
+  // Write to the file.
+  if (imageWrite(state->writer, buffer, size, address) < 0) {
+    return -1;
+  }
+  
+  // Update the progress bar.
+  sprintf(prefix, "0x%08X ", address + size - 1);
+  progressBar(prefix, address + size - state->start, state->count, 0, 1);
+  
+  return 0;
+}
+
 /**
  * Executes the "rvd download" command.
  */
 int runDownload(commandLineArgs_t *args) {
   filetype_t ft;
-  unsigned char pageBuffer[RVSRV_PAGE_SIZE];
+  unsigned char *pageBuffers;
+  int pageSize;
+  int page;
+  downloadState_t state;
   int selectedContext = 0;
   int multipleContexts = 0;
   value_t address;
   value_t count;
-  int f;
   iterPage_t i;
   char prefix[16];
   value_t dummyValue;
@@ -91,6 +155,7 @@ int runDownload(commandLineArgs_t *args) {
       "can be one of the following values.\n"
       "\n"
       " - \"srec\" or \"s\": Motorola S-record file.\n"
+      " - \"ihex\", \"hex\" or \"i\": Intel HEX file.\n"
       " - \"bin\" or \"b\": straight binary, no format.\n"
       "\n"
       "Unlike most commands, download cannot be run with multiple contexts selected,\n"
@@ -105,6 +170,7 @@ int runDownload(commandLineArgs_t *args) {
   ft = interpretFiletype(args->params[0]);
   if (ft == FT_UNKNOWN) {
     printf("Error: unsupported file type %s.\n", args->params[0]);
+    return -1;
   }
   
   // Determine which contexts we should use and crash if multiple contexts are
@@ -144,10 +210,8 @@ int runDownload(commandLineArgs_t *args) {
   }
   
   // Open the file.
-  unlink(args->params[1]);
-  f = open(args->params[1], O_WRONLY | O_CREAT, 00644);
-  if (f < 0) {
-    perror("Failed to open file for writing");
+  state.writer = imageWriteOpen(args->params[1], ft);
+  if (!state.writer) {
     return -1;
   }
   
@@ -164,107 +228,46 @@ int runDownload(commandLineArgs_t *args) {
   sprintf(prefix, "0x%08X ", address.value);
   progressBar(prefix, 0, count.value, 1, 1);
   
-  // Write header.
-  if (ft == FT_SREC) {
-    if (srecWriteHeader(f) < 0) {
-      close(f);
-      return -1;
-    }
+  // Get buffers for as many of the largest pages rvsrv can handle as we can
+  // have in flight at once.
+  pageBuffers = rvsrv_getPageBuffers(RVSRV_ASYNC_WINDOW, &pageSize);
+  if (!pageBuffers) {
+    imageWriteClose(state.writer, 0);
+    return -1;
   }
+  state.start = address.value;
+  state.count = count.value;
   
   // Iterate over the rvsrv pages which need to be updated to perform
   // this request. iterPage and iterPageInit will ensure that all pages
-  // except for the first and last are aligned.
-  i = iterPageInit(address.value, count.value, RVSRV_PAGE_SIZE);
+  // except for the first and last are aligned. The reads are pipelined;
+  // downloadCompleted() writes the pages to the file in order as their data
+  // arrives. Each read in flight gets its own buffer.
+  i = iterPageInit(address.value, count.value, pageSize);
+  page = 0;
   while (iterPage(&i)) {
+    unsigned char *pageBuffer = pageBuffers + (page % RVSRV_ASYNC_WINDOW) * pageSize;
     
-    uint32_t fault;
-    uint32_t curAddress;
-    int retval;
-    int remain;
-    unsigned char *ptr;
-    
-    // Perform the bulk read operation.
-    retval = rvsrv_readBulk(i.address, pageBuffer, i.numBytes, &fault);
-    if (retval < 0) {
-      close(f);
+    // Issue the bulk read operation.
+    if (rvsrv_readAsync(i.address, pageBuffer, i.numBytes, downloadCompleted, &state) < 0) {
+      imageWriteClose(state.writer, 0);
       return -1;
-    } else if (retval == 0) {
-      int k;
-      printf(
-        "\r\033[AWarning: bus fault 0x%08X occured while reading page 0x%08X..0x%08X.\n"
-        "Bus fault code will be written to file instead of actual data.\033[K\n\n",
-        fault,
-        i.address,
-        i.address + i.numBytes - 1
-      );
-      for (k = 0; k < RVSRV_PAGE_SIZE / 4; k++) {
-        pageBuffer[k*4+0] = fault >> 24;
-        pageBuffer[k*4+1] = fault >> 16;
-        pageBuffer[k*4+2] = fault >> 8;
-        pageBuffer[k*4+3] = fault;
-      }
-    }
-    
-    //hexdump(i.address, pageBuffer, i.numBytes, !retval, first ? HEXDUMP_PROLOGUE : HEXDUMP_CONTENT);
-    
-    // Call the write method for the selected filetype until all data has
-    // been written.
-    remain = i.numBytes;
-    ptr = pageBuffer;
-    curAddress = i.address;
-    while (remain) {
-      int count = 0;
-      
-      // Write to the file.
-      if (ft == FT_STRAIGHT) {
-        count = write(f, ptr, remain);
-      } else if (ft == FT_SREC) {
-        count = srecWrite(f, ptr, remain, curAddress);
-      }
-      
-      // Check for errors.
-      if (count < 0) {
-        if (ft == FT_STRAIGHT) {
-          perror("Could not write to output file");
-        }
-        close(f);
-        return -1;
-      } else if (count == 0) {
-        if (ft == FT_STRAIGHT) {
-          fprintf(stderr, "Could not write to output file.\n");
-        }
-        close(f);
-        return -1;
-      }
-      
-      // Update counters.
-      ptr += count;
-      remain -= count;
-      curAddress += count;
-      
     }
-      
-    // Update the progress bar.
-    sprintf(prefix, "0x%08X ", i.address + i.numBytes - 1);
-    progressBar(prefix, (count.value - i.remain) + i.numBytes, count.value, 0, 1);
+    page++;
     
   }
   
-  // Write footer.
-  if (ft == FT_SREC) {
-    if (srecWriteFooter(f) < 0) {
-      close(f);
-      return -1;
-    }
+  // Wait for the last reads to complete.
+  if (rvsrv_flushAsync() < 0) {
+    imageWriteClose(state.writer, 0);
+    return -1;
   }
   
   // Print an extra newline after the operation to keep things clean.
   printf("\n");
   
-  // Close the file.
-  close(f);
-  return 0;
+  // Write the footer and close the file.
+  return imageWriteClose(state.writer, 1);
   
 }
 
@@ -57,7 +57,7 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands.h"
 #include "definitions.h"
@@ -88,6 +88,7 @@ int runEvaluate(commandLineArgs_t *args) {
     return 0;
   }
   
+  rvsrv_beginBatch();
   FOR_EACH_CONTEXT(
     
     value_t value;
@@ -127,6 +128,9 @@ int runEvaluate(commandLineArgs_t *args) {
     }
     
   );
+  if (rvsrv_endBatch() < 0) {
+    return -1;
+  }
   
   return 0;
   
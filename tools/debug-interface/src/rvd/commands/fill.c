@@ -57,16 +57,21 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands.h"
 #include "definitions.h"
 
+/**
+ * Number of bytes filled with a single rvsrv_fill() call, which determines
+ * how often the progress bar is updated.
+ */
+#define FILL_CHUNK_SIZE (16*1024*1024)
+
 /**
  * Executes the "rvd fill" command.
  */
 int runFill(commandLineArgs_t *args) {
-  unsigned char pageBuffer[RVSRV_PAGE_SIZE];
   
   if (isHelp(args) || (args->paramCount < 2) || (args->paramCount > 3)) {
     printf(
@@ -115,21 +120,18 @@ int runFill(commandLineArgs_t *args) {
       value.value = 0;
     }
     
-    // Fill the buffer with the given value.
-    memset(pageBuffer, value.value, RVSRV_PAGE_SIZE);
-    
     // Don't do anything if count is zero.
     if (count.value == 0) {
       printf("Context %d: requested 0 bytes to be written.\n", ctxt);
     } else {
       
-      iterPage_t i;
+      uint32_t done;
       char prefix[16];
       
       printf(
         "Context %d: writing %02hhX to 0x%08X..0x%08X...\n",
         ctxt,
-        pageBuffer[0],
+        (unsigned char)value.value,
         address.value,
         address.value + count.value - 1
       );
@@ -138,34 +140,40 @@ int runFill(commandLineArgs_t *args) {
       sprintf(prefix, "0x%08X ", address.value);
       progressBar(prefix, 0, count.value, 1, 1);
       
-      // Iterate over the rvsrv pages which need to be updated to perform
-      // this request. iterPage and iterPageInit will ensure that all pages
-      // except for the first and last are aligned.
-      i = iterPageInit(address.value, count.value, RVSRV_PAGE_SIZE);
-      while (iterPage(&i)) {
+      // Fill the range in chunks to update the progress bar. rvsrv fills the
+      // memory by itself if it can, so only the requests are sent.
+      done = 0;
+      while (done < count.value) {
+        uint32_t chunkAddress = address.value + done;
+        uint32_t chunkSize = count.value - done;
+        uint32_t faultCode;
         
-        uint32_t fault;
-        int retval;
+        if (chunkSize > FILL_CHUNK_SIZE) {
+          chunkSize = FILL_CHUNK_SIZE;
+        }
         
-        // Perform the bulk write operation.
-        retval = rvsrv_writeBulk(i.address, pageBuffer, i.numBytes, &fault);
-        if (retval < 0) {
-          return -1;
-        } else if (retval == 0) {
-          
-          // Override the previous line in the terminal, which is the
-          // progress bar.
-          printf(
-            "\r\033[AWarning: bus fault 0x%08X occured while writing page 0x%08X..0x%08X.\033[K\n\n",
-            fault,
-            i.address,
-            i.address + i.numBytes - 1
-          );
+        switch (rvsrv_fill(chunkAddress, chunkSize, value.value, &faultCode)) {
+          case 0:
+            
+            // Override the previous line in the terminal, which is the
+            // progress bar.
+            printf(
+              "\r\033[AWarning: bus fault 0x%08X occured while writing 0x%08X..0x%08X.\033[K\n\n",
+              faultCode,
+              chunkAddress,
+              chunkAddress + chunkSize - 1
+            );
+            break;
+            
+          case -1:
+            return -1;
+            
         }
+        done += chunkSize;
         
         // Update the progress bar.
-        sprintf(prefix, "0x%08X ", i.address + i.numBytes - 1);
-        progressBar(prefix, (count.value - i.remain) + i.numBytes, count.value, 0, 1);
+        sprintf(prefix, "0x%08X ", chunkAddress + chunkSize - 1);
+        progressBar(prefix, done, count.value, 0, 1);
         
       }
       
@@ -57,17 +57,50 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands.h"
 #include "definitions.h"
 
+/**
+ * Completion callback for the page reads of a bulk read, which dumps the page
+ * to stdout. data points to a flag which is set until the first page has been
+ * dumped.
+ */
+static int readCompleted(
+  void *data,
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  int result,
+  uint32_t faultCode
+) {
+  int *first = (int*)data;
+  
+  if (!result) {
+    int k;
+    for (k = 0; k < (size + 3) / 4; k++) {
+      buffer[k*4+0] = faultCode >> 24;
+      buffer[k*4+1] = faultCode >> 16;
+      buffer[k*4+2] = faultCode >> 8;
+      buffer[k*4+3] = faultCode;
+    }
+  }
+  
+  // Dump the data to stdout.
+  hexdump(address, buffer, size, !result, *first ? HEXDUMP_PROLOGUE : HEXDUMP_CONTENT);
+  *first = 0;
+  
+  return 0;
+}
+
 /**
  * Executes the "rvd read" command.
  */
 int runRead(commandLineArgs_t *args) {
   int size;
-  unsigned char pageBuffer[RVSRV_PAGE_SIZE];
+  unsigned char *pageBuffers;
+  int pageSize;
   
   if (isHelp(args) || (args->paramCount < 1) || (args->paramCount > 3)) {
     printf(
@@ -158,37 +191,39 @@ int runRead(commandLineArgs_t *args) {
         
         iterPage_t i;
         int first;
+        int page;
+        
+        // Get buffers for as many of the largest pages rvsrv can handle as
+        // we can have in flight at once.
+        pageBuffers = rvsrv_getPageBuffers(RVSRV_ASYNC_WINDOW, &pageSize);
+        if (!pageBuffers) {
+          return -1;
+        }
         
         printf("Context %d: dumping 0x%08X..0x%08X...\n\n", ctxt, address.value, address.value + count.value * size - 1);
         
         // Iterate over the rvsrv pages which need to be updated to perform
         // this request. iterPage and iterPageInit will ensure that all pages
-        // except for the first and last are aligned.
-        i = iterPageInit(address.value, count.value * size, RVSRV_PAGE_SIZE);
+        // except for the first and last are aligned. The reads are
+        // pipelined; readCompleted() dumps the pages in order as their data
+        // arrives. Each read in flight gets its own buffer.
+        i = iterPageInit(address.value, count.value * size, pageSize);
         first = 1;
+        page = 0;
         while (iterPage(&i)) {
+          unsigned char *pageBuffer = pageBuffers + (page % RVSRV_ASYNC_WINDOW) * pageSize;
           
-          uint32_t fault;
-          int retval;
-          
-          // Perform the bulk read operation.
-          retval = rvsrv_readBulk(i.address, pageBuffer, i.numBytes, &fault);
-          if (retval < 0) {
+          // Issue the bulk read operation.
+          if (rvsrv_readAsync(i.address, pageBuffer, i.numBytes, readCompleted, &first) < 0) {
             return -1;
-          } else if (retval == 0) {
-            int k;
-            for (k = 0; k < RVSRV_PAGE_SIZE / 4; k++) {
-              pageBuffer[k*4+0] = fault >> 24;
-              pageBuffer[k*4+1] = fault >> 16;
-              pageBuffer[k*4+2] = fault >> 8;
-              pageBuffer[k*4+3] = fault;
-            }
           }
+          page++;
           
-          // Dump the data to stdout.
-          hexdump(i.address, pageBuffer, i.numBytes, !retval, first ? HEXDUMP_PROLOGUE : HEXDUMP_CONTENT);
-          first = 0;
-          
+        }
+        
+        // Wait for the last reads to complete.
+        if (rvsrv_flushAsync() < 0) {
+          return -1;
         }
         
         // Dump the last line.
@@ -57,7 +57,7 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands.h"
 
@@ -0,0 +1,115 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main.h"
+#include "definitions.h"
+#include "session.h"
+#include "rvsrvInterface.h"
+#include "commands.h"
+
+/**
+ * Executes the "rvd serve" command.
+ */
+int runServe(commandLineArgs_t *args) {
+  
+  if (isHelp(args) || (args->paramCount != 1)) {
+    printf(
+      "\n"
+      "Command usage:\n"
+      "  rvd serve <socket>\n"
+      "\n"
+      "This command starts an rvd session server, which listens on a Unix-domain\n"
+      "socket at the given path until it is terminated. When the RVD_SESSION\n"
+      "environment variable is set to this path, rvd forwards its command line to\n"
+      "the session server instead of running the command itself. The command is\n"
+      "then run in a process forked from the session server, which inherits the\n"
+      "memory maps and definitions loaded by the session server, which compiles the\n"
+      "definitions before the first command, and its connection to rvsrv, so they\n"
+      "don't have to be loaded, parsed and made again for every command.\n"
+      "This makes scripts which run rvd many times a lot faster.\n"
+      "\n"
+      "The memory maps and definitions specified on the command line of the serve\n"
+      "command are loaded for all commands. Maps specified for a forwarded command\n"
+      "are only loaded again if they have changed since the session server loaded\n"
+      "them, or if they are not in the same order. The -p, -h and -L options of a\n"
+      "forwarded command still apply to it. Commands are run one at a time.\n"
+      "\n"
+      "If no session server is running at RVD_SESSION, rvd runs commands itself.\n"
+      "For example:\n"
+      "\n"
+      "  rvd -m core.map -m memory.map serve /tmp/rvd.sock &\n"
+      "  export RVD_SESSION=/tmp/rvd.sock\n"
+      "  rvd read DCR\n"
+      "\n"
+    );
+    return 0;
+  }
+  
+  // The session server forks to run commands, so it would end up running
+  // itself.
+  if (session_isChild()) {
+    fprintf(stderr, "Error: cannot start a session server from within a session server.\n");
+    return -1;
+  }
+  
+  // Compile the definitions loaded so far, so the commands inherit their
+  // compiled form instead of each parsing them again.
+  if (defs_compileAll() < 0) {
+    return -1;
+  }
+  
+  // Connect to rvsrv now, so the first command doesn't have to. This is not
+  // fatal; rvsrv may not be running yet.
+  rvsrv_open();
+  
+  return session_serve(args->params[0], &runCommandLine);
+  
+}
@@ -52,16 +52,24 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "main.h"
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands.h"
 #include "definitions.h"
 
+/**
+ * Interval in milliseconds at which the trace condition is evaluated and the
+ * progress is updated while rvsrv streams the trace. Without a condition, the
+ * trace ends once no data was received for this long.
+ */
+#define TRACE_POLL_MS 100
+
 static int flushTraceBuf(uint32_t address) {
   uint32_t numBytes;
   int done = 0;
@@ -99,17 +107,116 @@ static int flushTraceBuf(uint32_t address) {
   return 0;
 }
 
+/**
+ * Writes size bytes of trace data to file f. Returns -1 and prints an error if
+ * something went wrong, otherwise returns 0.
+ */
+static int writeTraceData(int f, const unsigned char *ptr, int remain) {
+  while (remain) {
+    int count;
+    
+    // Write to the file.
+    count = write(f, ptr, remain);
+    
+    // Check for errors.
+    if (count < 0) {
+      perror("Could not write to output file");
+      return -1;
+    } else if (count == 0) {
+      fprintf(stderr, "Could not write to output file.\n");
+      return -1;
+    }
+    
+    // Update counters.
+    ptr += count;
+    remain -= count;
+    
+  }
+  return 0;
+}
+
+/**
+ * Receives the trace data streamed by rvsrv and writes it to file f until
+ * the trace condition evaluates to zero or, without a condition, no more
+ * data is produced. *traceByteCount is incremented by the number of bytes
+ * received. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int streamTrace(commandLineArgs_t *args, int f, uint32_t *traceByteCount) {
+  unsigned char buffer[RVSRV_PAGE_SIZE];
+  struct timeval lastCheck, now;
+  int count, ended, received;
+  
+  gettimeofday(&lastCheck, 0);
+  received = 0;
+  while (1) {
+    
+    // Receive and store the next block of trace data.
+    count = rvsrv_traceReceive(buffer, sizeof(buffer), TRACE_POLL_MS, &ended);
+    if (count < 0) {
+      return -1;
+    }
+    if (writeTraceData(f, buffer, count) < 0) {
+      return -1;
+    }
+    *traceByteCount += count;
+    received |= count;
+    if (ended) {
+      return 0;
+    }
+    
+    // Only check whether we're done every now and then, so the check doesn't
+    // slow down receiving the data.
+    gettimeofday(&now, 0);
+    if ((now.tv_sec - lastCheck.tv_sec) * 1000 + (now.tv_usec - lastCheck.tv_usec) / 1000 < TRACE_POLL_MS) {
+      continue;
+    }
+    lastCheck = now;
+    
+    // Show that we're doing something.
+    printf("\r\033[A%d trace bytes received...\n", *traceByteCount);
+    
+    // Determine if we're done yet. Once we are, keep receiving until rvsrv
+    // has sent everything it read before the stream stopped.
+    if (args->paramCount == 3) {
+      
+      value_t value;
+      
+      // Custom condition specified, evaluate it.
+      if (evaluate(args->params[2], &value, "") < 1) {
+        return -1;
+      }
+      
+      // Stop if it evaluated to 0.
+      if (!value.value && (rvsrv_traceStop() < 0)) {
+        return -1;
+      }
+      
+    } else {
+      
+      // No custom condition, simply stop when no data was received for a
+      // while.
+      if (!received && (rvsrv_traceStop() < 0)) {
+        return -1;
+      }
+      
+    }
+    received = 0;
+    
+  }
+}
+
 /**
  * Executes the "rvd trace" command.
  */
 int runTrace(commandLineArgs_t *args) {
   unsigned char pageBuffer[RVSRV_PAGE_SIZE];
   value_t address = {0, 0};
-  uint32_t trace_size;
+  uint32_t trace_size = 0;
   int f;
   int first;
   uint32_t traceByteCount;
   int page;
+  int retval;
   
   if (isHelp(args) || (args->paramCount < 1) || (args->paramCount > 3)) {
     printf(
@@ -149,13 +256,18 @@ int runTrace(commandLineArgs_t *args) {
       "   condition (tracing terminates when it evaluates to 0). Otherwise, tracing\n"
       "   terminates when no more data is available (i.e., the program has finished\n"
       "   executing).\n"
+      "   If rvsrv supports it, it reads the trace buffers on its own and streams\n"
+      "   the data over a separate connection. In this case, [condition] is\n"
+      "   evaluated every %d ms, and without a condition tracing terminates when no\n"
+      "   data was received for %d ms.\n"
       " - 0 is written to _TRACE_CTRL for each selected context to disable tracing.\n"
       " - The trace buffer is flushed.\n"
       "\n"
       "The trace dump is a binary file, of which the format is specified in\n"
       "core_trace.vhd. Additional processing is required to get a human-readable\n"
       "trace.\n"
-      "\n", RVSRV_PAGE_SIZE*2, RVSRV_PAGE_SIZE*2, RVSRV_PAGE_SIZE_LOG2+1
+      "\n", RVSRV_PAGE_SIZE*2, RVSRV_PAGE_SIZE*2, RVSRV_PAGE_SIZE_LOG2+1,
+      TRACE_POLL_MS, TRACE_POLL_MS
     );
     return 0;
   }
@@ -165,6 +277,7 @@ int runTrace(commandLineArgs_t *args) {
   // (which might not be the case in multiprocessor systems).
   printf("Halting execution...\n");
   first = 1;
+  rvsrv_beginBatch();
   FOR_EACH_CONTEXT(
     value_t value;
     if (evaluate("_ALWAYS",     &value, "") < 1) {
@@ -199,6 +312,9 @@ int runTrace(commandLineArgs_t *args) {
     trace_size = value.value;
     first = 0;
   );
+  if (rvsrv_endBatch() < 0) {
+    return -1;
+  }
   
   // Compute and check the size of a single trace buffer.
   if ((trace_size >> 1) > RVSRV_PAGE_SIZE) {
@@ -212,6 +328,7 @@ int runTrace(commandLineArgs_t *args) {
   
   // Write to the trace control registers.
   printf("Setting up trace control flags...\n");
+  rvsrv_beginBatch();
   FOR_EACH_CONTEXT(
     value_t value;
     value_t regAddr;
@@ -245,6 +362,9 @@ int runTrace(commandLineArgs_t *args) {
     }
     
   );
+  if (rvsrv_endBatch() < 0) {
+    return -1;
+  }
   
   // Flush the trace buffer. This can be done by reading the two buffers
   // (because when you read one buffer, it resets the other). We then read
@@ -260,6 +380,7 @@ int runTrace(commandLineArgs_t *args) {
   // Resume execution.
   printf("Resuming execution...\n");
   first = 1;
+  rvsrv_beginBatch();
   FOR_EACH_CONTEXT(
     value_t value;
     if (evaluate("_ALWAYS", &value, "") < 1) {
@@ -269,6 +390,9 @@ int runTrace(commandLineArgs_t *args) {
       return -1;
     }
   );
+  if (rvsrv_endBatch() < 0) {
+    return -1;
+  }
   
   // Open the file.
   unlink(args->params[0]);
@@ -278,10 +402,25 @@ int runTrace(commandLineArgs_t *args) {
     return -1;
   }
   
-  // Run the trace.
+  // Run the trace. If rvsrv supports it, it reads the trace buffers for us
+  // and streams the data to us, so we don't need a round trip for every
+  // buffer.
   traceByteCount = 0;
   printf("0 trace bytes received...\n");
-  while (1) {
+  retval = rvsrv_traceStart(address.value, trace_size * 2, 0);
+  if (retval < 0) {
+    close(f);
+    return -1;
+  } else if (retval > 0) {
+    retval = streamTrace(args, f, &traceByteCount);
+    rvsrv_traceClose();
+    if (retval < 0) {
+      close(f);
+      return -1;
+    }
+    printf("\r\033[A%d trace bytes received...\n", traceByteCount);
+  }
+  while (!retval) {
     
     int bytesRead = 0;
     
@@ -330,27 +469,9 @@ int runTrace(commandLineArgs_t *args) {
       bytesRead += remain;
       
       // Write to the file.
-      while (remain) {
-        int count;
-        
-        // Write to the file.
-        count = write(f, ptr, remain);
-        
-        // Check for errors.
-        if (count < 0) {
-          perror("Could not write to output file");
-          close(f);
-          return -1;
-        } else if (count == 0) {
-          fprintf(stderr, "Could not write to output file.\n");
-          close(f);
-          return -1;
-        }
-        
-        // Update counters.
-        ptr += count;
-        remain -= count;
-        
+      if (writeTraceData(f, ptr, remain) < 0) {
+        close(f);
+        return -1;
       }
       
     }
@@ -393,6 +514,7 @@ int runTrace(commandLineArgs_t *args) {
   
   // Clear the trace control registers.
   printf("Resetting trace control flags...\n");
+  rvsrv_beginBatch();
   FOR_EACH_CONTEXT(
     value_t regAddr;
     uint32_t fault;
@@ -417,6 +539,9 @@ int runTrace(commandLineArgs_t *args) {
     }
     
   );
+  if (rvsrv_endBatch() < 0) {
+    return -1;
+  }
   
   // Flush the trace buffer again, to make sure the core can finish writing
   // the trace packet it may be in the middle of.
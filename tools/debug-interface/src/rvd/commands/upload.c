@@ -57,40 +57,299 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands.h"
 #include "definitions.h"
+#include "crc32.h"
+#include "binaryProtocol.h"
+
+/**
+ * Size of the pages which upload-delta compares with the memory.
+ */
+#define DELTA_PAGE_SIZE RVSRV_PAGE_SIZE
+
+/**
+ * Size of the chunks in which upload-delta reads the file. A chunk spans the
+ * maximum number of pages rvsrv_hashPages() can handle, so the memory of a
+ * whole chunk is compared with a single request.
+ */
+#define DELTA_CHUNK_SIZE (RVSRV_MAX_HASH_PAGES * DELTA_PAGE_SIZE)
+
+/**
+ * Completion callback for the page writes, which warns about bus faults.
+ */
+static int uploadCompleted(
+  void *data,
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  int result,
+  uint32_t faultCode
+) {
+  if (!result) {
+    
+    // Override the previous line in the terminal, which is the progress bar.
+    printf(
+      "\r\033[AWarning: bus fault 0x%08X occured while writing page 0x%08X..0x%08X.\033[K\n\n",
+      faultCode,
+      address,
+      address + size - 1
+    );
+  }
+  return 0;
+}
+
+/**
+ * Writes size bytes to address using asynchronous writes of at most pageSize
+ * bytes each. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int writeRun(uint32_t address, unsigned char *buffer, int size, int pageSize) {
+  while (size) {
+    int count = (size < pageSize) ? size : pageSize;
+    if (rvsrv_writeAsync(address, buffer, count, uploadCompleted, 0) < 0) {
+      return -1;
+    }
+    address += count;
+    buffer += count;
+    size -= count;
+  }
+  return 0;
+}
+
+/**
+ * Writes size bytes to address for upload-delta, skipping the pages of
+ * DELTA_PAGE_SIZE bytes which the memory already contains according to their
+ * CRC. size may be at most DELTA_CHUNK_SIZE; the writes are split up into
+ * pages of pageSize bytes. Adds the number of bytes which were skipped to
+ * *skipped. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int writeDelta(uint32_t address, unsigned char *buffer, int size, int pageSize, int *skipped) {
+  uint32_t crcs[RVSRV_MAX_HASH_PAGES];
+  uint32_t faultCode;
+  int offset, runStart, page;
+  
+  // Have rvsrv compute the CRCs of the pages in memory. If it can't read
+  // them, just write everything; the write will report the fault if there is
+  // one. This waits for the writes of the previous chunk to complete, which
+  // is why the chunks are as large as a single request can hash.
+  switch (rvsrv_hashPages(address, size, DELTA_PAGE_SIZE, crcs, &faultCode)) {
+    case 1:
+      break;
+    case 0:
+      return writeRun(address, buffer, size, pageSize);
+    default:
+      return -1;
+  }
+  
+  // Write the runs of consecutive pages which differ.
+  runStart = -1;
+  for (offset = 0, page = 0; offset < size; offset += DELTA_PAGE_SIZE, page++) {
+    int count = (size - offset < DELTA_PAGE_SIZE) ? size - offset : DELTA_PAGE_SIZE;
+    if (crc32_update(0, buffer + offset, count) != crcs[page]) {
+      if (runStart < 0) {
+        runStart = offset;
+      }
+      continue;
+    }
+    *skipped += count;
+    if (runStart >= 0) {
+      if (writeRun(address + runStart, buffer + runStart, offset - runStart, pageSize) < 0) {
+        return -1;
+      }
+      runStart = -1;
+    }
+  }
+  if (runStart >= 0) {
+    return writeRun(address + runStart, buffer + runStart, size - runStart, pageSize);
+  }
+  
+  return 0;
+}
+
+/**
+ * Zeroes the address ranges which the image needs zeroed after the data has
+ * been written, i.e. the .bss areas of an ELF file. offset is added to all
+ * addresses. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int zeroRanges(void *image, uint32_t offset) {
+  uint32_t address, size, faultCode;
+  int total = 0;
+  int index;
+  
+  for (index = 0; imageReadZeroRange(image, index, &address, &size); index++) {
+    address += offset;
+    switch (rvsrv_fill(address, size, 0, &faultCode)) {
+      case 1:
+        break;
+      case 0:
+        printf(
+          "Warning: bus fault 0x%08X occured while zeroing 0x%08X..0x%08X.\n",
+          faultCode,
+          address,
+          address + size - 1
+        );
+        break;
+      default:
+        return -1;
+    }
+    total += size;
+  }
+  
+  if (total) {
+    printf("Zeroed %d bytes of .bss.\n", total);
+  }
+  return 0;
+}
+
+/**
+ * Writes the program arguments to the __argc, __argv and __argv_end symbols
+ * of an ELF file, the same way runrvex does. argv[0] is set to the filename.
+ * offset is added to all addresses. Returns -1 if an error occured, or 0
+ * otherwise.
+ */
+static int setupArguments(void *image, uint32_t offset, const char *filename, const char **params, int paramCount) {
+  uint32_t argcAddr, argvAddr, argvEnd;
+  unsigned char argcBuf[4];
+  unsigned char *buf;
+  uint32_t size, stringOffset;
+  int argc = paramCount + 1;
+  int pageSize;
+  int i;
+  
+  // Look up the symbols. If the program doesn't define them, it doesn't
+  // take arguments.
+  for (i = 0; i < 3; i++) {
+    static const char *names[3] = {"__argc", "__argv", "__argv_end"};
+    uint32_t *values[3] = {&argcAddr, &argvAddr, &argvEnd};
+    switch (imageReadSymbol(image, names[i], values[i])) {
+      case 1:
+        break;
+      case 0:
+        if (paramCount) {
+          printf("Warning: the program does not define __argc, __argv and __argv_end, so the\n"
+                 "arguments were ignored.\n");
+        }
+        return 0;
+      default:
+        return -1;
+    }
+  }
+  
+  // Make sure the arguments fit. __argv is filled with the argument
+  // pointers, a null pointer and then the strings.
+  size = 4 * (argc + 1);
+  size += strlen(filename) + 1;
+  for (i = 0; i < paramCount; i++) {
+    size += strlen(params[i]) + 1;
+  }
+  if (size > argvEnd - argvAddr) {
+    fprintf(stderr,
+      "Error: the program arguments take up %d bytes, but the program only has room\n"
+      "for %d.\n",
+      size, argvEnd - argvAddr
+    );
+    return -1;
+  }
+  
+  // Build the contents of __argv.
+  buf = (unsigned char*)malloc(size);
+  if (!buf) {
+    perror("Failed to allocate memory for program arguments");
+    return -1;
+  }
+  stringOffset = 4 * (argc + 1);
+  for (i = 0; i < argc; i++) {
+    const char *arg = i ? params[i - 1] : filename;
+    binProto_putU32(buf + 4 * i, argvAddr + offset + stringOffset);
+    strcpy((char*)buf + stringOffset, arg);
+    stringOffset += strlen(arg) + 1;
+  }
+  binProto_putU32(buf + 4 * argc, 0);
+  binProto_putU32(argcBuf, argc);
+  
+  // Write __argv and __argc.
+  pageSize = rvsrv_getPageSize();
+  if (pageSize < 0) {
+    free(buf);
+    return -1;
+  }
+  for (i = 0; i < size; i += pageSize) {
+    int count = (size - i < pageSize) ? size - i : pageSize;
+    if (rvsrv_writeAsync(argvAddr + offset + i, buf + i, count, uploadCompleted, 0) < 0) {
+      free(buf);
+      return -1;
+    }
+  }
+  free(buf);
+  if (rvsrv_writeAsync(argcAddr + offset, argcBuf, 4, uploadCompleted, 0) < 0) {
+    return -1;
+  }
+  if (rvsrv_flushAsync() < 0) {
+    return -1;
+  }
+  
+  printf("Passed %d program argument%s.\n", argc, (argc == 1) ? "" : "s");
+  return 0;
+}
 
 /**
  * Executes the "rvd upload" command.
  */
 int runUpload(commandLineArgs_t *args) {
   filetype_t ft;
-  unsigned char pageBuffer[RVSRV_PAGE_SIZE];
+  unsigned char *pageBuffer;
+  unsigned char *deltaBuffer = 0;
+  int pageSize;
+  int delta = !strcmp(args->command, "upload-delta") || !strcmp(args->command, "upd");
   
-  if (isHelp(args) || (args->paramCount < 2) || (args->paramCount > 3)) {
+  if (isHelp(args) || (args->paramCount < 2)
+    || ((args->paramCount > 3) && (interpretFiletype(args->params[0]) != FT_ELF))
+  ) {
     printf(
       "\n"
       "Command usage:\n"
       "  rvd upload <filetype> <filename> [address]\n"
       "  rvd up <filetype> <filename> [address]\n"
+      "  rvd upload-delta <filetype> <filename> [address]\n"
+      "  rvd upd <filetype> <filename> [address]\n"
+      "  rvd upload elf <filename> <address> [arguments ...]\n"
       "\n"
       "This command uploads <filename> to the hardware, parsing the file with the\n"
       "format specified by <filetype>, which must be one of the following.\n"
       "\n"
       " - \"srec\" or \"s\": Motorola S-record file.\n"
+      " - \"ihex\", \"hex\" or \"i\": Intel HEX file.\n"
+      " - \"elf\" or \"e\": 32-bit ELF file; the PT_LOAD segments are loaded at their\n"
+      "   physical addresses.\n"
       " - \"bin\" or \"b\": straight binary, no format.\n"
       "\n"
       "The optional address parameter specifies where the contents of the file should\n"
       "be written to. For straight binary files, this markes the start address; for\n"
-      "S-record files (which have embedded addresses), this address is added to all\n"
-      "addresses in the S-record.\n"
+      "the other file types (which have embedded addresses), this address is added to\n"
+      "all addresses in the file.\n"
+      "\n"
+      "ELF segments which are adjacent in memory are written together, and the parts\n"
+      "of the segments which are not stored in the file (.bss) are zeroed without\n"
+      "sending the zeros from here. If the program defines the __argc, __argv and\n"
+      "__argv_end symbols, its command line arguments are written to them like\n"
+      "runrvex does: argv[0] is set to <filename>, and any parameters after the\n"
+      "address are passed as the remaining arguments.\n"
       "\n"
       "Like all commands, upload is run for every selected context. The specified\n"
       "is guaranteed to be evaluated exactly once before the file is loaded, allowing\n"
       "it to perform bank selection operations as required.\n"
       "\n"
+      "upload-delta only writes the parts of the file which differ from what is in\n"
+      "memory already, which is a lot faster when only a small part of a large\n"
+      "program changed. The memory is compared in %d-byte pages by CRC-32, which\n"
+      "rvsrv computes without sending the memory contents, as long as it is recent\n"
+      "enough to support this. The file is read in chunks of up to %d bytes, the\n"
+      "CRCs of which are requested at once. This waits for the writes of the\n"
+      "previous chunk to complete, so upload-delta takes at least one round trip to\n"
+      "rvsrv per chunk.\n"
+      "\n",
+      DELTA_PAGE_SIZE, DELTA_CHUNK_SIZE
     );
     return 0;
   }
@@ -99,22 +358,35 @@ int runUpload(commandLineArgs_t *args) {
   ft = interpretFiletype(args->params[0]);
   if (ft == FT_UNKNOWN) {
     printf("Error: unsupported file type %s.\n", args->params[0]);
+    return -1;
+  }
+  
+  // Allocate a buffer for a chunk of the file for upload-delta.
+  if (delta) {
+    deltaBuffer = (unsigned char*)malloc(DELTA_CHUNK_SIZE);
+    if (!deltaBuffer) {
+      perror("Failed to allocate memory for upload buffer");
+      return -1;
+    }
   }
   
   FOR_EACH_CONTEXT(
     
     iterPage_t i;
     void *fileReaderState;
-    int f;
+    unsigned char *buffer;
+    int chunkSize;
     int fileSize;
     uint32_t address;
     int totalFileBytes;
     int totalDataBytes;
+    int skippedBytes;
     char prefix[16];
     value_t dummyValue;
     
     // Execute the _ALWAYS definition.
     if (evaluate("_ALWAYS", &dummyValue, "") < 1) {
+      free(deltaBuffer);
       return -1;
     }
     
@@ -122,6 +394,7 @@ int runUpload(commandLineArgs_t *args) {
     if (args->paramCount > 2) {
       value_t addressVal;
       if (evaluate(args->params[2], &addressVal, "") < 1) {
+        free(deltaBuffer);
         return -1;
       }
       address = addressVal.value;
@@ -129,108 +402,79 @@ int runUpload(commandLineArgs_t *args) {
       address = 0;
     }
     
-    // Give a little feedback.
-    printf("Uploading file to 0x%08X for context %d...\n", address, ctxt);
+    // Get a buffer for the largest page rvsrv can handle.
+    pageBuffer = rvsrv_getPageBuffer(&pageSize);
+    if (!pageBuffer) {
+      free(deltaBuffer);
+      return -1;
+    }
     
-    // Try to open the file.
-    f = open(args->params[1], O_RDONLY);
-    if (f < 0) {
-      perror("Failed to open input file");
+    // upload-delta reads the file in larger chunks, so it needs fewer Hash
+    // requests. Its writes are still split up into pages.
+    if (delta) {
+      buffer = deltaBuffer;
+      chunkSize = DELTA_CHUNK_SIZE;
+    } else {
+      buffer = pageBuffer;
+      chunkSize = pageSize;
     }
     
-    // Try to determine the size of the file.
-    fileSize = lseek(f, 0, SEEK_END);
-    if (fileSize == (off_t)-1) {
-      
-      // Can't seek, so we don't know the filesize. Maybe it's a stream of
-      // some sort - we can still read from the file probably, which is all
-      // we need, we just can't draw a normal progress bar now.
-      fileSize = 0;
-      
-    } else if (lseek(f, 0, SEEK_SET) == (off_t)-1) {
-      perror("Could not seek back to start of file");
-      close(f);
+    // Give a little feedback.
+    printf("Uploading file to 0x%08X for context %d...\n", address, ctxt);
+    
+    // Open the file.
+    fileReaderState = imageReadOpen(args->params[1], ft);
+    if (!fileReaderState) {
+      free(deltaBuffer);
       return -1;
     }
+    fileSize = imageReadSize(fileReaderState);
     
     // Initialize counters.
     totalFileBytes = 0;
     totalDataBytes = 0;
-    
-    // Initialize the file type reader.
-    if (ft == FT_SREC) {
-      if (!(fileReaderState = srecReadInit())) {
-        return -1;
-      }
-    }
+    skippedBytes = 0;
     
     // Start printing the progress bar.
     sprintf(prefix, "0x%08X ", address);
     progressBar(prefix, 0, fileSize, 1, 1);
     
-    // Iterate over rvsrv pages starting at the current address. We don't
-    // know exactly how much we're going to write, so we just set that to a
-    // bogus value and make sure it doesn't run out.
-    i = iterPageInit(address, RVSRV_PAGE_SIZE * 2, RVSRV_PAGE_SIZE);
+    // Iterate over chunks starting at the current address. We don't know
+    // exactly how much we're going to write, so we just set that to a bogus
+    // value and make sure it doesn't run out.
+    i = iterPageInit(address, chunkSize * 2, chunkSize);
     while (iterPage(&i)) {
       int remain = i.numBytes;
-      unsigned char *ptr = pageBuffer;
-      int retval;
-      uint32_t fault;
+      unsigned char *ptr = buffer;
       i.numBytes = 0;
       i.stopOffs = i.startOffs;
       
       // Make sure the page iterator doesn't run out.
-      i.remain = RVSRV_PAGE_SIZE * 2;
+      i.remain = chunkSize * 2;
       
       // Read into the buffer.
       while (remain) {
-        int count = 0;
+        int count;
         
-        if (ft == FT_STRAIGHT) {
-          
-          // Just read straight from the file.
-          count = read(f, ptr, remain);
-          if (count < 0) {
-            perror("Failed to read from input file");
-            close(f);
-            return -1;
-          } else if (count == 0) {
-            
-            // End of file reached: set remain to the number of bytes which
-            // we're about to upload so the page iterator will stop.
-            i.remain = i.numBytes;
-            break;
-            
-          }
-          
-          // Update the bytes read counter.
-          totalFileBytes += count;
-          
-        } else if (ft == FT_SREC) {
-          
-          // Call the srec read method. 
-          count = srecRead(fileReaderState, f, ptr, remain, i.address - address);
-          if (count < 0) {
-            close(f);
-            srecReadFree(fileReaderState);
-            return -1;
-          } else if (count == 0) {
-            
-            // If count is zero, it's either because we've reached the end of
-            // the file or because a noncontiguous address was encountered.
-            // We'll check for the address jump later - either way, we need
-            // to stop filling the buffer now.
-            break;
-            
-          }
+        // Call the image read method.
+        count = imageRead(fileReaderState, ptr, remain, i.address - address);
+        if (count < 0) {
+          rvsrv_flushAsync();
+          imageReadClose(fileReaderState);
+          free(deltaBuffer);
+          return -1;
+        } else if (count == 0) {
           
-          // Update the bytes read counter.
-          totalFileBytes += srecReadProgressDelta(fileReaderState);
+          // If count is zero, it's either because we've reached the end of
+          // the file or because a noncontiguous address was encountered.
+          // We'll check for the address jump later - either way, we need
+          // to stop filling the buffer now.
+          break;
           
         }
         
         // Update counters.
+        totalFileBytes += imageReadProgressDelta(fileReaderState);
         totalDataBytes += count;
         i.numBytes += count;
         i.stopOffs += count;
@@ -239,73 +483,80 @@ int runUpload(commandLineArgs_t *args) {
         
       }
       
-      // If we have bytes available, perform the write.
+      // If we have bytes available, issue the write. The writes are
+      // pipelined, so we can read the next page from the file while this one
+      // is still in flight.
       if (i.numBytes) {
-        
-        // Perform the bulk write operation.
-        retval = rvsrv_writeBulk(i.address, pageBuffer, i.numBytes, &fault);
+        int retval;
+        if (delta) {
+          retval = writeDelta(i.address, buffer, i.numBytes, pageSize, &skippedBytes);
+        } else {
+          retval = rvsrv_writeAsync(i.address, buffer, i.numBytes, uploadCompleted, 0);
+        }
         if (retval < 0) {
-          close(f);
-          if (ft == FT_SREC) {
-            srecReadFree(fileReaderState);
-          }
+          imageReadClose(fileReaderState);
+          free(deltaBuffer);
           return -1;
-        } else if (retval == 0) {
-          
-          // Override the previous line in the terminal, which is the
-          // progress bar.
-          printf(
-            "\r\033[AWarning: bus fault 0x%08X occured while writing page 0x%08X..0x%08X.\033[K\n\n",
-            fault,
-            i.address,
-            i.address + i.numBytes - 1
-          );
         }
-        
       }
       
       // Update the progress bar.
       sprintf(prefix, "0x%08X ", i.address + i.numBytes - 1);
       progressBar(prefix, totalFileBytes, fileSize, 0, 1);
         
-      // See if we need to change the address or if we're at the end of
-      // whatever file type we're reading.
-      if (ft == FT_SREC) {
-        
-        // Stop iterating if we're at the end of the file.
-        if (srecReadEof(fileReaderState)) {
-          i.remain = i.numBytes;
-        }
-        
-        // Change address to whatever the srec wants it to be. Note that the
-        // iterate method will add i.numBytes to the address to update it,
-        // which we don't want, so we do the reverse operation here.
-        i.address = (srecReadExpectedAddress(fileReaderState) + address) - i.numBytes;
-        
+      // Stop iterating if we're at the end of the file.
+      if (imageReadEof(fileReaderState)) {
+        i.remain = i.numBytes;
       }
       
+      // Change address to whatever the file wants it to be. Note that the
+      // iterate method will add i.numBytes to the address to update it,
+      // which we don't want, so we do the reverse operation here.
+      i.address = (imageReadExpectedAddress(fileReaderState) + address) - i.numBytes;
+      
     }
     
-    // Free the file type reader state.
-    if (ft == FT_SREC) {
-      srecReadFree(fileReaderState);
+    // Wait for the last writes to complete.
+    if (rvsrv_flushAsync() < 0) {
+      imageReadClose(fileReaderState);
+      free(deltaBuffer);
+      return -1;
     }
-    fileReaderState = 0;
     
     // Finish the progress indicator.
     progressBar(prefix, fileSize, fileSize, 0, 0);
     
     // Show how many bytes we've uploaded and 
-    printf("Uploaded %d bytes.\n", totalDataBytes);
+    if (delta) {
+      printf("Uploaded %d bytes, %d of which were already up to date.\n", totalDataBytes, skippedBytes);
+    } else {
+      printf("Uploaded %d bytes.\n", totalDataBytes);
+    }
+    
+    // Zero the .bss areas and set up the program arguments for ELF files.
+    // The arguments follow the address, so there are none if no address was
+    // specified.
+    if (ft == FT_ELF) {
+      int argCount = (args->paramCount > 3) ? args->paramCount - 3 : 0;
+      if ((zeroRanges(fileReaderState, address) < 0)
+        || (setupArguments(fileReaderState, address, args->params[1], args->params + 3, argCount) < 0)
+      ) {
+        imageReadClose(fileReaderState);
+        free(deltaBuffer);
+        return -1;
+      }
+    }
+    
+    // Free the file type reader state.
+    imageReadClose(fileReaderState);
+    fileReaderState = 0;
     
     // Print a newline to separate the contexts.
     printf("\n");
     
-    // Close the file.
-    close(f);
-    
   );
   
+  free(deltaBuffer);
   return 0;
   
 }
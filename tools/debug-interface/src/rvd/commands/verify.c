@@ -0,0 +1,356 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "parser.h"
+#include "types.h"
+#include "utils.h"
+#include "image.h"
+#include "crc32.h"
+#include "rvsrvInterface.h"
+#include "commands.h"
+#include "definitions.h"
+
+/**
+ * Size of the pages which are compared when a chunk differs, and the size of
+ * the chunks which are compared as a whole. A chunk spans the maximum number
+ * of pages rvsrv_hashPages() can handle, so a differing chunk can be narrowed
+ * down with a single request.
+ */
+#define VERIFY_PAGE_SIZE RVSRV_PAGE_SIZE
+#define VERIFY_CHUNK_SIZE (RVSRV_MAX_HASH_PAGES * VERIFY_PAGE_SIZE)
+
+/**
+ * Reports a range of memory which differs from the file.
+ */
+static void reportMismatch(uint32_t start, uint32_t end) {
+  
+  // Override the previous line in the terminal, which is the progress bar.
+  printf(
+    "\r\033[AMismatch at 0x%08X..0x%08X.\033[K\n\n",
+    start,
+    end
+  );
+}
+
+/**
+ * Reports a range of memory which could not be read.
+ */
+static void reportFault(uint32_t start, uint32_t end, uint32_t faultCode) {
+  
+  // Override the previous line in the terminal, which is the progress bar.
+  printf(
+    "\r\033[AWarning: bus fault 0x%08X occured while verifying 0x%08X..0x%08X.\033[K\n\n",
+    faultCode,
+    start,
+    end
+  );
+}
+
+/**
+ * Compares size bytes of image data in buffer with the memory starting at
+ * address. First the CRC of the whole range is compared; if it differs, the
+ * CRCs of the pages are compared to find out which pages differ. Those are
+ * read back to find the exact ranges of bytes which differ, which are
+ * reported. Adds the number of differing bytes to *mismatched and the number
+ * of bytes which could not be read to *faulted. Returns -1 if an error
+ * occured, or 0 otherwise.
+ */
+static int verifyChunk(uint32_t address, const unsigned char *buffer, uint32_t size, int *mismatched, int *faulted) {
+  uint32_t crcs[RVSRV_MAX_HASH_PAGES];
+  unsigned char memory[VERIFY_PAGE_SIZE];
+  uint32_t crc, faultCode;
+  uint32_t offset, runStart, i;
+  int page;
+  
+  // Compare the CRC of the whole chunk first, which is all that needs to be
+  // transferred if the memory is up to date.
+  switch (rvsrv_checksum(address, size, &crc, &faultCode)) {
+    case 1:
+      if (crc == crc32_update(0, buffer, size)) {
+        return 0;
+      }
+      break;
+    case 0:
+      reportFault(address, address + size - 1, faultCode);
+      *faulted += size;
+      return 0;
+    default:
+      return -1;
+  }
+  
+  // Find out which pages differ.
+  switch (rvsrv_hashPages(address, size, VERIFY_PAGE_SIZE, crcs, &faultCode)) {
+    case 1:
+      break;
+    case 0:
+      reportFault(address, address + size - 1, faultCode);
+      *faulted += size;
+      return 0;
+    default:
+      return -1;
+  }
+  
+  // Read back the pages which differ and report the runs of consecutive
+  // bytes which differ. A run may continue into the next page.
+  runStart = size;
+  for (offset = 0, page = 0; offset < size; offset += VERIFY_PAGE_SIZE, page++) {
+    uint32_t count = (size - offset < VERIFY_PAGE_SIZE) ? size - offset : VERIFY_PAGE_SIZE;
+    int differs = (crc32_update(0, buffer + offset, count) != crcs[page]);
+    int fault = 0;
+    
+    if (differs) {
+      switch (rvsrv_readBulk(address + offset, memory, count, &faultCode)) {
+        case 1:
+          break;
+        case 0:
+          fault = 1;
+          break;
+        default:
+          return -1;
+      }
+    }
+    
+    // End the current run if this page matches or could not be read.
+    if (!differs || fault) {
+      if (runStart != size) {
+        reportMismatch(address + runStart, address + offset - 1);
+        runStart = size;
+      }
+      if (fault) {
+        reportFault(address + offset, address + offset + count - 1, faultCode);
+        *faulted += count;
+      }
+      continue;
+    }
+    
+    // Compare the page byte by byte.
+    for (i = 0; i < count; i++) {
+      if (memory[i] != buffer[offset + i]) {
+        if (runStart == size) {
+          runStart = offset + i;
+        }
+        (*mismatched)++;
+      } else if (runStart != size) {
+        reportMismatch(address + runStart, address + offset + i - 1);
+        runStart = size;
+      }
+    }
+  }
+  if (runStart != size) {
+    reportMismatch(address + runStart, address + size - 1);
+  }
+  
+  return 0;
+}
+
+/**
+ * Executes the "rvd verify" command.
+ */
+int runVerify(commandLineArgs_t *args) {
+  filetype_t ft;
+  unsigned char *buffer;
+  int failed = 0;
+  
+  if (isHelp(args) || (args->paramCount < 2) || (args->paramCount > 3)) {
+    printf(
+      "\n"
+      "Command usage:\n"
+      "  rvd verify <filetype> <filename> [address]\n"
+      "\n"
+      "This command checks whether the memory contains the contents of <filename>,\n"
+      "for instance after uploading it. The filetype and address parameters have the\n"
+      "same meaning as for rvd upload. The memory is compared in chunks of %d bytes\n"
+      "by CRC-32, which rvsrv computes without sending the memory contents, as long as\n"
+      "it is recent enough to support this. The %d-byte pages of any chunk which\n"
+      "differs are compared next, and the pages which differ are read back to print\n"
+      "the exact ranges of bytes which differ. The command fails if any part of the\n"
+      "memory differs.\n"
+      "\n"
+      "Like all commands, verify is run for every selected context.\n"
+      "\n",
+      VERIFY_CHUNK_SIZE, VERIFY_PAGE_SIZE
+    );
+    return 0;
+  }
+  
+  // Interpret the file type.
+  ft = interpretFiletype(args->params[0]);
+  if (ft == FT_UNKNOWN) {
+    printf("Error: unsupported file type %s.\n", args->params[0]);
+    return -1;
+  }
+  
+  // Allocate a buffer for a chunk of the file.
+  buffer = (unsigned char*)malloc(VERIFY_CHUNK_SIZE);
+  if (!buffer) {
+    perror("Failed to allocate memory for verify buffer");
+    return -1;
+  }
+  
+  FOR_EACH_CONTEXT(
+    
+    void *fileReaderState;
+    int fileSize;
+    uint32_t address;
+    int totalFileBytes;
+    int totalDataBytes;
+    int mismatchedBytes;
+    int faultedBytes;
+    char prefix[16];
+    value_t dummyValue;
+    
+    // Execute the _ALWAYS definition.
+    if (evaluate("_ALWAYS", &dummyValue, "") < 1) {
+      free(buffer);
+      return -1;
+    }
+    
+    // Evaluate the address if it is specified, otherwise set it to 0.
+    if (args->paramCount > 2) {
+      value_t addressVal;
+      if (evaluate(args->params[2], &addressVal, "") < 1) {
+        free(buffer);
+        return -1;
+      }
+      address = addressVal.value;
+    } else {
+      address = 0;
+    }
+    
+    // Give a little feedback.
+    printf("Verifying file at 0x%08X for context %d...\n", address, ctxt);
+    
+    // Open the file.
+    fileReaderState = imageReadOpen(args->params[1], ft);
+    if (!fileReaderState) {
+      free(buffer);
+      return -1;
+    }
+    fileSize = imageReadSize(fileReaderState);
+    
+    // Initialize counters.
+    totalFileBytes = 0;
+    totalDataBytes = 0;
+    mismatchedBytes = 0;
+    faultedBytes = 0;
+    
+    // Start printing the progress bar.
+    sprintf(prefix, "0x%08X ", address);
+    progressBar(prefix, 0, fileSize, 1, 1);
+    
+    while (!imageReadEof(fileReaderState)) {
+      uint32_t fileAddress = imageReadExpectedAddress(fileReaderState);
+      uint32_t numBytes = 0;
+      
+      // Read the next contiguous chunk of the file.
+      while (numBytes < VERIFY_CHUNK_SIZE) {
+        int count = imageRead(fileReaderState, buffer + numBytes, VERIFY_CHUNK_SIZE - numBytes, fileAddress + numBytes);
+        if (count < 0) {
+          imageReadClose(fileReaderState);
+          free(buffer);
+          return -1;
+        } else if (count == 0) {
+          
+          // Either the end of the file or an address jump; the latter is
+          // handled by starting a new chunk at the expected address.
+          break;
+          
+        }
+        totalFileBytes += imageReadProgressDelta(fileReaderState);
+        numBytes += count;
+      }
+      totalDataBytes += numBytes;
+      
+      // Compare the chunk with the memory.
+      if (numBytes) {
+        if (verifyChunk(fileAddress + address, buffer, numBytes, &mismatchedBytes, &faultedBytes) < 0) {
+          imageReadClose(fileReaderState);
+          free(buffer);
+          return -1;
+        }
+        
+        // Update the progress bar.
+        sprintf(prefix, "0x%08X ", fileAddress + address + numBytes - 1);
+        progressBar(prefix, totalFileBytes, fileSize, 0, 1);
+        
+      }
+      
+    }
+    
+    // Finish the progress indicator.
+    progressBar(prefix, fileSize, fileSize, 0, 0);
+    
+    // Show the result.
+    if (mismatchedBytes || faultedBytes) {
+      printf(
+        "Verified %d bytes: %d differ and %d could not be read.\n",
+        totalDataBytes, mismatchedBytes, faultedBytes
+      );
+      failed = 1;
+    } else {
+      printf("Verified %d bytes: memory matches the file.\n", totalDataBytes);
+    }
+    
+    // Free the file type reader state.
+    imageReadClose(fileReaderState);
+    fileReaderState = 0;
+    
+    // Print a newline to separate the contexts.
+    printf("\n");
+    
+  );
+  
+  free(buffer);
+  return failed ? -1 : 0;
+  
+}
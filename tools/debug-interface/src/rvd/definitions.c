@@ -53,6 +53,7 @@
 #include <string.h>
 
 #include "definitions.h"
+#include "parser.h"
 
 /**
  * Number of bins in the hash table.
@@ -60,10 +61,10 @@
 #define NUM_BINS 256
 
 /**
- * Determines the bin for a given string using the (public domain) sbdm hash
- * function.
+ * Hashes a definition name using the (public domain) sbdm hash function.
  */
-static int getBin(const unsigned char *str) {
+uint32_t defs_hash(const char *def) {
+  const unsigned char *str = (const unsigned char *)def;
   uint32_t hash = 0;
   int c;
   
@@ -71,7 +72,14 @@ static int getBin(const unsigned char *str) {
     hash = c + (hash << 6) + (hash << 16) - hash;
   }
   
-  return hash % NUM_BINS;
+  return hash;
+}
+
+/**
+ * Determines the bin for a given string.
+ */
+static int getBin(const unsigned char *str) {
+  return defs_hash((const char *)str) % NUM_BINS;
 }
 
 /**
@@ -94,6 +102,11 @@ typedef struct _tableEntry_t {
    */
   char *expansion;
   
+  /**
+   * Compiled form of the expansion, or null if it has not been compiled yet.
+   */
+  compiledExpr_t *compiled;
+  
   /**
    * Next entry in the linked list of definitions.
    */
@@ -111,6 +124,12 @@ static tableEntry_t *bins[NUM_BINS] = {0};
  */
 static int currentContext = 0;
 
+/**
+ * Listener which is notified of every registered definition, or null.
+ */
+static defsListener_t listener = 0;
+static void *listenerData = 0;
+
 /**
  * Allocates a copy of the given null-terminated string. Prints an error and
  * returns null if malloc fails.
@@ -132,16 +151,39 @@ char *copyString(const char *str) {
  * if a new expansion was registered or -1 if a fatal error occured.
  */
 int defs_register(contextMask_t mask, const char *def, const char *expansion) {
-  int bin = getBin((const unsigned char *)def);
+  return defs_registerHashed(mask, def, expansion, defs_hash(def));
+}
+
+/**
+ * Same as defs_register(), but with the hash of def as returned by
+ * defs_hash() precomputed.
+ */
+int defs_registerHashed(contextMask_t mask, const char *def, const char *expansion, uint32_t hash) {
+  int bin = hash % NUM_BINS;
   tableEntry_t *ptr;
   
+  // Notify the listener.
+  if (listener) {
+    if (listener(listenerData, mask, def, expansion) < 0) {
+      return -1;
+    }
+  }
+  
   // See if there is a perfect match for this definition somewhere already; if
   // so, overwrite it.
   ptr = bins[bin];
   while (ptr) {
     if ((ptr->mask == mask) && !strcmp(def, ptr->def)) {
       
-      // Found a perfect match. Override the expansion.
+      // Found a perfect match. Nothing changes if the expansion is the
+      // same, which keeps the compiled form valid.
+      if (!strcmp(expansion, ptr->expansion)) {
+        return 1;
+      }
+      
+      // Override the expansion and drop its compiled form.
+      releaseCompiled(ptr->compiled);
+      ptr->compiled = 0;
       free(ptr->expansion);
       ptr->expansion = copyString(expansion);
       if (!ptr->expansion) {
@@ -161,6 +203,7 @@ int defs_register(contextMask_t mask, const char *def, const char *expansion) {
     return -1;
   }
   ptr->mask = mask;
+  ptr->compiled = 0;
   ptr->def = copyString(def);
   if (!ptr->def) {
     free(ptr);
@@ -192,6 +235,15 @@ int defs_registerLocal(const char *def, const char *expansion) {
  * known.
  */
 const char *defs_expand(const char *def) {
+  compiledExpr_t **cache;
+  return defs_expandCached(def, &cache);
+}
+
+/**
+ * Same as defs_expand(), but also sets *cache to the slot which caches the
+ * compiled form of the expansion.
+ */
+const char *defs_expandCached(const char *def, compiledExpr_t ***cache) {
   int bin = getBin((const unsigned char *)def);
   tableEntry_t *ptr;
   
@@ -200,6 +252,7 @@ const char *defs_expand(const char *def) {
     if ((ptr->mask & (1 << currentContext)) && !strcmp(def, ptr->def)) {
       
       // Found a match.
+      *cache = &ptr->compiled;
       return ptr->expansion;
       
     }
@@ -211,6 +264,15 @@ const char *defs_expand(const char *def) {
   
 }
 
+/**
+ * Sets the listener which is called for every definition which is registered
+ * from now on, or removes it if listener is null.
+ */
+void defs_setListener(defsListener_t newListener, void *data) {
+  listener = newListener;
+  listenerData = data;
+}
+
 /**
  * Sets the context used to expand definitions.
  */
@@ -222,6 +284,27 @@ void defs_setContext(int context) {
   currentContext = context;
 }
 
+/**
+ * Compiles the expansions of all definitions which have not been compiled
+ * yet, so they don't have to be parsed when they are first used. Expansions
+ * with syntax errors are left alone; the error is reported when they are
+ * used. Returns -1 if a fatal error occured, or 0 otherwise.
+ */
+int defs_compileAll(void) {
+  int bin;
+  tableEntry_t *entry;
+  
+  for (bin = 0; bin < NUM_BINS; bin++) {
+    for (entry = bins[bin]; entry; entry = entry->next) {
+      if (!entry->compiled && (compileExpansion(entry->expansion, &entry->compiled) < 0)) {
+        return -1;
+      }
+    }
+  }
+  
+  return 0;
+}
+
 /**
  * Frees all dynamically allocated memory for the definition hashmap.
  */
@@ -239,6 +322,7 @@ void defs_free(void) {
       // Free the strings in the entry.
       free(entry->def);
       free(entry->expansion);
+      releaseCompiled(entry->compiled);
       
       // Remember the pointer to the next entry.
       next = entry->next;
@@ -51,11 +51,29 @@
 
 #include "types.h"
 
+/**
+ * Listener which is called for every definition which is registered. Should
+ * return 0 if successful or -1 if a fatal error occured, in which case the
+ * registration fails.
+ */
+typedef int (*defsListener_t)(void *data, contextMask_t mask, const char *def, const char *expansion);
+
+/**
+ * Hashes a definition name.
+ */
+uint32_t defs_hash(const char *def);
+
 /**
  * Registers an expansion.
  */
 int defs_register(contextMask_t mask, const char *def, const char *expansion);
 
+/**
+ * Same as defs_register(), but with the hash of def as returned by
+ * defs_hash() precomputed.
+ */
+int defs_registerHashed(contextMask_t mask, const char *def, const char *expansion, uint32_t hash);
+
 /**
  * Registers an expansion locally, i.e., using the current context.
  */
@@ -67,11 +85,33 @@ int defs_registerLocal(const char *def, const char *expansion);
  */
 const char *defs_expand(const char *def);
 
+/**
+ * Same as defs_expand(), but also sets *cache to the slot which caches the
+ * compiled form of the expansion. The slot is null until the parser stores
+ * the compiled expansion in it; it is released and cleared when the
+ * definition is redefined.
+ */
+const char *defs_expandCached(const char *def, compiledExpr_t ***cache);
+
+/**
+ * Sets the listener which is called for every definition which is registered
+ * from now on, or removes it if listener is null.
+ */
+void defs_setListener(defsListener_t listener, void *data);
+
 /**
  * Sets the context used to expand definitions.
  */
 void defs_setContext(int context);
 
+/**
+ * Compiles the expansions of all definitions which have not been compiled
+ * yet, so they don't have to be parsed when they are first used. Expansions
+ * with syntax errors are left alone; the error is reported when they are
+ * used. Returns -1 if a fatal error occured, or 0 otherwise.
+ */
+int defs_compileAll(void);
+
 /**
  * Frees all dynamically allocated memory for the definition hashmap.
  */
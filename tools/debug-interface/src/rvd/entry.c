@@ -57,8 +57,10 @@
 #include "parser.h"
 #include "definitions.h"
 #include "readFile.h"
+#include "mapCache.h"
 #include "rvsrvInterface.h"
 #include "preload.h"
+#include "session.h"
 #include "gdb/gdb-main.h"
 
 /**
@@ -82,12 +84,19 @@ static void cleanupAndExit(int code) {
   // Close the connection to rvsrv if it is open.
   rvsrv_close();
   
-  // Clean up the definition hash map.
-  defs_free();
+  // Clean up the definition hash map. Commands run by the session server
+  // share it with the server until they write to it, so leave it to the
+  // system, freeing it would only copy all of it first.
+  if (!session_isChild()) {
+    defs_free();
+  }
   
   // Clean up the preload buffer.
   preload_free();
   
+  // Remove the session server socket if we're running the session server.
+  session_close();
+  
   exit(code);
 }
 
@@ -102,28 +111,53 @@ static void sigTermHandler(int signum) {
  * Application entry point.
  */
 int main(int argc, char **argv) {
+  const char *session;
+  int code;
+  
+  // Hand the command to the session server if one was started. Otherwise, or
+  // if it is not running anymore, run the command ourselves.
+  session = getenv("RVD_SESSION");
+  if (session) {
+    code = session_forward(session, argc, argv);
+    if (code >= 0) {
+      return code;
+    }
+  }
+  
+  return runCommandLine(argc, argv);
+}
+
+/**
+ * Parses the given command line and runs the command. Used by main() and by
+ * the session server to run forwarded commands. Does not return.
+ */
+int runCommandLine(int argc, char **argv) {
   
   commandLineArgs_t args;
   int contextSpecified = 0;
   char errorPrefix[1024];
-  char *buf;
   int port;
   char *host;
+  char *localPath;
   
   // Set command line option defaults.
   port = 21079;
   host = "127.0.0.1";
+  localPath = 0;
   args.contextMask = 1 << 0;
   
   // Set terminate signal handlers such that they will call the free methods.
   signal(SIGTERM, &sigTermHandler);
   
-  // Parse command line arguments.
+  // Parse command line arguments. The session server has already parsed its
+  // own command line when it calls us, so getopt must start over.
+  optind = 0;
   while (1) {
 
     static struct option long_options[] = {
       {"port",     required_argument, 0, 'p'},
       {"host",     required_argument, 0, 'h'},
+      {"local",    required_argument, 0, 'L'},
       {"map",      required_argument, 0, 'm'},
       {"define",   required_argument, 0, 'd'},
       {"context",  required_argument, 0, 'c'},
@@ -132,7 +166,7 @@ int main(int argc, char **argv) {
     
     int option_index = 0;
 
-    int c = getopt_long(argc, argv, "p:h:m:d:c:", long_options, &option_index);
+    int c = getopt_long(argc, argv, "p:h:L:m:d:c:", long_options, &option_index);
 
     if (c == -1) {
       break;
@@ -152,16 +186,25 @@ int main(int argc, char **argv) {
         host = optarg;
         break;
         
+      case 'L':
+        localPath = optarg;
+        break;
+        
       case 'm':
+        
+        // Don't parse maps again which the session server already has.
+        if (session_skipMap(optarg)) {
+          break;
+        }
         sprintf(errorPrefix, " in file %s", optarg);
-        if (parseDefs(buf = readFile(optarg, 0, 0), errorPrefix) != 1) {
-          free(buf);
+        if (mapCache_load(optarg, errorPrefix) != 1) {
           cleanupAndExit(EXIT_FAILURE);
         }
-        free(buf);
+        session_mapLoaded(optarg);
         break;
         
       case 'd':
+        session_skipMap(0);
         if (parseDefs(optarg, " on the command line") != 1) {
           cleanupAndExit(EXIT_FAILURE);
         }
@@ -247,6 +290,9 @@ int main(int argc, char **argv) {
   if (rvsrv_setup(host, port) < 0) {
     cleanupAndExit(EXIT_FAILURE);
   }
+  if (localPath && (rvsrv_setupLocal(localPath) < 0)) {
+    cleanupAndExit(EXIT_FAILURE);
+  }
   
   // Try to execute the given command.
   if (run(&args) < 0) {
@@ -282,6 +328,9 @@ static void usage(char *progName, int verbose) {
     "  -p  --port <port>  Specifies which TCP port to connect to. This should be the\n"
     "                     same as what was specified when starting rvsrv with the -d\n"
     "                     option. Defaults to port 21079.\n"
+    "  -L  --local <path> Accesses the memory shared by rvsrv through the given\n"
+    "                     local socket directly. This should be the same as what\n"
+    "                     was specified when starting rvsrv with the -L option.\n"
     "  -m  --map <file>   Loads a memory map file. refer to the comments in the\n"
     "                     default memory.map file for more information.\n"
     "  -d  --define <def> (Re)defines a definition. <def> must have the same format\n"
@@ -307,13 +356,17 @@ static void usage(char *progName, int verbose) {
     "  evaluate, eval       Evaluates the given expression.\n"
     "  execute, exec        Executes the given expression.\n"
     "  stop                 Sends the stop command to rvsrv.\n"
+    "  serve                Keeps definitions and the connection loaded for\n"
+    "                       faster rvd commands.\n"
     "\n"
     "Memory access:\n"
     "  write, w             Writes a word, halfword or byte.\n"
     "  read, r              Reads one or more words, halfwords or bytes.\n"
     "  fill                 Fills an address range with the specified byte.\n"
-    "  upload, up           Uploads an S-record or binary file.\n"
-    "  download, dl         Downloads an S-record or binary file.\n"
+    "  upload, up           Uploads an S-record, Intel HEX, ELF or binary file.\n"
+    "  upload-delta, upd    Uploads only the parts of a file which changed.\n"
+    "  download, dl         Downloads an S-record, Intel HEX or binary file.\n"
+    "  verify               Checks that the memory matches a file.\n"
     "\n"
     "Debugging:\n"
     "  gdb                  Uses GDB for debugging.\n"
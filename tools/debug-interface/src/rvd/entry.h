@@ -56,6 +56,12 @@
  */
 int main(int argc, char **argv);
 
+/**
+ * Parses the given command line and runs the command. Used by main() and by
+ * the session server to run forwarded commands. Does not return.
+ */
+int runCommandLine(int argc, char **argv);
+
 /**
  * Structure containing the command line parameters. This is filled in main and
  * then passed to run().
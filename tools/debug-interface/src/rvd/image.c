@@ -0,0 +1,1231 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+#include "image.h"
+
+/**
+ * Size of the output buffer used by the image writers. Buffered records are
+ * written to the file with a single write() call whenever the buffer fills.
+ */
+#define IMAGE_WRITE_BUFFER_SIZE 65536
+
+/**
+ * Maximum number of characters which a single S-record or Intel HEX record
+ * written by this module can take up.
+ */
+#define IMAGE_MAX_RECORD_SIZE 64
+
+/**
+ * Maximum number of data bytes in a written record (that's the amount of
+ * bytes most srec and ihex outputters tend to use).
+ */
+#define IMAGE_RECORD_DATA_SIZE 16
+
+/**
+ * Hex character decoding table. Valid hex characters map to their value
+ * with bit 4 set, anything else maps to zero.
+ */
+static const unsigned char hexValue[256] = {
+  ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13,
+  ['4'] = 0x14, ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17,
+  ['8'] = 0x18, ['9'] = 0x19,
+  ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E, ['F'] = 0x1F,
+  ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D, ['e'] = 0x1E, ['f'] = 0x1F
+};
+
+/**
+ * Hex character encoding table.
+ */
+static const char hexDigits[16] = "0123456789ABCDEF";
+
+/**
+ * Loadable segment of an ELF file.
+ */
+typedef struct {
+  
+  /**
+   * Offset of the segment data in the file.
+   */
+  uint32_t offset;
+  
+  /**
+   * Physical address of the segment.
+   */
+  uint32_t address;
+  
+  /**
+   * Number of bytes stored in the file and number of bytes in memory. The
+   * bytes in memory which are not in the file must be zeroed.
+   */
+  uint32_t fileSize;
+  uint32_t memSize;
+  
+} imageSegment_t;
+
+/**
+ * Address range which should be zeroed.
+ */
+typedef struct {
+  uint32_t address;
+  uint32_t size;
+} imageZeroRange_t;
+
+/**
+ * Image reader state structure.
+ */
+typedef struct {
+  
+  /**
+   * Type of the file being read.
+   */
+  filetype_t ft;
+  
+  /**
+   * Contents of the file. If isMapped is set, this was mapped using mmap(),
+   * otherwise it was allocated using malloc().
+   */
+  const unsigned char *file;
+  size_t fileSize;
+  int isMapped;
+  
+  /**
+   * Offset of the next line (S-record and Intel HEX) or index of the next
+   * segment (ELF) to process.
+   */
+  size_t position;
+  
+  /**
+   * Number of complete lines read so far.
+   */
+  int linesRead;
+  
+  /**
+   * Upper address bits set by Intel HEX extended address records.
+   */
+  uint32_t ihexBase;
+  
+  /**
+   * ELF file information.
+   */
+  int elfBigEndian;
+  
+  /**
+   * PT_LOAD segments of an ELF file, sorted by address.
+   */
+  imageSegment_t *segments;
+  int numSegments;
+  
+  /**
+   * Address ranges which an ELF file needs zeroed (.bss), sorted by address
+   * and with adjacent ranges merged.
+   */
+  imageZeroRange_t *zeroRanges;
+  int numZeroRanges;
+  
+  /**
+   * Data bytes which have not been returned by imageRead() yet, and the
+   * image address of the first one. These point either into the file or
+   * into the record buffer.
+   */
+  const unsigned char *data;
+  int dataRemain;
+  uint32_t address;
+  
+  /**
+   * Decoded contents of the current S-record or Intel HEX record.
+   */
+  unsigned char record[256];
+  
+  /**
+   * Progress counters. See imageReadProgressDelta().
+   */
+  int progress;
+  int progressReported;
+  int progressTotal;
+  
+  /**
+   * This is set when we've reached the end of the file.
+   */
+  int isEof;
+  
+} imageReadState_t;
+
+/**
+ * Decodes count bytes from hex characters. Returns -1 if an invalid
+ * character was encountered, or 0 otherwise.
+ */
+static int decodeHex(const unsigned char *src, unsigned char *dest, int count) {
+  unsigned char invalid = 0x10;
+  while (count--) {
+    unsigned char hi = hexValue[src[0]];
+    unsigned char lo = hexValue[src[1]];
+    invalid &= hi & lo;
+    *dest++ = (hi << 4) | (lo & 0x0F);
+    src += 2;
+  }
+  return invalid ? 0 : -1;
+}
+
+/**
+ * Returns the 16-bit or 32-bit word at the given offset in the ELF file,
+ * taking the file's endianness into account.
+ */
+static uint32_t elfHalf(const imageReadState_t *s, uint32_t offset) {
+  const unsigned char *p = s->file + offset;
+  if (s->elfBigEndian) {
+    return (p[0] << 8) | p[1];
+  }
+  return (p[1] << 8) | p[0];
+}
+static uint32_t elfWord(const imageReadState_t *s, uint32_t offset) {
+  const unsigned char *p = s->file + offset;
+  if (s->elfBigEndian) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  }
+  return ((uint32_t)p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+}
+
+/**
+ * qsort() comparison function which sorts segments by address.
+ */
+static int compareSegments(const void *a, const void *b) {
+  uint32_t addrA = ((const imageSegment_t*)a)->address;
+  uint32_t addrB = ((const imageSegment_t*)b)->address;
+  return (addrA > addrB) - (addrA < addrB);
+}
+
+/**
+ * Checks the ELF header and loads the PT_LOAD segments from the program
+ * header table. The segments are sorted by address, so segments which are
+ * adjacent in memory are read as one contiguous block by imageRead(); the
+ * parts of the segments which are not stored in the file are merged into
+ * zero ranges. Returns -1 if the file is not a supported ELF file or an
+ * error occured, or 0 otherwise.
+ */
+static int elfOpen(imageReadState_t *s) {
+  uint32_t phOffset;
+  int phEntSize, phNum;
+  int i;
+  
+  // Check the identification bytes.
+  if ((s->fileSize < 52) || memcmp(s->file, "\177ELF", 4)) {
+    fprintf(stderr, "Error: file is not an ELF file.\n");
+    return -1;
+  }
+  if (s->file[4] != 1) {
+    fprintf(stderr, "Error: only 32-bit ELF files are supported.\n");
+    return -1;
+  }
+  if ((s->file[5] != 1) && (s->file[5] != 2)) {
+    fprintf(stderr, "Error: unknown ELF data encoding.\n");
+    return -1;
+  }
+  s->elfBigEndian = s->file[5] == 2;
+  
+  // Load the program header table location.
+  phOffset = elfWord(s, 28);
+  phEntSize = elfHalf(s, 42);
+  phNum = elfHalf(s, 44);
+  if (phNum && (phEntSize < 32)) {
+    fprintf(stderr, "Error: invalid ELF program header size.\n");
+    return -1;
+  }
+  if ((uint64_t)phOffset + (uint64_t)phNum * phEntSize > s->fileSize) {
+    fprintf(stderr, "Error: ELF program header table extends beyond the end of the file.\n");
+    return -1;
+  }
+  
+  // Allocate room for the segments and zero ranges.
+  s->segments = (imageSegment_t*)malloc(sizeof(imageSegment_t) * (phNum + 1));
+  s->zeroRanges = (imageZeroRange_t*)malloc(sizeof(imageZeroRange_t) * (phNum + 1));
+  if (!s->segments || !s->zeroRanges) {
+    perror("Failed to allocate memory for ELF segments");
+    return -1;
+  }
+  
+  // Load the loadable segments and sum up their sizes for the progress
+  // indication. The segments are loaded at their physical addresses, as the
+  // debug interface writes to physical memory.
+  for (i = 0; i < phNum; i++) {
+    uint32_t ph = phOffset + i * phEntSize;
+    imageSegment_t *seg = &s->segments[s->numSegments];
+    if (elfWord(s, ph) != 1) {
+      continue;
+    }
+    seg->offset = elfWord(s, ph + 4);
+    seg->address = elfWord(s, ph + 12);
+    seg->fileSize = elfWord(s, ph + 16);
+    seg->memSize = elfWord(s, ph + 20);
+    if ((uint64_t)seg->offset + seg->fileSize > s->fileSize) {
+      fprintf(stderr, "Error: ELF segment %d extends beyond the end of the file.\n", i);
+      return -1;
+    }
+    if (seg->memSize < seg->fileSize) {
+      seg->memSize = seg->fileSize;
+    }
+    s->progressTotal += seg->fileSize;
+    s->numSegments++;
+  }
+  qsort(s->segments, s->numSegments, sizeof(imageSegment_t), compareSegments);
+  
+  // Determine which ranges need to be zeroed. They are clipped to the start
+  // of the next segment, in case the segments overlap.
+  for (i = 0; i < s->numSegments; i++) {
+    imageSegment_t *seg = &s->segments[i];
+    imageZeroRange_t *prev = s->numZeroRanges ? &s->zeroRanges[s->numZeroRanges - 1] : 0;
+    uint32_t start = seg->address + seg->fileSize;
+    uint32_t size = seg->memSize - seg->fileSize;
+    if ((i + 1 < s->numSegments) && (seg[1].address - start < size)) {
+      size = seg[1].address - start;
+    }
+    if (!size) {
+      continue;
+    }
+    if (prev && (prev->address + prev->size == start)) {
+      prev->size += size;
+    } else {
+      s->zeroRanges[s->numZeroRanges].address = start;
+      s->zeroRanges[s->numZeroRanges].size = size;
+      s->numZeroRanges++;
+    }
+  }
+  
+  return 0;
+}
+
+/**
+ * Loads the next segment of an ELF file with data in it, or sets isEof if
+ * there are no more.
+ */
+static void elfNext(imageReadState_t *s) {
+  while (s->position < s->numSegments) {
+    imageSegment_t *seg = &s->segments[s->position++];
+    if (!seg->fileSize) {
+      continue;
+    }
+    s->data = s->file + seg->offset;
+    s->dataRemain = seg->fileSize;
+    s->address = seg->address;
+    return;
+  }
+  s->isEof = 1;
+}
+
+/**
+ * Parses the given S-record line. Returns the address of the data in the
+ * record and sets *count to the number of data bytes, which are stored in
+ * s->record starting at *offset.
+ */
+static uint32_t srecParse(imageReadState_t *s, const unsigned char *line, int len, int *offset, int *count) {
+  int addrSize, byteCount, i;
+  uint32_t address;
+  unsigned char checksum;
+  
+  *count = 0;
+  
+  // Check the record type.
+  if (line[0] != 'S') {
+    printf("Warning: srec line did not start with S, skipping record (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  if (len < 2) {
+    printf("Warning: unexpected end of line in srec (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  switch (line[1]) {
+    case '1': addrSize = 2; break;
+    case '2': addrSize = 3; break;
+    case '3': addrSize = 4; break;
+    default:
+      // Unknown record.
+      return 0;
+  }
+  
+  // Decode the byte count and the rest of the record.
+  if ((len < 4) || (decodeHex(line + 2, s->record, 1) < 0)) {
+    printf("Warning: unexpected end of line in srec (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  byteCount = s->record[0];
+  if ((len < 4 + byteCount * 2) || (byteCount < addrSize + 1)) {
+    printf("Warning: unexpected end of line in srec (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  if (decodeHex(line + 4, s->record + 1, byteCount) < 0) {
+    printf("Warning: unexpected character in srec, skipping record (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  
+  // Verify the checksum.
+  checksum = 0;
+  for (i = 0; i <= byteCount; i++) {
+    checksum += s->record[i];
+  }
+  if (checksum != 0xFF) {
+    printf("Warning: incorrect checksum, but record was read anyway (line %d).\n", s->linesRead + 1);
+  }
+  
+  // Decode the address.
+  address = 0;
+  for (i = 1; i <= addrSize; i++) {
+    address = (address << 8) | s->record[i];
+  }
+  
+  *offset = 1 + addrSize;
+  *count = byteCount - addrSize - 1;
+  return address;
+}
+
+/**
+ * Parses the given Intel HEX line. Returns the address of the data in the
+ * record and sets *count to the number of data bytes, which are stored in
+ * s->record starting at *offset.
+ */
+static uint32_t ihexParse(imageReadState_t *s, const unsigned char *line, int len, int *offset, int *count) {
+  int byteCount, i;
+  unsigned char checksum;
+  unsigned char *r = s->record;
+  
+  *count = 0;
+  
+  // Check the start code.
+  if (line[0] != ':') {
+    printf("Warning: ihex line did not start with a colon, skipping record (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  
+  // Decode the byte count and the rest of the record.
+  if ((len < 3) || (decodeHex(line + 1, r, 1) < 0)) {
+    printf("Warning: unexpected end of line in ihex (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  byteCount = r[0];
+  if (len < 11 + byteCount * 2) {
+    printf("Warning: unexpected end of line in ihex (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  if (decodeHex(line + 3, r + 1, byteCount + 4) < 0) {
+    printf("Warning: unexpected character in ihex, skipping record (line %d).\n", s->linesRead + 1);
+    return 0;
+  }
+  
+  // Verify the checksum.
+  checksum = 0;
+  for (i = 0; i < byteCount + 5; i++) {
+    checksum += r[i];
+  }
+  if (checksum) {
+    printf("Warning: incorrect checksum, but record was read anyway (line %d).\n", s->linesRead + 1);
+  }
+  
+  // Handle the record.
+  switch (r[3]) {
+    case 0x00:
+      // Data record.
+      *offset = 4;
+      *count = byteCount;
+      return s->ihexBase + ((r[1] << 8) | r[2]);
+      
+    case 0x01:
+      // End of file record.
+      s->isEof = 1;
+      break;
+      
+    case 0x02:
+      // Extended segment address record.
+      if (byteCount == 2) {
+        s->ihexBase = ((r[4] << 8) | r[5]) << 4;
+      }
+      break;
+      
+    case 0x04:
+      // Extended linear address record.
+      if (byteCount == 2) {
+        s->ihexBase = ((r[4] << 8) | r[5]) << 16;
+      }
+      break;
+      
+    default:
+      // Start address records and unknown records.
+      break;
+      
+  }
+  
+  return 0;
+}
+
+/**
+ * Parses lines of an S-record or Intel HEX file until a record with data is
+ * found, or sets isEof if there are no more.
+ */
+static void textNext(imageReadState_t *s) {
+  while (!s->isEof) {
+    const unsigned char *line, *end, *next;
+    int len, offset, count;
+    uint32_t address;
+    
+    // Stop at the end of the file.
+    if (s->position >= s->fileSize) {
+      s->isEof = 1;
+      break;
+    }
+    
+    // Find the end of the line and strip trailing whitespace.
+    line = s->file + s->position;
+    end = memchr(line, '\n', s->fileSize - s->position);
+    next = end ? end + 1 : s->file + s->fileSize;
+    if (!end) {
+      end = next;
+    }
+    while ((end > line) && ((end[-1] == '\r') || (end[-1] == ' ') || (end[-1] == '\t'))) {
+      end--;
+    }
+    len = end - line;
+    
+    // Parse the record, skipping empty lines.
+    count = 0;
+    address = 0;
+    if (len) {
+      if (s->ft == FT_SREC) {
+        address = srecParse(s, line, len, &offset, &count);
+      } else {
+        address = ihexParse(s, line, len, &offset, &count);
+      }
+    }
+    
+    // Update the line counters.
+    s->progress += next - line;
+    s->position = next - s->file;
+    s->linesRead++;
+    
+    // Return if this record contained data.
+    if (count > 0) {
+      s->data = s->record + offset;
+      s->dataRemain = count;
+      s->address = address;
+      break;
+    }
+    
+  }
+}
+
+/**
+ * Loads the next chunk of data from the file into s->data, or sets isEof if
+ * there is none.
+ */
+static void nextChunk(imageReadState_t *s) {
+  switch (s->ft) {
+    case FT_STRAIGHT:
+      if (s->position < s->fileSize) {
+        s->data = s->file;
+        s->dataRemain = s->fileSize;
+        s->address = 0;
+        s->position = s->fileSize;
+      } else {
+        s->isEof = 1;
+      }
+      break;
+      
+    case FT_ELF:
+      elfNext(s);
+      break;
+      
+    default:
+      textNext(s);
+      break;
+      
+  }
+}
+
+/**
+ * Reads a whole file which can't be mapped into memory (a pipe, for
+ * instance) into a malloc'd buffer. Returns -1 if an error occured, or 0
+ * otherwise.
+ */
+static int readStream(imageReadState_t *s, int f) {
+  unsigned char *buffer = 0;
+  size_t size = 0;
+  size_t allocated = 0;
+  
+  while (1) {
+    ssize_t count;
+    
+    // Make sure there is room in the buffer.
+    if (size == allocated) {
+      unsigned char *newBuffer;
+      allocated = allocated ? allocated * 2 : 65536;
+      newBuffer = (unsigned char*)realloc(buffer, allocated);
+      if (!newBuffer) {
+        perror("Failed to allocate memory to read input file");
+        free(buffer);
+        return -1;
+      }
+      buffer = newBuffer;
+    }
+    
+    // Read into it.
+    count = read(f, buffer + size, allocated - size);
+    if (count < 0) {
+      perror("Failed to read from input file");
+      free(buffer);
+      return -1;
+    } else if (count == 0) {
+      break;
+    }
+    size += count;
+    
+  }
+  
+  s->file = buffer;
+  s->fileSize = size;
+  s->isMapped = 0;
+  return 0;
+}
+
+/**
+ * Opens a memory image file of the given type for reading. The file is
+ * mapped into memory if possible, or read into memory completely otherwise.
+ * If this returns null, an error occured (which will have been printed).
+ * When the file has been read, imageReadClose() must be called on the
+ * returned pointer, if non-null.
+ */
+void *imageReadOpen(const char *filename, filetype_t ft) {
+  imageReadState_t *s;
+  struct stat st;
+  int f;
+  
+  if (ft == FT_UNKNOWN) {
+    fprintf(stderr, "Error: unknown file type.\n");
+    return 0;
+  }
+  
+  // Allocate the state structure.
+  s = (imageReadState_t*)malloc(sizeof(imageReadState_t));
+  if (!s) {
+    perror("Failed to allocate memory for image reader");
+    return 0;
+  }
+  memset(s, 0, sizeof(imageReadState_t));
+  s->ft = ft;
+  
+  // Try to open the file.
+  f = open(filename, O_RDONLY);
+  if (f < 0) {
+    perror("Failed to open input file");
+    free(s);
+    return 0;
+  }
+  
+  // Map regular files into memory, so the parsers can work on the page
+  // cache directly. Anything else is read into memory completely.
+  if (!fstat(f, &st) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+    void *file = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+    if (file != MAP_FAILED) {
+      madvise(file, st.st_size, MADV_SEQUENTIAL);
+      s->file = (const unsigned char*)file;
+      s->fileSize = st.st_size;
+      s->isMapped = 1;
+    }
+  }
+  if (!s->isMapped) {
+    if (readStream(s, f) < 0) {
+      close(f);
+      free(s);
+      return 0;
+    }
+  }
+  close(f);
+  
+  // Determine the amount of progress units in the file.
+  if (ft == FT_ELF) {
+    if (elfOpen(s) < 0) {
+      imageReadClose(s);
+      return 0;
+    }
+  } else {
+    s->progressTotal = s->fileSize;
+  }
+  
+  return s;
+}
+
+/**
+ * Reads data from a memory image. state should be set to the pointer
+ * returned by imageReadOpen(). buffer is the buffer to read to, and count is
+ * the maximum amount of bytes to read. address specifies the address
+ * corresponding to the start of the buffer in image address space; if this
+ * does not match the current address in the image, no bytes will be read and
+ * 0 is returned. When the end of the file has been reached, 0 is returned as
+ * well. If an error occurs, -1 is returned and an error is printed.
+ * Otherwise, this returns the number of bytes written to the buffer.
+ */
+int imageRead(void *state, unsigned char *buffer, int count, uint32_t address) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  int total = 0;
+  
+  while (count) {
+    int size;
+    
+    // Load the next chunk of data if we've run out.
+    if (!s->dataRemain) {
+      if (s->isEof) {
+        break;
+      }
+      nextChunk(s);
+      continue;
+    }
+    
+    // Make sure the expected and actual addresses match.
+    if (address != s->address) {
+      break;
+    }
+    
+    // Copy as much as we can.
+    size = (count < s->dataRemain) ? count : s->dataRemain;
+    memcpy(buffer, s->data, size);
+    
+    // Update the various counters.
+    if ((s->ft == FT_STRAIGHT) || (s->ft == FT_ELF)) {
+      s->progress += size;
+    }
+    s->data += size;
+    s->dataRemain -= size;
+    s->address += size;
+    buffer += size;
+    address += size;
+    count -= size;
+    total += size;
+    
+  }
+  
+  // Return how many data bytes we've read.
+  return total;
+  
+}
+
+/**
+ * Returns the total amount of progress units which imageReadProgressDelta()
+ * will report while reading the whole file.
+ */
+int imageReadSize(void *state) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  return s->progressTotal;
+}
+
+/**
+ * Returns the amount of the file processed since the last call to this
+ * function. For S-record and Intel HEX files, this is the number of
+ * characters parsed; for binary and ELF files it is the number of data bytes
+ * read. Can be used for progress indication.
+ */
+int imageReadProgressDelta(void *state) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  int count = s->progress - s->progressReported;
+  s->progressReported = s->progress;
+  return count;
+}
+
+/**
+ * Returns nonzero of the end of the file has been reached.
+ */
+int imageReadEof(void *state) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  return s->isEof && !s->dataRemain;
+}
+
+/**
+ * Returns the expected address needed for the next read operation to succeed.
+ */
+uint32_t imageReadExpectedAddress(void *state) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  return s->address;
+}
+
+/**
+ * Returns the index'th address range which must be zeroed after the data has
+ * been written, which for ELF files are the .bss areas of the segments.
+ * Adjacent ranges are merged. Returns 1 and sets *address and *size if the
+ * range exists, or 0 if there are no more.
+ */
+int imageReadZeroRange(void *state, int index, uint32_t *address, uint32_t *size) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  if ((index < 0) || (index >= s->numZeroRanges)) {
+    return 0;
+  }
+  *address = s->zeroRanges[index].address;
+  *size = s->zeroRanges[index].size;
+  return 1;
+}
+
+/**
+ * Looks up the value of the given symbol in the symbol table of an ELF file.
+ * Returns 1 and sets *value if the symbol was found, 0 if it was not or the
+ * file has no symbol table, or -1 if the symbol table is malformed, in which
+ * case an error is printed.
+ */
+int imageReadSymbol(void *state, const char *name, uint32_t *value) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  uint32_t shOffset;
+  int shEntSize, shNum;
+  int nameLen = strlen(name);
+  int i;
+  
+  if (s->ft != FT_ELF) {
+    return 0;
+  }
+  
+  // Load the section header table location.
+  shOffset = elfWord(s, 32);
+  shEntSize = elfHalf(s, 46);
+  shNum = elfHalf(s, 48);
+  if (!shNum) {
+    return 0;
+  }
+  if ((shEntSize < 40) || ((uint64_t)shOffset + (uint64_t)shNum * shEntSize > s->fileSize)) {
+    fprintf(stderr, "Error: invalid ELF section header table.\n");
+    return -1;
+  }
+  
+  // Look for symbol tables.
+  for (i = 0; i < shNum; i++) {
+    uint32_t sh = shOffset + i * shEntSize;
+    uint32_t symOffset, symSize, symEntSize, strSh, strOffset, strSize, sym;
+    int link;
+    if (elfWord(s, sh + 4) != 2) {
+      continue;
+    }
+    
+    // Load the location of the symbols and of the associated string table.
+    symOffset = elfWord(s, sh + 16);
+    symSize = elfWord(s, sh + 20);
+    symEntSize = elfWord(s, sh + 36);
+    link = elfWord(s, sh + 24);
+    if ((symEntSize < 16) || (link >= shNum) || ((uint64_t)symOffset + symSize > s->fileSize)) {
+      fprintf(stderr, "Error: invalid ELF symbol table.\n");
+      return -1;
+    }
+    strSh = shOffset + link * shEntSize;
+    strOffset = elfWord(s, strSh + 16);
+    strSize = elfWord(s, strSh + 20);
+    if ((uint64_t)strOffset + strSize > s->fileSize) {
+      fprintf(stderr, "Error: invalid ELF string table.\n");
+      return -1;
+    }
+    
+    // Compare the symbol names.
+    for (sym = symOffset; sym + symEntSize <= symOffset + symSize; sym += symEntSize) {
+      uint32_t nameOffset = elfWord(s, sym);
+      if (((uint64_t)nameOffset + nameLen >= strSize)
+        || memcmp(s->file + strOffset + nameOffset, name, nameLen + 1)
+      ) {
+        continue;
+      }
+      *value = elfWord(s, sym + 4);
+      return 1;
+    }
+    
+  }
+  
+  return 0;
+}
+
+/**
+ * Unmaps the file and frees the state data structure allocated by
+ * imageReadOpen().
+ */
+void imageReadClose(void *state) {
+  imageReadState_t *s = (imageReadState_t*)state;
+  free(s->segments);
+  free(s->zeroRanges);
+  if (s->isMapped) {
+    munmap((void*)s->file, s->fileSize);
+  } else {
+    free((void*)s->file);
+  }
+  free(s);
+}
+
+/**
+ * Image writer state structure.
+ */
+typedef struct {
+  
+  /**
+   * Output file descriptor and file type.
+   */
+  int f;
+  filetype_t ft;
+  
+  /**
+   * Number of S-record data records written so far.
+   */
+  int numDataRecords;
+  
+  /**
+   * Upper 16 address bits of the last Intel HEX extended linear address
+   * record.
+   */
+  uint32_t ihexBase;
+  
+  /**
+   * Output buffer and the number of bytes in it.
+   */
+  int used;
+  unsigned char buffer[IMAGE_WRITE_BUFFER_SIZE];
+  
+} imageWriteState_t;
+
+/**
+ * Writes the given data to the output file completely. Returns -1 if an
+ * error occured, or 0 otherwise.
+ */
+static int writeAll(int f, const unsigned char *buf, int remain) {
+  while (remain) {
+    int count = write(f, buf, remain);
+    if (count < 0) {
+      perror("Failed to write to output file");
+      return -1;
+    } else if (count == 0) {
+      fprintf(stderr, "Failed to write to output file.\n");
+      return -1;
+    }
+    remain -= count;
+    buf += count;
+  }
+  return 0;
+}
+
+/**
+ * Writes the output buffer to the file. Returns -1 if an error occured, or 0
+ * otherwise.
+ */
+static int flushBuffer(imageWriteState_t *s) {
+  int retval = writeAll(s->f, s->buffer, s->used);
+  s->used = 0;
+  return retval;
+}
+
+/**
+ * Makes sure there is room for another record in the output buffer. Returns
+ * a pointer to the free space, or null if an error occured.
+ */
+static unsigned char *recordSpace(imageWriteState_t *s) {
+  if (s->used > IMAGE_WRITE_BUFFER_SIZE - IMAGE_MAX_RECORD_SIZE) {
+    if (flushBuffer(s) < 0) {
+      return 0;
+    }
+  }
+  return s->buffer + s->used;
+}
+
+/**
+ * Encodes a byte as two hex characters.
+ */
+static inline unsigned char *encodeHex(unsigned char *p, unsigned char byte) {
+  p[0] = hexDigits[byte >> 4];
+  p[1] = hexDigits[byte & 0x0F];
+  return p + 2;
+}
+
+/**
+ * Buffers a single S-record. The record type is adjusted to the size of the
+ * address.
+ */
+static int srecWriteRecord(imageWriteState_t *s, char recType, uint32_t address, const unsigned char *data, int count) {
+  unsigned char *p;
+  int addrSize = 2;
+  unsigned char checksum;
+  int i;
+  
+  if (!(p = recordSpace(s))) {
+    return -1;
+  }
+  
+  // Figure out the address size requirement, and update the record type
+  // accordingly.
+  if (address & 0xFF000000) {
+    addrSize = 4;
+  } else if (address & 0xFFFF0000) {
+    addrSize = 3;
+  }
+  switch (recType) {
+    case '1':
+    case '2':
+    case '3':
+      recType = '1' + (addrSize - 2);
+      break;
+    case '5':
+    case '6':
+      recType = '5' + (addrSize - 2);
+      break;
+    case '7':
+    case '8':
+    case '9':
+      recType = '9' - (addrSize - 2);
+      break;
+  }
+  
+  // Encode the record header.
+  *p++ = 'S';
+  *p++ = recType;
+  p = encodeHex(p, count + addrSize + 1);
+  checksum = count + addrSize + 1;
+  for (i = addrSize - 1; i >= 0; i--) {
+    p = encodeHex(p, address >> (i * 8));
+    checksum += address >> (i * 8);
+  }
+  
+  // Encode the data.
+  for (i = 0; i < count; i++) {
+    p = encodeHex(p, data[i]);
+    checksum += data[i];
+  }
+  
+  // Encode the checksum and newline.
+  p = encodeHex(p, ~checksum);
+  *p++ = '\r';
+  *p++ = '\n';
+  
+  s->used = p - s->buffer;
+  return 0;
+}
+
+/**
+ * Buffers a single Intel HEX record.
+ */
+static int ihexWriteRecord(imageWriteState_t *s, unsigned char recType, uint16_t address, const unsigned char *data, int count) {
+  unsigned char *p;
+  unsigned char checksum;
+  int i;
+  
+  if (!(p = recordSpace(s))) {
+    return -1;
+  }
+  
+  // Encode the record header.
+  *p++ = ':';
+  p = encodeHex(p, count);
+  p = encodeHex(p, address >> 8);
+  p = encodeHex(p, address);
+  p = encodeHex(p, recType);
+  checksum = count + (address >> 8) + address + recType;
+  
+  // Encode the data.
+  for (i = 0; i < count; i++) {
+    p = encodeHex(p, data[i]);
+    checksum += data[i];
+  }
+  
+  // Encode the checksum and newline.
+  p = encodeHex(p, -checksum);
+  *p++ = '\r';
+  *p++ = '\n';
+  
+  s->used = p - s->buffer;
+  return 0;
+}
+
+/**
+ * Creates or overwrites a memory image file of the given type for writing,
+ * and writes the file header if the type has one. If this returns null, an
+ * error occured (which will have been printed). imageWriteClose() must be
+ * called on the returned pointer, if non-null.
+ */
+void *imageWriteOpen(const char *filename, filetype_t ft) {
+  imageWriteState_t *s;
+  
+  if (ft == FT_UNKNOWN) {
+    fprintf(stderr, "Error: unknown file type.\n");
+    return 0;
+  }
+  if (ft == FT_ELF) {
+    fprintf(stderr, "Error: ELF files can only be uploaded.\n");
+    return 0;
+  }
+  
+  // Allocate the state structure.
+  s = (imageWriteState_t*)malloc(sizeof(imageWriteState_t));
+  if (!s) {
+    perror("Failed to allocate memory for image writer");
+    return 0;
+  }
+  s->ft = ft;
+  s->numDataRecords = 0;
+  s->ihexBase = 0;
+  s->used = 0;
+  
+  // Open the file.
+  unlink(filename);
+  s->f = open(filename, O_WRONLY | O_CREAT, 00644);
+  if (s->f < 0) {
+    perror("Failed to open file for writing");
+    free(s);
+    return 0;
+  }
+  
+  // Write header record.
+  if (ft == FT_SREC) {
+    srecWriteRecord(s, '0', 0, (const unsigned char*)"rvex dump", 10);
+  }
+  
+  return s;
+}
+
+/**
+ * Writes the given buffer, starting at the given address, to a memory image.
+ * The data is buffered and written to the file in large chunks. Returns 0 if
+ * successful or -1 if an error occured.
+ */
+int imageWrite(void *state, const unsigned char *buffer, int count, uint32_t address) {
+  imageWriteState_t *s = (imageWriteState_t*)state;
+  
+  // Straight binary data goes into the buffer as is, unless there's so much
+  // of it that copying it is pointless.
+  if (s->ft == FT_STRAIGHT) {
+    if (s->used + count > IMAGE_WRITE_BUFFER_SIZE) {
+      if (flushBuffer(s) < 0) {
+        return -1;
+      }
+    }
+    if (count >= IMAGE_WRITE_BUFFER_SIZE) {
+      return writeAll(s->f, buffer, count);
+    }
+    memcpy(s->buffer + s->used, buffer, count);
+    s->used += count;
+    return 0;
+  }
+  
+  // Split the data up into records.
+  while (count) {
+    int size = (count > IMAGE_RECORD_DATA_SIZE) ? IMAGE_RECORD_DATA_SIZE : count;
+    
+    if (s->ft == FT_SREC) {
+      if (srecWriteRecord(s, '1', address, buffer, size) < 0) {
+        return -1;
+      }
+      s->numDataRecords++;
+    } else {
+      
+      // Intel HEX records can't cross 64 kiB boundaries, and need an
+      // extended linear address record whenever the upper address bits
+      // change.
+      if (size > 0x10000 - (address & 0xFFFF)) {
+        size = 0x10000 - (address & 0xFFFF);
+      }
+      if ((address & 0xFFFF0000) != s->ihexBase) {
+        unsigned char base[2];
+        s->ihexBase = address & 0xFFFF0000;
+        base[0] = address >> 24;
+        base[1] = address >> 16;
+        if (ihexWriteRecord(s, 0x04, 0, base, 2) < 0) {
+          return -1;
+        }
+      }
+      if (ihexWriteRecord(s, 0x00, address, buffer, size) < 0) {
+        return -1;
+      }
+      
+    }
+    
+    buffer += size;
+    count -= size;
+    address += size;
+  }
+  
+  return 0;
+}
+
+/**
+ * Flushes any buffered data and closes a memory image opened by
+ * imageWriteOpen(). The file footer is only written if complete is nonzero.
+ * Returns 0 if successful or -1 if an error occured.
+ */
+int imageWriteClose(void *state, int complete) {
+  imageWriteState_t *s = (imageWriteState_t*)state;
+  int retval = 0;
+  
+  // Write the footer records.
+  if (complete) {
+    if (s->ft == FT_SREC) {
+      
+      // Write record count and termination records.
+      if ((srecWriteRecord(s, '5', s->numDataRecords, 0, 0) < 0)
+        || (srecWriteRecord(s, '7', 0, 0, 0) < 0)) {
+        retval = -1;
+      }
+      
+    } else if (s->ft == FT_IHEX) {
+      
+      // Write end of file record.
+      if (ihexWriteRecord(s, 0x01, 0, 0, 0) < 0) {
+        retval = -1;
+      }
+      
+    }
+  }
+  
+  // Flush the buffer and close the file.
+  if (flushBuffer(s) < 0) {
+    retval = -1;
+  }
+  if (close(s->f) < 0) {
+    perror("Failed to close output file");
+    retval = -1;
+  }
+  free(s);
+  
+  return retval;
+}
@@ -0,0 +1,144 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+#include "types.h"
+#include "main.h"
+
+/**
+ * Opens a memory image file of the given type for reading. The file is
+ * mapped into memory if possible, or read into memory completely otherwise.
+ * If this returns null, an error occured (which will have been printed).
+ * When the file has been read, imageReadClose() must be called on the
+ * returned pointer, if non-null.
+ */
+void *imageReadOpen(const char *filename, filetype_t ft);
+
+/**
+ * Reads data from a memory image. state should be set to the pointer
+ * returned by imageReadOpen(). buffer is the buffer to read to, and count is
+ * the maximum amount of bytes to read. address specifies the address
+ * corresponding to the start of the buffer in image address space; if this
+ * does not match the current address in the image, no bytes will be read and
+ * 0 is returned. When the end of the file has been reached, 0 is returned as
+ * well. If an error occurs, -1 is returned and an error is printed.
+ * Otherwise, this returns the number of bytes written to the buffer.
+ */
+int imageRead(void *state, unsigned char *buffer, int count, uint32_t address);
+
+/**
+ * Returns the total amount of progress units which imageReadProgressDelta()
+ * will report while reading the whole file.
+ */
+int imageReadSize(void *state);
+
+/**
+ * Returns the amount of the file processed since the last call to this
+ * function. For S-record and Intel HEX files, this is the number of
+ * characters parsed; for binary and ELF files it is the number of data bytes
+ * read. Can be used for progress indication.
+ */
+int imageReadProgressDelta(void *state);
+
+/**
+ * Returns nonzero of the end of the file has been reached.
+ */
+int imageReadEof(void *state);
+
+/**
+ * Returns the expected address needed for the next read operation to succeed.
+ */
+uint32_t imageReadExpectedAddress(void *state);
+
+/**
+ * Returns the index'th address range which must be zeroed after the data has
+ * been written, which for ELF files are the .bss areas of the segments.
+ * Adjacent ranges are merged. Returns 1 and sets *address and *size if the
+ * range exists, or 0 if there are no more.
+ */
+int imageReadZeroRange(void *state, int index, uint32_t *address, uint32_t *size);
+
+/**
+ * Looks up the value of the given symbol in the symbol table of an ELF file.
+ * Returns 1 and sets *value if the symbol was found, 0 if it was not or the
+ * file has no symbol table, or -1 if the symbol table is malformed, in which
+ * case an error is printed.
+ */
+int imageReadSymbol(void *state, const char *name, uint32_t *value);
+
+/**
+ * Unmaps the file and frees the state data structure allocated by
+ * imageReadOpen().
+ */
+void imageReadClose(void *state);
+
+/**
+ * Creates or overwrites a memory image file of the given type for writing,
+ * and writes the file header if the type has one. If this returns null, an
+ * error occured (which will have been printed). imageWriteClose() must be
+ * called on the returned pointer, if non-null.
+ */
+void *imageWriteOpen(const char *filename, filetype_t ft);
+
+/**
+ * Writes the given buffer, starting at the given address, to a memory image.
+ * The data is buffered and written to the file in large chunks. Returns 0 if
+ * successful or -1 if an error occured.
+ */
+int imageWrite(void *state, const unsigned char *buffer, int count, uint32_t address);
+
+/**
+ * Flushes any buffered data and closes a memory image opened by
+ * imageWriteOpen(). The file footer is only written if complete is nonzero.
+ * Returns 0 if successful or -1 if an error occured.
+ */
+int imageWriteClose(void *state, int complete);
+
+#endif
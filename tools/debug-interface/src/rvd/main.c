@@ -57,7 +57,7 @@
 #include "parser.h"
 #include "types.h"
 #include "utils.h"
-#include "srec.h"
+#include "image.h"
 #include "rvsrvInterface.h"
 #include "commands/commands.h"
 
@@ -69,6 +69,11 @@ filetype_t interpretFiletype(const char *filetype) {
   if (!strcmp(filetype, "s"))    return FT_SREC;
   if (!strcmp(filetype, "bin"))  return FT_STRAIGHT;
   if (!strcmp(filetype, "b"))    return FT_STRAIGHT;
+  if (!strcmp(filetype, "ihex")) return FT_IHEX;
+  if (!strcmp(filetype, "hex"))  return FT_IHEX;
+  if (!strcmp(filetype, "i"))    return FT_IHEX;
+  if (!strcmp(filetype, "elf"))  return FT_ELF;
+  if (!strcmp(filetype, "e"))    return FT_ELF;
   return FT_UNKNOWN;
 }
 
@@ -106,6 +111,11 @@ int run(commandLineArgs_t *args) {
   ) {
     return runStop(args);
     
+  } else if (
+    (!strcmp(args->command, "serve"))
+  ) {
+    return runServe(args);
+    
   } else if (
     (!strcmp(args->command, "write")) ||
     (!strcmp(args->command, "w"))
@@ -125,7 +135,9 @@ int run(commandLineArgs_t *args) {
     
   } else if (
     (!strcmp(args->command, "upload")) ||
-    (!strcmp(args->command, "up"))
+    (!strcmp(args->command, "up")) ||
+    (!strcmp(args->command, "upload-delta")) ||
+    (!strcmp(args->command, "upd"))
   ) {
     return runUpload(args);
     
@@ -135,6 +147,11 @@ int run(commandLineArgs_t *args) {
   ) {
     return runDownload(args);
     
+  } else if (
+    (!strcmp(args->command, "verify"))
+  ) {
+    return runVerify(args);
+    
   } else if (
     (!strcmp(args->command, "trace"))
   ) {
@@ -332,6 +349,18 @@ int run(commandLineArgs_t *args) {
         "    previous buffer. This can be used to invalidate the preload buffer, by\n"
         "    \"preloading\" a zero-byte block of memory.\n"
         "\n"
+        "  waitFor(address, mask, value)\n"
+        "  waitFor(address, mask, value, timeout)\n"
+        "  waitFor(address, mask, value, timeout, interval)\n"
+        "    Polls the word at address until (word & mask) == value, or until timeout\n"
+        "    milliseconds have passed. Waits indefinitely when timeout is not\n"
+        "    specified. interval specifies the time between polls in microseconds and\n"
+        "    defaults to 1000. The polling is done by rvsrv, so the condition is\n"
+        "    detected within about one interval and only a single round trip is\n"
+        "    needed. Returns the last word read; if it does not satisfy the condition,\n"
+        "    the timeout expired. If any kind of error or a bus fault occurs,\n"
+        "    evaluation is terminated.\n"
+        "\n"
         "  readPreload(address)\n"
         "  readBytePreload(address)\n"
         "  readHalfPreload(address)\n"
@@ -56,7 +56,7 @@
  * Enumeration for the supported binary file types.
  */
 typedef enum {
-  FT_UNKNOWN, FT_STRAIGHT, FT_SREC
+  FT_UNKNOWN, FT_STRAIGHT, FT_SREC, FT_IHEX, FT_ELF
 } filetype_t;
 
 /**
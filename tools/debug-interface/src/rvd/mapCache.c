@@ -0,0 +1,390 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mapCache.h"
+#include "definitions.h"
+#include "parser.h"
+#include "readFile.h"
+
+/**
+ * A map cache file consists of a header, followed by an array of entries, one
+ * for each definition which was registered while parsing the map, in order,
+ * followed by a table of null-terminated strings which the entries refer to.
+ * Everything is in native byte order; the cache is only meant to be used on
+ * the machine which wrote it. The version must be incremented whenever the
+ * format changes or the parser starts accepting different expansions.
+ */
+#define MAP_CACHE_MAGIC   "rvdmapc"
+#define MAP_CACHE_VERSION 1
+
+/**
+ * Map cache file header.
+ */
+typedef struct {
+  
+  /**
+   * MAP_CACHE_MAGIC, null-terminated.
+   */
+  char magic[8];
+  
+  /**
+   * MAP_CACHE_VERSION.
+   */
+  uint32_t version;
+  
+  /**
+   * Number of entries following the header.
+   */
+  uint32_t numEntries;
+  
+  /**
+   * Size of the string table following the entries.
+   */
+  uint32_t stringsSize;
+  uint32_t reserved;
+  
+  /**
+   * Identification of the map file which the cache was made from. The cache
+   * is only used if the map file still matches.
+   */
+  uint64_t srcDev;
+  uint64_t srcIno;
+  uint64_t srcSize;
+  int64_t srcMtimeSec;
+  int64_t srcMtimeNsec;
+  
+} mapCacheHeader_t;
+
+/**
+ * Map cache file entry.
+ */
+typedef struct {
+  
+  /**
+   * Context mask of the definition.
+   */
+  uint32_t mask;
+  
+  /**
+   * Hash of the definition name as returned by defs_hash().
+   */
+  uint32_t hash;
+  
+  /**
+   * Offsets of the definition name and expansion in the string table.
+   */
+  uint32_t def;
+  uint32_t expansion;
+  
+} mapCacheEntry_t;
+
+/**
+ * Definitions recorded while parsing a map, to be written to a cache file.
+ */
+typedef struct {
+  mapCacheEntry_t *entries;
+  uint32_t numEntries;
+  uint32_t entriesCap;
+  char *strings;
+  uint32_t stringsSize;
+  uint32_t stringsCap;
+} recording_t;
+
+/**
+ * Returns the path of the cache file for the map at path, or null if malloc
+ * fails. The returned string should be freed by the caller.
+ */
+static char *getCachePath(const char *path) {
+  const char *name;
+  char *cachePath;
+  
+  name = strrchr(path, '/');
+  name = name ? name + 1 : path;
+  
+  cachePath = (char*)malloc(strlen(path) + 7);
+  if (!cachePath) {
+    return 0;
+  }
+  sprintf(cachePath, "%.*s.%s.rvdc", (int)(name - path), path, name);
+  return cachePath;
+}
+
+/**
+ * Registers the definitions from the cache file at cachePath if it is valid
+ * and belongs to the map file described by st. Returns 1 if successful, 0 if
+ * the cache file does not exist or cannot be used, or -1 if a fatal error
+ * occured.
+ */
+static int loadCache(const char *cachePath, const struct stat *st) {
+  const mapCacheHeader_t *header;
+  const mapCacheEntry_t *entries;
+  const char *strings;
+  struct stat cacheSt;
+  void *map;
+  uint32_t i;
+  int retval = 1;
+  int f;
+  
+  // Map the cache file.
+  f = open(cachePath, O_RDONLY);
+  if (f < 0) {
+    return 0;
+  }
+  if ((fstat(f, &cacheSt) < 0) || (cacheSt.st_size < sizeof(mapCacheHeader_t))) {
+    close(f);
+    return 0;
+  }
+  map = mmap(0, cacheSt.st_size, PROT_READ, MAP_PRIVATE, f, 0);
+  close(f);
+  if (map == MAP_FAILED) {
+    return 0;
+  }
+  header = (const mapCacheHeader_t*)map;
+  entries = (const mapCacheEntry_t*)(header + 1);
+  strings = (const char*)(entries + header->numEntries);
+  
+  // Make sure the cache belongs to the map file and is consistent.
+  if (
+    memcmp(header->magic, MAP_CACHE_MAGIC, sizeof(header->magic)) ||
+    (header->version != MAP_CACHE_VERSION) ||
+    (header->srcDev != st->st_dev) ||
+    (header->srcIno != st->st_ino) ||
+    (header->srcSize != st->st_size) ||
+    (header->srcMtimeSec != st->st_mtim.tv_sec) ||
+    (header->srcMtimeNsec != st->st_mtim.tv_nsec) ||
+    (cacheSt.st_size != sizeof(mapCacheHeader_t)
+      + (uint64_t)header->numEntries * sizeof(mapCacheEntry_t)
+      + header->stringsSize) ||
+    (header->stringsSize && strings[header->stringsSize - 1])
+  ) {
+    munmap(map, cacheSt.st_size);
+    return 0;
+  }
+  for (i = 0; i < header->numEntries; i++) {
+    if ((entries[i].def >= header->stringsSize) || (entries[i].expansion >= header->stringsSize)) {
+      munmap(map, cacheSt.st_size);
+      return 0;
+    }
+  }
+  
+  // Register the definitions. The expansions were syntax-checked when the
+  // cache was written.
+  for (i = 0; i < header->numEntries; i++) {
+    if (defs_registerHashed(
+      entries[i].mask,
+      strings + entries[i].def,
+      strings + entries[i].expansion,
+      entries[i].hash
+    ) < 0) {
+      retval = -1;
+      break;
+    }
+  }
+  
+  munmap(map, cacheSt.st_size);
+  return retval;
+}
+
+/**
+ * Appends a null-terminated string to the string table of a recording.
+ * Returns the offset of the string, or -1 if malloc fails.
+ */
+static int64_t recordString(recording_t *rec, const char *str) {
+  uint32_t len = strlen(str) + 1;
+  uint32_t offset;
+  char *strings;
+  
+  if (rec->stringsSize + len > rec->stringsCap) {
+    rec->stringsCap = (rec->stringsCap + len) * 2;
+    strings = (char*)realloc(rec->strings, rec->stringsCap);
+    if (!strings) {
+      return -1;
+    }
+    rec->strings = strings;
+  }
+  offset = rec->stringsSize;
+  memcpy(rec->strings + offset, str, len);
+  rec->stringsSize += len;
+  return offset;
+}
+
+/**
+ * Definition listener which records the definitions registered while parsing
+ * a map. Returns 0 if successful or -1 if malloc fails.
+ */
+static int recordDefinition(void *data, contextMask_t mask, const char *def, const char *expansion) {
+  recording_t *rec = (recording_t*)data;
+  mapCacheEntry_t *entries;
+  int64_t defOffset, expOffset;
+  
+  if (rec->numEntries == rec->entriesCap) {
+    rec->entriesCap = rec->entriesCap ? rec->entriesCap * 2 : 256;
+    entries = (mapCacheEntry_t*)realloc(rec->entries, rec->entriesCap * sizeof(mapCacheEntry_t));
+    if (!entries) {
+      perror("Failed to allocate memory for map cache");
+      return -1;
+    }
+    rec->entries = entries;
+  }
+  
+  defOffset = recordString(rec, def);
+  expOffset = recordString(rec, expansion);
+  if ((defOffset < 0) || (expOffset < 0)) {
+    perror("Failed to allocate memory for map cache");
+    return -1;
+  }
+  
+  rec->entries[rec->numEntries].mask = mask;
+  rec->entries[rec->numEntries].hash = defs_hash(def);
+  rec->entries[rec->numEntries].def = defOffset;
+  rec->entries[rec->numEntries].expansion = expOffset;
+  rec->numEntries++;
+  return 0;
+}
+
+/**
+ * Writes a recording to the cache file at cachePath for the map file described
+ * by st. The file is written under a temporary name first, so concurrent rvd
+ * processes never see a partial cache file. Failure is silently ignored; the
+ * map will just be parsed again next time.
+ */
+static void writeCache(const char *cachePath, const struct stat *st, const recording_t *rec) {
+  mapCacheHeader_t header;
+  char *tempPath;
+  FILE *f;
+  int ok;
+  
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAP_CACHE_MAGIC, sizeof(header.magic));
+  header.version = MAP_CACHE_VERSION;
+  header.numEntries = rec->numEntries;
+  header.stringsSize = rec->stringsSize;
+  header.srcDev = st->st_dev;
+  header.srcIno = st->st_ino;
+  header.srcSize = st->st_size;
+  header.srcMtimeSec = st->st_mtim.tv_sec;
+  header.srcMtimeNsec = st->st_mtim.tv_nsec;
+  
+  if (asprintf(&tempPath, "%s.%d", cachePath, (int)getpid()) < 0) {
+    return;
+  }
+  f = fopen(tempPath, "wb");
+  if (!f) {
+    free(tempPath);
+    return;
+  }
+  ok = (fwrite(&header, sizeof(header), 1, f) == 1)
+    && (fwrite(rec->entries, sizeof(mapCacheEntry_t), rec->numEntries, f) == rec->numEntries)
+    && (fwrite(rec->strings, 1, rec->stringsSize, f) == rec->stringsSize);
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || (rename(tempPath, cachePath) < 0)) {
+    unlink(tempPath);
+  }
+  free(tempPath);
+}
+
+/**
+ * Loads the memory map file at path, using or updating its cache file.
+ * Returns 1 if successful, 0 if there was a parse error, in which case an
+ * error message is printed using errorPrefix, or -1 if a fatal error occured.
+ */
+int mapCache_load(const char *path, const char *errorPrefix) {
+  recording_t rec;
+  struct stat st, newSt;
+  char *cachePath = 0;
+  char *buf;
+  int retval;
+  
+  // Try the cache file first.
+  if (stat(path, &st) >= 0) {
+    cachePath = getCachePath(path);
+  }
+  if (cachePath) {
+    retval = loadCache(cachePath, &st);
+    if (retval) {
+      free(cachePath);
+      return retval;
+    }
+  }
+  
+  // Parse the map file, recording the definitions it registers if we can
+  // write a cache file.
+  buf = readFile(path, 0, 0);
+  memset(&rec, 0, sizeof(rec));
+  if (cachePath) {
+    defs_setListener(recordDefinition, &rec);
+  }
+  retval = parseDefs(buf, errorPrefix);
+  defs_setListener(0, 0);
+  free(buf);
+  
+  // Only cache maps without errors, so the errors are reported every time,
+  // and only if the map did not change while we were reading it.
+  if (cachePath && (retval == 1) && (stat(path, &newSt) >= 0)
+    && (newSt.st_size == st.st_size)
+    && (newSt.st_mtim.tv_sec == st.st_mtim.tv_sec)
+    && (newSt.st_mtim.tv_nsec == st.st_mtim.tv_nsec)
+  ) {
+    writeCache(cachePath, &st, &rec);
+  }
+  
+  free(rec.entries);
+  free(rec.strings);
+  free(cachePath);
+  return retval;
+}
@@ -443,93 +443,585 @@ static int scanString(const char **str, char **s) {
   
 }
 
-// Forward declaration to scanExpression for recursive calls.
-static int scanExpression(const char **str, value_t *value, int depth);
+/**
+ * Defines the type of a node in a compiled expression.
+ */
+typedef enum {
+  NODE_LITERAL,    // Integer literal
+  NODE_NEGATE,     // -operand
+  NODE_INVERT,     // ~operand
+  NODE_NOT,        // !operand
+  NODE_OPERATOR,   // operand, operator, [expression]
+  NODE_REFERENCE,  // Definition
+  NODE_READ,       // read*(address)
+  NODE_WRITE,      // write*(address, value)
+  NODE_PRELOAD,    // preload(address, count)
+  NODE_PRINTF,     // printf(format, ...)
+  NODE_DEF,        // def(name, expression)
+  NODE_SET,        // set(name, expression)
+  NODE_IF,         // if(condition, command [, command])
+  NODE_PRIORITIZE, // prioritize(condition, command, ...)
+  NODE_WHILE,      // while(condition, command)
+  NODE_WAIT_FOR,   // waitFor(address, mask, value [, timeout [, interval]])
+  NODE_DELAY       // delay_ms(time)
+} nodeType_t;
 
 /**
- * Scans and evaluates an operand. Returns 0 on failure, in which ase *str and
- * value are unaffected, and scanError is set. Whenever a definition is
- * resolved, depth is decremented in subsequent calls. When depth is zero,
- * definition resolution will result in an error. This prevents hangs on
- * circular definitions. Returns -1 if a fatal error occured.
- * 
- * Depth specifies how many definition expansions are still allowed (to avoid
- * hanging on loops). When this is set to -1, definitions are silently not
- * extended at all, useful for syntax checking without evaluation.
+ * Node in a compiled expression.
  */
-static int scanOperand(const char **str, value_t *value, int depth) {
+typedef struct _node_t {
   
-  const char *ptr = *str;
-  value_t v = {0, AS_UNDEFINED};
+  /**
+   * Type of this node.
+   */
+  nodeType_t type;
+  
+  /**
+   * Value for literals.
+   */
+  value_t value;
+  
+  /**
+   * Operator for operator nodes.
+   */
+  operator_t op;
+  
+  /**
+   * Access size for reads and writes. AS_UNDEFINED for write() means that the
+   * access size of the value is used.
+   */
+  accessSize_t size;
+  
+  /**
+   * Nonzero for reads which may be served by the preload buffer.
+   */
+  int preload;
+  
+  /**
+   * Definition name for references, def() and set().
+   */
+  char *name;
+  
+  /**
+   * Expansion text for def().
+   */
+  char *text;
+  
+  /**
+   * Null-terminated list of printf() format string pieces. Piece i contains
+   * the format specifier for argument i, the piece after the last argument
+   * contains the remainder of the format string.
+   */
+  char **format;
+  
+  /**
+   * Operands or function arguments. Operator nodes have only one operand
+   * when the optional second operand of the semicolon operator is omitted.
+   */
+  struct _node_t **args;
+  int numArgs;
+  
+  /**
+   * Position reported when running this node fails. This points into the
+   * source of the expression.
+   */
+  const char *errorPos;
+  
+} node_t;
+
+/**
+ * Compiled expression.
+ */
+struct compiledExpr {
+  
+  /**
+   * Reference count. The definition table holds a reference to the compiled
+   * expansions it caches, and evaluation holds one while it runs, because the
+   * expansion may redefine itself.
+   */
+  int refs;
+  
+  /**
+   * Copy of the source which the nodes point into, or null if the source is
+   * owned by the caller.
+   */
+  char *source;
+  
+  /**
+   * Root node of the expression tree.
+   */
+  node_t *root;
+  
+};
+
+/**
+ * Allocates a node of the given type. Prints an error and returns null if
+ * malloc fails.
+ */
+static node_t *newNode(nodeType_t type) {
+  node_t *node;
+  
+  node = (node_t*)calloc(1, sizeof(node_t));
+  if (!node) {
+    perror("Failed to allocate memory while parsing");
+    return 0;
+  }
+  node->type = type;
+  return node;
+}
+
+/**
+ * Frees a node and all its children.
+ */
+static void freeNode(node_t *node) {
+  int i;
+  
+  if (!node) {
+    return;
+  }
+  
+  for (i = 0; i < node->numArgs; i++) {
+    freeNode(node->args[i]);
+  }
+  if (node->format) {
+    for (i = 0; node->format[i]; i++) {
+      free(node->format[i]);
+    }
+    free(node->format);
+  }
+  free(node->args);
+  free(node->name);
+  free(node->text);
+  free(node);
+}
+
+/**
+ * Appends an operand or function argument to a node. Returns 1 if successful.
+ * Otherwise, arg is freed, an error is printed and -1 is returned.
+ */
+static int addArg(node_t *node, node_t *arg) {
+  node_t **args;
+  
+  args = (node_t**)realloc(node->args, (node->numArgs + 1) * sizeof(node_t*));
+  if (!args) {
+    perror("Failed to allocate memory while parsing");
+    freeNode(arg);
+    return -1;
+  }
+  node->args = args;
+  node->args[node->numArgs++] = arg;
+  return 1;
+}
+
+/**
+ * Appends a piece of a printf() format string to the null-terminated list of
+ * pieces of a node. Returns 1 if successful or -1 after printing an error if
+ * malloc fails.
+ */
+static int addFormat(node_t *node, const char *start, int len) {
+  char **format;
+  int count = 0;
+  
+  // Count the pieces we already have.
+  while (node->format && node->format[count]) {
+    count++;
+  }
+  
+  // Make room for the new piece and the null terminator.
+  format = (char**)realloc(node->format, (count + 2) * sizeof(char*));
+  if (!format) {
+    perror("Failed to allocate memory while parsing");
+    return -1;
+  }
+  node->format = format;
+  format[count] = 0;
+  
+  // Copy the piece.
+  format[count] = (char*)malloc(len + 1);
+  if (!format[count]) {
+    perror("Failed to allocate memory while parsing");
+    return -1;
+  }
+  memcpy(format[count], start, len);
+  format[count][len] = 0;
+  format[count + 1] = 0;
+  return 1;
+}
+
+/**
+ * Scans the given punctuation character. Returns 1 if successful, in which case
+ * *str is moved to the next token, or 0 if the character is not there, in
+ * which case scanError is set.
+ */
+static int scanChar(const char **str, char c) {
+  if (**str != c) {
+    sprintf(scanError, "expected '%c'", c);
+    scanErrorPos = *str;
+    return 0;
+  }
+  (*str)++;
+  scanWhitespace(str);
+  return 1;
+}
+
+// Forward declaration to compileExpression for recursive calls.
+static int compileExpression(const char **str, node_t **result);
+
+/**
+ * Compiles an expression and appends it as an argument to node. Returns 1 if
+ * successful, 0 on failure, in which case scanError is set, or -1 if a fatal
+ * error occured.
+ */
+static int compileArg(const char **str, node_t *node) {
+  node_t *arg;
+  int retval;
+  
+  if ((retval = compileExpression(str, &arg)) < 1) {
+    return retval;
+  }
+  return addArg(node, arg);
+}
+
+/**
+ * Compiles count comma-separated arguments and the close parenthesis of a
+ * function call. Returns 1 if successful, 0 on failure, in which case
+ * scanError is set, or -1 if a fatal error occured.
+ */
+static int compileArgs(const char **str, node_t *node, int count) {
+  int retval;
+  
+  while (count--) {
+    if ((retval = compileArg(str, node)) < 1) {
+      return retval;
+    }
+    if (!scanChar(str, count ? ',' : ')')) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Compiles the arguments of if(), prioritize() and waitFor(), which take a
+ * variable number of arguments, and the close parenthesis. minArgs and
+ * maxArgs specify the allowed number of arguments; maxArgs may be -1 for no
+ * limit. If pairs is nonzero, the arguments come in pairs. Returns 1 if
+ * successful, 0 on failure, in which case scanError is set, or -1 if a fatal
+ * error occured.
+ */
+static int compileVarArgs(const char **str, node_t *node, int minArgs, int maxArgs, int pairs) {
   int retval;
   
-  if (*ptr == '-') {
+  while (1) {
     
-    // Scan and execute negate operator.
-    ptr++;
-    scanWhitespace(&ptr);
-    if ((retval = scanOperand(&ptr, &v, depth)) < 1) {
+    // Compile the next argument.
+    if ((retval = compileArg(str, node)) < 1) {
       return retval;
     }
-    v.value = -v.value;
     
-  } else if (*ptr == '~') {
+    // Stop when we've reached the maximum or there are no more arguments.
+    if (node->numArgs == maxArgs) {
+      break;
+    }
+    if ((**str != ',') && (node->numArgs >= minArgs) && !(pairs && (node->numArgs & 1))) {
+      break;
+    }
+    
+    // Scan the comma.
+    if (!scanChar(str, ',')) {
+      return 0;
+    }
+  
+  }
+  
+  // Scan the close parenthesis.
+  if (pairs && (**str != ')')) {
+    sprintf(scanError, "expected ',' or ')'");
+    scanErrorPos = *str;
+    return 0;
+  }
+  return scanChar(str, ')');
+}
+
+/**
+ * Compiles the arguments of printf(). Returns 1 if successful, 0 on failure,
+ * in which case scanError is set, or -1 if a fatal error occured.
+ */
+static int compilePrintf(const char **str, node_t *node) {
+  const char *ptr = *str;
+  char *fmt, *fmtPtr, *fmtStart;
+  int retval;
+  
+  // Scan the format string.
+  if ((retval = scanString(&ptr, &fmt)) < 1) {
+    free(fmt);
+    return retval;
+  }
+  
+  // We can't pass a list of arguments to printf of which the size is unknown
+  // at compile time, so we need to scan for printf format specifiers
+  // ourselves. The format string is split up into pieces with one format
+  // specifier each, so we can still invoke printf to convert them.
+  fmtPtr = fmt;
+  fmtStart = fmtPtr;
+  while (*fmtPtr) {
     
-    // Scan and execute inverse operator.
-    ptr++;
-    scanWhitespace(&ptr);
-    if ((retval = scanOperand(&ptr, &v, depth)) < 1) {
-      return retval;
+    // Handle format specifiers.
+    if (*fmtPtr++ == '%') {
+      int brk = 0;
+      
+      // Scan characters until we reach a known format specifier or
+      // something illegal.
+      while (!brk) {
+        
+        switch (*fmtPtr++) {
+          
+          // Pass by characters which are perfectly fine.
+          case '-':
+          case '+':
+          case ' ':
+          case '#':
+          case '0':
+          case '1':
+          case '2':
+          case '3':
+          case '4':
+          case '5':
+          case '6':
+          case '7':
+          case '8':
+          case '9':
+          case '.':
+            break;
+          
+          // Handle supported format specifiers.
+          case 'd':
+          case 'i':
+          case 'u':
+          case 'o':
+          case 'x':
+          case 'X':
+            
+            // Scan the comma before the operand which we're printing.
+            if (!scanChar(&ptr, ',')) {
+              free(fmt);
+              return 0;
+            }
+            
+            // Compile the value to print.
+            if ((retval = compileArg(&ptr, node)) < 1) {
+              free(fmt);
+              return retval;
+            }
+            
+            // Store the piece of the format string which prints it. The next
+            // piece starts here.
+            if (addFormat(node, fmtStart, fmtPtr - fmtStart) < 0) {
+              free(fmt);
+              return -1;
+            }
+            fmtStart = fmtPtr;
+            
+            // Break out of format specifier loop.
+            brk = 1;
+            break;
+          
+          // Handle unsupported format specifiers.
+          case 'f':
+          case 'F':
+          case 'e':
+          case 'E':
+          case 'g':
+          case 'G':
+          case 'a':
+          case 'A':
+          case 'c':
+          case 's':
+          case 'p':
+          case 'n':
+            sprintf(scanError, "unsupported format specifier %c", *(fmtPtr-1));
+            scanErrorPos = ptr;
+            free(fmt);
+            return 0;
+          
+          // Handle unexpected nul character.
+          case 0:
+            sprintf(scanError, "improperly terminated format specifier");
+            scanErrorPos = ptr;
+            free(fmt);
+            return 0;
+          
+          // Handle unexpected nul character.
+          default:
+            sprintf(scanError, "illegal or unsupported character %c in format specifier", *(fmtPtr-1));
+            scanErrorPos = ptr;
+            free(fmt);
+            return 0;
+        
+        }
+      
+      }
+    
+    }
+  
+  }
+  
+  // Store the remainder of the format string.
+  retval = addFormat(node, fmtStart, strlen(fmtStart));
+  free(fmt);
+  if (retval < 0) {
+    return -1;
+  }
+  
+  // Scan the the close parenthesis now that we've reached the end of the
+  // format string.
+  if (!scanChar(&ptr, ')')) {
+    return 0;
+  }
+  
+  *str = ptr;
+  return 1;
+}
+
+/**
+ * Compiles the arguments of def() and set(). Returns 1 if successful, 0 on
+ * failure, in which case scanError is set, or -1 if a fatal error occured.
+ */
+static int compileDefSet(const char **str, node_t *node) {
+  const char *ptr = *str;
+  const char *expStart;
+  node_t *arg;
+  int retval;
+  int len;
+  
+  // Scan the name of the definition.
+  switch (scanIdentifier(&ptr, &node->name)) {
+    case 0:
+      sprintf(scanError, "definition name expected");
+      scanErrorPos = ptr;
+      return 0;
+    
+    case 1:
+      break;
+    
+    default:
+      return -1;
+  
+  }
+  
+  // Make sure the definition name was properly allocated.
+  if (!node->name) {
+    perror("Failed to allocate memory while parsing");
+    return -1;
+  }
+  
+  // Scan the comma.
+  if (!scanChar(&ptr, ',')) {
+    return 0;
+  }
+  
+  // Compile the value/expression. set() runs it; def() only needs it to be
+  // syntax-checked, because its source text is what gets registered.
+  expStart = ptr;
+  if ((retval = compileExpression(&ptr, &arg)) < 1) {
+    return retval;
+  }
+  if (node->type == NODE_SET) {
+    if (addArg(node, arg) < 0) {
+      return -1;
     }
-    v.value = ~v.value;
+  } else {
+    freeNode(arg);
     
-  } else if (*ptr == '!') {
+    // Copy what we've just scanned into a new string so we can null
+    // terminate it.
+    len = ptr - expStart;
+    node->text = (char*)malloc(len + 1);
+    if (!node->text) {
+      perror("Failed to allocated memory while parsing");
+      return -1;
+    }
+    memcpy(node->text, expStart, len);
+    node->text[len] = 0;
+  
+  }
+  
+  // Scan the close parenthesis.
+  if (!scanChar(&ptr, ')')) {
+    return 0;
+  }
+  
+  *str = ptr;
+  return 1;
+}
+
+/**
+ * Compiles an operand. Returns 1 if successful, in which case *result is set
+ * to the compiled operand and *str is moved to the next token. Returns 0 on
+ * failure, in which case *str and *result are unaffected, and scanError is
+ * set. Returns -1 if a fatal error occured.
+ */
+static int compileOperand(const char **str, node_t **result) {
+  
+  const char *ptr = *str;
+  node_t *node = 0;
+  node_t *operand;
+  int retval = 1;
+  
+  if ((*ptr == '-') || (*ptr == '~') || (*ptr == '!')) {
     
-    // Scan and execute not operator.
+    // Compile negate, inverse or not operator.
+    switch (*ptr) {
+      case '-': node = newNode(NODE_NEGATE); break;
+      case '~': node = newNode(NODE_INVERT); break;
+      default:  node = newNode(NODE_NOT);    break;
+    }
+    if (!node) {
+      return -1;
+    }
     ptr++;
     scanWhitespace(&ptr);
-    if ((retval = scanOperand(&ptr, &v, depth)) < 1) {
-      return retval;
+    if ((retval = compileOperand(&ptr, &operand)) >= 1) {
+      retval = addArg(node, operand);
     }
-    v.value = !v.value;
-    
+  
   } else if (*ptr == '(') {
     
     // Scan open bracket.
     ptr++;
     scanWhitespace(&ptr);
     
-    // Scan expression.
-    if ((retval = scanExpression(&ptr, &v, depth)) < 1) {
+    // Compile expression.
+    if ((retval = compileExpression(&ptr, &node)) < 1) {
       return retval;
     }
     
     // Scan close bracket.
-    if (*ptr != ')') {
-      sprintf(scanError, "expected ')'");
-      scanErrorPos = ptr;
-      return 0;
-    }
-    ptr++;
-    scanWhitespace(&ptr);
-    
+    retval = scanChar(&ptr, ')');
+  
   } else if (isdigit(*ptr)) {
     
     // Scan integer literal.
-    switch (scanLiteral(&ptr, &v)) {
+    node = newNode(NODE_LITERAL);
+    if (!node) {
+      return -1;
+    }
+    switch (scanLiteral(&ptr, &node->value)) {
       case 0:
         sprintf(scanError, "invalid integer literal");
         scanErrorPos = ptr;
-        return 0;
-        
+        retval = 0;
+        break;
+      
       case 1:
         break;
-        
-      default:
-        return -1;
       
-    }
+      default:
+        retval = -1;
+        break;
     
+    }
+  
   } else {
     const char *defStart = ptr;
     char *name;
@@ -540,13 +1032,13 @@ static int scanOperand(const char **str, value_t *value, int depth) {
         sprintf(scanError, "operand expected");
         scanErrorPos = ptr;
         return 0;
-        
+      
       case 1:
         break;
-        
+      
       default:
         return -1;
-      
+    
     }
     
     // Make sure name was properly allocated.
@@ -561,7 +1053,6 @@ static int scanOperand(const char **str, value_t *value, int depth) {
       ptr++;
       scanWhitespace(&ptr);
       
-      // ----------------------------------------------------------------------
       if (
         (!strcmp(name, "read")) ||
         (!strcmp(name, "readByte")) ||
@@ -572,750 +1063,77 @@ static int scanOperand(const char **str, value_t *value, int depth) {
         (!strcmp(name, "readHalfPreload")) ||
         (!strcmp(name, "readWordPreload"))
       ) {
-        int size;
-        uint32_t readVal;
-        char id;
-        int enablePreload;
-        
-        // Store an identifying character of the command name, then free the
-        // command.
-        id = name[4];
-        enablePreload = strlen(name) > 8;
-        free(name);
-        name = 0;
-        
-        // Scan the address.
-        if ((retval = scanExpression(&ptr, &v, depth)) < 1) {
-          return retval;
-        }
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Don't do anything when depth is -1. This is used to just check for
-        // syntax errors.
-        if (depth != -1) {
-          
-          // Determine the access size.
-          switch (id) {
-            case 'B': size = 1; v.size = AS_BYTE; break;
-            case 'H': size = 2; v.size = AS_HALF; break;
-            default : size = 4; v.size = AS_WORD; break;
+        if ((node = newNode(NODE_READ))) {
+          switch (name[4]) {
+            case 'B': node->size = AS_BYTE; break;
+            case 'H': node->size = AS_HALF; break;
+            default : node->size = AS_WORD; break;
           }
-          
-          // If this is a preload-enabled read, first see if the preload buffer
-          // contains the requested data. If it does, we don't need to query
-          // the rvex for the value.
-          if (enablePreload) {
-            switch (preload_read(v.value, &readVal, size)) {
-              case 0:
-                // Not preloaded.
-                enablePreload = 0;
-              case 1:
-                break;
-                
-              default:
-                return -1;
-                
-            }
-          }
-          
-          // Perform the access if the value was not preloaded.
-          if (!enablePreload) {
-            switch (rvsrv_readSingle(v.value, &readVal, size)) {
-              case 0:
-                sprintf(scanError, "failed to read from address 0x%08X; bus fault 0x%08X", v.value, readVal);
-                scanErrorPos = ptr;
-                return 0;
-                
-              case 1:
-                break;
-                
-              default:
-                return -1;
-                
-            }
-          }
-          
-          // Return the read value.
-          v.value = readVal;
-          
+          node->preload = strlen(name) > 8;
+          retval = compileArgs(&ptr, node, 1);
         }
-        
-      // ----------------------------------------------------------------------
+      
       } else if (
-        (!strcmp(name, "write")) || 
-        (!strcmp(name, "writeByte")) || 
-        (!strcmp(name, "writeHalf")) || 
+        (!strcmp(name, "write")) ||
+        (!strcmp(name, "writeByte")) ||
+        (!strcmp(name, "writeHalf")) ||
         (!strcmp(name, "writeWord"))
       ) {
-        int size;
-        uint32_t fault;
-        value_t address;
-        char id;
-        
-        // Store an identifying character of the command name, then free the
-        // command.
-        id = name[5];
-        free(name);
-        name = 0;
-        
-        // Scan the address.
-        if ((retval = scanExpression(&ptr, &address, depth)) < 1) {
-          return retval;
-        }
-        
-        // Scan the comma.
-        if (*ptr != ',') {
-          sprintf(scanError, "expected ','");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Scan the value to write.
-        if ((retval = scanExpression(&ptr, &v, depth)) < 1) {
-          return retval;
-        }
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Don't do anything when depth is -1. This is used to just check for
-        // syntax errors.
-        if (depth != -1) {
-          
-          // Determine the access size.
-          switch (id) {
-            case 'B': v.size = AS_BYTE; break;
-            case 'H': v.size = AS_HALF; break;
-            case 'W': v.size = AS_WORD; break;
-          }
-          switch (v.size) {
-            case AS_BYTE: size = 1; break;
-            case AS_HALF: size = 2; break;
-            default:      size = 4; break;
-          }
-          
-          // Perform the access.
-          switch (rvsrv_writeSingle(address.value, v.value, size, &fault)) {
-            case 0:
-              sprintf(scanError, "failed to write to address 0x%08X; bus fault 0x%08X", address.value, fault);
-              scanErrorPos = ptr;
-              return 0;
-              
-            case 1:
-              break;
-              
-            default:
-              return -1;
-              
-          }
-          
-        }
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "preload"))
-      ) {
-        value_t address;
-        value_t count;
-        uint32_t fault;
-        
-        // We don't need the name anymore.
-        free(name);
-        name = 0;
-        
-        // Scan the start address.
-        if ((retval = scanExpression(&ptr, &address, depth)) < 1) {
-          return retval;
-        }
-        
-        // Scan the comma.
-        if (*ptr != ',') {
-          sprintf(scanError, "expected ','");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Scan the number of bytes to preload.
-        if ((retval = scanExpression(&ptr, &count, depth)) < 1) {
-          return retval;
-        }
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Don't do anything when depth is -1. This is used to just check for
-        // syntax errors.
-        if (depth != -1) {
-          
-          // Execute the preload command.
-          switch (preload_load(address.value, count.value, &fault)) {
-            case 0:
-              sprintf(
-                scanError,
-                "failed to preload address 0x%08X..0x%08X; bus fault 0x%08X",
-                address.value, address.value + count.value - 1, fault
-              );
-              scanErrorPos = ptr;
-              return 0;
-              
-            case 1:
-              break;
-              
-            default:
-              return -1;
-              
-          }
-          
-          // Always return 0.
-          v.value = 0;
-          v.size = AS_UNDEFINED;
-          
-        }
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "printf"))
-      ) {
-        char *fmt, *fmtPtr, *fmtStart;
-        
-        // We don't need the name anymore.
-        free(name);
-        name = 0;
-        
-        // Scan the format string.
-        if ((retval = scanString(&ptr, &fmt)) < 1) {
-          return retval;
-        }
-        
-        // We can't pass a list of arguments to printf of which the size is
-        // unknown at compile time, so we need to scan for printf format
-        // specifiers ourselves. We still invoke printf to convert them though.
-        fmtPtr = fmt;
-        fmtStart = fmtPtr;
-        while (*fmtPtr) {
-          
-          // Handle format specifiers.
-          if (*fmtPtr++ == '%') {
-            int brk = 0;
-            char c;
-            
-            // Scan characters until we reach a known format specifier or
-            // something illegal.
-            while (!brk) {
-              
-              switch (*fmtPtr++) {
-                
-                // Pass by characters which are perfectly fine.
-                case '-':
-                case '+':
-                case ' ':
-                case '#':
-                case '0':
-                case '1':
-                case '2':
-                case '3':
-                case '4':
-                case '5':
-                case '6':
-                case '7':
-                case '8':
-                case '9':
-                case '.':
-                  break;
-                  
-                // Handle supported format specifiers.
-                case 'd':
-                case 'i':
-                case 'u':
-                case 'o':
-                case 'x':
-                case 'X':
-                  
-                  // Scan the comma before the operand which we're printing.free(name);
-                  if (*ptr != ',') {
-                    sprintf(scanError, "expected ','");
-                    scanErrorPos = ptr;
-                    free(fmt);
-                    return 0;
-                  }
-                  ptr++;
-                  scanWhitespace(&ptr);
-                  
-                  // Scan the value to print.
-                  if ((retval = scanExpression(&ptr, &v, depth)) < 1) {
-                    free(fmt);
-                    return retval;
-                  }
-                  
-                  // Trim the value by the size of its apparent type.
-                  if (v.size == AS_BYTE) {
-                    v.value &= 0xFF;
-                  } else if (v.size == AS_HALF) {
-                    v.value &= 0xFFFF;
-                  }
-                  
-                  // Don't print if we're just syntax-checking.
-                  if (depth != -1) {
-                    
-                    // We're ready to call printf now. However, we must make sure
-                    // that we null terminate the format string where we're
-                    // currently scanning (otherwise it would just try to print
-                    // the entire format string, which is what we're trying to
-                    // avoid). To do so, we temporarily insert a nul.
-                    c = *fmtPtr;
-                    *fmtPtr = 0;
-                    printf(fmtStart, v.value);
-                    *fmtPtr = c;
-                    
-                  }
-                  
-                  // The next time we call printf, start here.
-                  fmtStart = fmtPtr;
-                  
-                  // Break out of format specifier loop.
-                  brk = 1;
-                  break;
-                  
-                // Handle unsupported format specifiers.
-                case 'f':
-                case 'F':
-                case 'e':
-                case 'E':
-                case 'g':
-                case 'G':
-                case 'a':
-                case 'A':
-                case 'c':
-                case 's':
-                case 'p':
-                case 'n':
-                  sprintf(scanError, "unsupported format specifier %c", *(fmtPtr-1));
-                  scanErrorPos = ptr;
-                  free(fmt);
-                  return 0;
-                  
-                // Handle unexpected nul character.
-                case 0:
-                  sprintf(scanError, "improperly terminated format specifier");
-                  scanErrorPos = ptr;
-                  free(fmt);
-                  return 0;
-                  
-                // Handle unexpected nul character.
-                default:
-                  sprintf(scanError, "illegal or unsupported character %c in format specifier", *(fmtPtr-1));
-                  scanErrorPos = ptr;
-                  free(fmt);
-                  return 0;
-                  
-                  
-              }
-              
-            }
-            
-          }
-          
-        }
-        
-        // Scan the the close parenthesis now that we've reached the end of the
-        // format string.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          free(fmt);
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Call printf for the remainder of the format string, but don't print
-        // if we're just syntax-checking.
-        if (depth != -1) {
-          printf(fmtStart);
-        }
-        free(fmt);
-        
-        // Return 0.
-        v.value = 0;
-        v.size = AS_UNDEFINED;
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "def")) ||
-        (!strcmp(name, "set"))
-      ) {
-        const char *expStart;
-        char *expansion;
-        char id;
-        
-        // Store an identifying character of the command name, then free the
-        // command.
-        id = name[0];
-        free(name);
-        name = 0;
-        
-        // Scan the name of the definition.
-        switch (scanIdentifier(&ptr, &name)) {
-          case 0:
-            sprintf(scanError, "definition name expected");
-            scanErrorPos = ptr;
-            return 0;
-            
-          case 1:
-            break;
-            
-          default:
-            return -1;
-          
-        }
-        
-        // Make sure the definition name was properly allocated.
-        if (!name) {
-          perror("Failed to allocate memory while parsing");
-          return -1;
-        }
-        
-        // Scan the comma.
-        if (*ptr != ',') {
-          sprintf(scanError, "expected ','");
-          scanErrorPos = ptr;
-          free(name);
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Scan the value/expression. Only perform scanning/syntax checking for
-        // def; actually evaluate the expression for set.
-        expStart = ptr;
-        if ((retval = scanExpression(&ptr, &v, (id == 'd') ? -1 : depth)) < 1) {
-          free(name);
-          return retval;
-        }
-        
-        // Perform def/set specific tasks, including determining the expansion.
-        if (id == 'd') {
-          int len;
-          
-          // Handle def(). Copy what we've just scanned into a new string so we
-          // can null terminate it.
-          len = ptr - expStart;
-          expansion = (char*)malloc(len + 1);
-          if (!expansion) {
-            perror("Failed to allocated memory while parsing");
-            free(name);
-            return -1;
-          }
-          memcpy(expansion, expStart, len);
-          expansion[len] = 0;
-          
-          // Always return 0.
-          v.value = 0;
-          v.size = AS_UNDEFINED;
-          
-        } else {
-          
-          // Handle set(). Make a new string, large enough to contain an 8
-          // digit hex value with 0x, two extra characters for the hh size
-          // specifier and the nul termination character.
-          expansion = (char*)malloc(16);
-          if (!expansion) {
-            perror("Failed to allocated memory while parsing");
-            free(name);
-            return -1;
-          }
-          
-          // Write an integer literal which will evaluate to exactly the same
-          // value was what's currently in v.
-          switch (v.size) {
-            case AS_BYTE: sprintf(expansion, "0x%08Xhh", v.value);
-            case AS_HALF: sprintf(expansion, "0x%08Xh", v.value);
-            case AS_WORD: sprintf(expansion, "0x%08Xw", v.value);
-            case AS_UNDEFINED: sprintf(expansion, "0x%08X", v.value);
-          }
-          
-        }
-        
-        // Don't register if we're only syntax-checking/scanning.
-        if (depth != -1) {
-          
-          // Register the definition.
-          if (defs_registerLocal(name, expansion) < 0) {
-            free(name);
-            free(expansion);
-            return -1;
-          }
-          
-        }
-        
-        // Free the strings used for the definition.
-        free(name);
-        name = 0;
-        free(expansion);
-        expansion = 0;
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "if"))
-      ) {
-        value_t dummyVal;
-        value_t condition;
-        
-        // We don't need the command name anymore.
-        free(name);
-        name = 0;
-        
-        // Scan and evaluate the condition.
-        if ((retval = scanExpression(&ptr, &condition, depth)) < 1) {
-          return retval;
-        }
-        
-        // Scan the comma.
-        if (*ptr != ',') {
-          sprintf(scanError, "expected ','");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Scan the if operation.
-        if ((retval = scanExpression(&ptr, condition.value ? (&v) : (&dummyVal), condition.value ? depth : -1)) < 1) {
-          return retval;
-        }
-        
-        // Scan the optional else operation.
-        if (*ptr == ',') {
-          ptr++;
-          scanWhitespace(&ptr);
-          if ((retval = scanExpression(&ptr, condition.value ? (&dummyVal) : (&v), condition.value ? -1 : depth)) < 1) {
-            return retval;
-          }
-        } else if (!condition.value) {
-          v.value = 0;
-          v.size = AS_UNDEFINED;
-        }
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
-        }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "prioritize"))
-      ) {
-        value_t dummyVal;
-        value_t condition;
-        int done;
-        
-        // We don't need the command name anymore.
-        free(name);
-        name = 0;
-        
-        // Set default output.
-        v.value = 0;
-        v.size = AS_UNDEFINED;
-        
-        // We can have any number of condition-action pairs.
-        done = 0;
-        while (1) {
-          
-          // Scan and evaluate the condition.
-          if ((retval = scanExpression(&ptr, done ? (&dummyVal) : (&condition), done ? -1 : depth)) < 1) {
-            return retval;
-          }
-          
-          // Scan the comma.
-          if (*ptr != ',') {
-            sprintf(scanError, "expected ','");
-            scanErrorPos = ptr;
-            return 0;
-          }
-          ptr++;
-          scanWhitespace(&ptr);
-          
-          // Scan the action.
-          if ((retval = scanExpression(&ptr, condition.value ? (&v) : (&dummyVal), condition.value ? depth : -1)) < 1) {
-            return retval;
-          }
-          
-          // If we've performed this action, don't do anything else. Setting
-          // done to 1 stops further conditions from evaluating; setting
-          // condition to 0 prevents further actions from evaluating. Because
-          // the condition is no longer evaluated, condition remains 0.
-          if (condition.value) {
-            done = 1;
-            condition.value = 0;
+        if ((node = newNode(NODE_WRITE))) {
+          switch (name[5]) {
+            case 'B': node->size = AS_BYTE;      break;
+            case 'H': node->size = AS_HALF;      break;
+            case 'W': node->size = AS_WORD;      break;
+            default : node->size = AS_UNDEFINED; break;
           }
-          
-          // Scan the next comma, or stop iterating when a close-parenthesis
-          // is found.
-          if (*ptr == ')') {
-            break;
-          } else if (*ptr == ',') {
-            ptr++;
-            scanWhitespace(&ptr);
-          } else {
-            sprintf(scanError, "expected ',' or ')'");
-            scanErrorPos = ptr;
-            return 0;
-          }
-          
+          retval = compileArgs(&ptr, node, 2);
         }
-          
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
+      
+      } else if (!strcmp(name, "preload")) {
+        if ((node = newNode(NODE_PRELOAD))) {
+          retval = compileArgs(&ptr, node, 2);
         }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "while"))
-      ) {
-        const char *conditionPtr;
-        const char *commandPtr;
-        const char *endPtr;
-        
-        // We don't need the command name anymore.
-        free(name);
-        name = 0;
-        
-        // Scan the condition without evaluating it.
-        conditionPtr = ptr;
-        if ((retval = scanExpression(&ptr, &v, -1)) < 1) {
-          return retval;
+      
+      } else if (!strcmp(name, "printf")) {
+        if ((node = newNode(NODE_PRINTF))) {
+          retval = compilePrintf(&ptr, node);
         }
-        
-        // Scan the comma.
-        if (*ptr != ',') {
-          sprintf(scanError, "expected ','");
-          scanErrorPos = ptr;
-          return 0;
+      
+      } else if (!strcmp(name, "def")) {
+        if ((node = newNode(NODE_DEF))) {
+          retval = compileDefSet(&ptr, node);
         }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Scan the command without evaluating it.
-        commandPtr = ptr;
-        if ((retval = scanExpression(&ptr, &v, -1)) < 1) {
-          return retval;
+      
+      } else if (!strcmp(name, "set")) {
+        if ((node = newNode(NODE_SET))) {
+          retval = compileDefSet(&ptr, node);
         }
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
+      
+      } else if (!strcmp(name, "if")) {
+        if ((node = newNode(NODE_IF))) {
+          retval = compileVarArgs(&ptr, node, 2, 3, 0);
         }
-        ptr++;
-        scanWhitespace(&ptr);
-        endPtr = ptr;
-        
-        // Return 0 by default.
-        v.value = 0;
-        v.size = AS_UNDEFINED;
-        
-        // Run the loop if we're not just scanning/checking syntax.
-        if (depth != -1) {
-          
-          while (1) {
-            value_t condition;
-            
-            // Execute the condition.
-            ptr = conditionPtr;
-            if ((retval = scanExpression(&ptr, &condition, depth)) < 1) {
-              return retval;
-            }
-            
-            // Break if the condition is 0.
-            if (!condition.value) {
-              break;
-            }
-            
-            // Execute the command.
-            ptr = commandPtr;
-            if ((retval = scanExpression(&ptr, &v, depth)) < 1) {
-              return retval;
-            }
-            
-          }
-          
-          // Move the scan position back to the end of the while function.
-          ptr = endPtr;
-          
+      
+      } else if (!strcmp(name, "prioritize")) {
+        if ((node = newNode(NODE_PRIORITIZE))) {
+          retval = compileVarArgs(&ptr, node, 2, -1, 1);
         }
-        
-      // ----------------------------------------------------------------------
-      } else if (
-        (!strcmp(name, "delay_ms"))
-      ) {
-        
-        // We don't need the command name anymore.
-        free(name);
-        name = 0;
-        
-        // Scan the amount of milliseconds to wait.
-        if ((retval = scanExpression(&ptr, &v, depth)) < 1) {
-          return retval;
+      
+      } else if (!strcmp(name, "while")) {
+        if ((node = newNode(NODE_WHILE))) {
+          retval = compileArgs(&ptr, node, 2);
         }
-        
-        // Scan the close parenthesis.
-        if (*ptr != ')') {
-          sprintf(scanError, "expected ')'");
-          scanErrorPos = ptr;
-          return 0;
+      
+      } else if (!strcmp(name, "waitFor")) {
+        if ((node = newNode(NODE_WAIT_FOR))) {
+          retval = compileVarArgs(&ptr, node, 3, 5, 0);
         }
-        ptr++;
-        scanWhitespace(&ptr);
-        
-        // Sleep.
-        if (depth != -1) {
-          usleep(v.value * 1000);
+      
+      } else if (!strcmp(name, "delay_ms")) {
+        if ((node = newNode(NODE_DELAY))) {
+          retval = compileArgs(&ptr, node, 1);
         }
-        
-      // ----------------------------------------------------------------------
+      
       } else {
         
         // Unknown function.
@@ -1323,60 +1141,184 @@ static int scanOperand(const char **str, value_t *value, int depth) {
         scanErrorPos = defStart;
         free(name);
         return 0;
-        
+      
+      }
+      free(name);
+      if (!node) {
+        return -1;
       }
       
+      // Errors which occur while running a function are reported after it.
+      node->errorPos = ptr;
+    
     } else {
       
-      // Don't expand when depth is -1. This is used to just check for syntax
-      // errors.
-      if (depth != -1) {
-        
-        const char *expanded;
-        
-        // Expand the definition.
-        expanded = defs_expand(name);
-        if (!expanded) {
-          sprintf(scanError, "\"%s\" is not defined", name);
-          scanErrorPos = defStart;
-          free(name);
-          return 0;
-        }
-        
-        // Break if we've expanded too often (which probably indicates a loop).
-        if (!depth) {
-          sprintf(scanError, "too many recursive expansions, was about to expand \"%s\"", name);
-          scanErrorPos = defStart;
-          free(name);
-          return 0;
-        }
-        
-        // Evaluate the expansion as an expression.
-        if ((retval = scanExpression(&expanded, &v, depth-1)) < 1) {
-          
-          // Override the error position to where we were when we started scanning
-          // our definition, to get the position right in the final formatted error
-          // message.
-          scanErrorPos = defStart;
-          
-          free(name);
-          return retval;
-        }
-      
+      // This is a reference to a definition, which is expanded when the
+      // expression is run. Errors which occur while running the expansion
+      // are reported at the start of the reference.
+      node = newNode(NODE_REFERENCE);
+      if (!node) {
+        free(name);
+        return -1;
       }
-      
+      node->name = name;
+      node->errorPos = defStart;
+    
+    }
+  
+  }
+  
+  // Clean up if compilation failed.
+  if (retval < 1) {
+    freeNode(node);
+    return retval;
+  }
+  
+  // Everything's OK, update the inout variables.
+  *str = ptr;
+  *result = node;
+  return 1;
+  
+}
+
+/**
+ * Compiles an expression. Returns 1 if successful, in which case *result is
+ * set to the compiled expression and *str is moved to the next token. Returns
+ * 0 on failure, in which case *str and *result are unaffected, and scanError
+ * is set. Returns -1 if a fatal error occured.
+ *
+ * Note that there is no operator precedence and all operators are right
+ * associative; spam brackets!
+ */
+static int compileExpression(const char **str, node_t **result) {
+  
+  const char *ptr = *str;
+  node_t *node;
+  node_t *operand;
+  operator_t op;
+  int retval;
+  
+  // Compile the first operand.
+  if ((retval = compileOperand(&ptr, &operand)) < 1) {
+    return retval;
+  }
+  
+  // Scan the operator. This is allowed to fail, because the operator is
+  // optional.
+  if (!scanOperator(&ptr, &op)) {
+    *str = ptr;
+    *result = operand;
+    return 1;
+  }
+  
+  // Make an operator node with the first operand.
+  node = newNode(NODE_OPERATOR);
+  if (!node) {
+    freeNode(operand);
+    return -1;
+  }
+  node->op = op;
+  if (addArg(node, operand) < 0) {
+    freeNode(node);
+    return -1;
+  }
+  
+  // If the next character is the end of the string or a close parenthesis
+  // and we scanned a semicolon operator, that's fine, because the second
+  // operand is optional for that operator. For all other cases, fail if
+  // the second operand is not a valid expression.
+  if (!((op == OP_SEP) && ((*ptr == 0) || (*ptr == ')')))) {
+    if ((retval = compileArg(&ptr, node)) < 1) {
+      freeNode(node);
+      return retval;
     }
-    
-    free(name);
   }
   
   // Everything's OK, update the inout variables.
   *str = ptr;
-  *value = v;
+  *result = node;
   return 1;
   
 }
 
+/**
+ * Compiles the expression at *str. If copy is nonzero, the compiled expression
+ * owns a copy of the source, such that it remains valid when the source is
+ * freed. Returns 1 if successful, in which case *result is set to a compiled
+ * expression with one reference and *str is moved to the next token. Returns
+ * 0 on failure, in which case scanError is set, or -1 if a fatal error
+ * occured.
+ */
+static int compile(const char **str, int copy, compiledExpr_t **result) {
+  compiledExpr_t *expr;
+  const char *ptr = *str;
+  int retval;
+  int len;
+  
+  expr = (compiledExpr_t*)calloc(1, sizeof(compiledExpr_t));
+  if (!expr) {
+    perror("Failed to allocate memory while parsing");
+    return -1;
+  }
+  expr->refs = 1;
+  
+  // Copy the source if requested.
+  if (copy) {
+    len = strlen(*str);
+    expr->source = (char*)malloc(len + 1);
+    if (!expr->source) {
+      perror("Failed to allocate memory while parsing");
+      free(expr);
+      return -1;
+    }
+    memcpy(expr->source, *str, len + 1);
+    ptr = expr->source;
+  }
+  
+  // Compile the expression.
+  if ((retval = compileExpression(&ptr, &expr->root)) < 1) {
+    free(expr->source);
+    free(expr);
+    return retval;
+  }
+  
+  // Update the inout variables, mapping the end position back to the
+  // original source.
+  if (copy) {
+    *str += ptr - expr->source;
+  } else {
+    *str = ptr;
+  }
+  *result = expr;
+  return 1;
+}
+
+/**
+ * Compiles a definition expansion. The compiled expression owns a copy of the
+ * expansion. Returns 1 if successful, in which case *result is set to the
+ * compiled expression, 0 if the expansion has a syntax error or -1 if a fatal
+ * error occured.
+ */
+int compileExpansion(const char *expansion, compiledExpr_t **result) {
+  return compile(&expansion, 1, result);
+}
+
+/**
+ * Releases a reference to a compiled expression, freeing it when this was the
+ * last reference.
+ */
+void releaseCompiled(compiledExpr_t *expr) {
+  if (!expr) {
+    return;
+  }
+  if (--expr->refs > 0) {
+    return;
+  }
+  freeNode(expr->root);
+  free(expr->source);
+  free(expr);
+}
+
 /**
  * Priority encodes between two given access sizes:
  * AS_WORD > AS_HALF > AS_BYTE > AS_UNDEFINED
@@ -1392,51 +1334,75 @@ static accessSize_t mergeSize(accessSize_t a, accessSize_t b) {
 }
 
 /**
- * Scans and evaluates an expression. Returns 0 on failure, in which ase *str
- * and *value are unaffected, and scanError is set. Returns -1 if a fatal error
- * occured.
- * 
- * Note that there is no operator precedence and all operators are right
- * associative; spam brackets!
- * 
+ * Returns the number of bytes accessed for the given access size. Undefined
+ * access sizes default to words.
+ */
+static int accessBytes(accessSize_t size) {
+  switch (size) {
+    case AS_BYTE: return 1;
+    case AS_HALF: return 2;
+    default:      return 4;
+  }
+}
+
+// Forward declaration to runReference.
+static int runReference(const node_t *node, value_t *value, int depth);
+
+/**
+ * Runs a compiled expression. Returns 1 if successful, in which case *value is
+ * set to the result, 0 on failure, in which case scanError is set, or -1 if a
+ * fatal error occured.
+ *
  * Depth specifies how many definition expansions are still allowed (to avoid
- * hanging on loops). When this is set to -1, definitions are silently not
- * extended at all, useful for syntax checking without evaluation.
+ * hanging on loops).
  */
-static int scanExpression(const char **str, value_t *value, int depth) {
+static int runNode(const node_t *node, value_t *value, int depth) {
   
-  const char *ptr = *str;
   value_t v = {0, AS_UNDEFINED};
-  operator_t op;
+  value_t v2 = {0, AS_UNDEFINED};
+  value_t v3 = {0, AS_UNDEFINED};
+  uint32_t readVal;
+  uint32_t fault;
   int retval;
+  int i;
   
-  // Scan the first operand.
-  if ((retval = scanOperand(&ptr, &v, depth)) < 1) {
-    return retval;
-  }
-  
-  // Scan the operator. This is allowed to fail, because the operator is
-  // optional.
-  if ((retval = scanOperator(&ptr, &op)) < 0) {
-    return retval;
-  }
-  
-  // If scanning the operator was successful, scan the second operand.
-  if (retval) {
-    value_t v2 = {0, AS_UNDEFINED};
+  switch (node->type) {
+    
+    // ------------------------------------------------------------------------
+    case NODE_LITERAL:
+      v = node->value;
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_NEGATE:
+    case NODE_INVERT:
+    case NODE_NOT:
+      if ((retval = runNode(node->args[0], &v, depth)) < 1) {
+        return retval;
+      }
+      switch (node->type) {
+        case NODE_NEGATE: v.value = -v.value; break;
+        case NODE_INVERT: v.value = ~v.value; break;
+        default:          v.value = !v.value; break;
+      }
+      break;
     
-    // If the next character is the end of the string or a close parenthesis
-    // and we scanned a semicolon operator, that's fine, because the second
-    // operand is optional for that operator. For all other cases, fail if
-    // the second operand is not a valid expression.
-    if (!((op == OP_SEP) && ((*ptr == 0) || (*ptr == ')')))) {
+    // ------------------------------------------------------------------------
+    case NODE_OPERATOR:
+      if ((retval = runNode(node->args[0], &v, depth)) < 1) {
+        return retval;
+      }
       
-      if ((retval = scanExpression(&ptr, &v2, depth)) < 1) {
+      // The second operand of the semicolon operator may have been omitted.
+      if (node->numArgs < 2) {
+        break;
+      }
+      if ((retval = runNode(node->args[1], &v2, depth)) < 1) {
         return retval;
       }
       
       // Execute the operator.
-      switch (op) {
+      switch (node->op) {
         case OP_ADD:  v.value = v.value +  v2.value; v.size = mergeSize(v.size, v2.size); break;
         case OP_SUB:  v.value = v.value -  v2.value; v.size = mergeSize(v.size, v2.size); break;
         case OP_MUL:  v.value = v.value *  v2.value; v.size = mergeSize(v.size, v2.size); break;
@@ -1458,18 +1424,348 @@ static int scanExpression(const char **str, value_t *value, int depth) {
         case OP_DIV:  v.value = (v2.value == 0) ? 0 : (v.value / v2.value); v.size = mergeSize(v.size, v2.size); break;
         case OP_MOD:  v.value = (v2.value == 0) ? 0 : (v.value % v2.value); v.size = mergeSize(v.size, v2.size); break;
       }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_REFERENCE:
+      if ((retval = runReference(node, &v, depth)) < 1) {
+        return retval;
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_READ:
       
-    }
+      // Evaluate the address.
+      if ((retval = runNode(node->args[0], &v, depth)) < 1) {
+        return retval;
+      }
+      
+      // If this is a preload-enabled read, first see if the preload buffer
+      // contains the requested data. If it does, we don't need to query the
+      // rvex for the value.
+      retval = 0;
+      if (node->preload) {
+        if ((retval = preload_read(v.value, &readVal, accessBytes(node->size))) < 0) {
+          return -1;
+        }
+      }
+      
+      // Perform the access if the value was not preloaded.
+      if (!retval) {
+        switch (rvsrv_readSingle(v.value, &readVal, accessBytes(node->size))) {
+          case 0:
+            sprintf(scanError, "failed to read from address 0x%08X; bus fault 0x%08X", v.value, readVal);
+            scanErrorPos = node->errorPos;
+            return 0;
+          
+          case 1:
+            break;
+          
+          default:
+            return -1;
+        
+        }
+      }
+      
+      // Return the read value.
+      v.value = readVal;
+      v.size = node->size;
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_WRITE:
+      
+      // Evaluate the address and the value to write.
+      if ((retval = runNode(node->args[0], &v2, depth)) < 1) {
+        return retval;
+      }
+      if ((retval = runNode(node->args[1], &v, depth)) < 1) {
+        return retval;
+      }
+      
+      // Determine the access size. If the function name doesn't specify it,
+      // the size of the value is used.
+      if (node->size != AS_UNDEFINED) {
+        v.size = node->size;
+      }
+      
+      // Perform the access.
+      switch (rvsrv_writeSingle(v2.value, v.value, accessBytes(v.size), &fault)) {
+        case 0:
+          sprintf(scanError, "failed to write to address 0x%08X; bus fault 0x%08X", v2.value, fault);
+          scanErrorPos = node->errorPos;
+          return 0;
+        
+        case 1:
+          break;
+        
+        default:
+          return -1;
+      
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_PRELOAD:
+      
+      // Evaluate the start address and the number of bytes to preload.
+      if ((retval = runNode(node->args[0], &v2, depth)) < 1) {
+        return retval;
+      }
+      if ((retval = runNode(node->args[1], &v3, depth)) < 1) {
+        return retval;
+      }
+      
+      // Execute the preload command.
+      switch (preload_load(v2.value, v3.value, &fault)) {
+        case 0:
+          sprintf(
+            scanError,
+            "failed to preload address 0x%08X..0x%08X; bus fault 0x%08X",
+            v2.value, v2.value + v3.value - 1, fault
+          );
+          scanErrorPos = node->errorPos;
+          return 0;
+        
+        case 1:
+          break;
+        
+        default:
+          return -1;
+      
+      }
+      
+      // Always return 0.
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_PRINTF:
+      
+      // Evaluate and print the arguments one by one, each with its own piece
+      // of the format string.
+      for (i = 0; i < node->numArgs; i++) {
+        if ((retval = runNode(node->args[i], &v2, depth)) < 1) {
+          return retval;
+        }
+        
+        // Trim the value by the size of its apparent type.
+        if (v2.size == AS_BYTE) {
+          v2.value &= 0xFF;
+        } else if (v2.size == AS_HALF) {
+          v2.value &= 0xFFFF;
+        }
+        
+        printf(node->format[i], v2.value);
+      }
+      
+      // Print the remainder of the format string, which contains no format
+      // specifiers, and return 0.
+      fputs(node->format[node->numArgs], stdout);
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_DEF:
+      
+      // Register the definition and return 0.
+      if (defs_registerLocal(node->name, node->text) < 0) {
+        return -1;
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_SET:
+      {
+        // Large enough to contain an 8 digit hex value with 0x, two extra
+        // characters for the hh size specifier and the nul termination
+        // character.
+        char expansion[16];
+        
+        // Evaluate the expression.
+        if ((retval = runNode(node->args[0], &v, depth)) < 1) {
+          return retval;
+        }
+        
+        // Write an integer literal which will evaluate to exactly the same
+        // value was what's currently in v.
+        switch (v.size) {
+          case AS_BYTE: sprintf(expansion, "0x%08Xhh", v.value);
+          case AS_HALF: sprintf(expansion, "0x%08Xh", v.value);
+          case AS_WORD: sprintf(expansion, "0x%08Xw", v.value);
+          case AS_UNDEFINED: sprintf(expansion, "0x%08X", v.value);
+        }
+        
+        // Register the definition.
+        if (defs_registerLocal(node->name, expansion) < 0) {
+          return -1;
+        }
+      
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_IF:
+      
+      // Evaluate the condition, and then only the command which it selects.
+      // When the condition is false and there is no else command, return 0.
+      if ((retval = runNode(node->args[0], &v2, depth)) < 1) {
+        return retval;
+      }
+      i = v2.value ? 1 : 2;
+      if (i < node->numArgs) {
+        if ((retval = runNode(node->args[i], &v, depth)) < 1) {
+          return retval;
+        }
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_PRIORITIZE:
+      
+      // Evaluate the conditions in order, and perform only the action which
+      // belongs to the first one which is true. Return 0 if none are.
+      for (i = 0; i < node->numArgs; i += 2) {
+        if ((retval = runNode(node->args[i], &v2, depth)) < 1) {
+          return retval;
+        }
+        if (v2.value) {
+          if ((retval = runNode(node->args[i+1], &v, depth)) < 1) {
+            return retval;
+          }
+          break;
+        }
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_WHILE:
+      
+      // Return the result of the last command, or 0 if it never ran.
+      while (1) {
+        
+        // Execute the condition and break if it is 0.
+        if ((retval = runNode(node->args[0], &v2, depth)) < 1) {
+          return retval;
+        }
+        if (!v2.value) {
+          break;
+        }
+        
+        // Execute the command.
+        if ((retval = runNode(node->args[1], &v, depth)) < 1) {
+          return retval;
+        }
+      
+      }
+      break;
+    
+    // ------------------------------------------------------------------------
+    case NODE_WAIT_FOR:
+      {
+        value_t args[5];
+        
+        // Evaluate the address, mask, value and the optional timeout and poll
+        // interval.
+        for (i = 0; i < node->numArgs; i++) {
+          if ((retval = runNode(node->args[i], &args[i], depth)) < 1) {
+            return retval;
+          }
+        }
+        
+        // Wait for the condition. The result is the last value read, also
+        // when the timeout expired.
+        switch (rvsrv_waitFor(
+          args[0].value, args[1].value, args[2].value,
+          (node->numArgs > 3) ? args[3].value : -1,
+          (node->numArgs > 4) ? args[4].value : 0,
+          &readVal
+        )) {
+          case 0:
+            sprintf(scanError, "failed to read from address 0x%08X; bus fault 0x%08X", args[0].value, readVal);
+            scanErrorPos = node->errorPos;
+            return 0;
+          
+          case 1:
+          case 2:
+            break;
+          
+          default:
+            return -1;
+        
+        }
+        v.value = readVal;
+        v.size = AS_WORD;
+      
+      }
+      break;
     
+    // ------------------------------------------------------------------------
+    case NODE_DELAY:
+      
+      // Evaluate the amount of milliseconds to wait and sleep.
+      if ((retval = runNode(node->args[0], &v, depth)) < 1) {
+        return retval;
+      }
+      usleep(v.value * 1000);
+      break;
+  
   }
   
-  // Everything's OK, update the inout variables.
-  *str = ptr;
+  // Everything's OK, update the output.
   *value = v;
   return 1;
   
 }
 
+/**
+ * Expands and runs the definition referenced by the given node. Expansions are
+ * compiled the first time they are used and cached in the definition table
+ * until they are redefined. Returns 1 if successful, 0 on failure, in which
+ * case scanError is set, or -1 if a fatal error occured.
+ */
+static int runReference(const node_t *node, value_t *value, int depth) {
+  const char *expanded;
+  compiledExpr_t **cache;
+  compiledExpr_t *expr;
+  int retval;
+  
+  // Look up the definition.
+  expanded = defs_expandCached(node->name, &cache);
+  if (!expanded) {
+    sprintf(scanError, "\"%s\" is not defined", node->name);
+    scanErrorPos = node->errorPos;
+    return 0;
+  }
+  
+  // Break if we've expanded too often (which probably indicates a loop).
+  if (!depth) {
+    sprintf(scanError, "too many recursive expansions, was about to expand \"%s\"", node->name);
+    scanErrorPos = node->errorPos;
+    return 0;
+  }
+  
+  // Compile the expansion if it is not cached yet.
+  if (!*cache) {
+    if ((retval = compile(&expanded, 1, cache)) < 1) {
+      scanErrorPos = node->errorPos;
+      return retval;
+    }
+  }
+  
+  // Run the expansion. Hold a reference while doing so, because the
+  // expansion may redefine itself, which releases the cached copy.
+  expr = *cache;
+  expr->refs++;
+  retval = runNode(expr->root, value, depth - 1);
+  releaseCompiled(expr);
+  
+  // Override the error position to where the reference is, to get the
+  // position right in the final formatted error message.
+  if (retval < 1) {
+    scanErrorPos = node->errorPos;
+  }
+  return retval;
+}
 /**
  * Scans a context mask. Returns 0 on failure, in which case *str and *mask are
  * unaffected, and scanError is set. Returns -1 is a fatal error occured.
@@ -1578,7 +1874,7 @@ static int scanContextMask(const char **str, contextMask_t *mask) {
  */
 static int registerDefinition(contextMask_t mask, const char *def, char *expansion, int expLen) {
   char c;
-  value_t dummyValue;
+  compiledExpr_t *compiled;
   const char *ptr = expansion;
   int retval;
   
@@ -1586,13 +1882,14 @@ static int registerDefinition(contextMask_t mask, const char *def, char *expansi
   c = expansion[expLen];
   expansion[expLen] = 0;
   
-  // Syntax-check the expansion. Use -1 for depth so the scan routines won't
-  // try to expand definitions; we're just syntax checking.
-  retval = scanExpression(&ptr, &dummyValue, -1);
+  // Syntax-check the expansion by compiling it. The expansion is compiled
+  // again when it is first used, so we don't need the result.
+  retval = compile(&ptr, 0, &compiled);
   if (retval < 1) {
     expansion[expLen] = c;
     return retval;
   }
+  releaseCompiled(compiled);
   if (*ptr != 0) {
     sprintf(scanError, "expected '}'");
     scanErrorPos = ptr;
@@ -1760,6 +2057,8 @@ static void printParseError(const char *str) {
 int evaluate(const char *str, value_t *value, const char *errorPrefix) {
   
   const char *ptr = str;
+  compiledExpr_t *compiled;
+  int retval;
   
   if (!str || !value) {
     return -1;
@@ -1770,8 +2069,24 @@ int evaluate(const char *str, value_t *value, const char *errorPrefix) {
   scanErrorPos = str;
   sprintf(scanError, "unknown error");
   
+  // Compile the expression. The compiled form points into str, which remains
+  // valid until we return.
   scanWhitespace(&ptr);
-  switch (scanExpression(&ptr, value, 256)) {
+  retval = compile(&ptr, 0, &compiled);
+  if ((retval == 1) && *ptr) {
+    scanErrorPos = ptr;
+    sprintf(scanError, "unexpected token");
+    releaseCompiled(compiled);
+    retval = 0;
+  }
+  
+  // Run the expression.
+  if (retval == 1) {
+    retval = runNode(compiled->root, value, 256);
+    releaseCompiled(compiled);
+  }
+  
+  switch (retval) {
     case 0:
       
       // Don't print errors when errorPrefix is null.
@@ -1784,21 +2099,7 @@ int evaluate(const char *str, value_t *value, const char *errorPrefix) {
       return 0;
       
     case 1:
-      if (*ptr) {
-        scanErrorPos = ptr;
-        sprintf(scanError, "unexpected token");
-        
-        // Don't print errors when errorPrefix is null.
-        if (errorPrefix) {
-          
-          fprintf(stderr, "Evaluation error%s: ", errorPrefix);
-          printParseError(str);
-          
-        }
-        return 0;
-      } else {
-        return 1;
-      }
+      return 1;
       
     default:
       return -1;
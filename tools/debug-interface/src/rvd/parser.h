@@ -126,4 +126,18 @@ int parseMask(const char *str, contextMask_t *mask, const char *errorPrefix);
  */
 int parseDefs(char *str, const char *errorPrefix);
 
+/**
+ * Compiles a definition expansion. The compiled expression owns a copy of the
+ * expansion. Returns 1 if successful, in which case *result is set to the
+ * compiled expression, 0 if the expansion has a syntax error or -1 if a fatal
+ * error occured.
+ */
+int compileExpansion(const char *expansion, compiledExpr_t **result);
+
+/**
+ * Releases a reference to a compiled expression, freeing it when this was the
+ * last reference.
+ */
+void releaseCompiled(compiledExpr_t *expr);
+
 #endif
@@ -51,11 +51,18 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <string.h>
+#include <sys/time.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 
+#include "rvsrvInterface.h"
+#include "binaryProtocol.h"
+#include "localShare.h"
+#include "crc32.h"
+
 /**
  * Hostname and port to connect to.
  */
@@ -68,31 +75,274 @@ static int port;
 static int rvsrvSocket = -1;
 
 /**
- * Maximum size of a debug packet. Set to 8k plus a little extra so a write
- * command can write a full 4kbyte page at once.
+ * Maximum size of a text protocol packet. Set to 8k plus a little extra so a
+ * write command can write a full 4kbyte page at once.
  */
 #define MAX_PACKET_LEN 8448
 
 /**
- * Buffer shared between commands and replies.
+ * Buffer shared between commands and replies. It holds at least
+ * MAX_PACKET_LEN+1 bytes, and is grown to fit a full binary frame once the
+ * transfer size has been negotiated.
  */
-static char packetBuffer[MAX_PACKET_LEN+1];
+static char *packetBuffer = 0;
+static int packetBufferSize = 0;
 
 /**
- * Tries to connect to the given host and port, if not connected already.
- * Returns -1 and prints an error if something went wrong, otherwise returns
- * 0 to indicate success.
+ * Maximum number of bytes which can be read or written with a single command,
+ * as negotiated with rvsrv.
  */
-static int rvsrv_connect(void) {
-  struct addrinfo hints;
-  struct addrinfo *addrInfo;
-  struct addrinfo *curAddrInfo;
-  int retval;
+static int transferSize = RVSRV_PAGE_SIZE;
+
+/**
+ * Buffer returned by rvsrv_getPageBuffers() and its size.
+ */
+static unsigned char *pageBuffer = 0;
+static int pageBufferSize = 0;
+
+/**
+ * Set when rvsrv accepted the switch to the binary protocol for the current
+ * connection.
+ */
+static int binaryMode = 0;
+
+/**
+ * Binary protocol version reported by rvsrv.
+ */
+static unsigned int binaryVersion = 0;
+
+/**
+ * Tag for the next binary request.
+ */
+static uint32_t nextTag = 0;
+
+/**
+ * Path of the rvsrv local socket, or null if local access is not used.
+ */
+static char *localPath = 0;
+
+/**
+ * Target memory mapped through the local socket.
+ */
+static localShare_t localShare;
+
+/**
+ * Socket of the dedicated connection used for a trace stream, or -1 if no
+ * stream is open.
+ */
+static int traceSocket = -1;
+
+/**
+ * Set once the trace stream has been asked to stop.
+ */
+static int traceStopping = 0;
+
+/**
+ * Trace data received from rvsrv which has not been returned by
+ * rvsrv_traceReceive() yet, and the buffer it is stored in.
+ */
+static unsigned char *traceBuffer = 0;
+static int traceBufferSize = 0;
+static int tracePending = 0;
+static int traceOffset = 0;
+
+/**
+ * Nesting depth of rvsrv_beginBatch() calls. While nonzero, single writes are
+ * queued in batchBuffer instead of being sent right away.
+ */
+static int batchDepth = 0;
+
+/**
+ * Request payload of the pending batch, and its size and number of entries.
+ */
+static unsigned char batchBuffer[BINPROTO_MAX_BATCH_SIZE];
+static int batchSize = 0;
+static int batchEntries = 0;
+
+/**
+ * Asynchronous read or write which was sent to rvsrv, but whose completion
+ * callback has not been called yet.
+ */
+typedef struct {
   
-  // Return success if we're already connected.
-  if (rvsrvSocket >= 0) {
+  /**
+   * Binary protocol opcode and tag of the request.
+   */
+  int opcode;
+  uint32_t tag;
+  
+  /**
+   * Address range which is accessed and the buffer which receives the read
+   * data.
+   */
+  uint32_t address;
+  unsigned char *buffer;
+  int size;
+  
+  /**
+   * Completion callback and its data pointer.
+   */
+  rvsrvCompletion_t callback;
+  void *data;
+  
+  /**
+   * Set once the reply has been received. result is then 1 if the access was
+   * successful, 0 if a bus fault occured or -1 if an error occured.
+   */
+  int received;
+  int result;
+  uint32_t faultCode;
+  
+} asyncRequest_t;
+
+/**
+ * Ring buffer of the asynchronous requests which are in flight, in the order
+ * in which they were issued.
+ */
+static asyncRequest_t asyncRequests[RVSRV_ASYNC_WINDOW];
+static int asyncFirst = 0;
+static int asyncCount = 0;
+
+/**
+ * Set when an asynchronous request or its completion callback failed. The
+ * callbacks of the requests which are still in flight are then no longer
+ * called. The failure is latched until rvsrv_flushAsync() has reported it.
+ */
+static int asyncFailed = 0;
+
+/**
+ * Writes exactly size bytes to the given rvsrv socket. Returns -1 and prints
+ * an error if something went wrong, otherwise returns 0.
+ */
+static int sendAll(int f, const void *buf, int size) {
+  const char *ptr = (const char*)buf;
+  
+  while (size) {
+    int count = write(f, ptr, size);
+    if (count < 1) {
+      perror("Failed to write to rvsrv socket");
+      return -1;
+    }
+    ptr += count;
+    size -= count;
+  }
+  
+  return 0;
+}
+
+/**
+ * Reads exactly size bytes from the given rvsrv socket. commandName is only
+ * used for the error message. Returns -1 and prints an error if something
+ * went wrong, otherwise returns 0.
+ */
+static int receiveAll(int f, void *buf, int size, const char *commandName) {
+  char *ptr = (char*)buf;
+  
+  while (size) {
+    int count = read(f, ptr, size);
+    if (count < 0) {
+      perror("Failed to read from rvsrv socket");
+      return -1;
+    } else if (count == 0) {
+      fprintf(stderr,
+        "Error: rvsrv seems to have closed the connection while trying to execute the\n"
+        "\"%s\" command. It probably crashed...\n",
+        commandName
+      );
+      return -1;
+    }
+    ptr += count;
+    size -= count;
+  }
+  
+  return 0;
+}
+
+/**
+ * Makes sure the packet buffer can hold at least size bytes. Returns -1 and
+ * prints an error if something went wrong, otherwise returns 0.
+ */
+static int allocPacketBuffer(int size) {
+  char *buf;
+  
+  if (size <= packetBufferSize) {
     return 0;
   }
+  buf = (char*)realloc(packetBuffer, size);
+  if (!buf) {
+    perror("Failed to allocate memory for rvsrv packet buffer");
+    return -1;
+  }
+  packetBuffer = buf;
+  packetBufferSize = size;
+  return 0;
+}
+
+/**
+ * Asks rvsrv to switch the current connection to the binary protocol. Older
+ * versions of rvsrv reply with an error, in which case we keep using the text
+ * protocol. Returns -1 and prints an error if something went wrong, otherwise
+ * returns 0.
+ */
+static int negotiateBinary(void) {
+  char reply[64];
+  int len = 0;
+  unsigned int version, size;
+  
+  binaryMode = 0;
+  transferSize = RVSRV_PAGE_SIZE;
+  if (sendAll(rvsrvSocket, "Binary;", 7) < 0) {
+    return -1;
+  }
+  
+  // Read the reply up to and including the newline following the semicolon,
+  // so no text remains in the socket when we start using binary frames.
+  while (1) {
+    char d;
+    if (receiveAll(rvsrvSocket, &d, 1, "Binary") < 0) {
+      return -1;
+    }
+    if (d == '\n') {
+      break;
+    }
+    if (len < sizeof(reply) - 1) {
+      reply[len++] = d;
+    }
+  }
+  reply[len] = 0;
+  
+  if (strncmp(reply, "OK, Binary, ", 12)) {
+    return 0;
+  }
+  binaryMode = 1;
+  binaryVersion = 1;
+  
+  // Newer versions of rvsrv also report how many bytes they can transfer at
+  // once. Make sure the packet buffer can hold a full frame of that size, or
+  // a full batch, whichever is larger.
+  if (sscanf(reply + 12, "%u, %u;", &version, &size) == 2) {
+    binaryVersion = version;
+    if ((size > RVSRV_PAGE_SIZE) && (size <= BINPROTO_MAX_TRANSFER_SIZE) && !(size & (size - 1))) {
+      transferSize = size;
+    }
+  }
+  size = (transferSize > BINPROTO_MAX_BATCH_SIZE) ? transferSize : BINPROTO_MAX_BATCH_SIZE;
+  if (allocPacketBuffer(BINPROTO_REQUEST_HEADER_SIZE + size + 1) < 0) {
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Opens a new TCP connection to the configured host and port. Returns the
+ * socket, or -1 after printing an error if something went wrong.
+ */
+static int openSocket(void) {
+  struct addrinfo hints;
+  struct addrinfo *addrInfo;
+  struct addrinfo *curAddrInfo;
+  int retval, f;
   
   // Make sure setup has been called.
   if (!host) {
@@ -118,17 +368,13 @@ static int rvsrv_connect(void) {
     addr->sin_port = htons(port);
     
     // Try to open a connection.
-    rvsrvSocket = socket(AF_INET, SOCK_STREAM, 0);
-    if (rvsrvSocket >= 0) {
-      if (connect(rvsrvSocket, (struct sockaddr *)addr, curAddrInfo->ai_addrlen) >= 0) {
-        
-        // Opened a connection.
+    f = socket(AF_INET, SOCK_STREAM, 0);
+    if (f >= 0) {
+      if (connect(f, (struct sockaddr *)addr, curAddrInfo->ai_addrlen) >= 0) {
         freeaddrinfo(addrInfo);
-        return 0;
-        
+        return f;
       }
-      close(rvsrvSocket);
-      rvsrvSocket = -1;
+      close(f);
     }
     
     // Try the next connection in the linked list.
@@ -149,6 +395,75 @@ static int rvsrv_connect(void) {
   return -1;
 }
 
+/**
+ * Tries to connect to the given host and port, if not connected already.
+ * Returns -1 and prints an error if something went wrong, otherwise returns
+ * 0 to indicate success.
+ */
+static int rvsrv_connect(void) {
+  
+  // Return success if we're already connected.
+  if (rvsrvSocket >= 0) {
+    return 0;
+  }
+  
+  // Make sure we have a buffer for text commands.
+  if (allocPacketBuffer(MAX_PACKET_LEN + 1) < 0) {
+    return -1;
+  }
+  
+  // Open the connection and switch to the binary protocol if rvsrv supports
+  // it.
+  rvsrvSocket = openSocket();
+  if (rvsrvSocket < 0) {
+    return -1;
+  }
+  if (negotiateBinary() < 0) {
+    close(rvsrvSocket);
+    rvsrvSocket = -1;
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Prints an error message for an error reply from rvsrv. reason is the error
+ * name sent by rvsrv, or null if it did not send one.
+ */
+static void printServerError(const char *commandName, const char *reason) {
+  if (!reason) {
+    fprintf(stderr, 
+      "Error: rvsrv replied with an undefined error to command \"%s\".\n",
+      commandName
+    );
+  } else if (!strcmp(reason, "UnknownCommand")) {
+    fprintf(stderr, 
+      "Error: rvsrv replied with an unknown command error to command\n"
+      "\"%s\". Are you using the right rvsrv version?\n",
+      commandName
+    );
+  } else if (!strcmp(reason, "Syntax")) {
+    fprintf(stderr, 
+      "Error: rvsrv replied with a syntax error to command \"%s\".\n"
+      "Are you using the right rvsrv version?\n",
+      commandName
+    );
+  } else if (!strcmp(reason, "CommunicationError")) {
+    fprintf(stderr, 
+      "Error: rvsrv encountered a communication error with the hardware while\n"
+      "executing the \"%s\" command. Please ensure that the hardware\n"
+      "is connected and that rvsrv is configured correctly.\n",
+      commandName
+    );
+  } else {
+    fprintf(stderr, 
+      "rvsrv replied with an \"%s\" error to command \"%s\".\n",
+      reason, commandName
+    );
+  }
+}
+
 /**
  * Sends the null-terminated contents in commandBuf to the server, then replace
  * the buffer contents with the server reply. Returns a pointer to the first
@@ -177,16 +492,8 @@ static char *transfer(void) {
   *ptr2 = 0;
   
   // Send the command to the server.
-  ptr = packetBuffer;
-  remain = strlen(packetBuffer);
-  while (remain) {
-    int count = write(rvsrvSocket, ptr, remain);
-    if (count < 1) {
-      perror("Failed to write to rvsrv socket");
-      return 0;
-    }
-    ptr += count;
-    remain -= count;
+  if (sendAll(rvsrvSocket, packetBuffer, strlen(packetBuffer)) < 0) {
+    return 0;
   }
   
   // Wait for and read the server reply.
@@ -306,37 +613,7 @@ static char *transfer(void) {
   // Handle error messages from the server by just printing them and returning
   // failure.
   if (error) {
-    ptr = strtok(0, ",");
-    if (!ptr) {
-      fprintf(stderr, 
-        "Error: rvsrv replied with an undefined error to command \"%s\".\n",
-        commandName
-      );
-    } else if (!strcmp(ptr, "UnknownCommand")) {
-      fprintf(stderr, 
-        "Error: rvsrv replied with an unknown command error to command\n"
-        "\"%s\". Are you using the right rvsrv version?\n",
-        commandName
-      );
-    } else if (!strcmp(ptr, "Syntax")) {
-      fprintf(stderr, 
-        "Error: rvsrv replied with a syntax error to command \"%s\".\n"
-        "Are you using the right rvsrv version?\n",
-        commandName
-      );
-    } else if (!strcmp(ptr, "CommunicationError")) {
-      fprintf(stderr, 
-        "Error: rvsrv encountered a communication error with the hardware while\n"
-        "executing the \"%s\" command. Please ensure that the hardware\n"
-        "is connected and that rvsrv is configured correctly.\n",
-        commandName
-      );
-    } else {
-      fprintf(stderr, 
-        "rvsrv replied with an \"%s\" error to command \"%s\".\n",
-        ptr, commandName
-      );
-    }
+    printServerError(commandName, strtok(0, ","));
     return 0;
   }
   
@@ -358,6 +635,13 @@ static char *transfer(void) {
  */
 int rvsrv_setup(const char *newHost, int newPort) {
   int size = strlen(newHost) + 1;
+  
+  // A connection may have been inherited from an rvd session server. Drop it
+  // if it goes somewhere else.
+  if (host && (strcmp(host, newHost) || (port != newPort))) {
+    rvsrv_disconnect();
+  }
+  free(host);
   host = (char*)malloc(size);
   if (!host) {
     perror("Failed to allocate memory for host name");
@@ -369,26 +653,74 @@ int rvsrv_setup(const char *newHost, int newPort) {
 }
 
 /**
- * Closes the connection to rvsrv if a connection is open.
+ * Enables local access through the Unix-domain socket of rvsrv at the given
+ * path. The memory is not mapped until the first read or write.
  */
-void rvsrv_close(void) {
-  if (rvsrvSocket >= 0) {
-    close(rvsrvSocket);
+int rvsrv_setupLocal(const char *path) {
+  int size = strlen(path) + 1;
+  
+  // Drop memory inherited from an rvd session server if it was shared through
+  // another socket.
+  if (localPath && strcmp(localPath, path)) {
+    localShare_close(&localShare);
   }
-  free(host);
-  host = 0;
+  free(localPath);
+  localPath = (char*)malloc(size);
+  if (!localPath) {
+    perror("Failed to allocate memory for local socket path");
+    return -1;
+  }
+  memcpy(localPath, path, size);
+  return 0;
 }
 
 /**
- * Sends the stop command to the server.
+ * Returns the maximum number of bytes which can be read or written with a
+ * single call to rvsrv_readBulk() or rvsrv_writeBulk(), connecting to rvsrv
+ * first if necessary to find out. This is a power of two, at least
+ * RVSRV_PAGE_SIZE. Returns -1 and prints an error if something went wrong.
  */
-int rvsrv_stopServer(void) {
-  sprintf(packetBuffer, "Stop;");
-  if (!transfer()) {
+int rvsrv_getPageSize(void) {
+  if (rvsrv_connect() < 0) {
     return -1;
   }
-  printf("Successfully requested rvsrv to close.\n");
-  return 0;
+  return transferSize;
+}
+
+/**
+ * Returns a buffer large enough to hold a full page as returned by
+ * rvsrv_getPageSize(), and sets *pageSize to that page size. The buffer is
+ * shared between all callers and remains valid until rvsrv_close() is called.
+ * Returns null and prints an error if something went wrong.
+ */
+unsigned char *rvsrv_getPageBuffer(int *pageSize) {
+  return rvsrv_getPageBuffers(1, pageSize);
+}
+
+/**
+ * Like rvsrv_getPageBuffer(), but returns a buffer large enough to hold count
+ * consecutive pages, so a page can be read into while the reads of the others
+ * are still in flight.
+ */
+unsigned char *rvsrv_getPageBuffers(int count, int *pageSize) {
+  int size = rvsrv_getPageSize();
+  
+  if (size < 0) {
+    return 0;
+  }
+  *pageSize = size;
+  size *= count;
+  if (size > pageBufferSize) {
+    free(pageBuffer);
+    pageBufferSize = 0;
+    pageBuffer = (unsigned char*)malloc(size);
+    if (!pageBuffer) {
+      perror("Failed to allocate memory for page buffer");
+      return 0;
+    }
+    pageBufferSize = size;
+  }
+  return pageBuffer;
 }
 
 /**
@@ -532,283 +864,1776 @@ static int executeReadWrite(int isWrite, int *fault, unsigned char **readBuf, in
 }
 
 /**
- * Reads a single byte, halfword or word from the hardware (size set to 1, 2 or
- * 4 respectively). Returns 1 when successful, 0 when a bus error occured, or
- * -1 when a fatal error occured. In the latter case, an error will be printed
- * to stderr. When a bus error occurs, value is set to the bus fault.
+ * Builds a binary protocol request frame in the packet buffer and sends it.
+ * payload should point to payloadSize bytes of request payload. Returns -1
+ * and prints an error if something went wrong, otherwise returns 0.
  */
-int rvsrv_readSingle(
+static int sendRequest(
+  int opcode,
+  uint32_t tag,
   uint32_t address,
-  uint32_t *value,
-  int size
+  uint32_t count,
+  const unsigned char *payload,
+  int payloadSize
 ) {
-  int fault;
-  unsigned char *readBuf;
-  int readBufSize;
+  unsigned char *buf = (unsigned char*)packetBuffer;
   
-  // Check the size locally before sending the command to rvsrv.
-  switch (size) {
-    case 1:
-    case 2:
-    case 4:
-      break;
-    default:
-      fprintf(stderr, "rvsrv_readSingle() was called with incorrect size %d.\n", size);
-      return -1;
+  binProto_putU32(buf + 0, BINPROTO_REQUEST_HEADER_SIZE - 4 + payloadSize);
+  buf[4] = opcode;
+  buf[5] = 0;
+  buf[6] = 0;
+  buf[7] = 0;
+  binProto_putU32(buf + 8, tag);
+  binProto_putU32(buf + 12, address);
+  binProto_putU32(buf + 16, count);
+  if (payloadSize) {
+    memcpy(buf + BINPROTO_REQUEST_HEADER_SIZE, payload, payloadSize);
   }
-  
-  // Send the command to rvsrv.
-  sprintf(packetBuffer, "Read,%08X,%d;", address, size);
-  if (executeReadWrite(0, &fault, &readBuf, &readBufSize) < 0) {
-    free(readBuf);
+  return sendAll(rvsrvSocket, buf, BINPROTO_REQUEST_HEADER_SIZE + payloadSize);
+}
+
+/**
+ * Sends a binary protocol request and receives the reply. payload should point
+ * to payloadSize bytes of request payload, i.e. the write data for writes or
+ * the entries for batches. replySize specifies the payload size expected in a
+ * successful reply. Returns the reply status (BINPROTO_STATUS_OK,
+ * BINPROTO_STATUS_FAULT or, for WaitFor requests, BINPROTO_STATUS_TIMEOUT) if
+ * successful. The payload of a successful reply is stored in packetBuffer. If
+ * a bus fault occured, *faultCode is set to the fault code. Error replies
+ * from rvsrv are printed and result in -1 being returned.
+ */
+static int binaryTransfer(
+  int opcode,
+  uint32_t address,
+  uint32_t count,
+  const unsigned char *payload,
+  int payloadSize,
+  int replySize,
+  uint32_t *faultCode
+) {
+  unsigned char *buf = (unsigned char*)packetBuffer;
+  const char *commandName;
+  uint32_t tag, len;
+  int status;
+  
+  switch (opcode) {
+    case BINPROTO_OP_READ:     commandName = "Read";     break;
+    case BINPROTO_OP_WRITE:    commandName = "Write";    break;
+    case BINPROTO_OP_BATCH:    commandName = "Batch";    break;
+    case BINPROTO_OP_WAIT:     commandName = "WaitFor";  break;
+    case BINPROTO_OP_HASH:     commandName = "Hash";     break;
+    case BINPROTO_OP_FILL:     commandName = "Fill";     break;
+    case BINPROTO_OP_CHECKSUM: commandName = "Checksum"; break;
+    default:                   commandName = "Stop";     break;
+  }
+  
+  // Complete the asynchronous requests which are still in flight first, so
+  // the replies arrive in the right order. If one of them failed, fail this
+  // request as well, so the error is not lost.
+  if (rvsrv_flushAsync() < 0) {
     return -1;
   }
   
-  // If a bus fault occured, we're getting 4 bytes regardless of how much we
-  // read, because that's the size of the bus fault code.
-  if (fault) {
-    size = 4;
+  // Make sure we have a connection.
+  if (rvsrv_connect() < 0) {
+    return -1;
   }
   
-  // Make sure we got the expected amount of bytes.
-  if (readBufSize != size) {
-    fprintf(stderr, 
-      "Error: received a malformed reply to command \"Read\" from rvsrv:\n"
-      "unexpected amount of bytes returned.\n"
-    );
-    free(readBuf);
+  // Send the request frame.
+  tag = nextTag++;
+  if (sendRequest(opcode, tag, address, count, payload, payloadSize) < 0) {
     return -1;
   }
   
-  // Set the value output.
-  *value = readBuf[0];
-  if (size >= 2) {
-    *value <<= 8;
-    *value |= readBuf[1];
+  // Receive the reply header.
+  if (receiveAll(rvsrvSocket, buf, BINPROTO_REPLY_HEADER_SIZE, commandName) < 0) {
+    return -1;
   }
-  if (size >= 4) {
-    *value <<= 8;
-    *value |= readBuf[2];
-    *value <<= 8;
-    *value |= readBuf[3];
+  len = binProto_getU32(buf + 0);
+  if ((len < BINPROTO_REPLY_HEADER_SIZE - 4) || (len - (BINPROTO_REPLY_HEADER_SIZE - 4) >= packetBufferSize)
+    || (buf[4] != opcode) || (binProto_getU32(buf + 8) != tag)
+  ) {
+    fprintf(stderr, 
+      "Error: received a malformed reply to command \"%s\" from rvsrv.\n",
+      commandName
+    );
+    return -1;
   }
   
-  // Free the read buffer.
-  free(readBuf);
+  // Receive the payload into the packet buffer, after moving the status and
+  // fault code out of it.
+  status = buf[5];
+  *faultCode = binProto_getU32(buf + 20);
+  payloadSize = len - (BINPROTO_REPLY_HEADER_SIZE - 4);
+  if (receiveAll(rvsrvSocket, buf, payloadSize, commandName) < 0) {
+    return -1;
+  }
+  buf[payloadSize] = 0;
   
-  // Return 1 when the read was successful or 0 when a bus fault occured.
-  return !fault;
+  switch (status) {
+    case BINPROTO_STATUS_OK:
+    case BINPROTO_STATUS_TIMEOUT:
+      if (payloadSize != replySize) {
+        fprintf(stderr, 
+          "Error: received a malformed reply to command \"%s\" from rvsrv:\n"
+          "unexpected amount of bytes returned.\n",
+          commandName
+        );
+        return -1;
+      }
+      return status;
+      
+    case BINPROTO_STATUS_FAULT:
+      return BINPROTO_STATUS_FAULT;
+      
+    case BINPROTO_STATUS_ERROR:
+      printServerError(commandName, payloadSize ? (const char*)buf : 0);
+      return -1;
+      
+  }
   
+  fprintf(stderr, 
+    "Error: received a malformed reply to command \"%s\" from rvsrv:\n"
+    "unknown status %d.\n",
+    commandName, status
+  );
+  return -1;
 }
 
 /**
- * Reads at most 4096 bytes in a single command. The address does not need to
- * be aligned, but it's slightly faster if it is. Returns 1 when successful,
- * 0 when a bus error occured, or -1 when a fatal error occured. In the latter
- * case, an error will be printed to stderr. If a bus error occured and fault
- * is not null, *faultCode will be set to the bus fault. Only the last bus
- * access is checked for fault conditions.
+ * Sends all queued writes to rvsrv as a single Batch command. Bus faults can no
+ * longer be reported to the code which requested the write at this point, so
+ * they are printed and treated as errors. Returns -1 if an error occured or
+ * any of the writes failed, or 0 otherwise.
  */
-int rvsrv_readBulk(
-  uint32_t address,
-  unsigned char *buffer,
-  int size,
-  uint32_t *faultCode
-) {
-  int fault;
-  unsigned char *readBuf;
-  int readBufSize;
+static int flushBatch(void) {
+  const unsigned char *entry, *result;
+  uint32_t faultCode;
+  int i, numEntries, size, retval;
   
-  // Check the size.
-  if (size > 4096) {
-    fprintf(stderr,
-      "Error: rvsrv_readBulk() called with more than 4096 bytes.\n"
-    );
-    return -1;
+  if (!batchEntries) {
+    return 0;
   }
+  numEntries = batchEntries;
+  size = batchSize;
+  batchEntries = 0;
+  batchSize = 0;
   
-  // Send the command to rvsrv.
-  sprintf(packetBuffer, "Read,%08X,%d;", address, size);
-  if (executeReadWrite(0, &fault, &readBuf, &readBufSize) < 0) {
-    free(readBuf);
+  // Send the batch. The reply contains only the status and fault code of
+  // each write.
+  retval = binaryTransfer(
+    BINPROTO_OP_BATCH, 0, numEntries,
+    batchBuffer, size, numEntries * BINPROTO_BATCH_RESULT_SIZE,
+    &faultCode
+  );
+  if (retval < 0) {
     return -1;
   }
-  
-  // Make sure we got the expected amount of bytes.
-  if (readBufSize != (fault ? 4 : size)) {
+  if (retval != BINPROTO_STATUS_OK) {
     fprintf(stderr, 
-      "Error: received a malformed reply to command \"Write\" from rvsrv:\n"
-      "unexpected amount of bytes returned.\n"
+      "Error: received a malformed reply to command \"Batch\" from rvsrv.\n"
     );
-    free(readBuf);
     return -1;
   }
   
-  if (fault) {
-    
-    // Set the faultCode output.
-    *faultCode = readBuf[0];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[1];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[2];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[3];
-    
-  } else {
-    
-    // Copy the read buffer into the specified buffer.
-    memcpy(buffer, readBuf, size);
-    
+  // Check the result of every write.
+  retval = 0;
+  entry = batchBuffer;
+  result = (const unsigned char*)packetBuffer;
+  for (i = 0; i < numEntries; i++) {
+    switch (result[0]) {
+      case BINPROTO_STATUS_OK:
+        break;
+        
+      case BINPROTO_STATUS_FAULT:
+        fprintf(stderr,
+          "Error: failed to write to address 0x%08X; bus fault 0x%08X.\n",
+          binProto_getU32(entry + 4), binProto_getU32(result + 4)
+        );
+        retval = -1;
+        break;
+        
+      default:
+        fprintf(stderr,
+          "Error: failed to write to address 0x%08X.\n",
+          binProto_getU32(entry + 4)
+        );
+        retval = -1;
+        break;
+        
+    }
+    entry += BINPROTO_BATCH_ENTRY_SIZE + binProto_getU32(entry + 8);
+    result += BINPROTO_BATCH_RESULT_SIZE;
   }
   
-  // Free the read buffer.
-  free(readBuf);
-  
-  // Return 1 when the read was successful or 0 when a bus fault occured.
-  return !fault;
-  
+  return retval;
 }
 
 /**
- * Writes a single byte, halfword or word to the hardware (size set to 1, 2 or
- * 4 respectively). Returns 1 when successful, 0 when a bus error occured, or
- * -1 when a fatal error occured. In the latter case, an error will be printed
- * to stderr. If a bus error occured and fault is not null, *faultCode will be
- * set to the bus fault.
+ * Adds a write to the pending batch, flushing the batch first if it is full.
  */
-int rvsrv_writeSingle(
-  uint32_t address,
-  uint32_t value,
-  int size,
-  uint32_t *faultCode
-) {
-  
-  int fault;
-  unsigned char *readBuf;
-  int readBufSize;
+static int queueWrite(uint32_t address, const unsigned char *data, int size) {
+  unsigned char *entry;
   
-  // Check the size locally before sending the command to rvsrv.
-  switch (size) {
-    case 1:
-      sprintf(packetBuffer, "Write,%08X,%d,%02X;", address, size, value & 0xFF);
-      break;
-    case 2:
-      sprintf(packetBuffer, "Write,%08X,%d,%04X;", address, size, value & 0xFFFF);
-      break;
-    case 4:
-      sprintf(packetBuffer, "Write,%08X,%d,%08X;", address, size, value);
-      break;
-    default:
-      fprintf(stderr, "rvsrv_writeSingle() was called with incorrect size %d.\n", size);
+  if ((batchEntries >= BINPROTO_MAX_BATCH_ENTRIES) || (batchSize + BINPROTO_BATCH_ENTRY_SIZE + size > BINPROTO_MAX_BATCH_SIZE)) {
+    if (flushBatch() < 0) {
       return -1;
+    }
   }
   
-  // Send the command to rvsrv.
-  if (executeReadWrite(1, &fault, &readBuf, &readBufSize) < 0) {
-    free(readBuf);
+  entry = batchBuffer + batchSize;
+  entry[0] = BINPROTO_OP_WRITE;
+  entry[1] = 0;
+  entry[2] = 0;
+  entry[3] = 0;
+  binProto_putU32(entry + 4, address);
+  binProto_putU32(entry + 8, size);
+  memcpy(entry + BINPROTO_BATCH_ENTRY_SIZE, data, size);
+  batchSize += BINPROTO_BATCH_ENTRY_SIZE + size;
+  batchEntries++;
+  
+  return 0;
+}
+
+/**
+ * Starts batching single writes. Until the matching call to rvsrv_endBatch(),
+ * rvsrv_writeSingle() may queue writes locally and send them to rvsrv in bulk
+ * once a read is performed or the batch ends, so the writes to all contexts
+ * can be done in a single round trip. Bus faults for queued writes are printed
+ * and reported as errors by whichever call flushes the queue. Calls may be
+ * nested. Batching only takes place if rvsrv supports the binary protocol.
+ */
+void rvsrv_beginBatch(void) {
+  batchDepth++;
+}
+
+/**
+ * Ends a batch started with rvsrv_beginBatch(), sending any queued writes when
+ * the outermost batch ends. Returns -1 if an error occured or any of the
+ * queued writes failed, or 0 otherwise.
+ */
+int rvsrv_endBatch(void) {
+  if (batchDepth && --batchDepth) {
+    return 0;
+  }
+  return flushBatch();
+}
+
+/**
+ * Receives the reply to one of the asynchronous requests which are in flight
+ * and stores its result in the request. Read data is received directly into
+ * the buffer of the request. Errors reported by rvsrv are printed and only
+ * fail the request itself. Returns -1 and prints an error if the connection
+ * can no longer be used, otherwise returns 0.
+ */
+static int receiveAsync(void) {
+  unsigned char header[BINPROTO_REPLY_HEADER_SIZE];
+  unsigned char *buf = (unsigned char*)packetBuffer;
+  asyncRequest_t *req = 0;
+  const char *commandName;
+  uint32_t len, tag;
+  int i, status, payloadSize, replySize;
+  
+  // Receive the reply header.
+  commandName = (asyncRequests[asyncFirst].opcode == BINPROTO_OP_WRITE) ? "Write" : "Read";
+  if (receiveAll(rvsrvSocket, header, BINPROTO_REPLY_HEADER_SIZE, commandName) < 0) {
     return -1;
   }
   
-  // Make sure we got the expected amount of bytes.
-  if (readBufSize != (fault ? 4 : 0)) {
+  // Look up the request the reply belongs to. rvsrv may complete requests out
+  // of order.
+  tag = binProto_getU32(header + 8);
+  for (i = 0; i < asyncCount; i++) {
+    asyncRequest_t *r = &asyncRequests[(asyncFirst + i) % RVSRV_ASYNC_WINDOW];
+    if (!r->received && (r->tag == tag)) {
+      req = r;
+      break;
+    }
+  }
+  len = binProto_getU32(header + 0);
+  if (!req || (len < BINPROTO_REPLY_HEADER_SIZE - 4) || (len - (BINPROTO_REPLY_HEADER_SIZE - 4) >= packetBufferSize)
+    || (header[4] != req->opcode)
+  ) {
     fprintf(stderr, 
-      "Error: received a malformed reply to command \"Write\" from rvsrv:\n"
-      "unexpected amount of bytes returned.\n"
+      "Error: received a malformed reply to command \"%s\" from rvsrv.\n",
+      commandName
     );
-    free(readBuf);
     return -1;
   }
+  commandName = (req->opcode == BINPROTO_OP_WRITE) ? "Write" : "Read";
   
-  // Set the faultCode output.
-  if (fault) {
-    *faultCode = readBuf[0];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[1];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[2];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[3];
+  // Receive the payload. Read data goes straight into the buffer of the
+  // request, anything else into the packet buffer.
+  status = header[5];
+  req->faultCode = binProto_getU32(header + 20);
+  payloadSize = len - (BINPROTO_REPLY_HEADER_SIZE - 4);
+  replySize = (req->opcode == BINPROTO_OP_WRITE) ? 0 : req->size;
+  if ((status == BINPROTO_STATUS_OK) && (payloadSize == replySize)) {
+    buf = req->buffer;
+  }
+  if (receiveAll(rvsrvSocket, buf, payloadSize, commandName) < 0) {
+    return -1;
   }
+  req->received = 1;
   
-  // Free the read buffer.
-  free(readBuf);
+  switch (status) {
+    case BINPROTO_STATUS_OK:
+      if (payloadSize != replySize) {
+        fprintf(stderr, 
+          "Error: received a malformed reply to command \"%s\" from rvsrv:\n"
+          "unexpected amount of bytes returned.\n",
+          commandName
+        );
+        req->result = -1;
+      } else {
+        req->result = 1;
+      }
+      return 0;
+      
+    case BINPROTO_STATUS_FAULT:
+      req->result = 0;
+      return 0;
+      
+    case BINPROTO_STATUS_ERROR:
+      buf[payloadSize] = 0;
+      printServerError(commandName, payloadSize ? (const char*)buf : 0);
+      req->result = -1;
+      return 0;
+      
+  }
   
-  // Return 1 when the read was successful or 0 when a bus fault occured.
-  return !fault;
+  fprintf(stderr, 
+    "Error: received a malformed reply to command \"%s\" from rvsrv:\n"
+    "unknown status %d.\n",
+    commandName, status
+  );
+  req->result = -1;
+  return 0;
+}
+
+/**
+ * Waits for the oldest asynchronous request in flight to complete and calls
+ * its completion callback, unless an earlier request failed. Returns -1 if
+ * an error occured or this or an earlier request or callback failed,
+ * otherwise returns 0.
+ */
+static int completeAsync(void) {
+  asyncRequest_t *req = &asyncRequests[asyncFirst];
   
+  // Receive replies until the one we're waiting for has arrived. If the
+  // connection breaks, the replies to the other requests will never arrive,
+  // so they are dropped along with the connection.
+  while (!req->received) {
+    if (receiveAsync() < 0) {
+      rvsrv_disconnect();
+      asyncFailed = 1;
+      return -1;
+    }
+  }
+  asyncFirst = (asyncFirst + 1) % RVSRV_ASYNC_WINDOW;
+  asyncCount--;
+  
+  // Call the completion callback.
+  if (!asyncFailed) {
+    if ((req->result < 0) || (req->callback(req->data, req->address, req->buffer, req->size, req->result, req->faultCode) < 0)) {
+      asyncFailed = 1;
+    }
+  }
+  
+  return asyncFailed ? -1 : 0;
 }
 
 /**
- * Writes at most 4096 bytes in a single command. The address does not need to
- * be aligned, but it's slightly faster if it is. Returns 1 when successful,
- * 0 when a bus error occured, or -1 when a fatal error occured. In the latter
- * case, an error will be printed to stderr. If a bus error occured and fault
- * is not null, *faultCode will be set to the bus fault. Only the last bus
- * access is checked for fault conditions.
+ * Issues an asynchronous binary Read or Write request. Accesses which cannot
+ * be pipelined, because they are performed on the memory shared by rvsrv or
+ * rvsrv only supports the text protocol, are performed right away once the
+ * requests in flight have completed. The return value is the same as for
+ * rvsrv_readAsync() and rvsrv_writeAsync().
  */
-int rvsrv_writeBulk(
+static int asyncTransfer(
+  int opcode,
   uint32_t address,
   unsigned char *buffer,
   int size,
-  uint32_t *faultCode
+  rvsrvCompletion_t callback,
+  void *data
 ) {
+  int isWrite = (opcode == BINPROTO_OP_WRITE);
+  asyncRequest_t *req;
+  uint32_t faultCode;
+  int local = 0;
+  int retval;
   
-  char *ptr;
-  int fault;
-  int readBufSize;
-  unsigned char *readBuf;
-  
-  // Check the size.
-  if (size > 4096) {
-    fprintf(stderr,
-      "Error: rvsrv_writeBulk() called with more than 4096 bytes.\n"
-    );
+  // Don't issue any more requests once one of them has failed.
+  if (asyncFailed) {
     return -1;
   }
   
-  // Generate the command.
-  sprintf(packetBuffer, "Write,%08X,%d,", address, size);
-  ptr = packetBuffer + strlen(packetBuffer);
-  while (size) {
-    sprintf(ptr, "%02hhX", *buffer);
-    buffer++;
-    ptr += 2;
-    size--;
+  // See if the access should be performed on the shared memory.
+  if (localPath) {
+    if (!localShare.addr) {
+      if (localShare_open(localPath, &localShare) < 0) {
+        return -1;
+      }
+    }
+    local = localShare_contains(&localShare, address, size);
   }
-  sprintf(ptr, ";");
   
-  // Send the command to rvsrv.
-  if (executeReadWrite(1, &fault, &readBuf, &readBufSize) < 0) {
-    free(readBuf);
+  // Make sure we have a connection, so we know which protocol to use.
+  if (!local && (rvsrv_connect() < 0)) {
     return -1;
   }
   
-  // Make sure we got the expected amount of bytes.
-  if (readBufSize != (fault ? 4 : 0)) {
-    fprintf(stderr, 
-      "Error: received a malformed reply to command \"Write\" from rvsrv:\n"
-      "unexpected amount of bytes returned.\n"
+  // Perform the access synchronously if we can't pipeline it.
+  if (local || !binaryMode) {
+    if (rvsrv_flushAsync() < 0) {
+      return -1;
+    }
+    if (isWrite) {
+      retval = rvsrv_writeBulk(address, buffer, size, &faultCode);
+    } else {
+      retval = rvsrv_readBulk(address, buffer, size, &faultCode);
+    }
+    if (retval < 0) {
+      return -1;
+    }
+    return callback(data, address, buffer, size, retval, faultCode);
+  }
+  
+  // Check the size against what rvsrv supports.
+  if (size > transferSize) {
+    fprintf(stderr,
+      "Error: cannot %s more than %d bytes at once using this version of rvsrv.\n",
+      isWrite ? "write" : "read", transferSize
     );
-    free(readBuf);
     return -1;
   }
   
-  // Set the faultCode output.
-  if (fault) {
-    *faultCode = readBuf[0];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[1];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[2];
-    *faultCode <<= 8;
-    *faultCode |= readBuf[3];
+  // Make sure queued writes are performed first.
+  if (flushBatch() < 0) {
+    return -1;
   }
   
-  // Free the read buffer.
-  free(readBuf);
+  // Wait for the oldest request to complete if the window is full.
+  if (asyncCount == RVSRV_ASYNC_WINDOW) {
+    if (completeAsync() < 0) {
+      return -1;
+    }
+  }
+  
+  // Send the request and add it to the window.
+  req = &asyncRequests[(asyncFirst + asyncCount) % RVSRV_ASYNC_WINDOW];
+  req->opcode = opcode;
+  req->tag = nextTag++;
+  req->address = address;
+  req->buffer = buffer;
+  req->size = size;
+  req->callback = callback;
+  req->data = data;
+  req->received = 0;
+  if (sendRequest(opcode, req->tag, address, size, isWrite ? buffer : 0, isWrite ? size : 0) < 0) {
+    rvsrv_disconnect();
+    return -1;
+  }
+  asyncCount++;
+  
+  return 0;
+}
+
+/**
+ * Issues a read of at most rvsrv_getPageSize() bytes without waiting for the
+ * reply. Up to RVSRV_ASYNC_WINDOW reads and writes may be in flight at once;
+ * when the window is full, this waits for the oldest one to complete first.
+ * buffer must remain valid until the completion callback has been called,
+ * which happens from within this function, rvsrv_writeAsync(),
+ * rvsrv_flushAsync() or any other function which accesses rvsrv. Callbacks
+ * are called in the order in which the requests were issued. Returns -1 if
+ * an error occured or a previous request or callback failed, in which case
+ * the callbacks of the remaining requests are not called. Otherwise returns
+ * 0.
+ */
+int rvsrv_readAsync(
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  rvsrvCompletion_t callback,
+  void *data
+) {
+  return asyncTransfer(BINPROTO_OP_READ, address, buffer, size, callback, data);
+}
+
+/**
+ * Issues a write of at most rvsrv_getPageSize() bytes without waiting for
+ * the reply. This behaves like rvsrv_readAsync(), except that the data is
+ * sent right away, so buffer may be reused as soon as this returns.
+ */
+int rvsrv_writeAsync(
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  rvsrvCompletion_t callback,
+  void *data
+) {
+  return asyncTransfer(BINPROTO_OP_WRITE, address, buffer, size, callback, data);
+}
+
+/**
+ * Waits for all asynchronous requests in flight to complete, calling their
+ * completion callbacks. Returns -1 if an error occured or any of the requests
+ * or callbacks failed since the previous call, otherwise returns 0.
+ */
+int rvsrv_flushAsync(void) {
+  int retval;
+  
+  while (asyncCount) {
+    completeAsync();
+  }
+  
+  // Report the failure once; the next requests start with a clean slate.
+  retval = asyncFailed ? -1 : 0;
+  asyncFailed = 0;
+  
+  return retval;
+}
+
+/**
+ * Performs a read or write directly on the memory shared by rvsrv, if local
+ * access is enabled and the address range is within the shared memory. For
+ * reads, data is the destination buffer. Returns 1 if the access was
+ * performed, 0 if it should be sent to rvsrv instead, or -1 if an error
+ * occured.
+ */
+static int localReadWrite(int isWrite, uint32_t address, unsigned char *data, int size) {
+  
+  if (!localPath) {
+    return 0;
+  }
+  
+  // Map the memory when this is the first access.
+  if (!localShare.addr) {
+    if (localShare_open(localPath, &localShare) < 0) {
+      return -1;
+    }
+  }
+  if (!localShare_contains(&localShare, address, size)) {
+    return 0;
+  }
+  
+  // Make sure asynchronous requests and queued writes are performed first.
+  if (rvsrv_flushAsync() < 0) {
+    return -1;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  
+  if (isWrite) {
+    localShare_write(&localShare, address, data, size);
+  } else {
+    localShare_read(&localShare, address, data, size);
+  }
+  return 1;
+}
+
+/**
+ * Performs a read or write using whichever protocol was negotiated with rvsrv.
+ * For writes, data should point to size bytes of write data; for reads it is
+ * ignored. The outputs are the same as for executeReadWrite(): *readBuf will
+ * contain either the read data or the big-endian bus fault code, and must be
+ * freed by the caller.
+ */
+static int readWrite(
+  int isWrite,
+  uint32_t address,
+  const unsigned char *data,
+  int size,
+  int *fault,
+  unsigned char **readBuf,
+  int *readBufSize
+) {
+  uint32_t faultCode;
+  int retval;
+  char *ptr;
+  
+  *fault = 0;
+  *readBuf = 0;
+  *readBufSize = 0;
+  
+  // Access the memory directly if we can.
+  if (!isWrite) {
+    *readBuf = (unsigned char *)malloc(size);
+    if (!*readBuf) {
+      perror("Failed to allocate memory for read data");
+      return -1;
+    }
+  }
+  retval = localReadWrite(isWrite, address, isWrite ? (unsigned char *)data : *readBuf, size);
+  if (retval) {
+    if (retval > 0) {
+      *readBufSize = isWrite ? 0 : size;
+    }
+    return (retval < 0) ? -1 : 0;
+  }
+  free(*readBuf);
+  *readBuf = 0;
+  
+  // Make sure we have a connection, so we know which protocol to use.
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  
+  // Make sure queued writes are performed first.
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  
+  // Check the size against what rvsrv supports.
+  if (size > transferSize) {
+    fprintf(stderr,
+      "Error: cannot %s more than %d bytes at once using this version of rvsrv.\n",
+      isWrite ? "write" : "read", transferSize
+    );
+    return -1;
+  }
+  
+  if (!binaryMode) {
+    
+    // Generate the text command.
+    sprintf(packetBuffer, "%s,%08X,%d", isWrite ? "Write" : "Read", address, size);
+    if (isWrite) {
+      ptr = packetBuffer + strlen(packetBuffer);
+      *ptr++ = ',';
+      while (size) {
+        sprintf(ptr, "%02hhX", *data);
+        data++;
+        ptr += 2;
+        size--;
+      }
+    }
+    strcat(packetBuffer, ";");
+    
+    // Send the command to rvsrv.
+    return executeReadWrite(isWrite, fault, readBuf, readBufSize);
+    
+  }
+  
+  // Send the binary request.
+  if (isWrite) {
+    retval = binaryTransfer(BINPROTO_OP_WRITE, address, size, data, size, 0, &faultCode);
+  } else {
+    retval = binaryTransfer(BINPROTO_OP_READ, address, size, 0, 0, size, &faultCode);
+  }
+  if (retval < 0) {
+    return -1;
+  }
+  *fault = (retval == BINPROTO_STATUS_FAULT);
+  
+  // Copy the result into a buffer in the same format as executeReadWrite()
+  // returns it.
+  if (*fault) {
+    *readBufSize = 4;
+  } else if (!isWrite) {
+    *readBufSize = size;
+  } else {
+    return 0;
+  }
+  *readBuf = (unsigned char *)malloc(*readBufSize);
+  if (!*readBuf) {
+    perror("Failed to allocate memory for data returned by rvsrv");
+    return -1;
+  }
+  if (*fault) {
+    binProto_putU32(*readBuf, faultCode);
+  } else {
+    memcpy(*readBuf, packetBuffer, size);
+  }
+  
+  return 0;
+}
+
+/**
+ * Connects to rvsrv and maps the memory shared through the local socket now,
+ * instead of when they are first needed. Returns -1 and prints an error if
+ * something went wrong, otherwise returns 0.
+ */
+int rvsrv_open(void) {
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (localPath && !localShare.addr) {
+    if (localShare_open(localPath, &localShare) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Closes the connection to rvsrv and unmaps the shared memory without
+ * forgetting where to connect to, so the next access connects again. Pending
+ * batched writes and asynchronous requests are discarded without calling
+ * their completion callbacks.
+ */
+void rvsrv_disconnect(void) {
+  if (rvsrvSocket >= 0) {
+    close(rvsrvSocket);
+    rvsrvSocket = -1;
+  }
+  binaryMode = 0;
+  binaryVersion = 0;
+  transferSize = RVSRV_PAGE_SIZE;
+  batchDepth = 0;
+  batchSize = 0;
+  batchEntries = 0;
+  asyncFirst = 0;
+  asyncCount = 0;
+  asyncFailed = 0;
+  localShare_close(&localShare);
+  rvsrv_traceClose();
+}
+
+/**
+ * Closes the connection to rvsrv if a connection is open.
+ */
+void rvsrv_close(void) {
+  if (rvsrvSocket >= 0) {
+    flushBatch();
+    close(rvsrvSocket);
+  }
+  asyncFirst = 0;
+  asyncCount = 0;
+  asyncFailed = 0;
+  free(host);
+  host = 0;
+  free(packetBuffer);
+  packetBuffer = 0;
+  packetBufferSize = 0;
+  free(pageBuffer);
+  pageBuffer = 0;
+  pageBufferSize = 0;
+  localShare_close(&localShare);
+  free(localPath);
+  localPath = 0;
+  rvsrv_traceClose();
+  free(traceBuffer);
+  traceBuffer = 0;
+  traceBufferSize = 0;
+}
+
+/**
+ * Sends the stop command to the server.
+ */
+int rvsrv_stopServer(void) {
+  uint32_t faultCode;
+  
+  // Make sure we have a connection, so we know which protocol to use.
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  if (binaryMode) {
+    if (binaryTransfer(BINPROTO_OP_STOP, 0, 0, 0, 0, 0, &faultCode) < 0) {
+      return -1;
+    }
+  } else {
+    sprintf(packetBuffer, "Stop;");
+    if (!transfer()) {
+      return -1;
+    }
+  }
+  printf("Successfully requested rvsrv to close.\n");
+  return 0;
+}
+
+/**
+ * Reads a single byte, halfword or word from the hardware (size set to 1, 2 or
+ * 4 respectively). Returns 1 when successful, 0 when a bus error occured, or
+ * -1 when a fatal error occured. In the latter case, an error will be printed
+ * to stderr. When a bus error occurs, value is set to the bus fault.
+ */
+int rvsrv_readSingle(
+  uint32_t address,
+  uint32_t *value,
+  int size
+) {
+  int fault;
+  unsigned char *readBuf;
+  int readBufSize;
+  
+  // Check the size locally before sending the command to rvsrv.
+  switch (size) {
+    case 1:
+    case 2:
+    case 4:
+      break;
+    default:
+      fprintf(stderr, "rvsrv_readSingle() was called with incorrect size %d.\n", size);
+      return -1;
+  }
+  
+  // Send the command to rvsrv.
+  if (readWrite(0, address, 0, size, &fault, &readBuf, &readBufSize) < 0) {
+    free(readBuf);
+    return -1;
+  }
+  
+  // If a bus fault occured, we're getting 4 bytes regardless of how much we
+  // read, because that's the size of the bus fault code.
+  if (fault) {
+    size = 4;
+  }
+  
+  // Make sure we got the expected amount of bytes.
+  if (readBufSize != size) {
+    fprintf(stderr, 
+      "Error: received a malformed reply to command \"Read\" from rvsrv:\n"
+      "unexpected amount of bytes returned.\n"
+    );
+    free(readBuf);
+    return -1;
+  }
+  
+  // Set the value output.
+  *value = readBuf[0];
+  if (size >= 2) {
+    *value <<= 8;
+    *value |= readBuf[1];
+  }
+  if (size >= 4) {
+    *value <<= 8;
+    *value |= readBuf[2];
+    *value <<= 8;
+    *value |= readBuf[3];
+  }
+  
+  // Free the read buffer.
+  free(readBuf);
   
   // Return 1 when the read was successful or 0 when a bus fault occured.
   return !fault;
   
 }
+
+/**
+ * Reads at most 4096 bytes in a single command. The address does not need to
+ * be aligned, but it's slightly faster if it is. Returns 1 when successful,
+ * 0 when a bus error occured, or -1 when a fatal error occured. In the latter
+ * case, an error will be printed to stderr. If a bus error occured and fault
+ * is not null, *faultCode will be set to the bus fault. Only the last bus
+ * access is checked for fault conditions.
+ */
+int rvsrv_readBulk(
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  uint32_t *faultCode
+) {
+  int fault;
+  unsigned char *readBuf;
+  int readBufSize;
+  
+  // Check the size.
+  if (size > BINPROTO_MAX_TRANSFER_SIZE) {
+    fprintf(stderr,
+      "Error: rvsrv_readBulk() called with more than %d bytes.\n",
+      BINPROTO_MAX_TRANSFER_SIZE
+    );
+    return -1;
+  }
+  
+  // Send the command to rvsrv.
+  if (readWrite(0, address, 0, size, &fault, &readBuf, &readBufSize) < 0) {
+    free(readBuf);
+    return -1;
+  }
+  
+  // Make sure we got the expected amount of bytes.
+  if (readBufSize != (fault ? 4 : size)) {
+    fprintf(stderr, 
+      "Error: received a malformed reply to command \"Write\" from rvsrv:\n"
+      "unexpected amount of bytes returned.\n"
+    );
+    free(readBuf);
+    return -1;
+  }
+  
+  if (fault) {
+    
+    // Set the faultCode output.
+    *faultCode = readBuf[0];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[1];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[2];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[3];
+    
+  } else {
+    
+    // Copy the read buffer into the specified buffer.
+    memcpy(buffer, readBuf, size);
+    
+  }
+  
+  // Free the read buffer.
+  free(readBuf);
+  
+  // Return 1 when the read was successful or 0 when a bus fault occured.
+  return !fault;
+  
+}
+
+/**
+ * Writes a single byte, halfword or word to the hardware (size set to 1, 2 or
+ * 4 respectively). Returns 1 when successful, 0 when a bus error occured, or
+ * -1 when a fatal error occured. In the latter case, an error will be printed
+ * to stderr. If a bus error occured and fault is not null, *faultCode will be
+ * set to the bus fault.
+ */
+int rvsrv_writeSingle(
+  uint32_t address,
+  uint32_t value,
+  int size,
+  uint32_t *faultCode
+) {
+  
+  int fault;
+  unsigned char *readBuf;
+  int readBufSize;
+  unsigned char data[4];
+  
+  // Check the size locally before sending the command to rvsrv.
+  switch (size) {
+    case 1:
+    case 2:
+    case 4:
+      break;
+    default:
+      fprintf(stderr, "rvsrv_writeSingle() was called with incorrect size %d.\n", size);
+      return -1;
+  }
+  
+  // Convert the value to big-endian bytes.
+  binProto_putU32(data, value << (8 * (4 - size)));
+  
+  // Write directly if the memory is shared with us.
+  switch (localReadWrite(1, address, data, size)) {
+    case 0:  break;
+    case 1:  return 1;
+    default: return -1;
+  }
+  
+  // Queue the write if we're batching.
+  if (batchDepth) {
+    if (rvsrv_connect() < 0) {
+      return -1;
+    }
+    if (binaryMode) {
+      return (queueWrite(address, data, size) < 0) ? -1 : 1;
+    }
+  }
+  
+  // Send the command to rvsrv.
+  if (readWrite(1, address, data, size, &fault, &readBuf, &readBufSize) < 0) {
+    free(readBuf);
+    return -1;
+  }
+  
+  // Make sure we got the expected amount of bytes.
+  if (readBufSize != (fault ? 4 : 0)) {
+    fprintf(stderr, 
+      "Error: received a malformed reply to command \"Write\" from rvsrv:\n"
+      "unexpected amount of bytes returned.\n"
+    );
+    free(readBuf);
+    return -1;
+  }
+  
+  // Set the faultCode output.
+  if (fault) {
+    *faultCode = readBuf[0];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[1];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[2];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[3];
+  }
+  
+  // Free the read buffer.
+  free(readBuf);
+  
+  // Return 1 when the read was successful or 0 when a bus fault occured.
+  return !fault;
+  
+}
+
+/**
+ * Writes at most 4096 bytes in a single command. The address does not need to
+ * be aligned, but it's slightly faster if it is. Returns 1 when successful,
+ * 0 when a bus error occured, or -1 when a fatal error occured. In the latter
+ * case, an error will be printed to stderr. If a bus error occured and fault
+ * is not null, *faultCode will be set to the bus fault. Only the last bus
+ * access is checked for fault conditions.
+ */
+int rvsrv_writeBulk(
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  uint32_t *faultCode
+) {
+  
+  int fault;
+  int readBufSize;
+  unsigned char *readBuf;
+  
+  // Check the size.
+  if (size > BINPROTO_MAX_TRANSFER_SIZE) {
+    fprintf(stderr,
+      "Error: rvsrv_writeBulk() called with more than %d bytes.\n",
+      BINPROTO_MAX_TRANSFER_SIZE
+    );
+    return -1;
+  }
+  
+  // Send the command to rvsrv.
+  if (readWrite(1, address, buffer, size, &fault, &readBuf, &readBufSize) < 0) {
+    free(readBuf);
+    return -1;
+  }
+  
+  // Make sure we got the expected amount of bytes.
+  if (readBufSize != (fault ? 4 : 0)) {
+    fprintf(stderr, 
+      "Error: received a malformed reply to command \"Write\" from rvsrv:\n"
+      "unexpected amount of bytes returned.\n"
+    );
+    free(readBuf);
+    return -1;
+  }
+  
+  // Set the faultCode output.
+  if (fault) {
+    *faultCode = readBuf[0];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[1];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[2];
+    *faultCode <<= 8;
+    *faultCode |= readBuf[3];
+  }
+  
+  // Free the read buffer.
+  free(readBuf);
+  
+  // Return 1 when the read was successful or 0 when a bus fault occured.
+  return !fault;
+  
+}
+
+/**
+ * Polls the word at the given address locally until (word & mask) == value
+ * or the timeout expires. Used when rvsrv does not support WaitFor or the
+ * address can be accessed directly. The return value and outputs are the same
+ * as for rvsrv_waitFor().
+ */
+static int pollLocally(
+  uint32_t address,
+  uint32_t mask,
+  uint32_t value,
+  int timeout,
+  int interval,
+  uint32_t *result
+) {
+  struct timeval start, now;
+  int retval;
+  
+  gettimeofday(&start, 0);
+  while (1) {
+    retval = rvsrv_readSingle(address, result, 4);
+    if (retval < 1) {
+      return retval;
+    }
+    if ((*result & mask) == value) {
+      return 1;
+    }
+    gettimeofday(&now, 0);
+    if ((timeout >= 0) && ((now.tv_sec - start.tv_sec) * 1000 + (now.tv_usec - start.tv_usec) / 1000 >= timeout)) {
+      return 2;
+    }
+    usleep(interval);
+  }
+}
+
+/**
+ * Waits until (word & mask) == value holds for the 32-bit word at the given
+ * address, or until timeout milliseconds have passed. A negative timeout
+ * waits indefinitely. interval specifies the time between polls in
+ * microseconds, or 0 for the default. The polling is done by rvsrv if it
+ * supports it, so only a single round trip is needed. Returns 1 when the
+ * condition was met, 2 when the timeout expired, 0 when a bus error occured
+ * or -1 when a fatal error occured. In the latter case, an error will be
+ * printed to stderr. *result is set to the last word that was read, or to the
+ * bus fault if a bus error occured.
+ */
+int rvsrv_waitFor(
+  uint32_t address,
+  uint32_t mask,
+  uint32_t value,
+  int timeout,
+  int interval,
+  uint32_t *result
+) {
+  unsigned char payload[BINPROTO_WAIT_PAYLOAD_SIZE];
+  int retval, chunk;
+  
+  value &= mask;
+  if (!interval) {
+    interval = BINPROTO_DEFAULT_WAIT_INTERVAL;
+  }
+  
+  // Make sure we have a connection, so we know which protocol to use, and
+  // that queued writes are performed first.
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  
+  // Fall back to polling from here if rvsrv can't do it for us, or if we can
+  // access the word directly anyway.
+  if (!binaryMode || (binaryVersion < 2)) {
+    return pollLocally(address, mask, value, timeout, interval, result);
+  }
+  if (localPath) {
+    if (!localShare.addr) {
+      if (localShare_open(localPath, &localShare) < 0) {
+        return -1;
+      }
+    }
+    if (localShare_contains(&localShare, address, 4)) {
+      return pollLocally(address, mask, value, timeout, interval, result);
+    }
+  }
+  
+  // rvsrv limits the timeout of a single request, so send more requests for
+  // longer waits.
+  binProto_putU32(payload + 0, mask);
+  binProto_putU32(payload + 4, value);
+  binProto_putU32(payload + 8, interval);
+  do {
+    chunk = timeout;
+    if ((chunk < 0) || (chunk > BINPROTO_MAX_WAIT_TIMEOUT)) {
+      chunk = BINPROTO_MAX_WAIT_TIMEOUT;
+    }
+    if (timeout > 0) {
+      timeout -= chunk;
+    }
+    retval = binaryTransfer(BINPROTO_OP_WAIT, address, chunk, payload, BINPROTO_WAIT_PAYLOAD_SIZE, 4, result);
+    switch (retval) {
+      case BINPROTO_STATUS_OK:
+        *result = binProto_getU32((unsigned char *)packetBuffer);
+        return 1;
+        
+      case BINPROTO_STATUS_FAULT:
+        return 0;
+        
+      case BINPROTO_STATUS_TIMEOUT:
+        *result = binProto_getU32((unsigned char *)packetBuffer);
+        break;
+        
+      default:
+        return -1;
+        
+    }
+  } while (timeout);
+  
+  return 2;
+}
+
+/**
+ * Result of rvsrv_fill(), shared with the completion callback of its writes.
+ */
+typedef struct {
+  int faulted;
+  uint32_t faultCode;
+} fillResult_t;
+
+/**
+ * Completion callback for the writes of rvsrv_fill(), which records the
+ * first bus fault.
+ */
+static int fillCompleted(
+  void *data,
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  int result,
+  uint32_t faultCode
+) {
+  fillResult_t *fill = (fillResult_t*)data;
+  if (!result && !fill->faulted) {
+    fill->faulted = 1;
+    fill->faultCode = faultCode;
+  }
+  return 0;
+}
+
+/**
+ * Performs rvsrv_fill() by writing pages of the fill value, pipelined using
+ * the asynchronous request window. Used when rvsrv does not support Fill
+ * requests or the memory can be accessed directly. The return value and
+ * outputs are the same as for rvsrv_fill().
+ */
+static int fillLocally(
+  uint32_t address,
+  uint32_t size,
+  unsigned char value,
+  uint32_t *faultCode
+) {
+  fillResult_t fill;
+  unsigned char *buf;
+  int pageSize;
+  
+  // Get a page of the fill value. The writes copy the data when they are
+  // sent, so a single page suffices.
+  pageSize = rvsrv_getPageSize();
+  if (pageSize < 0) {
+    return -1;
+  }
+  buf = (unsigned char*)malloc(pageSize);
+  if (!buf) {
+    perror("Failed to allocate memory for fill buffer");
+    return -1;
+  }
+  memset(buf, value, pageSize);
+  
+  // Write the range in aligned pages.
+  fill.faulted = 0;
+  while (size) {
+    uint32_t count = pageSize - (address % pageSize);
+    if (count > size) {
+      count = size;
+    }
+    if (rvsrv_writeAsync(address, buf, count, fillCompleted, &fill) < 0) {
+      free(buf);
+      return -1;
+    }
+    address += count;
+    size -= count;
+  }
+  
+  // Wait for the writes to complete.
+  free(buf);
+  if (rvsrv_flushAsync() < 0) {
+    return -1;
+  }
+  if (fill.faulted) {
+    *faultCode = fill.faultCode;
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * Sets the size bytes starting at address to value. rvsrv fills the memory
+ * by itself if it supports it, so the data is not transferred; otherwise the
+ * writes are pipelined using the asynchronous request window. Any
+ * asynchronous requests in flight are completed first. Returns 1 when
+ * successful, 0 when a bus error occured or -1 when a fatal error occured. In
+ * the latter case, an error will be printed to stderr. If a bus error
+ * occured, *faultCode is set to the first bus fault.
+ */
+int rvsrv_fill(
+  uint32_t address,
+  uint32_t size,
+  unsigned char value,
+  uint32_t *faultCode
+) {
+  unsigned char payload[BINPROTO_FILL_PAYLOAD_SIZE];
+  
+  // Complete the requests in flight, and make sure we have a connection, so
+  // we know which protocol to use, and that queued writes are performed
+  // first.
+  if (rvsrv_flushAsync() < 0) {
+    return -1;
+  }
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  if (!size) {
+    return 1;
+  }
+  
+  // Fall back to writing the memory from here if rvsrv can't fill it for us,
+  // or if we can access the memory directly anyway.
+  if (!binaryMode || (binaryVersion < 6)) {
+    return fillLocally(address, size, value, faultCode);
+  }
+  if (localPath) {
+    if (!localShare.addr) {
+      if (localShare_open(localPath, &localShare) < 0) {
+        return -1;
+      }
+    }
+    if (localShare_contains(&localShare, address, size)) {
+      return fillLocally(address, size, value, faultCode);
+    }
+  }
+  
+  // Send the request.
+  binProto_putU32(payload, value * 0x01010101u);
+  switch (binaryTransfer(BINPROTO_OP_FILL, address, size, payload, BINPROTO_FILL_PAYLOAD_SIZE, 0, faultCode)) {
+    case BINPROTO_STATUS_OK:
+      return 1;
+    case BINPROTO_STATUS_FAULT:
+      return 0;
+  }
+  
+  return -1;
+}
+
+/**
+ * Computes the page CRCs for rvsrv_hashPages() by reading the memory through
+ * the regular read path. Used when rvsrv does not support Hash requests or
+ * the memory can be accessed directly. The return value and outputs are the
+ * same as for rvsrv_hashPages().
+ */
+static int hashLocally(
+  uint32_t address,
+  uint32_t size,
+  uint32_t pageSize,
+  uint32_t *crcs,
+  uint32_t *faultCode
+) {
+  unsigned char *buf;
+  int retval = 1;
+  
+  buf = (unsigned char*)malloc(transferSize);
+  if (!buf) {
+    perror("Failed to allocate memory for hash buffer");
+    return -1;
+  }
+  
+  while (size && (retval == 1)) {
+    uint32_t remain = (size < pageSize) ? size : pageSize;
+    uint32_t crc = 0;
+    
+    size -= remain;
+    while (remain) {
+      int count = (remain < transferSize) ? remain : transferSize;
+      retval = rvsrv_readBulk(address, buf, count, faultCode);
+      if (retval != 1) {
+        break;
+      }
+      crc = crc32_update(crc, buf, count);
+      address += count;
+      remain -= count;
+    }
+    *crcs++ = crc;
+  }
+  
+  free(buf);
+  return retval;
+}
+
+/**
+ * Computes the CRC-32 (as used by zlib) of every page of pageSize bytes in
+ * the size bytes starting at address, and stores them in crcs. The pages are
+ * counted from address; the last one may be partial. pageSize must be a power
+ * of two between RVSRV_MIN_HASH_PAGE_SIZE and rvsrv_getPageSize(), and the
+ * range may span at most RVSRV_MAX_HASH_PAGES pages. The memory is read and
+ * hashed by rvsrv if it supports it, so only the CRCs are transferred.
+ * Returns 1 when successful, 0 when a bus error occured or -1 when a fatal
+ * error occured. In the latter case, an error will be printed to stderr. If a
+ * bus error occured, *faultCode is set to the bus fault.
+ */
+int rvsrv_hashPages(
+  uint32_t address,
+  uint32_t size,
+  uint32_t pageSize,
+  uint32_t *crcs,
+  uint32_t *faultCode
+) {
+  unsigned char payload[BINPROTO_HASH_PAYLOAD_SIZE];
+  uint32_t numPages, i;
+  int retval;
+  
+  // Make sure we have a connection, so we know which protocol to use, and
+  // that queued writes are performed first.
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  
+  // Check the parameters.
+  numPages = size / pageSize + ((size % pageSize) ? 1 : 0);
+  if ((pageSize < RVSRV_MIN_HASH_PAGE_SIZE) || (pageSize > transferSize) || (pageSize & (pageSize - 1))
+    || (numPages < 1) || (numPages > RVSRV_MAX_HASH_PAGES)
+  ) {
+    fprintf(stderr,
+      "Error: rvsrv_hashPages() called with an invalid page size or range.\n"
+    );
+    return -1;
+  }
+  
+  // Fall back to reading the memory from here if rvsrv can't hash it for us,
+  // or if we can access the memory directly anyway.
+  if (!binaryMode || (binaryVersion < 5)) {
+    return hashLocally(address, size, pageSize, crcs, faultCode);
+  }
+  if (localPath) {
+    if (!localShare.addr) {
+      if (localShare_open(localPath, &localShare) < 0) {
+        return -1;
+      }
+    }
+    if (localShare_contains(&localShare, address, size)) {
+      return hashLocally(address, size, pageSize, crcs, faultCode);
+    }
+  }
+  
+  // Send the request.
+  binProto_putU32(payload, pageSize);
+  retval = binaryTransfer(BINPROTO_OP_HASH, address, size, payload, BINPROTO_HASH_PAYLOAD_SIZE, numPages * 4, faultCode);
+  switch (retval) {
+    case BINPROTO_STATUS_OK:
+      for (i = 0; i < numPages; i++) {
+        crcs[i] = binProto_getU32((unsigned char *)packetBuffer + i * 4);
+      }
+      return 1;
+      
+    case BINPROTO_STATUS_FAULT:
+      return 0;
+      
+  }
+  
+  return -1;
+}
+
+/**
+ * Computes the CRC for rvsrv_checksum() by reading the memory through the
+ * regular read path. Used when rvsrv does not support Checksum requests or
+ * the memory can be accessed directly. The return value and outputs are the
+ * same as for rvsrv_checksum().
+ */
+static int checksumLocally(
+  uint32_t address,
+  uint32_t size,
+  uint32_t *crc,
+  uint32_t *faultCode
+) {
+  unsigned char *buf;
+  int retval = 1;
+  
+  buf = (unsigned char*)malloc(transferSize);
+  if (!buf) {
+    perror("Failed to allocate memory for checksum buffer");
+    return -1;
+  }
+  
+  *crc = 0;
+  while (size) {
+    int count = (size < transferSize) ? size : transferSize;
+    retval = rvsrv_readBulk(address, buf, count, faultCode);
+    if (retval != 1) {
+      break;
+    }
+    *crc = crc32_update(*crc, buf, count);
+    address += count;
+    size -= count;
+  }
+  
+  free(buf);
+  return retval;
+}
+
+/**
+ * Computes the CRC-32 (as used by zlib) of the size bytes starting at
+ * address and stores it in *crc. The memory is read and checksummed by rvsrv
+ * if it supports it, so only the CRC is transferred. Returns 1 when
+ * successful, 0 when a bus error occured or -1 when a fatal error occured. In
+ * the latter case, an error will be printed to stderr. If a bus error
+ * occured, *faultCode is set to the bus fault.
+ */
+int rvsrv_checksum(
+  uint32_t address,
+  uint32_t size,
+  uint32_t *crc,
+  uint32_t *faultCode
+) {
+  
+  // Make sure we have a connection, so we know which protocol to use, and
+  // that queued writes are performed first.
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  if (!size) {
+    *crc = 0;
+    return 1;
+  }
+  
+  // Fall back to reading the memory from here if rvsrv can't checksum it for
+  // us, or if we can access the memory directly anyway.
+  if (!binaryMode || (binaryVersion < 7)) {
+    return checksumLocally(address, size, crc, faultCode);
+  }
+  if (localPath) {
+    if (!localShare.addr) {
+      if (localShare_open(localPath, &localShare) < 0) {
+        return -1;
+      }
+    }
+    if (localShare_contains(&localShare, address, size)) {
+      return checksumLocally(address, size, crc, faultCode);
+    }
+  }
+  
+  // Send the request.
+  switch (binaryTransfer(BINPROTO_OP_CHECKSUM, address, size, 0, 0, BINPROTO_CHECKSUM_REPLY_SIZE, faultCode)) {
+    case BINPROTO_STATUS_OK:
+      *crc = binProto_getU32((unsigned char *)packetBuffer);
+      return 1;
+      
+    case BINPROTO_STATUS_FAULT:
+      return 0;
+      
+  }
+  
+  return -1;
+}
+
+/**
+ * Tag of the TraceStream request which starts a stream, and of the request
+ * which stops it.
+ */
+#define TRACE_START_TAG 0
+#define TRACE_STOP_TAG  1
+
+/**
+ * Sends a TraceStream request on the trace connection. A size of zero stops
+ * the stream.
+ */
+static int sendTraceRequest(uint32_t tag, uint32_t address, uint32_t size, uint32_t interval) {
+  unsigned char buf[BINPROTO_REQUEST_HEADER_SIZE + BINPROTO_TRACE_PAYLOAD_SIZE];
+  int payloadSize = size ? BINPROTO_TRACE_PAYLOAD_SIZE : 0;
+  
+  binProto_putU32(buf + 0, BINPROTO_REQUEST_HEADER_SIZE - 4 + payloadSize);
+  buf[4] = BINPROTO_OP_TRACE;
+  buf[5] = 0;
+  buf[6] = 0;
+  buf[7] = 0;
+  binProto_putU32(buf + 8, tag);
+  binProto_putU32(buf + 12, address);
+  binProto_putU32(buf + 16, size);
+  binProto_putU32(buf + 20, interval);
+  return sendAll(traceSocket, buf, BINPROTO_REQUEST_HEADER_SIZE + payloadSize);
+}
+
+/**
+ * Starts streaming the contents of the trace buffer at the given address
+ * through rvsrv, on a separate connection, so other commands can still be
+ * executed while the stream is running. size is the total size of the double
+ * buffer. interval is the time between polls of an idle trace buffer in
+ * microseconds, or 0 for the default. Returns 1 if the stream was started, 0
+ * if rvsrv does not support trace streams, in which case the caller should
+ * read the buffers itself, or -1 if an error occured.
+ */
+int rvsrv_traceStart(uint32_t address, uint32_t size, int interval) {
+  char d;
+  
+  // Make sure rvsrv supports trace streams.
+  if (rvsrv_connect() < 0) {
+    return -1;
+  }
+  if (!binaryMode || (binaryVersion < 3) || (size > 2 * (uint32_t)transferSize)) {
+    return 0;
+  }
+  if (flushBatch() < 0) {
+    return -1;
+  }
+  
+  // Allocate a buffer for a full half of the trace buffer.
+  if (traceBufferSize < size / 2) {
+    free(traceBuffer);
+    traceBufferSize = 0;
+    traceBuffer = (unsigned char*)malloc(size / 2);
+    if (!traceBuffer) {
+      perror("Failed to allocate memory for trace buffer");
+      return -1;
+    }
+    traceBufferSize = size / 2;
+  }
+  tracePending = 0;
+  traceOffset = 0;
+  traceStopping = 0;
+  
+  // Open the connection and switch it to the binary protocol. We already
+  // know that rvsrv supports it, so the reply doesn't need to be checked.
+  traceSocket = openSocket();
+  if (traceSocket < 0) {
+    return -1;
+  }
+  if (sendAll(traceSocket, "Binary;", 7) < 0) {
+    rvsrv_traceClose();
+    return -1;
+  }
+  do {
+    if (receiveAll(traceSocket, &d, 1, "Binary") < 0) {
+      rvsrv_traceClose();
+      return -1;
+    }
+  } while (d != '\n');
+  
+  // Start the stream.
+  if (sendTraceRequest(TRACE_START_TAG, address, size, interval) < 0) {
+    rvsrv_traceClose();
+    return -1;
+  }
+  
+  return 1;
+}
+
+/**
+ * Receives trace data from a stream started with rvsrv_traceStart(). Waits
+ * at most timeout milliseconds for data to arrive. Returns the number of
+ * bytes stored in buffer, which is 0 if no data arrived in time, or -1 if an
+ * error occured. *ended is set once the stream has ended, which only happens
+ * after rvsrv_traceStop() was called.
+ */
+int rvsrv_traceReceive(unsigned char *buffer, int size, int timeout, int *ended) {
+  unsigned char header[BINPROTO_REPLY_HEADER_SIZE];
+  struct pollfd pfd;
+  uint32_t len, tag, count;
+  int status;
+  
+  *ended = 0;
+  while (1) {
+    
+    // Return data we received earlier first.
+    if (tracePending) {
+      if (size > tracePending) {
+        size = tracePending;
+      }
+      memcpy(buffer, traceBuffer + traceOffset, size);
+      traceOffset += size;
+      tracePending -= size;
+      return size;
+    }
+    
+    // Wait for the next frame.
+    pfd.fd = traceSocket;
+    pfd.events = POLLIN;
+    switch (poll(&pfd, 1, timeout)) {
+      case -1:
+        perror("Failed to wait for trace data");
+        return -1;
+        
+      case 0:
+        return 0;
+        
+    }
+    
+    // Receive the frame header and check it.
+    if (receiveAll(traceSocket, header, BINPROTO_REPLY_HEADER_SIZE, "TraceStream") < 0) {
+      return -1;
+    }
+    len = binProto_getU32(header + 0);
+    tag = binProto_getU32(header + 8);
+    count = binProto_getU32(header + 16);
+    status = header[5];
+    if ((len < BINPROTO_REPLY_HEADER_SIZE - 4) || (len - (BINPROTO_REPLY_HEADER_SIZE - 4) > traceBufferSize)
+      || (header[4] != BINPROTO_OP_TRACE) || ((tag != TRACE_START_TAG) && (tag != TRACE_STOP_TAG))
+    ) {
+      fprintf(stderr, 
+        "Error: received a malformed reply to command \"TraceStream\" from rvsrv.\n"
+      );
+      return -1;
+    }
+    len -= BINPROTO_REPLY_HEADER_SIZE - 4;
+    if (receiveAll(traceSocket, traceBuffer, len, "TraceStream") < 0) {
+      return -1;
+    }
+    
+    // The reply to the stop request is sent after the final frame of the
+    // stream.
+    if (tag == TRACE_STOP_TAG) {
+      *ended = 1;
+      return 0;
+    }
+    
+    switch (status) {
+      case BINPROTO_STATUS_OK:
+        if (count != len) {
+          fprintf(stderr, 
+            "Error: received a malformed reply to command \"TraceStream\" from rvsrv:\n"
+            "unexpected amount of bytes returned.\n"
+          );
+          return -1;
+        }
+        
+        // A frame without data ends the stream. If we didn't stop it
+        // ourselves, rvsrv must have dropped it.
+        if (!count && !traceStopping) {
+          fprintf(stderr, "Error: rvsrv ended the trace stream unexpectedly.\n");
+          return -1;
+        }
+        tracePending = count;
+        traceOffset = 0;
+        break;
+        
+      case BINPROTO_STATUS_FAULT:
+        fprintf(stderr,
+          "Error: bus fault 0x%08X occured while reading from trace buffer.\n",
+          binProto_getU32(header + 20)
+        );
+        return -1;
+        
+      default:
+        if (len >= traceBufferSize) {
+          len = traceBufferSize - 1;
+        }
+        traceBuffer[len] = 0;
+        printServerError("TraceStream", len ? (const char*)traceBuffer : 0);
+        return -1;
+        
+    }
+  }
+}
+
+/**
+ * Asks rvsrv to stop a trace stream. The data which was read from the trace
+ * buffer up to that point is still returned by rvsrv_traceReceive(), which
+ * reports the end of the stream afterwards. Returns -1 if an error occured,
+ * or 0 otherwise.
+ */
+int rvsrv_traceStop(void) {
+  if (traceStopping) {
+    return 0;
+  }
+  traceStopping = 1;
+  return sendTraceRequest(TRACE_STOP_TAG, 0, 0, 0);
+}
+
+/**
+ * Closes the connection used for a trace stream, stopping the stream if it
+ * was still running.
+ */
+void rvsrv_traceClose(void) {
+  if (traceSocket >= 0) {
+    close(traceSocket);
+    traceSocket = -1;
+  }
+  tracePending = 0;
+}
@@ -52,23 +52,115 @@
 #include "types.h"
 
 /**
- * Size of an rvsrv page: the maximum amount of bytes which can be transferred
- * in a single operation.
+ * Size of an rvsrv page: the amount of bytes which every version of rvsrv can
+ * transfer in a single operation. Use rvsrv_getPageSize() to get the actual
+ * maximum, which may be larger.
  */
 #define RVSRV_PAGE_SIZE_LOG2 12
 #define RVSRV_PAGE_SIZE (1 << (RVSRV_PAGE_SIZE_LOG2))
 
+/**
+ * Maximum number of asynchronous reads and writes which may be in flight at
+ * once. Keeping this many requests in flight hides the round trip to rvsrv
+ * for bulk transfers.
+ */
+#define RVSRV_ASYNC_WINDOW 8
+
+/**
+ * Minimum page size and maximum number of pages for rvsrv_hashPages().
+ */
+#define RVSRV_MIN_HASH_PAGE_SIZE 256
+#define RVSRV_MAX_HASH_PAGES 1024
+
+/**
+ * Completion callback for asynchronous reads and writes. address, buffer and
+ * size are the parameters the request was issued with. result is 1 if the
+ * access was successful or 0 if a bus fault occured, in which case faultCode
+ * is set to the bus fault. Should return 0 to continue, or -1 to fail the
+ * remaining requests.
+ */
+typedef int (*rvsrvCompletion_t)(
+  void *data,
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  int result,
+  uint32_t faultCode
+);
+
 /**
  * Stores the hostname and port to connect to internally. The connection is not
  * made until the first call to one of the read or write methods.
  */
 int rvsrv_setup(const char *host, int port);
 
+/**
+ * Enables local access through the Unix-domain socket of rvsrv at the given
+ * path (rvsrv --local). Reads and writes within the memory shared by rvsrv
+ * are then performed directly instead of being sent to rvsrv.
+ */
+int rvsrv_setupLocal(const char *path);
+
+/**
+ * Returns the maximum number of bytes which can be read or written with a
+ * single call to rvsrv_readBulk() or rvsrv_writeBulk(), connecting to rvsrv
+ * first if necessary to find out. This is a power of two, at least
+ * RVSRV_PAGE_SIZE. Returns -1 and prints an error if something went wrong.
+ */
+int rvsrv_getPageSize(void);
+
+/**
+ * Returns a buffer large enough to hold a full page as returned by
+ * rvsrv_getPageSize(), and sets *pageSize to that page size. The buffer is
+ * shared between all callers and remains valid until rvsrv_close() is called.
+ * Returns null and prints an error if something went wrong.
+ */
+unsigned char *rvsrv_getPageBuffer(int *pageSize);
+
+/**
+ * Like rvsrv_getPageBuffer(), but returns a buffer large enough to hold count
+ * consecutive pages, so a page can be read into while the reads of the others
+ * are still in flight.
+ */
+unsigned char *rvsrv_getPageBuffers(int count, int *pageSize);
+
+/**
+ * Connects to rvsrv and maps the memory shared through the local socket now,
+ * instead of when they are first needed. Used by the rvd session server, so
+ * the commands it runs inherit a warm connection. Returns -1 and prints an
+ * error if something went wrong, otherwise returns 0.
+ */
+int rvsrv_open(void);
+
+/**
+ * Closes the connection to rvsrv and unmaps the shared memory without
+ * forgetting where to connect to, so the next access connects again. Pending
+ * batched writes are discarded.
+ */
+void rvsrv_disconnect(void);
+
 /**
  * Closes the connection to rvsrv if a connection is open.
  */
 void rvsrv_close(void);
 
+/**
+ * Starts batching single writes. Until the matching call to rvsrv_endBatch(),
+ * rvsrv_writeSingle() may queue writes locally and send them to rvsrv in bulk
+ * once a read is performed or the batch ends, so the writes to all contexts
+ * can be done in a single round trip. Bus faults for queued writes are printed
+ * and reported as errors by whichever call flushes the queue. Calls may be
+ * nested. Batching only takes place if rvsrv supports the binary protocol.
+ */
+void rvsrv_beginBatch(void);
+
+/**
+ * Ends a batch started with rvsrv_beginBatch(), sending any queued writes when
+ * the outermost batch ends. Returns -1 if an error occured or any of the
+ * queued writes failed, or 0 otherwise.
+ */
+int rvsrv_endBatch(void);
+
 /**
  * Sends the stop command to the server.
  */
@@ -87,8 +179,8 @@ int rvsrv_readSingle(
 );
 
 /**
- * Reads at most 4096 bytes in a single command. The address does not need to
- * be aligned, but it's slightly faster if it is. Returns 1 when successful,
+ * Reads at most rvsrv_getPageSize() bytes in a single command. The address
+ * does not need to be aligned, but it's slightly faster if it is. Returns 1 when successful,
  * 0 when a bus error occured, or -1 when a fatal error occured. In the latter
  * case, an error will be printed to stderr. If a bus error occured and fault
  * is not null, *faultCode will be set to the bus fault. Only the last bus
@@ -116,8 +208,8 @@ int rvsrv_writeSingle(
 );
 
 /**
- * Writes at most 4096 bytes in a single command. The address does not need to
- * be aligned, but it's slightly faster if it is. Returns 1 when successful,
+ * Writes at most rvsrv_getPageSize() bytes in a single command. The address
+ * does not need to be aligned, but it's slightly faster if it is. Returns 1 when successful,
  * 0 when a bus error occured, or -1 when a fatal error occured. In the latter
  * case, an error will be printed to stderr. If a bus error occured and fault
  * is not null, *faultCode will be set to the bus fault. Only the last bus
@@ -130,4 +222,148 @@ int rvsrv_writeBulk(
   uint32_t *faultCode
 );
 
+/**
+ * Issues a read of at most rvsrv_getPageSize() bytes without waiting for the
+ * reply. Up to RVSRV_ASYNC_WINDOW reads and writes may be in flight at once;
+ * when the window is full, this waits for the oldest one to complete first.
+ * buffer must remain valid until the completion callback has been called,
+ * which happens from within this function, rvsrv_writeAsync(),
+ * rvsrv_flushAsync() or any other function which accesses rvsrv. Callbacks
+ * are called in the order in which the requests were issued. Returns -1 if
+ * an error occured or a previous request or callback failed, in which case
+ * the callbacks of the remaining requests are not called. Otherwise returns
+ * 0.
+ */
+int rvsrv_readAsync(
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  rvsrvCompletion_t callback,
+  void *data
+);
+
+/**
+ * Issues a write of at most rvsrv_getPageSize() bytes without waiting for
+ * the reply. This behaves like rvsrv_readAsync(), except that the data is
+ * sent right away, so buffer may be reused as soon as this returns.
+ */
+int rvsrv_writeAsync(
+  uint32_t address,
+  unsigned char *buffer,
+  int size,
+  rvsrvCompletion_t callback,
+  void *data
+);
+
+/**
+ * Waits for all asynchronous requests in flight to complete, calling their
+ * completion callbacks. Returns -1 if an error occured or any of the requests
+ * or callbacks failed since the previous call, otherwise returns 0.
+ */
+int rvsrv_flushAsync(void);
+
+/**
+ * Waits until (word & mask) == value holds for the 32-bit word at the given
+ * address, or until timeout milliseconds have passed. A negative timeout
+ * waits indefinitely. interval specifies the time between polls in
+ * microseconds, or 0 for the default. The polling is done by rvsrv if it
+ * supports it, so only a single round trip is needed. Returns 1 when the
+ * condition was met, 2 when the timeout expired, 0 when a bus error occured
+ * or -1 when a fatal error occured. In the latter case, an error will be
+ * printed to stderr. *result is set to the last word that was read, or to the
+ * bus fault if a bus error occured.
+ */
+int rvsrv_waitFor(
+  uint32_t address,
+  uint32_t mask,
+  uint32_t value,
+  int timeout,
+  int interval,
+  uint32_t *result
+);
+
+/**
+ * Sets the size bytes starting at address to value. rvsrv fills the memory
+ * by itself if it supports it, so the data is not transferred; otherwise the
+ * writes are pipelined using the asynchronous request window. Any
+ * asynchronous requests in flight are completed first. Returns 1 when
+ * successful, 0 when a bus error occured or -1 when a fatal error occured. In
+ * the latter case, an error will be printed to stderr. If a bus error
+ * occured, *faultCode is set to the first bus fault.
+ */
+int rvsrv_fill(
+  uint32_t address,
+  uint32_t size,
+  unsigned char value,
+  uint32_t *faultCode
+);
+
+/**
+ * Computes the CRC-32 (as used by zlib) of every page of pageSize bytes in
+ * the size bytes starting at address, and stores them in crcs. The pages are
+ * counted from address; the last one may be partial. pageSize must be a power
+ * of two between RVSRV_MIN_HASH_PAGE_SIZE and rvsrv_getPageSize(), and the
+ * range may span at most RVSRV_MAX_HASH_PAGES pages. The memory is read and
+ * hashed by rvsrv if it supports it, so only the CRCs are transferred.
+ * Returns 1 when successful, 0 when a bus error occured or -1 when a fatal
+ * error occured. In the latter case, an error will be printed to stderr. If a
+ * bus error occured, *faultCode is set to the bus fault.
+ */
+int rvsrv_hashPages(
+  uint32_t address,
+  uint32_t size,
+  uint32_t pageSize,
+  uint32_t *crcs,
+  uint32_t *faultCode
+);
+
+/**
+ * Computes the CRC-32 (as used by zlib) of the size bytes starting at
+ * address and stores it in *crc. The memory is read and checksummed by rvsrv
+ * if it supports it, so only the CRC is transferred. Returns 1 when
+ * successful, 0 when a bus error occured or -1 when a fatal error occured. In
+ * the latter case, an error will be printed to stderr. If a bus error
+ * occured, *faultCode is set to the bus fault.
+ */
+int rvsrv_checksum(
+  uint32_t address,
+  uint32_t size,
+  uint32_t *crc,
+  uint32_t *faultCode
+);
+
+/**
+ * Starts streaming the contents of the trace buffer at the given address
+ * through rvsrv, on a separate connection, so other commands can still be
+ * executed while the stream is running. size is the total size of the double
+ * buffer. interval is the time between polls of an idle trace buffer in
+ * microseconds, or 0 for the default. Returns 1 if the stream was started, 0
+ * if rvsrv does not support trace streams, in which case the caller should
+ * read the buffers itself, or -1 if an error occured.
+ */
+int rvsrv_traceStart(uint32_t address, uint32_t size, int interval);
+
+/**
+ * Receives trace data from a stream started with rvsrv_traceStart(). Waits
+ * at most timeout milliseconds for data to arrive. Returns the number of
+ * bytes stored in buffer, which is 0 if no data arrived in time, or -1 if an
+ * error occured. *ended is set once the stream has ended, which only happens
+ * after rvsrv_traceStop() was called.
+ */
+int rvsrv_traceReceive(unsigned char *buffer, int size, int timeout, int *ended);
+
+/**
+ * Asks rvsrv to stop a trace stream. The data which was read from the trace
+ * buffer up to that point is still returned by rvsrv_traceReceive(), which
+ * reports the end of the stream afterwards. Returns -1 if an error occured,
+ * or 0 otherwise.
+ */
+int rvsrv_traceStop(void);
+
+/**
+ * Closes the connection used for a trace stream, stopping the stream if it
+ * was still running.
+ */
+void rvsrv_traceClose(void);
+
 #endif
@@ -0,0 +1,660 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "session.h"
+#include "rvsrvInterface.h"
+
+/**
+ * A command line forwarded to the session server consists of a 32-bit size in
+ * native byte order, followed by that many bytes containing the working
+ * directory and the arguments as null-terminated strings. The standard
+ * streams of the forwarding process are attached to the first message. The
+ * server replies with the 32-bit exit code of the command. The maximum size
+ * of a forwarded command line is defined below.
+ */
+#define MAX_REQUEST_SIZE (1024 * 1024)
+
+/**
+ * Memory map loaded by the session server.
+ */
+typedef struct {
+  
+  /**
+   * Canonical path of the map file.
+   */
+  char *path;
+  
+  /**
+   * File status when it was loaded, used to detect changes.
+   */
+  struct stat st;
+  
+} sessionMap_t;
+
+/**
+ * Maps loaded before the session server was started, in order.
+ */
+static sessionMap_t *maps = 0;
+static int numMaps = 0;
+
+/**
+ * Index of the map which a session server child can skip next. Set to
+ * numMaps when the child loads something else.
+ */
+static int nextMap = 0;
+
+/**
+ * Set in processes forked by the session server to run a command.
+ */
+static int isChild = 0;
+
+/**
+ * Listening socket of the session server, its path and the process ID of the
+ * server, or -1 and null if we're not running the session server.
+ */
+static int listenSocket = -1;
+static char *serverPath = 0;
+static pid_t serverPid = -1;
+
+/**
+ * Writes exactly size bytes to the given socket. Returns -1 if something went
+ * wrong, otherwise returns 0.
+ */
+static int sendAll(int f, const void *buf, int size) {
+  const char *ptr = (const char*)buf;
+  int count;
+  
+  while (size > 0) {
+    count = send(f, ptr, size, MSG_NOSIGNAL);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    ptr += count;
+    size -= count;
+  }
+  return 0;
+}
+
+/**
+ * Reads exactly size bytes from the given socket. Returns -1 if something
+ * went wrong or the connection was closed, otherwise returns 0.
+ */
+static int receiveAll(int f, void *buf, int size) {
+  char *ptr = (char*)buf;
+  int count;
+  
+  while (size > 0) {
+    count = recv(f, ptr, size, 0);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (count == 0) {
+      return -1;
+    }
+    ptr += count;
+    size -= count;
+  }
+  return 0;
+}
+
+/**
+ * Fills in a Unix-domain socket address for path. Returns -1 and prints an
+ * error if the path is too long, otherwise returns 0.
+ */
+static int makeAddress(const char *path, struct sockaddr_un *addr) {
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    fprintf(stderr, "Error: session socket path %s is too long.\n", path);
+    return -1;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+/**
+ * Forwards the given command line, the current working directory and the
+ * standard streams to the rvd session server listening at path, and waits
+ * for the command to complete. Returns the exit code of the command, or -1
+ * if there is no session server at path, in which case the caller should run
+ * the command itself.
+ */
+int session_forward(const char *path, int argc, char **argv) {
+  struct sockaddr_un addr;
+  char cwd[PATH_MAX];
+  char *request, *ptr;
+  uint32_t size;
+  int32_t code;
+  int i, sock, fds[3];
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(sizeof(fds))];
+    struct cmsghdr align;
+  } control;
+  
+  // Everything which goes wrong before the command line has been sent just
+  // means that the command should be run locally.
+  if (makeAddress(path, &addr) < 0) {
+    return -1;
+  }
+  for (i = 0; i < 3; i++) {
+    if (fcntl(i, F_GETFD) < 0) {
+      return -1;
+    }
+    fds[i] = i;
+  }
+  if (!getcwd(cwd, sizeof(cwd))) {
+    return -1;
+  }
+  
+  // Build the request.
+  size = strlen(cwd) + 1;
+  for (i = 0; i < argc; i++) {
+    size += strlen(argv[i]) + 1;
+  }
+  if (size > MAX_REQUEST_SIZE) {
+    return -1;
+  }
+  request = (char*)malloc(sizeof(size) + size);
+  if (!request) {
+    return -1;
+  }
+  memcpy(request, &size, sizeof(size));
+  ptr = request + sizeof(size);
+  strcpy(ptr, cwd);
+  ptr += strlen(cwd) + 1;
+  for (i = 0; i < argc; i++) {
+    strcpy(ptr, argv[i]);
+    ptr += strlen(argv[i]) + 1;
+  }
+  size += sizeof(size);
+  
+  // Connect to the session server.
+  sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) {
+    free(request);
+    return -1;
+  }
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(sock);
+    free(request);
+    return -1;
+  }
+  
+  // Send the first part of the request along with the standard streams, and
+  // the rest normally.
+  iov.iov_base = request;
+  iov.iov_len = size;
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  i = sendmsg(sock, &msg, MSG_NOSIGNAL);
+  if ((i <= 0) || (sendAll(sock, request + i, size - i) < 0)) {
+    close(sock);
+    free(request);
+    return -1;
+  }
+  free(request);
+  
+  // The command is running now, so we can't fall back to running it
+  // ourselves anymore. Wait for its exit code.
+  if (receiveAll(sock, &code, sizeof(code)) < 0) {
+    fprintf(stderr, "Error: lost connection to the rvd session server at %s.\n", path);
+    close(sock);
+    return EXIT_FAILURE;
+  }
+  close(sock);
+  
+  return (code < 0) ? EXIT_FAILURE : code;
+}
+
+/**
+ * Receives a command line from a client of the session server. On success,
+ * returns 0, sets *request to the allocated request data, *size to its size
+ * and fds to the standard streams of the client. Returns -1 and prints an
+ * error if something went wrong.
+ */
+static int receiveRequest(int client, char **request, uint32_t *size, int *fds) {
+  struct msghdr msg;
+  struct iovec iov;
+  struct cmsghdr *cmsg;
+  union {
+    char buf[CMSG_SPACE(3 * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  int count;
+  
+  fds[0] = fds[1] = fds[2] = -1;
+  *request = 0;
+  
+  // Receive the size along with the file descriptors.
+  iov.iov_base = size;
+  iov.iov_len = sizeof(*size);
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  count = recvmsg(client, &msg, MSG_WAITALL);
+  for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)
+      && (cmsg->cmsg_len == CMSG_LEN(3 * sizeof(int)))) {
+      memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+    }
+  }
+  if ((count != sizeof(*size)) || (fds[0] < 0) || (*size < 2) || (*size > MAX_REQUEST_SIZE)) {
+    fprintf(stderr, "Error: received a malformed request on the session socket.\n");
+    return -1;
+  }
+  
+  // Receive the command line.
+  *request = (char*)malloc(*size);
+  if (!*request) {
+    perror("Failed to allocate memory for session request");
+    return -1;
+  }
+  if (receiveAll(client, *request, *size) < 0) {
+    fprintf(stderr, "Error: received a malformed request on the session socket.\n");
+    return -1;
+  }
+  if ((*request)[*size - 1]) {
+    fprintf(stderr, "Error: received a malformed request on the session socket.\n");
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Runs the command line in request in a child process with the given
+ * standard streams, and waits for it to complete. Terminates the child if the
+ * client disconnects before that. Returns the exit code of the command, or -1
+ * and prints an error if it could not be started.
+ */
+static int runRequest(int client, char *request, uint32_t size, int *fds, sessionHandler_t handler) {
+  char *cwd, *ptr, **argv;
+  int argc, i, status, done[2];
+  struct pollfd pfd[2];
+  pid_t pid;
+  
+  // Split the request into the working directory and the arguments.
+  cwd = request;
+  argc = 0;
+  for (ptr = request + strlen(request) + 1; ptr < request + size; ptr += strlen(ptr) + 1) {
+    argc++;
+  }
+  if (!argc) {
+    fprintf(stderr, "Error: received a malformed request on the session socket.\n");
+    return -1;
+  }
+  argv = (char**)malloc((argc + 1) * sizeof(char*));
+  if (!argv) {
+    perror("Failed to allocate memory for session request");
+    return -1;
+  }
+  i = 0;
+  for (ptr = request + strlen(request) + 1; ptr < request + size; ptr += strlen(ptr) + 1) {
+    argv[i++] = ptr;
+  }
+  argv[argc] = 0;
+  
+  // Connect to rvsrv if we're not connected, so the command doesn't have to.
+  // If this fails the command will report the problem itself.
+  rvsrv_open();
+  
+  // The child inherits our stdio buffers, so make sure they are empty.
+  fflush(NULL);
+  
+  // The child keeps the write end of this pipe open, so we see the read end
+  // hang up when it terminates.
+  if (pipe(done) < 0) {
+    perror("Failed to create pipe");
+    free(argv);
+    return -1;
+  }
+  pid = fork();
+  if (pid < 0) {
+    perror("Failed to fork");
+    close(done[0]);
+    close(done[1]);
+    free(argv);
+    return -1;
+  }
+  
+  if (!pid) {
+    
+    // Run the command with the standard streams of the client.
+    isChild = 1;
+    close(listenSocket);
+    close(client);
+    close(done[0]);
+    for (i = 0; i < 3; i++) {
+      dup2(fds[i], i);
+      close(fds[i]);
+    }
+    signal(SIGPIPE, SIG_DFL);
+    if (chdir(cwd) < 0) {
+      fprintf(stderr, "Error: failed to change to directory %s: ", cwd);
+      perror("");
+      exit(EXIT_FAILURE);
+    }
+    exit(handler(argc, argv));
+    
+  }
+  
+  close(done[1]);
+  free(argv);
+  
+  // Wait for the command to complete. If the client goes away first, terminate
+  // the command.
+  pfd[0].fd = done[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = client;
+  pfd[1].events = POLLIN;
+  while (1) {
+    pfd[0].revents = pfd[1].revents = 0;
+    if (poll(pfd, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Failed to wait for command");
+      kill(pid, SIGTERM);
+      break;
+    }
+    if (pfd[0].revents) {
+      break;
+    }
+    if (pfd[1].revents) {
+      kill(pid, SIGTERM);
+      pfd[1].fd = -1;
+    }
+  }
+  close(done[0]);
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      perror("Failed to wait for command");
+      return -1;
+    }
+  }
+  
+  if (WIFEXITED(status)) {
+    return WEXITSTATUS(status);
+  }
+  return 128 + WTERMSIG(status);
+}
+
+/**
+ * Handles a single client of the session server.
+ */
+static void handleClient(int client, sessionHandler_t handler) {
+  char *request;
+  uint32_t size;
+  int32_t code = -1;
+  int i, fds[3];
+  
+  if (receiveRequest(client, &request, &size, fds) >= 0) {
+    code = runRequest(client, request, size, fds, handler);
+  }
+  free(request);
+  for (i = 0; i < 3; i++) {
+    if (fds[i] >= 0) {
+      close(fds[i]);
+    }
+  }
+  
+  // A command which failed may have been interrupted in the middle of a
+  // transfer, so start over with a new connection to rvsrv.
+  if (code) {
+    rvsrv_disconnect();
+  }
+  
+  sendAll(client, &code, sizeof(code));
+}
+
+/**
+ * Runs the rvd session server at the given path until it is terminated. Every
+ * command line received from session_forward() is run by calling handler in a
+ * process forked from the server, so it inherits the parsed definitions and
+ * the connection to rvsrv. Commands are run one at a time. Returns -1 and
+ * prints an error if something went wrong; does not return otherwise.
+ */
+int session_serve(const char *path, sessionHandler_t handler) {
+  struct sockaddr_un addr;
+  int client;
+  
+  if (makeAddress(path, &addr) < 0) {
+    return -1;
+  }
+  listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenSocket < 0) {
+    perror("Failed to create session socket");
+    return -1;
+  }
+  
+  // Remove the socket of a session server which was killed, but don't steal
+  // the socket of one which is still running.
+  if (connect(listenSocket, (struct sockaddr *)&addr, sizeof(addr)) >= 0) {
+    fprintf(stderr, "Error: an rvd session server is already running at %s.\n", path);
+    return -1;
+  }
+  close(listenSocket);
+  unlink(path);
+  listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listenSocket < 0) {
+    perror("Failed to create session socket");
+    return -1;
+  }
+  if (bind(listenSocket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    fprintf(stderr, "Error: failed to bind session socket to %s: ", path);
+    perror("");
+    return -1;
+  }
+  serverPid = getpid();
+  serverPath = strdup(path);
+  if (!serverPath) {
+    perror("Failed to allocate memory for session socket path");
+    return -1;
+  }
+  if (listen(listenSocket, 16) < 0) {
+    perror("Failed to listen on session socket");
+    return -1;
+  }
+  
+  // Writing to clients which went away should not kill us.
+  signal(SIGPIPE, SIG_IGN);
+  
+  printf("rvd session server listening at %s.\n", path);
+  fflush(stdout);
+  
+  while (1) {
+    client = accept(listenSocket, 0, 0);
+    if (client < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("Failed to accept session client");
+      return -1;
+    }
+    handleClient(client, handler);
+    close(client);
+  }
+  
+}
+
+/**
+ * Returns nonzero in a process forked by the session server to run a
+ * command.
+ */
+int session_isChild(void) {
+  return isChild;
+}
+
+/**
+ * Records that the memory map at path has been loaded, if we are not a
+ * session server child. Maps recorded before session_serve() is called are
+ * not parsed again by the commands it runs.
+ */
+void session_mapLoaded(const char *path) {
+  sessionMap_t *newMaps;
+  sessionMap_t map;
+  
+  if (isChild) {
+    return;
+  }
+  
+  // If we can't identify the file, children will just load it again.
+  map.path = realpath(path, 0);
+  if (!map.path) {
+    return;
+  }
+  if (stat(map.path, &map.st) < 0) {
+    free(map.path);
+    return;
+  }
+  newMaps = (sessionMap_t*)realloc(maps, (numMaps + 1) * sizeof(sessionMap_t));
+  if (!newMaps) {
+    free(map.path);
+    return;
+  }
+  maps = newMaps;
+  maps[numMaps++] = map;
+}
+
+/**
+ * Returns nonzero if loading the memory map at path can be skipped because
+ * the session server already loaded it. This is only the case in a session
+ * server child, if the file has not changed since and the maps which were
+ * loaded before it are the same as those loaded by the server. path may be
+ * null to indicate that something else was defined, after which no more maps
+ * are skipped.
+ */
+int session_skipMap(const char *path) {
+  const sessionMap_t *map;
+  struct stat st;
+  char *real;
+  int same = 0;
+  
+  if (!isChild || (nextMap >= numMaps)) {
+    return 0;
+  }
+  map = &maps[nextMap];
+  
+  if (path && (real = realpath(path, 0))) {
+    same = !strcmp(real, map->path)
+      && (stat(real, &st) >= 0)
+      && (st.st_dev == map->st.st_dev)
+      && (st.st_ino == map->st.st_ino)
+      && (st.st_size == map->st.st_size)
+      && (st.st_mtim.tv_sec == map->st.st_mtim.tv_sec)
+      && (st.st_mtim.tv_nsec == map->st.st_mtim.tv_nsec);
+    free(real);
+  }
+  
+  if (!same) {
+    nextMap = numMaps;
+    return 0;
+  }
+  nextMap++;
+  return 1;
+}
+
+/**
+ * Removes the socket of the session server if this is the session server
+ * process, and frees the memory used by the session module.
+ */
+void session_close(void) {
+  int i;
+  
+  if (serverPath && (getpid() == serverPid)) {
+    unlink(serverPath);
+  }
+  free(serverPath);
+  serverPath = 0;
+  if (listenSocket >= 0) {
+    close(listenSocket);
+    listenSocket = -1;
+  }
+  for (i = 0; i < numMaps; i++) {
+    free(maps[i].path);
+  }
+  free(maps);
+  maps = 0;
+  numMaps = 0;
+}
@@ -0,0 +1,106 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _SESSION_H_
+#define _SESSION_H_
+
+/**
+ * Handler which runs a single forwarded command line in a process forked from
+ * the session server. It does not need to return; if it does, the process
+ * exits with the returned code.
+ */
+typedef int (*sessionHandler_t)(int argc, char **argv);
+
+/**
+ * Forwards the given command line, the current working directory and the
+ * standard streams to the rvd session server listening at path, and waits
+ * for the command to complete. Returns the exit code of the command, or -1
+ * if there is no session server at path, in which case the caller should run
+ * the command itself.
+ */
+int session_forward(const char *path, int argc, char **argv);
+
+/**
+ * Runs the rvd session server at the given path until it is terminated. Every
+ * command line received from session_forward() is run by calling handler in a
+ * process forked from the server, so it inherits the parsed definitions and
+ * the connection to rvsrv. Commands are run one at a time. Returns -1 and
+ * prints an error if something went wrong; does not return otherwise.
+ */
+int session_serve(const char *path, sessionHandler_t handler);
+
+/**
+ * Returns nonzero in a process forked by the session server to run a
+ * command.
+ */
+int session_isChild(void);
+
+/**
+ * Records that the memory map at path has been loaded, if we are not a
+ * session server child. Maps recorded before session_serve() is called are
+ * not parsed again by the commands it runs.
+ */
+void session_mapLoaded(const char *path);
+
+/**
+ * Returns nonzero if loading the memory map at path can be skipped because
+ * the session server already loaded it. This is only the case in a session
+ * server child, if the file has not changed since and the maps which were
+ * loaded before it are the same as those loaded by the server. path may be
+ * null to indicate that something else was defined, after which no more maps
+ * are skipped.
+ */
+int session_skipMap(const char *path);
+
+/**
+ * Removes the socket of the session server if this is the session server
+ * process, and frees the memory used by the session module.
+ */
+void session_close(void);
+
+#endif
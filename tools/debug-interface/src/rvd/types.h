@@ -84,4 +84,10 @@ typedef struct {
  */
 typedef uint32_t contextMask_t;
 
+/**
+ * Expression compiled by the parser. The definition table caches these for
+ * definition expansions; the contents are private to parser.c.
+ */
+typedef struct compiledExpr compiledExpr_t;
+
 #endif
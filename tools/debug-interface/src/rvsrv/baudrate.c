@@ -0,0 +1,81 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+// This file is kept separate from serial.c because the kernel termios2
+// definitions in asm/termbits.h conflict with those in termios.h.
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "baudrate.h"
+
+/**
+ * Sets the baud rate of an open serial port to an arbitrary value using the
+ * Linux termios2 interface, for rates which have no Bxxx constant. Returns 0
+ * on success or -1 on failure, with errno set.
+ */
+int baudrate_setCustom(int f, int baud) {
+  struct termios2 cfg;
+  
+  // Retrieve the current configuration.
+  if (ioctl(f, TCGETS2, &cfg) < 0) {
+    return -1;
+  }
+  
+  // Select an arbitrary rate for both directions.
+  cfg.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+  cfg.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+  cfg.c_ispeed = baud;
+  cfg.c_ospeed = baud;
+  
+  // Commit the new configuration.
+  if (ioctl(f, TCSETS2, &cfg) < 0) {
+    return -1;
+  }
+  
+  return 0;
+}
@@ -46,9 +46,14 @@
  * Copyright (C) 2008-2016 by TU Delft.
  */
 
-#ifndef _UART_INTERNAL_H_
-#define _UART_INTERNAL_H_
+#ifndef _BAUDRATE_H_
+#define _BAUDRATE_H_
 
-extern int tty;
+/**
+ * Sets the baud rate of an open serial port to an arbitrary value using the
+ * Linux termios2 interface, for rates which have no Bxxx constant. Returns 0
+ * on success or -1 on failure, with errno set.
+ */
+int baudrate_setCustom(int f, int baud);
 
 #endif
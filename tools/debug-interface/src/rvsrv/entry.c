@@ -54,6 +54,7 @@
 
 #include "entry.h"
 #include "main.h"
+#include "tcpserv.h"
 
 /**
  * Prints usage information.
@@ -76,18 +77,33 @@ static void license(void);
 int main(int argc, char **argv) {
   
   commandLineArgs_t args;
+  targetArgs_t *target;
+  int i, j;
   
   // Set command line option defaults.
-  args.port = "/dev/ttyS0";
-  args.baudrate  = 115200;
-  args.pcieCdev = NULL;
-  args.mmioFile = NULL;
-  args.mmioOffset = 0;
-  args.mmioLength = 0;
-  args.appPort   = 21078;
-  args.debugPort = 21079;
+  args.targets = (targetArgs_t*)malloc(sizeof(targetArgs_t));
+  if (!args.targets) {
+    perror("Failed to allocate memory for command line arguments");
+    exit(EXIT_FAILURE);
+  }
+  args.numTargets = 1;
+  target = args.targets;
+  target->port = "/dev/ttyS0";
+  target->baudrate  = 115200;
+  target->pcieCdev = NULL;
+  target->mmioFile = NULL;
+  target->mmioOffset = 0;
+  target->mmioLength = 0;
+  target->sim = NULL;
+  target->appPort   = 21078;
+  target->debugPort = 21079;
+  target->localPath = NULL;
+  target->recordPath = NULL;
   args.foreground = 0;
   args.noReconnect = 0;
+  args.appLag = 4 * 1024 * 1024;
+  args.appOverflow = TCP_OVERFLOW_DROP;
+  args.statsInterval = 60;
   
   // Parse command line arguments.
   while (1) {
@@ -97,18 +113,25 @@ int main(int argc, char **argv) {
       {"baud",         required_argument, 0, 'b'},
       {"pcie",         required_argument, 0, 'P'},
       {"mmio",         required_argument, 0, 'm'},
+      {"sim",          required_argument, 0, 'S'},
       {"app",          required_argument, 0, 'a'},
       {"debug",        required_argument, 0, 'd'},
       {"foreground",   no_argument,       0, 'f'},
       {"help",         no_argument,       0, 'h'},
       {"license",      no_argument,       0, 'l'},
       {"no-reconnect", no_argument,       0, 'n'},
+      {"local",        required_argument, 0, 'L'},
+      {"app-lag",      required_argument, 0, 'g'},
+      {"app-overflow", required_argument, 0, 'o'},
+      {"record",       required_argument, 0, 'r'},
+      {"target",       no_argument,       0, 't'},
+      {"stats",        required_argument, 0, 's'},
       {0, 0, 0, 0}
     };
     
     int option_index = 0;
 
-    int c = getopt_long(argc, argv, "p:b:P:m:a:d:h", long_options, &option_index);
+    int c = getopt_long(argc, argv, "p:b:P:m:S:a:d:L:th", long_options, &option_index);
 
     if (c == -1) {
       break;
@@ -116,12 +139,12 @@ int main(int argc, char **argv) {
 
     switch (c) {
       case 'p':
-        args.port = optarg;
+        target->port = optarg;
         break;
         
       case 'b':
-        args.baudrate = atoi(optarg);
-        if (args.baudrate < 1) {
+        target->baudrate = atoi(optarg);
+        if (target->baudrate < 1) {
           printf("%s: invalid baud rate specified\n\n", argv[0]);
           usage(argv[0], 0);
           exit(EXIT_FAILURE);
@@ -129,19 +152,19 @@ int main(int argc, char **argv) {
         break;
 
       case 'P':
-        args.pcieCdev = optarg;
+        target->pcieCdev = optarg;
         {
           struct stat st;
-          if (stat(args.pcieCdev, &st) == -1) {
+          if (stat(target->pcieCdev, &st) == -1) {
             printf("%s: Couldn't stat PCIe character device %s.\n", argv[0],
-                args.pcieCdev);
+                target->pcieCdev);
             perror(argv[0]);
             printf("\n");
             usage(argv[0], 0);
             exit(EXIT_FAILURE);
-          } else if (!S_ISCHR(st.st_mode)) {
-            printf("%s: Path doesn't point to a character device: %s.\n\n", argv[0],
-                args.pcieCdev);
+          } else if (!S_ISCHR(st.st_mode) && !S_ISREG(st.st_mode)) {
+            printf("%s: Path doesn't point to a character device or file: %s.\n\n", argv[0],
+                target->pcieCdev);
             usage(argv[0], 0);
             exit(EXIT_FAILURE);
           }
@@ -159,7 +182,7 @@ int main(int argc, char **argv) {
             usage(argv[0], 0);
             exit(EXIT_FAILURE);
           }
-          args.mmioFile = token;
+          target->mmioFile = token;
           
           // Parse offset.
           token = strtok(NULL, ":");
@@ -168,7 +191,7 @@ int main(int argc, char **argv) {
             usage(argv[0], 0);
             exit(EXIT_FAILURE);
           }
-          args.mmioOffset = strtoul(token, NULL, 0);
+          target->mmioOffset = strtoul(token, NULL, 0);
           
           // Parse length.
           token = strtok(NULL, ":");
@@ -177,14 +200,18 @@ int main(int argc, char **argv) {
             usage(argv[0], 0);
             exit(EXIT_FAILURE);
           }
-          args.mmioLength = strtoul(token, NULL, 0);
+          target->mmioLength = strtoul(token, NULL, 0);
           
         }
         break;
         
+      case 'S':
+        target->sim = optarg;
+        break;
+        
       case 'a':
-        args.appPort = atoi(optarg);
-        if ((args.appPort < 1) || (args.appPort > 65535)) {
+        target->appPort = atoi(optarg);
+        if ((target->appPort < 1) || (target->appPort > 65535)) {
           printf("%s: invalid TCP port specified for application access\n\n", argv[0]);
           usage(argv[0], 0);
           exit(EXIT_FAILURE);
@@ -192,14 +219,81 @@ int main(int argc, char **argv) {
         break;
         
       case 'd':
-        args.debugPort = atoi(optarg);
-        if ((args.debugPort < 1) || (args.debugPort > 65535)) {
+        target->debugPort = atoi(optarg);
+        if ((target->debugPort < 1) || (target->debugPort > 65535)) {
           printf("%s: invalid TCP port specified for debug access\n\n", argv[0]);
           usage(argv[0], 0);
           exit(EXIT_FAILURE);
         }
         break;
         
+      case 'L':
+        target->localPath = optarg;
+        break;
+        
+      case 'g':
+        args.appLag = atoi(optarg);
+        if (args.appLag < 1) {
+          printf("%s: invalid application client lag specified\n\n", argv[0]);
+          usage(argv[0], 0);
+          exit(EXIT_FAILURE);
+        }
+        args.appLag *= 1024;
+        break;
+        
+      case 'o':
+        if (!strcmp(optarg, "drop")) {
+          args.appOverflow = TCP_OVERFLOW_DROP;
+        } else if (!strcmp(optarg, "disconnect")) {
+          args.appOverflow = TCP_OVERFLOW_DISCONNECT;
+        } else {
+          printf("%s: --app-overflow should be drop or disconnect\n\n", argv[0]);
+          usage(argv[0], 0);
+          exit(EXIT_FAILURE);
+        }
+        break;
+        
+      case 'r':
+        target->recordPath = optarg;
+        break;
+        
+      case 's':
+        args.statsInterval = atoi(optarg);
+        if (args.statsInterval < 0 || args.statsInterval > 2000) {
+          printf("%s: invalid statistics interval specified\n\n", argv[0]);
+          usage(argv[0], 0);
+          exit(EXIT_FAILURE);
+        }
+        break;
+        
+      case 't':
+        {
+          targetArgs_t *targets;
+          
+          // Start a new target. The options which follow apply to it. Its
+          // TCP ports default to the next pair after the previous target.
+          targets = (targetArgs_t*)realloc(args.targets, sizeof(targetArgs_t) * (args.numTargets + 1));
+          if (!targets) {
+            perror("Failed to allocate memory for command line arguments");
+            exit(EXIT_FAILURE);
+          }
+          args.targets = targets;
+          target = &targets[args.numTargets];
+          target->port = NULL;
+          target->baudrate  = 115200;
+          target->pcieCdev = NULL;
+          target->mmioFile = NULL;
+          target->mmioOffset = 0;
+          target->mmioLength = 0;
+          target->sim = NULL;
+          target->appPort   = targets[args.numTargets - 1].appPort + 2;
+          target->debugPort = targets[args.numTargets - 1].debugPort + 2;
+          target->localPath = NULL;
+          target->recordPath = NULL;
+          args.numTargets++;
+        }
+        break;
+        
       case 'f':
         args.foreground = 1;
         break;
@@ -225,18 +319,52 @@ int main(int argc, char **argv) {
     }
   }
   
-  // Make sure the application and debug ports are not set to the same port.
-  if (args.appPort == args.debugPort) {
-    printf("%s: cannot use one port for both application and debug interface\n\n", argv[0]);
-    usage(argv[0], 0);
-    exit(EXIT_FAILURE);
-  }
-  
-  // Make sure that the user isn't trying to do PCIe and mmio at the same time.
-  if (args.mmioFile && args.pcieCdev) {
-    printf("%s: cannot use PCIe and memory mapped I/O at the same time\n\n", argv[0]);
-    usage(argv[0], 0);
-    exit(EXIT_FAILURE);
+  for (i = 0; i < args.numTargets; i++) {
+    target = &args.targets[i];
+    
+    // Make sure the application and debug ports are not set to the same port.
+    if (target->appPort == target->debugPort) {
+      printf("%s: cannot use one port for both application and debug interface\n\n", argv[0]);
+      usage(argv[0], 0);
+      exit(EXIT_FAILURE);
+    }
+    
+    // Make sure that the user isn't trying to use more than one of PCIe,
+    // mmio and simulation at the same time.
+    if (!!target->mmioFile + !!target->pcieCdev + !!target->sim > 1) {
+      printf("%s: can only use one of PCIe, memory mapped I/O and simulation\n\n", argv[0]);
+      usage(argv[0], 0);
+      exit(EXIT_FAILURE);
+    }
+    
+    // Targets specified with --target have no serial port by default, so
+    // they need at least one way to talk to the board.
+    if (!target->port && !target->mmioFile && !target->pcieCdev && !target->sim) {
+      printf("%s: target %d needs --port, --pcie, --mmio or --sim\n\n", argv[0], i);
+      usage(argv[0], 0);
+      exit(EXIT_FAILURE);
+    }
+    
+    // Local access hands out the memory-mapped file, so it requires mmio.
+    if (target->localPath && !target->mmioFile) {
+      printf("%s: --local can only be used together with --mmio\n\n", argv[0]);
+      usage(argv[0], 0);
+      exit(EXIT_FAILURE);
+    }
+    
+    // Make sure that targets don't share TCP ports.
+    for (j = 0; j < i; j++) {
+      if ((target->appPort == args.targets[j].appPort)
+        || (target->appPort == args.targets[j].debugPort)
+        || (target->debugPort == args.targets[j].appPort)
+        || (target->debugPort == args.targets[j].debugPort)
+      ) {
+        printf("%s: targets %d and %d use the same TCP port\n\n", argv[0], j, i);
+        usage(argv[0], 0);
+        exit(EXIT_FAILURE);
+      }
+    }
+    
   }
   
   // Print welcome text/license header.
@@ -245,8 +373,10 @@ int main(int argc, char **argv) {
   
   // Command line parsing and eye candy complete: now run the actual program.
   if (run(&args)) {
+    free(args.targets);
     exit(EXIT_FAILURE);
   }
+  free(args.targets);
   
   // Exit gracefully.
   printf("Shut down gracefully.\n");
@@ -276,19 +406,46 @@ static void usage(char *progName, int verbose) {
     "  -b  --baud <rate>  Specify baud rate to use. Defaults to 115200.\n"
     "  -P  --pcie <dev>   Use the PCIe driver to communicate with the device instead\n"
     "                     of the UART connection. Specify the character device to use\n"
-    "                     to communicate with the driver.\n"
+    "                     to communicate with the driver. A regular file can be\n"
+    "                     specified instead to simulate the device memory.\n"
     "  -m  --mmio <d>:<s>:<l>  Use memory-mapped I/O to communicate with the device\n"
     "                     instead of the UART connection. <d> should be a device\n"
     "                     filename, <s> should be an offset within the device file\n"
     "                     and <l> should be the number of bytes to map.\n"
+    "  -S  --sim <lat>[:<s>:<l>]...  Simulate the device memory instead of\n"
+    "                     connecting to hardware, for testing and benchmarking.\n"
+    "                     Each access takes <lat> microseconds, and accesses to\n"
+    "                     each region of <l> bytes starting at <s> fault. The\n"
+    "                     debug control registers respond to break, step,\n"
+    "                     resume and reset commands.\n"
     "  -a  --app <port>   Listen on the specified TCP port for UART communication\n"
     "                     with application code. Defaults to port 21078.\n"
     "  -d  --debug <port> Listen on the specified TCP port for debugging commands.\n"
     "                     Defaults to port 21079.\n"
+    "  -L  --local <path> Listen on a Unix-domain socket at the specified path.\n"
+    "                     Local clients connecting to it are given direct access\n"
+    "                     to the memory mapped with --mmio.\n"
+    "      --app-lag <KiB> Maximum amount of application data which may be queued\n"
+    "                     for a client which is not keeping up. Defaults to 4096.\n"
+    "      --app-overflow <drop|disconnect>  What to do with application clients\n"
+    "                     which exceed --app-lag: drop the oldest data so they\n"
+    "                     catch up (default), or disconnect them.\n"
+    "      --record <file> Append all data sent by the application to the given\n"
+    "                     file, with timestamps. See pyrvd/apprecord.py.\n"
+    "  -t  --target       Start the options for another target, i.e. another board\n"
+    "                     or backend served by this instance. --port, --baud,\n"
+    "                     --pcie, --mmio, --sim, --app, --debug, --local and\n"
+    "                     --record which follow apply to the new target. Its TCP ports\n"
+    "                     default to the ports of the previous target plus two,\n"
+    "                     and it has no serial port unless --port is given.\n"
     "      --foreground   Run in the calling terminal instead of starting the daemon\n"
     "                     process.\n"
     "      --no-reconnect Do not attempt to reconnect to serial port after the port\n"
     "                     stops working; exit instead.\n"
+    "      --stats <sec>  Print traffic and latency statistics for each target\n"
+    "                     every <sec> seconds while it is in use, up to 2000.\n"
+    "                     Defaults to 60; 0 disables them. Clients can request the same\n"
+    "                     statistics at any time with the Stats command.\n"
     "  -h  --help         Shows this usage screen%s.\n"
     "      --license      Prints licensing information.\n"
     "\n",
@@ -55,13 +55,14 @@
 int main(int argc, char **argv);
 
 /**
- * Structure containing the command line parameters. This is filled in main and
- * then passed to run().
+ * Command line parameters for a single target, i.e. a board connected through
+ * one of the backends, with its own application and debug servers.
  */
 typedef struct {
   
   /**
-   * Filename of the serial port to connect to.
+   * Filename of the serial port to connect to, or NULL if the target does not
+   * have one.
    */ 
   char *port;
   
@@ -90,6 +91,12 @@ typedef struct {
    */
   unsigned long mmioLength;
   
+  /**
+   * Specification for the simulated backend, see init_sim_iface(). NULL when
+   * the target is not simulated.
+   */
+  char *sim;
+  
   /**
    * TCP port to listen on for application-access connections.
    */
@@ -100,6 +107,33 @@ typedef struct {
    */
   int debugPort;
   
+  /**
+   * Path of the Unix-domain socket to listen on for local clients, or NULL
+   * if local access is disabled.
+   */
+  char *localPath;
+  
+  /**
+   * Path of the file to record the application stream to, or NULL if
+   * recording is disabled.
+   */
+  char *recordPath;
+  
+} targetArgs_t;
+
+/**
+ * Structure containing the command line parameters. This is filled in main and
+ * then passed to run().
+ */
+typedef struct {
+  
+  /**
+   * Parameters for each target served by this rvsrv instance. There is always
+   * at least one.
+   */
+  targetArgs_t *targets;
+  int numTargets;
+  
   /**
    * When set, rvsrv should keep running in the current shell, instead of
    * turning into a daemon.
@@ -112,6 +146,19 @@ typedef struct {
    */
   int noReconnect;
   
+  /**
+   * Maximum number of bytes which may be queued for a single application
+   * client, and what to do when a client exceeds it (TCP_OVERFLOW_*).
+   */
+  int appLag;
+  int appOverflow;
+  
+  /**
+   * Interval between the statistics printed for each target, in seconds, or
+   * 0 to disable them.
+   */
+  int statsInterval;
+  
 } commandLineArgs_t;
 
 #endif
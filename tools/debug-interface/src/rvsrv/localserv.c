@@ -0,0 +1,222 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "localserv.h"
+#include "reactor.h"
+#include "localShare.h"
+
+/**
+ * State of a local server.
+ */
+struct localServer {
+  
+  /**
+   * Listening socket, or -1 if the server is not open.
+   */
+  int listenDesc;
+  
+  /**
+   * Absolute path of the socket file, so we can remove it again after
+   * daemonize() changed the working directory.
+   */
+  char socketPath[sizeof(((struct sockaddr_un*)0)->sun_path)];
+  
+  /**
+   * Backend which provides the memory to share.
+   */
+  const rvex_iface_t *rvexIface;
+  
+};
+
+/**
+ * Reactor handler for the listening socket. Sends the shared memory file
+ * descriptor to every incoming connection and closes it again.
+ */
+static int onListenReady(int f, int events, void *data) {
+  localServer_t *server = (localServer_t*)data;
+  int clientDesc, fd;
+  unsigned long offset, length;
+  
+  while (1) {
+    
+    // Accept the incoming connection.
+    clientDesc = accept(server->listenDesc, 0, 0);
+    if (clientDesc < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        return 0;
+      }
+      if ((errno == EINTR) || (errno == ECONNABORTED)) {
+        continue;
+      }
+      perror("Failed to accept incoming local connection");
+      return -1;
+    }
+    
+    // Hand over the file descriptor. Failing to do so is not fatal; the
+    // client may just have disconnected already.
+    if (server->rvexIface->share(server->rvexIface->data, &fd, &offset, &length) >= 0) {
+      if (localShare_send(clientDesc, fd, offset, length) >= 0) {
+        printf("Shared target memory with local client.\n");
+      }
+    }
+    close(clientDesc);
+    
+  }
+  
+}
+
+/**
+ * Starts listening on a Unix-domain socket at the given path. Local clients
+ * connecting to it receive a file descriptor for the memory backing the
+ * target, as described in localShare.h, so they can access it directly. The
+ * backend must support the share() method. Returns null and prints an error
+ * if something went wrong.
+ */
+localServer_t *localServer_open(const char *path, const rvex_iface_t *iface) {
+  localServer_t *server;
+  struct sockaddr_un addr;
+  int size;
+  
+  printf("Trying to open local socket %s...\n", path);
+  if (!iface->share) {
+    printf("Local access is only supported for memory-mapped I/O.\n");
+    return 0;
+  }
+  server = (localServer_t*)malloc(sizeof(localServer_t));
+  if (!server) {
+    perror("Failed to allocate local server");
+    return 0;
+  }
+  server->listenDesc = -1;
+  server->rvexIface = iface;
+  
+  // Figure out the absolute path of the socket.
+  server->socketPath[0] = 0;
+  if (path[0] != '/') {
+    if (!getcwd(server->socketPath, sizeof(server->socketPath))) {
+      perror("Failed to get working directory");
+      localServer_close(&server);
+      return 0;
+    }
+    strcat(server->socketPath, "/");
+  }
+  size = strlen(server->socketPath) + strlen(path);
+  if (size >= sizeof(server->socketPath)) {
+    printf("Local socket path %s is too long.\n", path);
+    server->socketPath[0] = 0;
+    localServer_close(&server);
+    return 0;
+  }
+  strcat(server->socketPath, path);
+  
+  // Create the socket. It is nonblocking so we can accept connections until
+  // there are none left when the reactor tells us there are some.
+  server->listenDesc = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (server->listenDesc < 0) {
+    perror("Failed to open local socket");
+    server->socketPath[0] = 0;
+    localServer_close(&server);
+    return 0;
+  }
+  
+  // Remove a stale socket file left behind by a previous instance and bind
+  // to the path. Only the current user may connect, because connecting gives
+  // full access to the target memory.
+  memset((void*)&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, server->socketPath);
+  unlink(server->socketPath);
+  if (bind(server->listenDesc, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("Failed to bind local socket");
+    server->socketPath[0] = 0;
+    localServer_close(&server);
+    return 0;
+  }
+  if (chmod(server->socketPath, S_IRUSR | S_IWUSR) < 0) {
+    perror("Failed to set local socket permissions");
+    localServer_close(&server);
+    return 0;
+  }
+  
+  // Start listening.
+  if ((listen(server->listenDesc, 5) < 0) || (reactor_register(server->listenDesc, REACTOR_READ, &onListenReady, server) < 0)) {
+    perror("Failed to start listening on local socket");
+    localServer_close(&server);
+    return 0;
+  }
+  
+  printf("Now listening on local socket %s.\n", server->socketPath);
+  return server;
+}
+
+/**
+ * Stops listening on the local socket, removes the socket file and frees the
+ * server.
+ */
+void localServer_close(localServer_t **server) {
+  if (!*server) {
+    return;
+  }
+  if ((*server)->listenDesc >= 0) {
+    reactor_unregister((*server)->listenDesc);
+    close((*server)->listenDesc);
+  }
+  if ((*server)->socketPath[0]) {
+    unlink((*server)->socketPath);
+  }
+  free(*server);
+  *server = 0;
+}
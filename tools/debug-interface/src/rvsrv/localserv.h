@@ -45,37 +45,29 @@
  * 
  * Copyright (C) 2008-2016 by TU Delft.
  */
+#ifndef _LOCALSERV_H_
+#define _LOCALSERV_H_
 
-#ifndef _SELECT_H_
-#define _SELECT_H_
+#include "rvex_iface.h"
 
 /**
- * Initializes the internal state of the select unit.
+ * Local server, which shares the memory of a single target.
  */
-int select_init(void);
+typedef struct localServer localServer_t;
 
 /**
- * Registers a file descriptor to be waited on by select_wait().
+ * Starts listening on a Unix-domain socket at the given path. Local clients
+ * connecting to it receive a file descriptor for the memory backing the
+ * target, as described in localShare.h, so they can access it directly. The
+ * backend must support the share() method. Returns null and prints an error
+ * if something went wrong.
  */
-int select_register(int f);
+localServer_t *localServer_open(const char *path, const rvex_iface_t *iface);
 
 /**
- * Unregisters a file descriptor from the set used by select_wait().
+ * Stops listening on the local socket, removes the socket file and frees the
+ * server.
  */
-int select_unregister(int f);
-
-/**
- * Makes the actual call to select. When quick is nonzero, the timeout is set
- * to 1 ms, which is useful for when operations are in progress and we want to
- * check for timeouts. When quick is 0, select_wait blocks until any of the
- * monitored streams are ready.
- */
-int select_wait(int quick);
-
-/**
- * Returns whether the given file descriptor is ready for read access in this
- * iteration.
- */
-int select_isReady(int f);
+void localServer_close(localServer_t **server);
 
 #endif
@@ -55,32 +55,27 @@
 #include <time.h>
 
 #include "main.h"
-#include "serial.h"
 #include "daemon.h"
-#include "parseReadWrite.h"
-#include "rvex_iface.h"
-#include "select.h"
-#include "tcpserv.h"
-
-#include "pcie/pcie.h"
-#include "mmio/mmio.h"
-#include "uart/uart.h"
+#include "protocol.h"
+#include "reactor.h"
+#include "target.h"
 
 /**
- * TCP server for sending data to and receiving data from the application code
- * running on the rvex platform.
+ * State for each target we're serving.
  */
-tcpServer_t *appServer;
+static target_t *targets = 0;
 
 /**
- * TCP server for debug requests.
+ * Number of targets which have been opened, or at least attempted to.
  */
-tcpServer_t *debugServer;
+static int numTargets = 0;
 
 /**
- * Interface to the rVEX device.
+ * Set when the main loop should terminate because we received SIGTERM or a
+ * target lost its serial port. Clients requesting a stop are tracked by the
+ * protocol handler.
  */
-static rvex_iface_t rvexIface;
+static int terminated = 0;
 
 
 //-----------------------------------------------------------------------------
@@ -90,7 +85,7 @@ static rvex_iface_t rvexIface;
 /**
  * This contains the file descriptors for a pipe which will be used to handle
  * SIGTERM. The handler for SIGTERM will write a dummy byte to the pipe, which
- * will wake up select(), so we can break out of the main loop cleanly.
+ * will wake up the reactor, so we can break out of the main loop cleanly.
  */
 static int terminatePipe[] = {0, 0};
 
@@ -105,307 +100,15 @@ static void terminate(int sig) {
   }
 }
 
-
-//-----------------------------------------------------------------------------
-// Debug server command handling
-//-----------------------------------------------------------------------------
-
-/**
- * Maximum size of a debug command. Set to 8k plus a little extra so a write
- * command can write a full 4kbyte page at once.
- */
-#define MAX_DEBUG_COMMAND_SIZE 8448
-
-/**
- * Extra data structure for receiving debug commands.
- */
-typedef struct {
-  
-  /**
-   * Command buffer.
-   */
-  unsigned char commandBuf[MAX_DEBUG_COMMAND_SIZE];
-  
-  /**
-   * Number of bytes currently in the buffer.
-   */
-  int numBytes;
-  
-} debugServerClientData_t;
-
-/**
- * Allocates extra data for debug server command handling.
- */
-static int debugServerExtraDataAlloc(void **extra) {
-  if (extra) {
-    *extra = malloc(sizeof(debugServerClientData_t));
-    if (!*extra) {
-      return -1;
-    }
-    ((debugServerClientData_t*)(*extra))->numBytes = 0;
-  }
-  return 0;
-}
-
-/**
- * Deallocates extra data for debug server command handling.
- */
-static int debugServerExtraDataFree(void **extra) {
-  if (extra && *extra) {
-    free(*extra);
-    *extra = 0;
-  }
-  return 0;
-}
-
-/**
- * Returns 1 if command starts with the specified text and is either followed
- * by a comma or null, or 0 otherwise.
- */
-static int checkCommand(const unsigned char *command, const unsigned char *text) {
-  
-  while (*text) {
-    if (*command++ != *text++) {
-      return 0;
-    }
-  }
-  
-  return (*command == 0) || (*command == ',');
-}
-
-/**
- * Handles a server command. firstTime should be set to 1 the first time
- * handleCommand is called for a specific command, and 0 thereafter. Return
- * values:
- *  -1 = An error occured.
- *   0 = Command is being processed, not done yet.
- *   1 = Command processing complete, stop the server.
- *   2 = Command processing complete, fetch the next command.
- */
-static int handleCommand(unsigned char *command, int clientID, int firstTime) {
-  unsigned char *ptr;
-  
-  if (checkCommand(command, (const unsigned char *)"Stop")) {
-    
-    // Stop server command.
-    if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)"OK, Stop;\n") < 0) {
-      return -1;
-    }
-    printf("Client ID %d (debug access) requested the server to stop.\n", clientID);
-    return 1;
-    
-  } else if (checkCommand(command, (const unsigned char *)"Read") || checkCommand(command, (const unsigned char *)"Write")) {
-
-    struct parse_rw_result res;
-    unsigned char *syntax_error;
-    
-    // Parse read/write command.
-    int err = parseReadWrite(command, &res, &syntax_error);
-    if (err == 0) {
-      // Perform the write or read.
-      if (res.is_write) {
-        err = rvexIface.write(res.address, res.buffer, res.buf_size, clientID);
-        free(res.buffer);
-      } else {
-        err = rvexIface.read(res.address, res.buf_size, clientID);
-      }
-      if (err < 0) {
-        return -1;
-      }
-    } else if (err == 1) {
-      tcpServer_sendStr(debugServer, clientID, syntax_error);
-      free(syntax_error);
-    } else {
-      return -1;
-    }
-    
-    return 2;
-    
-  }
-  
-  // Unknown command.
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)"Error, ") < 0) {
-    return -1;
-  }
-  ptr = command;
-  while ((*ptr) && (*ptr != ',')) {
-    if (tcpServer_send(debugServer, clientID, *ptr++) < 0) {
-      return -1;
-    }
-  }
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)", UnknownCommand;\n") < 0) {
-    return -1;
-  }
-  return 2;
-  
-}
-
 /**
- * Retrieves and handles debug commands. Returns values:
- *  -1 = An error occured.
- *   0 = Everything is OK.
- *   1 = Stop command received, stop the server.
+ * Reactor handler for the read end of the terminate pipe.
  */
-static int handleDebugServer(void) {
-  static unsigned char *currentCommand = 0;
-  static int currentClient = 0;
-  
-  // If we were handling a command, continue doing so.
-  if (currentCommand) {
-    int retval;
-    
-    retval = handleCommand(currentCommand, currentClient, 0);
-    if (retval < 0) {
-      
-      // Error while processing the command.
-      return -1;
-      
-    } else if (retval == 0) {
-      
-      // Command did not complete yet.
-      return 0;
-      
-    } else if (retval == 1) {
-      
-      // Received stop server command.
-      return 1;
-      
-    }
-    
-    // Command handling complete.
-    currentCommand = 0;
-    
-  }
-  
-  // If we're not handling a command right now, try to get one.
-  if (!currentCommand) {
-    int clientID;
-    
-    // Loop over all connected clients.
-    for (clientID = tcpServer_nextClient(debugServer, -1); clientID >= 0; clientID = tcpServer_nextClient(debugServer, clientID)) {
-      debugServerClientData_t *extra;
-      int d;
-      
-      // Found a client to retrieve stuff from. Get the pointer to the
-      // packet buffer.
-      extra = tcpServer_getExtraData(debugServer, clientID);
-      if (!extra) {
-        continue;
-      }
-      
-      // Receive bytes from the client, process them, and stick them in
-      // the command buffer.
-      while ((d = tcpServer_receive(debugServer, clientID)) >= 0) {
-        
-        // Check if the buffer is full.
-        if (extra->numBytes >= MAX_DEBUG_COMMAND_SIZE) {
-          
-          // Buffer is full; ignore everything except for the semicolon
-          // delimiter character.
-          if (d == ';') {
-            
-            // Send an error message.
-            tcpServer_sendStr(debugServer, clientID, (const unsigned char *)"Error, PacketBufferOverrun;\n");
-            
-            // Reset the buffer.
-            extra->numBytes = 0;
-            
-          }
-          
-        } else {
-          
-          // There is space left in the buffer, handle the byte.
-          if (d == ';') {
-            int retval;
-            
-            // Delimiter character: we've received a full command.
-            // Null-terminate the command.
-            extra->commandBuf[extra->numBytes] = 0;
-            
-            // Reset the buffer.
-            extra->numBytes = 0;
-            
-            // Call handleCommand for the first time.
-            retval = handleCommand(extra->commandBuf, clientID, 1);
-            if (retval < 0) {
-              
-              // Error while processing the command.
-              return -1;
-              
-            } else if (retval == 0) {
-              
-              // Command did not complete yet. Remember that we're working on
-              // a command and return.
-              currentCommand = extra->commandBuf;
-              currentClient = clientID;
-              return 0;
-              
-            } else if (retval == 1) {
-              
-              // Received stop server command.
-              return 1;
-              
-            }
-            
-          } else if ((d == ',') || ((d >= 'a') && (d <= 'z')) || ((d >= 'A') && (d <= 'Z')) || ((d >= '0') && (d <= '9'))) {
-            
-            // Normal character, add it to the buffer.
-            extra->commandBuf[extra->numBytes++] = d;
-            
-          } else {
-            
-            // Ignore everything else.
-            
-          }
-          
-        }
-        
-      }
-      
-    }
-    
-  }
-  
+static int onTerminatePipe(int f, int events, void *data) {
+  terminated = 1;
   return 0;
-  
 }
 
 
-//-----------------------------------------------------------------------------
-// Application server command handling
-//-----------------------------------------------------------------------------
-
-/**
- * Forwards data received from the application TCP server to the rvex
- * application, and broadcasts data from the rvex application to all clients
- * connected to the application TCP server.
- */
-static int handleApplicationData(int tty) {
-  int clientID;
-  int d;
-  
-  // Loop over all connected clients.
-  for (clientID = tcpServer_nextClient(appServer, -1); clientID >= 0; clientID = tcpServer_nextClient(appServer, clientID)) {
-    
-    // Receive bytes from the client and stick them in the application serial
-    // TX buffer.
-    while ((d = tcpServer_receive(appServer, clientID)) >= 0) {
-      if (serial_appSend(tty, d) < 0) {
-        return -1;
-      }
-    }
-  }
-  
-  // Broadcast bytes from the application serial RX buffer.
-  while ((d = serial_appReceive(tty)) >= 0) {
-    if (tcpServer_broadcast(appServer, d) < 0) {
-      return -1;
-    }
-  }
-  
-  return 0;
-}
-
 //-----------------------------------------------------------------------------
 // Main program loop
 //-----------------------------------------------------------------------------
@@ -413,24 +116,20 @@ static int handleApplicationData(int tty) {
 /**
  * Closes all file descriptors and connections.
  */
-static void cleanup(int *tty) {
-  
-  // Free memory used by the debug command queues.
-  if(rvexIface.free) {
-    rvexIface.free();
-  }
+static void cleanup(void) {
+  int i;
   
-  // Close the serial port connection.
-  if (*tty >= 0) {
-    serial_close(tty);
+  // Close the backends, serial ports and servers of all targets.
+  for (i = 0; i < numTargets; i++) {
+    target_close(&targets[i]);
   }
-  
-  // Close TCP servers.
-  tcpServer_close(&appServer);
-  tcpServer_close(&debugServer);
+  free(targets);
+  targets = 0;
+  numTargets = 0;
   
   // Close the handles to the pipe used for the terminate signal.
   if (terminatePipe[0]) {
+    reactor_unregister(terminatePipe[0]);
     close(terminatePipe[0]);
     terminatePipe[0] = 0;
   }
@@ -439,6 +138,9 @@ static void cleanup(int *tty) {
     terminatePipe[1] = 0;
   }
   
+  // Close the epoll instance.
+  reactor_free();
+  
 }
 
 /**
@@ -446,7 +148,7 @@ static void cleanup(int *tty) {
  */
 #define CHECK_FALSE(f) \
   if (!(f)) { \
-    cleanup(&tty); \
+    cleanup(); \
     return -1; \
   }
 
@@ -461,52 +163,34 @@ static void cleanup(int *tty) {
 #define CHECKNULL(f) CHECK_FALSE(f)
 
 /**
- * Runs the program. First opens the handle to the serial port, then starts
- * listening on the requested TCP ports and starts handling commands.
+ * Runs the program. First opens the serial ports and backends of all targets,
+ * then starts listening on the requested TCP ports and starts handling
+ * commands.
  */
 int run(const commandLineArgs_t *args) {
-  int tty;
   int busy;
-  int terminated;
-  int supposed_to_have_tty;
-  time_t now = 0;
-  time_t last_reconnect_attempt = 0;
+  int retval;
+  int i;
   
-  // Initialize select wrapper state.
-  CHECK(select_init());
+  // Initialize the reactor.
+  CHECK(reactor_init());
   
-  // Try to open the serial port.
-  tty = serial_open(args->port, args->baudrate);
-  // Only fail when we are not using PCIe or mmio communication.
-  CHECK_FALSE(tty >= 0 || args->pcieCdev || args->mmioFile);
-  supposed_to_have_tty = tty != 0;
-
-  // Try to initalize the rvex interface.
-  if (args->pcieCdev) {
-    CHECK(init_pcie_iface(args->pcieCdev, &rvexIface));
-  } else if (args->mmioFile) {
-    CHECK(init_mmio_iface(args->mmioFile, args->mmioOffset, args->mmioLength, &rvexIface));
-  } else {
-    CHECK(init_uart_iface(tty, &rvexIface));
+  // Open all the targets.
+  CHECKNULL(targets = (target_t*)malloc(sizeof(target_t) * args->numTargets));
+  for (i = 0; i < args->numTargets; i++) {
+    numTargets++;
+    CHECK(target_open(&targets[i], &args->targets[i], args));
   }
   
-  // Try to open the TCP servers.
-  CHECKNULL(appServer = tcpServer_open(
-    args->appPort,
-    "application",
-    0,
-    0
-  ));
-  CHECKNULL(debugServer = tcpServer_open(
-    args->debugPort,
-    "debug",
-    &debugServerExtraDataAlloc,
-    &debugServerExtraDataFree
-  ));
-  
   // Fork into daemon mode if foreground is not set.
   if (!args->foreground) {
-    CHECK(daemonize(args->debugPort));
+    CHECK(daemonize(args->targets[0].debugPort));
+  }
+  
+  // Start the backend threads now that we're in the process which will
+  // keep running; threads don't survive fork().
+  for (i = 0; i < numTargets; i++) {
+    CHECK(target_start(&targets[i]));
   }
   
   // Set up the terminate handler.
@@ -514,88 +198,40 @@ int run(const commandLineArgs_t *args) {
     perror("Could not create pipe");
     return -1;
   }
-  CHECK(select_register(terminatePipe[0]));
+  CHECK(reactor_register(terminatePipe[0], REACTOR_READ, &onTerminatePipe, 0));
   signal(SIGTERM, &terminate);
   
-  // Run the main loop for the program, where we poll for incoming data and
-  // and handle it if we find some.
+  // Run the main loop for the program. The reactor calls the handlers for
+  // whatever became ready: TCP clients are accepted and their data is handled
+  // directly, timers fire and the serial ports are marked readable. After
+  // that we only need to move data between the serial ports and the backends
+  // of each target, and flush whatever was queued for transmission.
   busy = 0;
   terminated = 0;
-  while (!terminated) {
-    int retval;
+  while (!terminated && !protocol_stopRequested()) {
     
-    // Wait for things to become ready.
-    CHECK(select_wait(busy));
+    // Wait for things to become ready and handle them. If there is still work
+    // pending from the previous iteration, only handle what's ready now.
+    CHECK(reactor_wait(busy));
     busy = 0;
     
-    // Update the serial port (perform reads into our buffer).
-    if (tty >= 0) {
-      if (serial_update(tty) == -1) {
-        
-        // USB serial port connection lost. Close the port file immediately.
-        serial_close(&tty);
-        
-        // Terminate if we shouldn't try to reconnect.
-        if (args->noReconnect) {
-          terminated = 1;
-        }
-        
+    // Update all targets.
+    for (i = 0; i < numTargets; i++) {
+      CHECK(retval = target_update(&targets[i]));
+      if (retval) {
+        busy = 1;
       }
-    } else if (supposed_to_have_tty) {
-      
-      // Try to reopen the USB serial port at most every few seconds if we lost
-      // the connection.
-      time(&now);
-      if (last_reconnect_attempt + 5 < now) {
-        printf("Trying to reopen serial port...\n");
-        tty = serial_open(args->port, args->baudrate);
+      if (targets[i].lost) {
+        terminated = 1;
       }
-      last_reconnect_attempt = now;
-      
-    }
-    
-    // Update the TCP servers (accept incoming connections, perform reads into
-    // our buffer).
-    tcpServer_update(appServer);
-    tcpServer_update(debugServer);
-    
-    // Handle debug server incoming data.
-    CHECK(retval = handleDebugServer());
-    if (retval == 1) {
-      terminated = 1;
-    }
-    
-    // Handle debug command issue and replies.
-    CHECK(busy = rvexIface.update());
-    
-    if (tty >= 0) {
-      // Handle application data.
-      CHECK(handleApplicationData(tty));
-    
-      // Flush the serial port (write pending data to the serial port).
-      serial_flush(tty);
-    }
-    
-    // Flush the TCP servers (write pending data to the sockets).
-    tcpServer_flush(appServer);
-    tcpServer_flush(debugServer);
-    
-    // Check for the terminate signal. Most of the time the call to select
-    // just fails with errno=EINTR so we don't even get here, but it's
-    // possible for the signal to occur just before the call to select, in
-    // which case it would be possible for us to miss the signal and block
-    // until the next read, if it weren't for the magic with the pipe.
-    if (select_isReady(terminatePipe[0])) {
-      terminated = 1;
     }
     
   }
   
   // Clean up: close open file descriptors and deallocate memory.
-  cleanup(&tty);
+  cleanup();
   
   // Success.
   return 0;
   
 }
-
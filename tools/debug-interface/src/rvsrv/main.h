@@ -50,18 +50,6 @@
 #define _MAIN_H_
 
 #include "entry.h"
-#include "tcpserv.h"
-
-/**
- * TCP server for sending data to and receiving data from the application code
- * running on the rvex platform.
- */
-extern tcpServer_t *appServer;
-
-/**
- * TCP server for debug requests.
- */
-extern tcpServer_t *debugServer;
 
 /**
  * Runs the application.
@@ -50,7 +50,8 @@
 
 #include "../main.h"
 #include "../rvex_iface.h"
-#include "../tcpserv.h"
+#include "../protocol.h"
+#include "binaryProtocol.h"
 
 #include <sys/mman.h>
 #include <fcntl.h>
@@ -60,87 +61,99 @@
 #include <string.h>
 
 /**
- * File descriptor for the memory-mapped file.
+ * State of a memory-mapped target.
  */
-static int mmio_fd = -1;
-
-/**
- * Address marking the start offset of the file within memory.
- */
-static unsigned char *mmio_addr = NULL;
-
-/**
- * Number of memory-mapped bytes.
- */
-static unsigned long mmio_length = 0;
-
-/**
- * Start address of the mmap'd region (i.e. page aligned).
- */
-static unsigned char *mmio_map_addr = NULL;
-
-/**
- * Size of the mmap'd region (i.e. page aligned).
- */
-static unsigned long mmio_map_length = 0;
+typedef struct {
+  
+  /**
+   * File descriptor for the memory-mapped file.
+   */
+  int fd;
+  
+  /**
+   * Address marking the start offset of the file within memory.
+   */
+  unsigned char *addr;
+  
+  /**
+   * Number of memory-mapped bytes.
+   */
+  unsigned long length;
+  
+  /**
+   * Offset of the memory-mapped bytes within the file.
+   */
+  unsigned long offset;
+  
+  /**
+   * Start address of the mmap'd region (i.e. page aligned).
+   */
+  unsigned char *map_addr;
+  
+  /**
+   * Size of the mmap'd region (i.e. page aligned).
+   */
+  unsigned long map_length;
+  
+  /**
+   * Buffer for read data, large enough for the maximum transfer size.
+   */
+  unsigned char *buffer;
+  
+} mmio_t;
 
 /**
  * Tries to handle a Read command sent by a TCP client connected to
  * the debug server.
  */
-static int mmio_read(uint32_t address, uint32_t buf_size, int clientID) {
+static int mmio_read(void *data, debugRequest_t *req, uint32_t address, uint32_t buf_size) {
+  mmio_t *mmio = (mmio_t*)data;
+  unsigned char *buffer = mmio->buffer;
   
   // Make sure that the addresses are not out of the memory-mapped range.
-  if ((uint64_t)address + (uint64_t)buf_size > (uint64_t)mmio_length) {
-    tcpServer_sendStr(debugServer, clientID, (const unsigned char *)("Error,Read,OutOfMappedRange;\n"));
-    return 0;
+  if ((uint64_t)address + (uint64_t)buf_size > (uint64_t)mmio->length) {
+    return protocol_replyError(req, "OutOfMappedRange");
   }
   
-  // Transmit response to client.
-  int i;
-  unsigned char str[32];
-  // Send status, we don't check for read failures.
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)("OK, Read, OK, ")) < 0) {
-    return 0;
-  }
-  // Send read arguments.
-  sprintf((char *)str, "%08X, %d, ", address, buf_size);
-  if (tcpServer_sendStr(debugServer, clientID, str) < 0) {
-    return 0;
-  }
-  // Send read bytes.
-  for (i = 0; i < buf_size; i++) {
-    sprintf((char *)str, "%02hhX", mmio_addr[address + i]);
-    if (tcpServer_sendStr(debugServer, clientID, str) < 0) {
-      return 0;
+  // Read the bytes. We want to do word reads when we can, for the same reason
+  // as for writes.
+  unsigned char *ptr = mmio->addr + address;
+  unsigned char *buf_ptr = buffer;
+  unsigned char *end = mmio->addr + address + buf_size;
+  while (ptr < end) {
+    if (((long)ptr & 3) || (ptr + 4 > end)) {
+      // ptr misaligned or less than a word remaining.
+      *buf_ptr++ = *ptr++;
+    } else {
+      // Can do a full word at once.
+      *((uint32_t*)buf_ptr) = *((uint32_t*)ptr);
+      ptr += 4;
+      buf_ptr += 4;
     }
   }
-  // Terminate response.
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)";\n") < 0) {
-    return 0;
-  }
-
-  return 0;
+  
+  // Transmit response to client.
+  return protocol_replyRead(req, address, buf_size, buffer);
 }
 
 /**
  * Tries to handle a Write command sent by a TCP client connected to
  * the debug server.
  */
-static int mmio_write(uint32_t address, unsigned char *buffer,
-    uint32_t buf_size, int clientID) {
+static int mmio_write(void *data, debugRequest_t *req, uint32_t address,
+    unsigned char *buffer, uint32_t buf_size) {
+  mmio_t *mmio = (mmio_t*)data;
   
   // Make sure that the addresses are not out of the memory-mapped range.
-  if ((uint64_t)address + (uint64_t)buf_size > (uint64_t)mmio_length) {
-    tcpServer_sendStr(debugServer, clientID, (const unsigned char *)("Error,Write,OutOfMappedRange;\n"));
-    return 0;
+  if ((uint64_t)address + (uint64_t)buf_size > (uint64_t)mmio->length) {
+    return protocol_replyError(req, "OutOfMappedRange");
   }
   
   // Write the bytes. We want to do word writes when we can, because single byte
   // writes are not supported everywhere.
-  unsigned char *ptr = mmio_addr + address;
+  unsigned char *ptr = mmio->addr + address;
   unsigned char *buf_ptr = buffer;
-  unsigned char *end = mmio_addr + address + buf_size;
+  unsigned char *end = mmio->addr + address + buf_size;
   while (ptr < end) {
     if (((long)ptr & 3) || (ptr + 4 > end)) {
       // ptr misaligned or less than a word remaining.
@@ -154,16 +167,52 @@ static int mmio_write(uint32_t address, unsigned char *buffer,
   }
 
   // Transmit response to client.
-  unsigned char str[32];
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)("OK, Write, OK, ")) < 0) {
-    return 0;
+  return protocol_replyWrite(req, address, buf_size);
+}
+
+/**
+ * Tries to handle a Fill command sent by a TCP client connected to the debug
+ * server.
+ */
+static int mmio_fill(void *data, debugRequest_t *req, uint32_t address,
+    uint32_t pattern, uint32_t buf_size) {
+  mmio_t *mmio = (mmio_t*)data;
+  unsigned char bytes[4];
+  uint32_t word;
+  int i;
+  
+  // Make sure that the addresses are not out of the memory-mapped range.
+  if ((uint64_t)address + (uint64_t)buf_size > (uint64_t)mmio->length) {
+    return protocol_replyError(req, "OutOfMappedRange");
   }
-  sprintf((char *)str, "%08X, %d;\n", address, buf_size);
-  if (tcpServer_sendStr(debugServer, clientID, str) < 0) {
-    return 0;
+  
+  // Write the bytes up to the first word boundary a byte at a time.
+  unsigned char *ptr = mmio->addr + address;
+  unsigned char *end = mmio->addr + address + buf_size;
+  while (((long)ptr & 3) && (ptr < end)) {
+    *ptr = pattern >> (24 - 8 * ((ptr - mmio->addr) & 3));
+    ptr++;
   }
-
-  return 0;
+  
+  // Write full words, with the pattern rotated to the alignment of the
+  // words within the target memory.
+  for (i = 0; i < 4; i++) {
+    bytes[i] = pattern >> (24 - 8 * ((ptr - mmio->addr + i) & 3));
+  }
+  memcpy(&word, bytes, 4);
+  while (ptr + 4 <= end) {
+    *((uint32_t*)ptr) = word;
+    ptr += 4;
+  }
+  
+  // Write the remaining bytes.
+  while (ptr < end) {
+    *ptr = pattern >> (24 - 8 * ((ptr - mmio->addr) & 3));
+    ptr++;
+  }
+  
+  // Transmit response to client.
+  return protocol_replyWrite(req, address, buf_size);
 }
 
 /**
@@ -171,30 +220,43 @@ static int mmio_write(uint32_t address, unsigned char *buffer,
  * idle, or 1 if we want update to be called quickly again to handle potential
  * timeouts.
  */
-int mmio_update(void) {
+static int mmio_update(void *data) {
   /* This backend doesn't to update anything as all calls are blocking */
   return 0;
 }
 
+/**
+ * Returns the file descriptor and the mapped region within it, so local
+ * clients can map the file themselves.
+ */
+static int mmio_share(void *data, int *fd, unsigned long *offset, unsigned long *length) {
+  mmio_t *mmio = (mmio_t*)data;
+  *fd = mmio->fd;
+  *offset = mmio->offset;
+  *length = mmio->length;
+  return 0;
+}
+
 /**
  * Frees all dynamically allocated memory by the interface.
  */
-void mmio_free(void) {
+static void mmio_free(void *data) {
+  mmio_t *mmio = (mmio_t*)data;
   
   // Unmap the file.
-  if (mmio_addr != NULL) {
-    munmap(mmio_map_addr, mmio_map_length);
+  if (mmio->map_addr != NULL) {
+    munmap(mmio->map_addr, mmio->map_length);
   }
-  mmio_addr = NULL;
-  mmio_length = 0;
-  mmio_map_addr = NULL;
-  mmio_map_length = 0;
+  
+  // Free the read buffer.
+  free(mmio->buffer);
   
   // Close the file.
-  if (mmio_fd >= 0) {
-    close(mmio_fd);
+  if (mmio->fd >= 0) {
+    close(mmio->fd);
   }
-  mmio_fd = -1;
+  
+  free(mmio);
   
 }
 
@@ -204,6 +266,7 @@ int init_mmio_iface(
   unsigned long length, 
   rvex_iface_t *iface
 ) {
+  mmio_t *mmio;
   
   // Make sure that the offset is word aligned.
   if (offset & 3) {
@@ -218,10 +281,19 @@ int init_mmio_iface(
     return -1;
   }
   
+  // Allocate the instance.
+  mmio = (mmio_t*)malloc(sizeof(mmio_t));
+  if (!mmio) {
+    perror("mmio: failed to allocate state");
+    return -1;
+  }
+  memset((void*)mmio, 0, sizeof(mmio_t));
+  
   // Open the file.
-  mmio_fd = open(file, O_RDWR);
-  if (mmio_fd < 0) {
+  mmio->fd = open(file, O_RDWR);
+  if (mmio->fd < 0) {
     perror("mmio: couldn't open file");
+    free(mmio);
     return -1;
   }
   
@@ -231,31 +303,44 @@ int init_mmio_iface(
   unsigned long page_count = (page_offset + length + page_size-1) / page_size;
   
   // Memory-map the region.
-  mmio_map_length = page_index * page_size;
-  mmio_map_addr = (unsigned char*)mmap(
+  mmio->map_length = page_count * page_size;
+  mmio->map_addr = (unsigned char*)mmap(
     NULL, 
-    page_count * page_size,
+    mmio->map_length,
     PROT_READ | PROT_WRITE,
     MAP_SHARED,
-    mmio_fd,
-    mmio_map_length
+    mmio->fd,
+    page_index * page_size
   );
-  if (mmio_map_addr == MAP_FAILED) {
+  if (mmio->map_addr == MAP_FAILED) {
     perror("mmio: failed to map memory");
-    close(mmio_fd);
-    mmio_fd = -1;
+    mmio->map_addr = NULL;
+    mmio_free(mmio);
     return -1;
   }
-  mmio_addr = mmio_map_addr + page_offset;
-  mmio_length = length;
+  mmio->addr = mmio->map_addr + page_offset;
+  mmio->length = length;
+  mmio->offset = offset;
   
   printf("Successfully memory-mapped file \"%s\"\n.", file);
   
+  // Allocate the read buffer.
+  mmio->buffer = (unsigned char*)malloc(BINPROTO_MAX_TRANSFER_SIZE);
+  if (!mmio->buffer) {
+    perror("mmio: failed to allocate read buffer");
+    mmio_free(mmio);
+    return -1;
+  }
+  
   *iface = (rvex_iface_t) {
+    .data   = mmio,
     .read   = mmio_read,
     .write  = mmio_write,
+    .fill   = mmio_fill,
     .update = mmio_update,
     .free   = mmio_free,
+    .share  = mmio_share,
+    .maxTransferSize = BINPROTO_MAX_TRANSFER_SIZE,
   };
 
   return 0;
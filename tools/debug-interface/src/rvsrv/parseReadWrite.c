@@ -47,6 +47,8 @@
  */
 
 #include "parseReadWrite.h"
+#include "protocol.h"
+#include "binaryProtocol.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -80,40 +82,6 @@ static int charVal(unsigned char c) {
   return -1;
 }
 
-/**
- * Formats a syntax error message.
- *
- * After returning, error_str will point to a malloced string containing the
- * error message to be send to the client. Freeing this memory should be done
- * by the caller.
- *
- * Returns -1 in case of error and 1 otherwise.
- */
-static int syntaxError(unsigned char *command, unsigned char **error_str) {
-  static const char *start_str = "Error, ";
-  static const char *end_str = ", Syntax;\n";
-  size_t start_str_len = strlen(start_str);
-  size_t end_str_len = strlen(end_str);
-  size_t cmd_len = strchr((char*)command, 'r') - (char*)command;
-
-  size_t len = start_str_len + cmd_len + end_str_len + 1;
-
-  *error_str = malloc(len);
-  if (!*error_str) {
-    return -1;
-  }
-
-  memcpy(*error_str, start_str, start_str_len);
-
-  memcpy(*error_str+start_str_len, command, cmd_len);
-
-  memcpy(*error_str+start_str_len+cmd_len, end_str, end_str_len);
-
-  (*error_str)[len] = 0;
-  
-  return 1;
-}
-
 /**
  * Tries to parse a Read or Write command sent by a TCP client connected to
  * the debug server. command should be a null-terminated string of one of the
@@ -122,36 +90,34 @@ static int syntaxError(unsigned char *command, unsigned char **error_str) {
  *   Read,<1-8 hex chars: address>,<1-.. decimal chars: count>
  *   Write,<1-8 hex chars: address>,<1-.. decimal chars: count>,<2*count hex chars: data>
  *
- * At most 4096 bytes may be read or written at once. In case of an error one
- * of the following syntax error strings will be generated:
+ * At most MAX_TRANSFER_SIZE bytes may be read or written at once. In case of
+ * an error, reason is set to one of the following error names, which should be
+ * sent back to the client using protocol_replyError():
  *
- *   Error, Syntax, <1-.. decimal chars: character index in command>
- *   Error, InvalidBufSize
+ *   Syntax
+ *   InvalidBufSize
  *
  * When the message has been successfully parsed and it is a write message,
  * res->buffer contains a malloc'ed region of memory of size res->buf_size. This
- * memory should be freed by the caller.
- *
- * In case of a syntax error, syntax_error will point to a malloced string
- * containing the error message to be send to the client. Freeing this memory
- * should be done by the caller.
+ * memory should be freed by the caller. In all other cases res->buffer is
+ * null.
  *
  * Returns -1 in case of unexpected error, 0 when the message was successfully
  * parsed and 1 in case of a syntax error.
  */
 int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
-    unsigned char **syntax_error) {
+    const char **reason) {
   int scanPos = 0;
   int i, j;
 
-  // Initialize syntax_error in case we return with error code but without a
-  // syntax error to transmit.
-  *syntax_error = NULL;
+  // Initialize the outputs in case we return with an error code.
+  *reason = "Syntax";
+  res->buffer = NULL;
   
   // Make sure there's a comma in here somewhere. If not, we should return a
   // syntax error instead of dying in the next test.
   if (!strchr((char *)command, ',')) {
-    return syntaxError(command, syntax_error);
+    return 1;
   }
   
   // Scan the "Read," or "Write,".
@@ -176,7 +142,7 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
     // Read the next hex character.
     j = charVal(command[scanPos]);
     if (j < 0) {
-      return syntaxError(command, syntax_error);
+      return 1;
     }
     scanPos++;
     
@@ -188,7 +154,7 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
   
   // We must see a comma here.
   if (command[scanPos] != ',') {
-    return syntaxError(command, syntax_error);
+    return 1;
   }
   scanPos++;
   
@@ -204,7 +170,7 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
     // Read the next decimal character.
     j = charVal(command[scanPos]);
     if ((j < 0) || (j > 9)) {
-      return syntaxError(command, syntax_error);
+      return 1;
     }
     scanPos++;
     
@@ -215,34 +181,19 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
   }
   
   // Make sure the count is within range.
-  if ((res->buf_size < 1) || (res->buf_size > 4096)) {
-    const char *err_str;
-    if (res->is_write) {
-      err_str = "Error, Write, InvalidBufSize;\n";
-    } else {
-      err_str = "Error, Read, InvalidBufSize;\n";
-    }
-    size_t len = strlen(err_str);
-
-    *syntax_error = malloc(len);
-    if (!*syntax_error) {
-      return -1;
-    }
-
-    memcpy(*syntax_error, err_str, len);
+  if ((res->buf_size < 1) || (res->buf_size > MAX_TRANSFER_SIZE)) {
+    *reason = "InvalidBufSize";
     return 1;
   }
   
   // We should be at the end of the string for read commands, or we should have
   // another comma for write commands.
   if (command[scanPos] != (res->is_write ? ',' : 0)) {
-    return syntaxError(command, syntax_error);
+    return 1;
   }
   scanPos++;
   
-  if (!res->is_write) {
-    res->buffer = NULL;
-  } else {
+  if (res->is_write) {
     // If this is a write command, read the supplied data into the buffer.
 
     // Allocate the data buffer.
@@ -261,7 +212,7 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
       j = charVal(command[scanPos]);
       if (j < 0) {
         free(res->buffer);
-        return syntaxError(command, syntax_error);
+        return 1;
       }
       scanPos++;
       
@@ -271,7 +222,7 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
       j = charVal(command[scanPos]);
       if (j < 0) {
         free(res->buffer);
-        return syntaxError(command, syntax_error);
+        return 1;
       }
       scanPos++;
       
@@ -282,10 +233,106 @@ int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
     // We should be at the end of the command now.
     if (command[scanPos] != 0) {
       free(res->buffer);
-      return syntaxError(command, syntax_error);
+      return 1;
     }
     scanPos++;
   }
 
   return 0;
 }
+
+/**
+ * Scans a hexadecimal number of 1 to 8 characters at command[*pos],
+ * followed by the given terminator character. On success, *pos is advanced
+ * past the terminator. Returns 0 if successful or 1 in case of a syntax
+ * error.
+ */
+static int scanHex(const unsigned char *command, int *pos, uint32_t *value, unsigned char terminator) {
+  int i, j;
+  
+  *value = 0;
+  for (i = 0; i < 8; i++) {
+    j = charVal(command[*pos]);
+    if (j < 0) {
+      break;
+    }
+    *value = (*value << 4) | j;
+    (*pos)++;
+  }
+  if ((i == 0) || (command[*pos] != terminator)) {
+    return 1;
+  }
+  (*pos)++;
+  return 0;
+}
+
+/**
+ * Like scanHex(), but scans a decimal number of 1 to 9 characters. The
+ * terminator may be either of the two given characters; the one which was
+ * found is returned through *found.
+ */
+static int scanDec(const unsigned char *command, int *pos, uint32_t *value, unsigned char term1, unsigned char term2, unsigned char *found) {
+  int i;
+  
+  *value = 0;
+  for (i = 0; i < 9; i++) {
+    if ((command[*pos] < '0') || (command[*pos] > '9')) {
+      break;
+    }
+    *value = (*value * 10) + (command[*pos] - '0');
+    (*pos)++;
+  }
+  *found = command[*pos];
+  if ((i == 0) || ((*found != term1) && (*found != term2))) {
+    return 1;
+  }
+  (*pos)++;
+  return 0;
+}
+
+/**
+ * Tries to parse a WaitFor command sent by a TCP client connected to the
+ * debug server. command should be a null-terminated string of the following
+ * format:
+ * 
+ *   WaitFor,<1-8 hex chars: address>,<1-8 hex chars: mask>,
+ *     <1-8 hex chars: value>,<1-9 decimal chars: timeout in ms>
+ *     [,<1-9 decimal chars: poll interval in us>]
+ *
+ * The interval is set to 0 when it is not specified. In case of an error,
+ * reason is set to one of the following error names, which should be sent
+ * back to the client using protocol_replyError():
+ *
+ *   Syntax
+ *   InvalidTimeout
+ *
+ * Returns 0 when the message was successfully parsed or 1 in case of a syntax
+ * error.
+ */
+int parseWaitFor(unsigned char *command, struct parse_wait_result *res,
+    const char **reason) {
+  int scanPos = 0;
+  unsigned char found;
+  
+  *reason = "Syntax";
+  res->interval = 0;
+  
+  if (!matchAt(command, (const unsigned char *)"WaitFor,", &scanPos)) {
+    return 1;
+  }
+  if (scanHex(command, &scanPos, &res->address, ',')) return 1;
+  if (scanHex(command, &scanPos, &res->mask, ',')) return 1;
+  if (scanHex(command, &scanPos, &res->value, ',')) return 1;
+  if (scanDec(command, &scanPos, &res->timeout, ',', 0, &found)) return 1;
+  if (found == ',') {
+    if (scanDec(command, &scanPos, &res->interval, 0, 0, &found)) return 1;
+  }
+  
+  // Make sure the timeout is within range.
+  if (res->timeout > BINPROTO_MAX_WAIT_TIMEOUT) {
+    *reason = "InvalidTimeout";
+    return 1;
+  }
+  
+  return 0;
+}
@@ -59,6 +59,17 @@ struct parse_rw_result {
 };
 
 int parseReadWrite(unsigned char *command, struct parse_rw_result *res,
-    unsigned char **syntax_error);
+    const char **reason);
+
+struct parse_wait_result {
+  uint32_t address;
+  uint32_t mask;
+  uint32_t value;
+  uint32_t timeout;
+  uint32_t interval;
+};
+
+int parseWaitFor(unsigned char *command, struct parse_wait_result *res,
+    const char **reason);
 
 #endif
@@ -50,129 +50,423 @@
 
 #include "../main.h"
 #include "../rvex_iface.h"
-#include "../tcpserv.h"
+#include "../protocol.h"
+#include "../reactor.h"
+#include "binaryProtocol.h"
 
+#include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <unistd.h>
+#include <sys/eventfd.h>
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
- * File descriptor of the rVEX memory character device.
+ * Number of worker threads, and thus the maximum number of transfers which
+ * can be in flight at the same time.
  */
-static int cdev_fd = -1;
+#define PCIE_NUM_WORKERS 4
 
+/**
+ * Size of the pattern buffer for fills, which is written repeatedly.
+ */
+#define PCIE_FILL_CHUNK_SIZE (1024*1024)
 
 /**
- * Tries to handle a Read or Write command sent by a TCP client connected to
- * the debug server. command should be null-terminated.
+ * A read or write which is queued for or being performed by a worker thread.
  */
-static int pcie_read(uint32_t address, uint32_t buf_size, int clientID) {
-  /* Allocate buffer */
-  unsigned char *buffer = malloc(buf_size);
-  if (!buffer) {
-    perror("pcie_read: Failed to allocate memory to service debug read command");
-    return -1;
+typedef struct pcieJob {
+  
+  /**
+   * Next job in the queue.
+   */
+  struct pcieJob *next;
+  
+  /**
+   * The request to complete when the job is done.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Nonzero for writes, zero for reads.
+   */
+  int isWrite;
+  
+  /**
+   * Nonzero for fills, which are writes of which buffer holds the pattern
+   * for at most PCIE_FILL_CHUNK_SIZE bytes, aligned to address 0, plus three
+   * bytes.
+   */
+  int isFill;
+  
+  /**
+   * Nonzero if the job must not overlap with any other job: writes, because
+   * they must stay ordered with respect to everything else, and untagged
+   * requests, because their replies must be sent in order.
+   */
+  int exclusive;
+  
+  /**
+   * Address and number of bytes to transfer.
+   */
+  uint32_t address;
+  uint32_t size;
+  
+  /**
+   * Write data, or the buffer for read data.
+   */
+  unsigned char *buffer;
+  
+  /**
+   * Set to errno by the worker if the transfer failed, or 0 if it succeeded.
+   */
+  int error;
+  
+} pcieJob_t;
+
+/**
+ * Simple FIFO of jobs.
+ */
+typedef struct {
+  pcieJob_t *head;
+  pcieJob_t *tail;
+} pcieQueue_t;
+
+/**
+ * State of a PCIe target.
+ */
+typedef struct {
+  
+  /**
+   * File descriptor of the rVEX memory character device.
+   */
+  int cdev_fd;
+  
+  /**
+   * Event descriptor used by the workers to wake up the main loop when jobs
+   * have completed.
+   */
+  int event_fd;
+  
+  /**
+   * Worker threads and the number of them which have been started.
+   */
+  pthread_t workers[PCIE_NUM_WORKERS];
+  int num_workers;
+  
+  /**
+   * Protects everything below. Workers wait on the condition variable for
+   * jobs to become available or for the stop flag to be set.
+   */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  
+  /**
+   * Jobs which have not been started yet, and jobs which have completed but
+   * have not been replied to yet.
+   */
+  pcieQueue_t pending;
+  pcieQueue_t done;
+  
+  /**
+   * Number of jobs being performed right now, and whether one of them is
+   * exclusive.
+   */
+  int num_active;
+  int exclusive_active;
+  
+  /**
+   * Set to make the workers exit.
+   */
+  int stopping;
+  
+} pcie_t;
+
+/**
+ * Appends a job to a queue.
+ */
+static void queue_push(pcieQueue_t *queue, pcieJob_t *job) {
+  job->next = NULL;
+  if (queue->tail) {
+    queue->tail->next = job;
+  } else {
+    queue->head = job;
   }
+  queue->tail = job;
+}
 
-  /* Seek to address */
-  off_t off = lseek (cdev_fd, address, SEEK_SET);
-  if (off == (off_t)-1) {
-    perror("pcie_read: Failed to seek to address");
-    free(buffer);
-    return -1;
+/**
+ * Removes and returns the job at the head of a queue, or returns null if the
+ * queue is empty.
+ */
+static pcieJob_t *queue_pop(pcieQueue_t *queue) {
+  pcieJob_t *job = queue->head;
+  if (job) {
+    queue->head = job->next;
+    if (!queue->head) {
+      queue->tail = NULL;
+    }
+  }
+  return job;
+}
+
+/**
+ * Frees a job and all queued jobs behind it.
+ */
+static void free_jobs(pcieJob_t *job) {
+  while (job) {
+    pcieJob_t *next = job->next;
+    free(job->buffer);
+    free(job->req);
+    free(job);
+    job = next;
   }
+}
 
-  /* Read data into buffer */
-  unsigned char *bufp = buffer;
-  uint32_t bytes_left = buf_size;
-  while(bytes_left > 0) {
-    ssize_t bytes_read = read(cdev_fd, bufp, buf_size);
-    if(bytes_read == -1) {
-      perror("pcie_read: Failed to read bytes");
-      free(buffer);
-      return -1;
+/**
+ * Performs the transfer for the given job. Called from a worker thread
+ * without holding the pcie->lock.
+ */
+static void perform_job(pcie_t *pcie, pcieJob_t *job) {
+  unsigned char *bufp = job->buffer;
+  off_t off = job->address;
+  uint32_t bytes_left = job->size;
+  
+  while (bytes_left > 0) {
+    ssize_t count;
+    if (job->isFill) {
+      
+      // Write the pattern buffer, starting at the alignment of the current
+      // address.
+      uint32_t size = (bytes_left < PCIE_FILL_CHUNK_SIZE) ? bytes_left : PCIE_FILL_CHUNK_SIZE;
+      count = pwrite(pcie->cdev_fd, job->buffer + (off & 3), size, off);
+      
+    } else if (job->isWrite) {
+      count = pwrite(pcie->cdev_fd, bufp, bytes_left, off);
+    } else {
+      count = pread(pcie->cdev_fd, bufp, bytes_left, off);
+    }
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      job->error = errno;
+      return;
+    } else if (count == 0) {
+      // The device did not accept or return any more data.
+      job->error = EIO;
+      return;
     }
+    bufp += count;
+    off += count;
+    bytes_left -= count;
+  }
+  
+  job->error = 0;
+}
 
-    bufp += bytes_read;
-    bytes_left -= bytes_read;
+/**
+ * Worker thread. Takes jobs from the pcie->pending queue in order, as long as the
+ * job at the head does not conflict with the jobs which are already being
+ * performed, and moves them to the pcie->done queue when complete.
+ */
+static void *worker(void *arg) {
+  static const uint64_t one = 1;
+  pcie_t *pcie = (pcie_t*)arg;
+  
+  pthread_mutex_lock(&pcie->lock);
+  while (!pcie->stopping) {
+    pcieJob_t *job = pcie->pending.head;
+    
+    // Wait until we can start the job at the head of the queue.
+    if (!job || pcie->exclusive_active || (job->exclusive && pcie->num_active)) {
+      pthread_cond_wait(&pcie->cond, &pcie->lock);
+      continue;
+    }
+    queue_pop(&pcie->pending);
+    pcie->num_active++;
+    pcie->exclusive_active = job->exclusive;
+    pthread_mutex_unlock(&pcie->lock);
+    
+    perform_job(pcie, job);
+    
+    // Pass the job back to the main thread.
+    pthread_mutex_lock(&pcie->lock);
+    pcie->num_active--;
+    pcie->exclusive_active = 0;
+    queue_push(&pcie->done, job);
+    if (write(pcie->event_fd, &one, sizeof(one)) < 0) {
+      perror("pcie: failed to signal job completion");
+    }
+    
+    // Other workers may have been waiting for this job to complete.
+    pthread_cond_broadcast(&pcie->cond);
+    
   }
+  pthread_mutex_unlock(&pcie->lock);
+  
+  return NULL;
+}
 
-  /* Transmit response to client
-   * Note: we don't consider communication errors as fatal errors, so return
-   * 0 in case that happens */
-  int i;
-  unsigned char str[32];
-  /* Send status, we don't check for read failures */
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)("OK, Read, OK, ")) < 0) {
-    free(buffer);
-    return 0;
-  }
-  /* Send read arguments */
-  sprintf((char *)str, "%08X, %d, ", address, buf_size);
-  if (tcpServer_sendStr(debugServer, clientID, str) < 0) {
-    free(buffer);
-    return 0;
-  }
-  /* Send read bytes */
-  for (i = 0; i < buf_size; i++) {
-    sprintf((char *)str, "%02hhX", buffer[i]);
-    if (tcpServer_sendStr(debugServer, clientID, str) < 0) {
-      free(buffer);
+/**
+ * Reactor handler for the event descriptor. Sends the replies for all
+ * completed jobs, in the order in which they completed. Failed transfers are
+ * reported to the client, but do not stop the server.
+ */
+static int on_event_ready(int f, int events, void *data) {
+  pcie_t *pcie = (pcie_t*)data;
+  uint64_t count;
+  pcieJob_t *job;
+  int retval = 0;
+  
+  // Reset the event counter. If there is nothing to read, an earlier call
+  // already handled the jobs.
+  if (read(f, &count, sizeof(count)) != sizeof(count)) {
+    if (errno == EAGAIN) {
       return 0;
     }
+    perror("pcie: failed to read from event descriptor");
+    return -1;
   }
-  /* Terminate response */
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)";\n") < 0) {
-    free(buffer);
-    return 0;
+  
+  // Take the completed jobs.
+  pthread_mutex_lock(&pcie->lock);
+  job = pcie->done.head;
+  pcie->done.head = pcie->done.tail = NULL;
+  pthread_mutex_unlock(&pcie->lock);
+  
+  // Send the replies.
+  while (job) {
+    pcieJob_t *next = job->next;
+    
+    if (job->error) {
+      fprintf(stderr, "pcie: failed to %s %u bytes at address 0x%08X: %s\n",
+          job->isWrite ? "write" : "read", job->size, job->address,
+          strerror(job->error));
+      if (protocol_replyError(job->req, "CommunicationError") < 0) {
+        retval = -1;
+      }
+    } else if (job->isWrite) {
+      if (protocol_replyWrite(job->req, job->address, job->size) < 0) {
+        retval = -1;
+      }
+    } else {
+      if (protocol_replyRead(job->req, job->address, job->size, job->buffer) < 0) {
+        retval = -1;
+      }
+    }
+    
+    free(job->buffer);
+    free(job);
+    job = next;
   }
-
-  free(buffer);
-  return 0;
+  
+  return retval;
 }
 
 /**
- * Tries to handle a Read or Write command sent by a TCP client connected to
- * the debug server. command should be null-terminated.
+ * Queues a transfer for the worker threads. For writes, data is copied, as it
+ * is only valid until the backend write function returns.
  */
-static int pcie_write(uint32_t address, unsigned char *buffer,
-    uint32_t buf_size, int clientID) {
-  /* Seek to address */
-  off_t off = lseek (cdev_fd, address, SEEK_SET);
-  if (off == (off_t)-1) {
-    perror("pcie_write: Failed to seek to address");
+static int queue_job(pcie_t *pcie, debugRequest_t *req, int isWrite, uint32_t address,
+    const unsigned char *data, uint32_t size) {
+  pcieJob_t *job;
+  
+  job = (pcieJob_t*)malloc(sizeof(pcieJob_t));
+  if (!job) {
+    perror("pcie: failed to allocate job");
+    protocol_replyError(req, "CommunicationError");
+    return -1;
+  }
+  job->buffer = (unsigned char*)malloc(size);
+  if (!job->buffer) {
+    perror("pcie: failed to allocate transfer buffer");
+    free(job);
+    protocol_replyError(req, "CommunicationError");
     return -1;
   }
+  if (isWrite) {
+    memcpy(job->buffer, data, size);
+  }
+  job->req = req;
+  job->isWrite = isWrite;
+  job->isFill = 0;
+  job->exclusive = isWrite || !req->tagged;
+  job->address = address;
+  job->size = size;
+  job->error = 0;
+  
+  pthread_mutex_lock(&pcie->lock);
+  queue_push(&pcie->pending, job);
+  pthread_cond_broadcast(&pcie->cond);
+  pthread_mutex_unlock(&pcie->lock);
+  
+  return 0;
+}
 
-  /* Read data into buffer */
-  unsigned char *bufp = buffer;
-  while(buf_size > 0) {
-    ssize_t bytes_written = write(cdev_fd, bufp, buf_size);
-    if(bytes_written == -1) {
-      perror("pcie_write: Failed to write bytes");
-      return -1;
-    }
+/**
+ * Tries to handle a Read command sent by a TCP client connected to the debug
+ * server. The read is performed by a worker thread.
+ */
+static int pcie_read(void *data, debugRequest_t *req, uint32_t address, uint32_t buf_size) {
+  return queue_job((pcie_t*)data, req, 0, address, NULL, buf_size);
+}
 
-    bufp += bytes_written;
-    buf_size -= bytes_written;
-  }
+/**
+ * Tries to handle a Write command sent by a TCP client connected to the debug
+ * server. The write is performed by a worker thread.
+ */
+static int pcie_write(void *data, debugRequest_t *req, uint32_t address,
+    unsigned char *buffer, uint32_t buf_size) {
+  return queue_job((pcie_t*)data, req, 1, address, buffer, buf_size);
+}
 
-  /* Transmit response to client */
-  /* Note: we don't consider communication errors as fatal errors, so return
-   * 0 in case that happens */
-  unsigned char str[32];
-  /* Send status, we don't check for write failures */
-  if (tcpServer_sendStr(debugServer, clientID, (const unsigned char *)("OK, Write, OK, ")) < 0) {
-    return 0;
+/**
+ * Tries to handle a Fill command sent by a TCP client connected to the debug
+ * server. The worker thread writes a buffer of the pattern repeatedly, so
+ * the range can be much larger than the buffer.
+ */
+static int pcie_fill(void *data, debugRequest_t *req, uint32_t address,
+    uint32_t pattern, uint32_t buf_size) {
+  pcie_t *pcie = (pcie_t*)data;
+  uint32_t size = (buf_size < PCIE_FILL_CHUNK_SIZE) ? buf_size : PCIE_FILL_CHUNK_SIZE;
+  pcieJob_t *job;
+  uint32_t i;
+  
+  job = (pcieJob_t*)malloc(sizeof(pcieJob_t));
+  if (!job) {
+    perror("pcie: failed to allocate job");
+    protocol_replyError(req, "CommunicationError");
+    return -1;
   }
-  /* Send write arguments and terminate response */
-  sprintf((char *)str, "%08X, %d;\n", address, buf_size);
-  if (tcpServer_sendStr(debugServer, clientID, str) < 0) {
-    return 0;
+  job->buffer = (unsigned char*)malloc(size + 3);
+  if (!job->buffer) {
+    perror("pcie: failed to allocate fill buffer");
+    free(job);
+    protocol_replyError(req, "CommunicationError");
+    return -1;
   }
-
+  for (i = 0; i < size + 3; i++) {
+    job->buffer[i] = pattern >> (24 - 8 * (i & 3));
+  }
+  job->req = req;
+  job->isWrite = 1;
+  job->isFill = 1;
+  job->exclusive = 1;
+  job->address = address;
+  job->size = buf_size;
+  job->error = 0;
+  
+  pthread_mutex_lock(&pcie->lock);
+  queue_push(&pcie->pending, job);
+  pthread_cond_broadcast(&pcie->cond);
+  pthread_mutex_unlock(&pcie->lock);
+  
   return 0;
 }
 
@@ -181,34 +475,146 @@ static int pcie_write(uint32_t address, unsigned char *buffer,
  * idle, or 1 if we want update to be called quickly again to handle potential
  * timeouts.
  */
-int pcie_update(void) {
-  /* This backend doesn't to update anything as all calls are blocking */
+static int pcie_update(void *data) {
+  // Completed jobs are handled by on_event_ready() when the reactor sees the
+  // event descriptor become readable.
   return 0;
 }
 
+/**
+ * Appends the number of jobs waiting for a worker, being performed and
+ * waiting to be replied to to buf.
+ */
+static void pcie_stats(void *data, statsBuffer_t *buf) {
+  pcie_t *pcie = (pcie_t*)data;
+  uint64_t pending = 0, done = 0, active;
+  pcieJob_t *job;
+  
+  pthread_mutex_lock(&pcie->lock);
+  for (job = pcie->pending.head; job; job = job->next) {
+    pending++;
+  }
+  for (job = pcie->done.head; job; job = job->next) {
+    done++;
+  }
+  active = pcie->num_active;
+  pthread_mutex_unlock(&pcie->lock);
+  
+  stats_put(buf, "pcie.", "pending", pending);
+  stats_put(buf, "pcie.", "active", active);
+  stats_put(buf, "pcie.", "done", done);
+}
+
 /**
  * Frees all dynamically allocated memory by the interface.
  */
-void pcie_free(void) {
-  close(cdev_fd);
+static void pcie_free(void *data) {
+  pcie_t *pcie = (pcie_t*)data;
+  int i;
+  
+  // Stop the workers. Jobs which are being performed are completed first.
+  pthread_mutex_lock(&pcie->lock);
+  pcie->stopping = 1;
+  pthread_cond_broadcast(&pcie->cond);
+  pthread_mutex_unlock(&pcie->lock);
+  for (i = 0; i < pcie->num_workers; i++) {
+    pthread_join(pcie->workers[i], NULL);
+  }
+  
+  // Drop the jobs which were never replied to.
+  free_jobs(pcie->pending.head);
+  free_jobs(pcie->done.head);
+  
+  if (pcie->event_fd >= 0) {
+    reactor_unregister(pcie->event_fd);
+    close(pcie->event_fd);
+  }
+  
+  if (pcie->cdev_fd >= 0) {
+    close(pcie->cdev_fd);
+  }
+  
+  pthread_cond_destroy(&pcie->cond);
+  pthread_mutex_destroy(&pcie->lock);
+  free(pcie);
+}
 
-  cdev_fd = -1;
+/**
+ * Starts the worker threads. This is done separately from initialization,
+ * because rvsrv may fork into daemon mode in between and threads do not
+ * survive that.
+ */
+static int pcie_start(void *data) {
+  pcie_t *pcie = (pcie_t*)data;
+  sigset_t all, old;
+  
+  // Start the workers with all signals blocked, so signals are still handled
+  // by the main thread.
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  for (pcie->num_workers = 0; pcie->num_workers < PCIE_NUM_WORKERS; pcie->num_workers++) {
+    int err = pthread_create(&pcie->workers[pcie->num_workers], NULL, &worker, pcie);
+    if (err) {
+      fprintf(stderr, "pcie_start: Couldn't start worker thread: %s\n",
+          strerror(err));
+      break;
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (pcie->num_workers < PCIE_NUM_WORKERS) {
+    return -1;
+  }
+  
+  return 0;
 }
 
 int init_pcie_iface(const char *cdev, rvex_iface_t *iface) {
-  cdev_fd = open(cdev, O_RDWR);
-  if (cdev_fd < 0) {
+  pcie_t *pcie;
+  
+  pcie = (pcie_t*)malloc(sizeof(pcie_t));
+  if (!pcie) {
+    perror("init_pcie_iface: Couldn't allocate state");
+    return -1;
+  }
+  memset((void*)pcie, 0, sizeof(pcie_t));
+  pcie->event_fd = -1;
+  pthread_mutex_init(&pcie->lock, NULL);
+  pthread_cond_init(&pcie->cond, NULL);
+  
+  pcie->cdev_fd = open(cdev, O_RDWR);
+  if (pcie->cdev_fd < 0) {
     perror("init_pcie_iface: Couldn't open character device");
+    pcie_free(pcie);
     return -1;
   }
 
   printf("Successfully opened character device \"%s\"\n.", cdev);
 
+  // Set up the event descriptor the workers use to wake us up.
+  pcie->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (pcie->event_fd < 0) {
+    perror("init_pcie_iface: Couldn't create event descriptor");
+    pcie_free(pcie);
+    return -1;
+  }
+  if (reactor_register(pcie->event_fd, REACTOR_READ, &on_event_ready, pcie) < 0) {
+    close(pcie->event_fd);
+    pcie->event_fd = -1;
+    pcie_free(pcie);
+    return -1;
+  }
+
+  // The workers are started by pcie_start().
   *iface = (rvex_iface_t) {
+    .data = pcie,
     .read = pcie_read,
     .write = pcie_write,
+    .fill = pcie_fill,
+    .start = pcie_start,
     .update = pcie_update,
     .free = pcie_free,
+    .stats = pcie_stats,
+    .maxTransferSize = BINPROTO_MAX_TRANSFER_SIZE,
   };
 
   return 0;
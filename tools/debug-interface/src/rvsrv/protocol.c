@@ -0,0 +1,2196 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "protocol.h"
+#include "main.h"
+#include "timeout.h"
+#include "parseReadWrite.h"
+#include "binaryProtocol.h"
+#include "crc32.h"
+
+/**
+ * Set when a client sends the Stop command.
+ */
+static int stopRequested = 0;
+
+/**
+ * Number assigned to the next client connection.
+ */
+static uint32_t nextConnection = 1;
+
+/**
+ * Number of bytes which may be waiting to be sent to a client before its
+ * trace stream stops reading from the trace buffer.
+ */
+#define TRACE_MAX_QUEUED (1024*1024)
+
+/**
+ * Per-client protocol state.
+ */
+typedef struct {
+  
+  /**
+   * Connection number, see debugRequest_t.
+   */
+  uint32_t connection;
+  
+  /**
+   * Set once the client has switched to the binary protocol.
+   */
+  int binary;
+  
+  /**
+   * Command buffer. In text mode this contains the filtered command text, in
+   * binary mode the frame received so far. The buffer starts out with room
+   * for MAX_DEBUG_COMMAND_SIZE bytes and is grown when a larger binary frame
+   * comes in.
+   */
+  unsigned char *commandBuf;
+  
+  /**
+   * Allocated size of the command buffer.
+   */
+  uint32_t bufSize;
+  
+  /**
+   * Number of bytes currently in the buffer.
+   */
+  int numBytes;
+  
+  /**
+   * Trace stream running on this connection, or null if there is none.
+   */
+  struct debugTrace *trace;
+  
+  /**
+   * Request statistics for this connection.
+   */
+  protocolStats_t stats;
+  
+} debugClient_t;
+
+/**
+ * State of a Batch command which is being executed.
+ */
+typedef struct debugBatch {
+  
+  /**
+   * The Batch request itself, used to send the reply.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Number of entries in the batch.
+   */
+  uint32_t numEntries;
+  
+  /**
+   * Number of entries which have not been completed yet, plus one while the
+   * entries are still being issued.
+   */
+  uint32_t remaining;
+  
+  /**
+   * Reply payload, containing the results of all entries.
+   */
+  unsigned char *results;
+  
+  /**
+   * Size of the reply payload in bytes.
+   */
+  uint32_t resultsSize;
+  
+} debugBatch_t;
+
+/**
+ * State of a WaitFor command which is being executed.
+ */
+typedef struct debugWait {
+  
+  /**
+   * The WaitFor request itself, used to send the reply.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Address of the word which is polled, and the condition it is waited for:
+   * (word & mask) == value.
+   */
+  uint32_t address;
+  uint32_t mask;
+  uint32_t value;
+  
+  /**
+   * Time at which the command was received, as returned by startTimeout(),
+   * and the timeout in microseconds.
+   */
+  int start;
+  int timeout;
+  
+  /**
+   * Interval between polls in microseconds.
+   */
+  int interval;
+  
+  /**
+   * Timer used to schedule the next poll.
+   */
+  timeout_t *timer;
+  
+} debugWait_t;
+
+/**
+ * State of a TraceStream command which is being executed.
+ */
+typedef struct debugTrace {
+  
+  /**
+   * The TraceStream request itself. The data frames are sent as replies to
+   * it.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Start address of the trace buffer and the size of each half.
+   */
+  uint32_t address;
+  uint32_t halfSize;
+  
+  /**
+   * Half of the trace buffer which is to be read next.
+   */
+  int half;
+  
+  /**
+   * Number of consecutive reads which did not return any trace data.
+   */
+  int emptyReads;
+  
+  /**
+   * Interval between polls in microseconds while no data is produced.
+   */
+  int interval;
+  
+  /**
+   * Set while a read of the trace buffer is in progress.
+   */
+  int reading;
+  
+  /**
+   * Request which stopped the stream, or null while it is running.
+   */
+  debugRequest_t *stopReq;
+  
+  /**
+   * Timer used to schedule the next read.
+   */
+  timeout_t *timer;
+  
+} debugTrace_t;
+
+/**
+ * State of a Hash command which is being executed.
+ */
+typedef struct debugHash {
+  
+  /**
+   * The Hash request itself, used to send the reply.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Start address of the range and the size of each page.
+   */
+  uint32_t address;
+  uint32_t pageSize;
+  
+  /**
+   * Number of reads which have not been completed yet, plus one while the
+   * reads are still being issued.
+   */
+  uint32_t remaining;
+  
+  /**
+   * Reply payload, containing the CRC of every page.
+   */
+  unsigned char *crcs;
+  uint32_t crcsSize;
+  
+  /**
+   * Status of the read with the lowest address which failed, or
+   * BINPROTO_STATUS_OK if all reads succeeded so far, along with its address
+   * and the fault code or error name.
+   */
+  int status;
+  uint32_t failAddress;
+  uint32_t faultCode;
+  const char *reason;
+  
+} debugHash_t;
+
+/**
+ * State of a Fill command which is being performed using writes, because the
+ * backend cannot fill memory by itself.
+ */
+typedef struct debugFill {
+  
+  /**
+   * The Fill request itself, used to send the reply.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Range which is to be filled, and the number of bytes for which writes
+   * have been issued so far.
+   */
+  uint32_t address;
+  uint32_t count;
+  uint32_t issued;
+  
+  /**
+   * Write data: the pattern repeated for the maximum transfer size, plus
+   * three bytes so a write can start at any alignment.
+   */
+  unsigned char *data;
+  
+  /**
+   * Number of writes in flight, and whether issueFillWrites() is running.
+   */
+  int inFlight;
+  int issuing;
+  
+  /**
+   * Status of the write with the lowest address which failed, or
+   * BINPROTO_STATUS_OK if all writes succeeded so far, along with its address
+   * and the fault code or error name.
+   */
+  int status;
+  uint32_t failAddress;
+  uint32_t faultCode;
+  const char *reason;
+  
+} debugFill_t;
+
+/**
+ * State of a Checksum command which is being executed.
+ */
+typedef struct debugChecksum {
+  
+  /**
+   * The Checksum request itself, used to send the reply.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Range which is to be checksummed. The range is read in chunks of the
+   * maximum transfer size.
+   */
+  uint32_t address;
+  uint32_t count;
+  
+  /**
+   * Number of chunks for which reads have been issued, and number of chunks
+   * which have been combined into crc so far.
+   */
+  uint32_t issued;
+  uint32_t combined;
+  uint32_t crc;
+  
+  /**
+   * CRCs of the chunks which have been read but not combined yet, indexed by
+   * chunk index modulo PROTOCOL_CHECKSUM_WINDOW. Reads may complete out of
+   * order, but the CRCs must be combined in order.
+   */
+  uint32_t chunkCrcs[PROTOCOL_CHECKSUM_WINDOW];
+  int chunkValid[PROTOCOL_CHECKSUM_WINDOW];
+  
+  /**
+   * Number of reads in flight, and whether issueChecksumReads() is running.
+   */
+  int inFlight;
+  int issuing;
+  
+  /**
+   * Status of the read with the lowest address which failed, or
+   * BINPROTO_STATUS_OK if all reads succeeded so far, along with its address
+   * and the fault code or error name.
+   */
+  int status;
+  uint32_t failAddress;
+  uint32_t faultCode;
+  const char *reason;
+  
+} debugChecksum_t;
+
+static int completeWaitPoll(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason);
+static int completeTraceRead(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason);
+static int completeFillWrite(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason);
+static int completeChecksumRead(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason);
+
+/**
+ * Sets up the protocol state for a target which passes requests to the given
+ * backend. The target structure is owned by the caller; it must be passed as
+ * the data pointer of the debug server, and the server must be stored in it
+ * once it has been opened.
+ */
+int protocol_init(debugTarget_t *target, const rvex_iface_t *iface) {
+  uint32_t maxTransferSize, maxFrameSize;
+  
+  target->iface = iface;
+  target->server = 0;
+  memset((void*)&target->stats, 0, sizeof(protocolStats_t));
+  target->statsHandler = 0;
+  target->statsData = 0;
+  stopRequested = 0;
+  
+  // Figure out the maximum transfer size. This must be a power of two, so
+  // clients can split accesses at aligned boundaries.
+  maxTransferSize = iface->maxTransferSize;
+  if (maxTransferSize < MAX_TRANSFER_SIZE) {
+    maxTransferSize = MAX_TRANSFER_SIZE;
+  }
+  if (maxTransferSize > BINPROTO_MAX_TRANSFER_SIZE) {
+    maxTransferSize = BINPROTO_MAX_TRANSFER_SIZE;
+  }
+  while (maxTransferSize & (maxTransferSize - 1)) {
+    maxTransferSize &= maxTransferSize - 1;
+  }
+  
+  // Binary frames must fit either a full write or a full batch.
+  maxFrameSize = BINPROTO_REQUEST_HEADER_SIZE + maxTransferSize;
+  if (maxFrameSize < BINPROTO_REQUEST_HEADER_SIZE + BINPROTO_MAX_BATCH_SIZE) {
+    maxFrameSize = BINPROTO_REQUEST_HEADER_SIZE + BINPROTO_MAX_BATCH_SIZE;
+  }
+  
+  target->maxTransferSize = maxTransferSize;
+  target->maxFrameSize = maxFrameSize;
+  return 0;
+}
+
+/**
+ * Allocates the per-client protocol state. Should be passed to
+ * tcpServer_open() as the onAlloc callback for the debug server.
+ */
+int protocol_clientAlloc(void **extra) {
+  debugClient_t *client;
+  
+  if (extra) {
+    client = (debugClient_t*)malloc(sizeof(debugClient_t));
+    if (!client) {
+      return -1;
+    }
+    client->commandBuf = (unsigned char*)malloc(MAX_DEBUG_COMMAND_SIZE);
+    if (!client->commandBuf) {
+      free(client);
+      return -1;
+    }
+    client->bufSize = MAX_DEBUG_COMMAND_SIZE;
+    client->connection = nextConnection++;
+    client->binary = 0;
+    client->numBytes = 0;
+    client->trace = 0;
+    memset((void*)&client->stats, 0, sizeof(protocolStats_t));
+    *extra = client;
+  }
+  return 0;
+}
+
+/**
+ * Frees the per-client protocol state. Should be passed to tcpServer_open()
+ * as the onFree callback for the debug server.
+ */
+int protocol_clientFree(void **extra) {
+  if (extra && *extra) {
+    free(((debugClient_t*)*extra)->commandBuf);
+    free(*extra);
+    *extra = 0;
+  }
+  return 0;
+}
+
+/**
+ * Returns nonzero if a client requested the server to stop.
+ */
+int protocol_stopRequested(void) {
+  return stopRequested;
+}
+
+/**
+ * Appends the given request statistics to buf, with the given name prefix.
+ */
+static void putStats(statsBuffer_t *buf, const char *prefix, const protocolStats_t *stats) {
+  static const char *names[PROTOCOL_NUM_STATS] = {
+    "read", "write", "bulkRead", "bulkWrite", "batch", "waitFor"
+  };
+  int i;
+  
+  stats_put(buf, prefix, "faults", stats->faults);
+  stats_put(buf, prefix, "errors", stats->errors);
+  for (i = 0; i < PROTOCOL_NUM_STATS; i++) {
+    stats_putHistogram(buf, prefix, names[i], &stats->latency[i]);
+  }
+}
+
+/**
+ * Appends the statistics of the protocol handler of the given target to buf:
+ * traffic and request statistics for the target as a whole and for each
+ * connected client.
+ */
+void protocol_stats(debugTarget_t *target, statsBuffer_t *buf) {
+  tcpServer_t *server = target->server;
+  debugClient_t *client;
+  char prefix[32];
+  int clientID;
+  
+  stats_put(buf, "debug.", "connections", server->connections);
+  stats_put(buf, "debug.", "rxBytes", server->rxBytes);
+  stats_put(buf, "debug.", "txBytes", server->txBytes);
+  putStats(buf, "debug.", &target->stats);
+  
+  clientID = -1;
+  while ((clientID = tcpServer_nextClient(server, clientID)) >= 0) {
+    client = tcpServer_getExtraData(server, clientID);
+    if (!client) {
+      continue;
+    }
+    sprintf(prefix, "client%d.", clientID);
+    stats_put(buf, prefix, "rxBytes", server->clients[clientID]->rxBytes);
+    stats_put(buf, prefix, "txBytes", server->clients[clientID]->txBytes);
+    stats_put(buf, prefix, "queued", server->clients[clientID]->txQueued);
+    putStats(buf, prefix, &client->stats);
+  }
+}
+
+
+//-----------------------------------------------------------------------------
+// Replies
+//-----------------------------------------------------------------------------
+
+/**
+ * Returns the text protocol command name for the given opcode.
+ */
+static const char *commandName(int opcode) {
+  switch (opcode) {
+    case BINPROTO_OP_READ:     return "Read";
+    case BINPROTO_OP_WRITE:    return "Write";
+    case BINPROTO_OP_STOP:     return "Stop";
+    case BINPROTO_OP_BATCH:    return "Batch";
+    case BINPROTO_OP_WAIT:     return "WaitFor";
+    case BINPROTO_OP_TRACE:    return "TraceStream";
+    case BINPROTO_OP_STATS:    return "Stats";
+    case BINPROTO_OP_HASH:     return "Hash";
+    case BINPROTO_OP_FILL:     return "Fill";
+    case BINPROTO_OP_CHECKSUM: return "Checksum";
+  }
+  return "Unknown";
+}
+
+/**
+ * Returns nonzero if the client which sent the given request is still
+ * connected.
+ */
+static int isConnected(const debugRequest_t *req) {
+  debugClient_t *client = tcpServer_getExtraData(req->target->server, req->clientID);
+  return client && (client->connection == req->connection);
+}
+
+/**
+ * Updates the given statistics for a completed request.
+ */
+static void updateStats(protocolStats_t *stats, int kind, int status, uint64_t latency) {
+  if (kind >= 0) {
+    stats_record(&stats->latency[kind], latency);
+  }
+  if (status == BINPROTO_STATUS_FAULT) {
+    stats->faults++;
+  } else if (status == BINPROTO_STATUS_ERROR) {
+    stats->errors++;
+  }
+}
+
+/**
+ * Records the completion of a request in the statistics of its target and of
+ * its client. count is the number of bytes accessed by reads and writes.
+ */
+static void recordReply(const debugRequest_t *req, int status, uint32_t count) {
+  debugClient_t *client;
+  uint64_t latency;
+  int kind;
+  
+  switch (req->opcode) {
+    case BINPROTO_OP_READ:
+      kind = (count > PROTOCOL_BULK_SIZE) ? PROTOCOL_STATS_BULK_READ : PROTOCOL_STATS_READ;
+      break;
+    case BINPROTO_OP_WRITE:
+      kind = (count > PROTOCOL_BULK_SIZE) ? PROTOCOL_STATS_BULK_WRITE : PROTOCOL_STATS_WRITE;
+      break;
+    case BINPROTO_OP_BATCH:
+      kind = PROTOCOL_STATS_BATCH;
+      break;
+    case BINPROTO_OP_WAIT:
+      kind = PROTOCOL_STATS_WAIT;
+      break;
+    default:
+      kind = -1;
+      break;
+  }
+  latency = stats_now() - req->startTime;
+  
+  updateStats(&req->target->stats, kind, status, latency);
+  client = tcpServer_getExtraData(req->target->server, req->clientID);
+  if (client && (client->connection == req->connection)) {
+    updateStats(&client->stats, kind, status, latency);
+  }
+}
+
+/**
+ * Sends a binary reply frame. payload may be null if payloadSize is 0.
+ */
+static int sendBinaryReply(
+  const debugRequest_t *req,
+  int status,
+  uint32_t address,
+  uint32_t count,
+  uint32_t faultCode,
+  const unsigned char *payload,
+  uint32_t payloadSize
+) {
+  unsigned char header[BINPROTO_REPLY_HEADER_SIZE];
+  
+  binProto_putU32(header + 0, BINPROTO_REPLY_HEADER_SIZE - 4 + payloadSize);
+  header[4] = req->opcode;
+  header[5] = status;
+  header[6] = 0;
+  header[7] = 0;
+  binProto_putU32(header + 8, req->tag);
+  binProto_putU32(header + 12, address);
+  binProto_putU32(header + 16, count);
+  binProto_putU32(header + 20, faultCode);
+  if (tcpServer_sendBuf(req->target->server, req->clientID, header, BINPROTO_REPLY_HEADER_SIZE) < 0) {
+    return -1;
+  }
+  if (payloadSize) {
+    if (tcpServer_sendBuf(req->target->server, req->clientID, payload, payloadSize) < 0) {
+      return -1;
+    }
+  }
+  
+  return 0;
+}
+
+/**
+ * Sends count bytes from data to the given client as a hex string.
+ */
+static int sendHex(debugTarget_t *target, int clientID, const unsigned char *data, uint32_t count) {
+  static const char hexChars[] = "0123456789ABCDEF";
+  unsigned char str[512];
+  int i;
+  
+  while (count) {
+    for (i = 0; (i < sizeof(str)) && count; i += 2, count--) {
+      str[i]   = hexChars[*data >> 4];
+      str[i+1] = hexChars[*data & 0xF];
+      data++;
+    }
+    if (tcpServer_sendBuf(target->server, clientID, str, i) < 0) {
+      return -1;
+    }
+  }
+  
+  return 0;
+}
+
+/**
+ * Sends the "Tag, <tag>, " prefix for text replies to tagged requests.
+ */
+static int sendTagPrefix(debugTarget_t *target, int clientID, int tagged, uint32_t tag) {
+  unsigned char str[32];
+  
+  if (!tagged) {
+    return 0;
+  }
+  sprintf((char *)str, "Tag, %08X, ", tag);
+  return tcpServer_sendStr(target->server, clientID, str);
+}
+
+/**
+ * Releases a reference to a batch. When the last reference is released, all
+ * entries have been completed, so the reply is sent and the batch is freed.
+ */
+static int releaseBatch(debugBatch_t *batch) {
+  
+  if (--batch->remaining) {
+    return 0;
+  }
+  
+  recordReply(batch->req, BINPROTO_STATUS_OK, 0);
+  if (isConnected(batch->req)) {
+    sendBinaryReply(batch->req, BINPROTO_STATUS_OK, 0, batch->numEntries, 0, batch->results, batch->resultsSize);
+  }
+  
+  free(batch->results);
+  free(batch->req);
+  free(batch);
+  return 0;
+}
+
+/**
+ * Stores the result of a batch entry in its batch and frees the request.
+ */
+static int completeBatchEntry(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason) {
+  debugBatch_t *batch = (debugBatch_t*)req->context;
+  unsigned char *result = batch->results + req->index;
+  
+  result[0] = status;
+  binProto_putU32(result + 4, faultCode);
+  if (data) {
+    memcpy(result + BINPROTO_BATCH_RESULT_SIZE, data, count);
+  }
+  
+  free(req);
+  return releaseBatch(batch);
+}
+
+/**
+ * Ends a WaitFor command: closes its timer and frees it along with its
+ * request.
+ */
+static void freeWait(debugWait_t *wait) {
+  timeout_close(&wait->timer);
+  free(wait->req);
+  free(wait);
+}
+
+/**
+ * Sends the reply to a WaitFor command which completed normally, i.e. with
+ * status BINPROTO_STATUS_OK or BINPROTO_STATUS_TIMEOUT, and frees it.
+ */
+static void replyWait(debugWait_t *wait, int status, uint32_t word) {
+  debugRequest_t *req = wait->req;
+  unsigned char payload[4];
+  unsigned char str[64];
+  
+  recordReply(req, status, 4);
+  if (isConnected(req)) {
+    if (req->binary) {
+      binProto_putU32(payload, word);
+      sendBinaryReply(req, status, wait->address, 4, 0, payload, 4);
+    } else {
+      sprintf((char *)str, "OK, WaitFor, %s, %08X, %08X;\n", (status == BINPROTO_STATUS_OK) ? "OK" : "Timeout", wait->address, word);
+      if (sendTagPrefix(req->target, req->clientID, req->tagged, req->tag) >= 0) {
+        tcpServer_sendStr(req->target->server, req->clientID, str);
+      }
+    }
+  }
+  
+  freeWait(wait);
+}
+
+/**
+ * Passes the next poll of a WaitFor command to the backend. The backend may
+ * complete it immediately, which may free the command, so wait must not be
+ * used after this returns.
+ */
+static int issueWaitPoll(debugWait_t *wait) {
+  debugRequest_t *poll;
+  
+  poll = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+  if (!poll) {
+    perror("Failed to allocate memory for debug request");
+    return -1;
+  }
+  *poll = *wait->req;
+  poll->opcode = BINPROTO_OP_READ;
+  poll->complete = completeWaitPoll;
+  poll->context = wait;
+  return wait->req->target->iface->read(wait->req->target->iface->data, poll, wait->address, 4);
+}
+
+/**
+ * Timer handler for WaitFor commands, issues the next poll.
+ */
+static int onWaitTimer(void *data) {
+  return issueWaitPoll((debugWait_t*)data);
+}
+
+/**
+ * Handles the completion of a poll issued for a WaitFor command. Replies to
+ * the command if the condition was met, the timeout expired or the poll
+ * failed, otherwise schedules the next poll.
+ */
+static int completeWaitPoll(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason) {
+  debugWait_t *wait = (debugWait_t*)req->context;
+  uint32_t word;
+  int remaining;
+  
+  free(req);
+  
+  // Don't bother to continue polling for clients which have gone away.
+  if (!isConnected(wait->req)) {
+    freeWait(wait);
+    return 0;
+  }
+  
+  // Pass failures on to the client. The request is detached from the wait
+  // first, so the reply functions handle it like any other request.
+  if (status != BINPROTO_STATUS_OK) {
+    uint32_t address = wait->address;
+    req = wait->req;
+    wait->req = 0;
+    freeWait(wait);
+    if (status == BINPROTO_STATUS_FAULT) {
+      return protocol_replyFault(req, address, 4, faultCode);
+    }
+    return protocol_replyError(req, reason);
+  }
+  
+  // Check the condition.
+  word = binProto_getU32(data);
+  if ((word & wait->mask) == wait->value) {
+    replyWait(wait, BINPROTO_STATUS_OK, word);
+    return 0;
+  }
+  
+  // Check the timeout.
+  remaining = wait->timeout - (startTimeout() - wait->start);
+  if (remaining <= 0) {
+    replyWait(wait, BINPROTO_STATUS_TIMEOUT, word);
+    return 0;
+  }
+  
+  // Schedule the next poll. Poll one last time right when the timeout
+  // expires if that comes first.
+  return timeout_arm(wait->timer, (remaining < wait->interval) ? remaining : wait->interval);
+}
+
+/**
+ * Ends a trace stream. Sends the final frame with the given status and the
+ * reply to the stop request, if any, unless the client has disconnected, then
+ * frees the stream.
+ */
+static void endTrace(debugTrace_t *trace, int status, uint32_t faultCode, const char *reason) {
+  debugClient_t *client;
+  
+  if (isConnected(trace->req)) {
+    sendBinaryReply(trace->req, status, trace->address, 0, faultCode, (const unsigned char *)reason, reason ? strlen(reason) : 0);
+    if (trace->stopReq) {
+      sendBinaryReply(trace->stopReq, BINPROTO_STATUS_OK, 0, 0, 0, 0, 0);
+    }
+    client = tcpServer_getExtraData(trace->req->target->server, trace->req->clientID);
+    if (client->trace == trace) {
+      client->trace = 0;
+    }
+  }
+  
+  timeout_close(&trace->timer);
+  free(trace->stopReq);
+  free(trace->req);
+  free(trace);
+}
+
+/**
+ * Passes the next read of a trace stream to the backend, unless the client
+ * is not keeping up, in which case the read is retried after the poll
+ * interval. As with WaitFor polls, trace must not be used after this returns.
+ */
+static int issueTraceRead(debugTrace_t *trace) {
+  debugRequest_t *read;
+  int queued;
+  
+  // Stop when the client has gone away or asked us to.
+  if (!isConnected(trace->req) || trace->stopReq) {
+    endTrace(trace, BINPROTO_STATUS_OK, 0, 0);
+    return 0;
+  }
+  
+  // Don't read more trace data while the client hasn't received what we
+  // sent it yet. The trace peripheral stalls the core when its buffers are
+  // full, so this throttles the program instead of losing data.
+  queued = tcpServer_getQueued(trace->req->target->server, trace->req->clientID);
+  if (queued > TRACE_MAX_QUEUED) {
+    return timeout_arm(trace->timer, trace->interval);
+  }
+  
+  read = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+  if (!read) {
+    perror("Failed to allocate memory for debug request");
+    return -1;
+  }
+  *read = *trace->req;
+  read->opcode = BINPROTO_OP_READ;
+  read->complete = completeTraceRead;
+  read->context = trace;
+  trace->reading = 1;
+  return trace->req->target->iface->read(trace->req->target->iface->data, read, trace->address + trace->half * trace->halfSize, trace->halfSize);
+}
+
+/**
+ * Timer handler for trace streams, issues the next read.
+ */
+static int onTraceTimer(void *data) {
+  return issueTraceRead((debugTrace_t*)data);
+}
+
+/**
+ * Handles the completion of a read of a trace buffer half. Sends the trace
+ * data in it to the client and schedules the next read.
+ */
+static int completeTraceRead(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason) {
+  debugTrace_t *trace = (debugTrace_t*)req->context;
+  uint32_t valid;
+  
+  free(req);
+  trace->reading = 0;
+  
+  // Pass failures on to the client, which ends the stream.
+  if (status != BINPROTO_STATUS_OK) {
+    endTrace(trace, status, faultCode, reason);
+    return 0;
+  }
+  
+  // Send the valid part of the buffer, without the byte counter.
+  valid = ((uint32_t)data[2] << 8) | data[3];
+  if ((valid < BINPROTO_TRACE_COUNTER_SIZE) || (valid > trace->halfSize)) {
+    endTrace(trace, BINPROTO_STATUS_ERROR, 0, "InvalidTraceCounter");
+    return 0;
+  }
+  valid -= BINPROTO_TRACE_COUNTER_SIZE;
+  if (valid && isConnected(trace->req)) {
+    sendBinaryReply(trace->req, BINPROTO_STATUS_OK, trace->address + trace->half * trace->halfSize, valid, 0, data + BINPROTO_TRACE_COUNTER_SIZE, valid);
+    trace->emptyReads = 0;
+  } else {
+    trace->emptyReads++;
+  }
+  trace->half ^= 1;
+  
+  // Read the next half right away while the trace is producing data, or
+  // after the poll interval once both halves turned out to be empty. The
+  // read is started from the timer in both cases, so backends which complete
+  // reads immediately don't recurse.
+  return timeout_arm(trace->timer, (trace->emptyReads >= 2) ? trace->interval : 1);
+}
+
+/**
+ * Releases a reference to a Hash command. When the last reference is
+ * released, all reads have been completed, so the reply is sent and the
+ * command is freed.
+ */
+static int releaseHash(debugHash_t *hash) {
+  
+  if (--hash->remaining) {
+    return 0;
+  }
+  
+  recordReply(hash->req, hash->status, 0);
+  if (isConnected(hash->req)) {
+    switch (hash->status) {
+      case BINPROTO_STATUS_OK:
+        sendBinaryReply(hash->req, BINPROTO_STATUS_OK, hash->address, hash->crcsSize / 4, 0, hash->crcs, hash->crcsSize);
+        break;
+      case BINPROTO_STATUS_FAULT:
+        sendBinaryReply(hash->req, BINPROTO_STATUS_FAULT, hash->failAddress, 0, hash->faultCode, 0, 0);
+        break;
+      default:
+        sendBinaryReply(hash->req, BINPROTO_STATUS_ERROR, 0, 0, 0, (const unsigned char *)hash->reason, strlen(hash->reason));
+        break;
+    }
+  }
+  
+  free(hash->crcs);
+  free(hash->req);
+  free(hash);
+  return 0;
+}
+
+/**
+ * Handles the completion of a read issued for a Hash command: computes the
+ * CRCs of the pages that were read, or records the failure.
+ */
+static int completeHashRead(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason) {
+  debugHash_t *hash = (debugHash_t*)req->context;
+  uint32_t page = req->index;
+  uint32_t readAddress = hash->address + page * hash->pageSize;
+  
+  free(req);
+  
+  if (status == BINPROTO_STATUS_OK) {
+    while (count) {
+      uint32_t size = (count < hash->pageSize) ? count : hash->pageSize;
+      binProto_putU32(hash->crcs + page * 4, crc32_update(0, data, size));
+      data += size;
+      count -= size;
+      page++;
+    }
+  } else if ((hash->status == BINPROTO_STATUS_OK) || (readAddress - hash->address < hash->failAddress - hash->address)) {
+    hash->status = status;
+    hash->failAddress = readAddress;
+    hash->faultCode = faultCode;
+    hash->reason = reason ? reason : "CommunicationError";
+  }
+  
+  return releaseHash(hash);
+}
+
+/**
+ * Issues the writes of a Fill command until PROTOCOL_FILL_WINDOW writes are in
+ * flight. Once everything has been written or a write failed and no writes
+ * are in flight anymore, the reply is sent and the command is freed. Returns
+ * -1 if an error occured, or 0 otherwise.
+ */
+static int issueFillWrites(debugFill_t *fill) {
+  debugTarget_t *target = fill->req->target;
+  int retval = 0;
+  
+  // Writes which complete immediately call us again; the loop below takes
+  // care of issuing the next write in that case.
+  if (fill->issuing) {
+    return 0;
+  }
+  fill->issuing = 1;
+  
+  while ((fill->inFlight < PROTOCOL_FILL_WINDOW) && (fill->issued < fill->count) && (fill->status == BINPROTO_STATUS_OK)) {
+    debugRequest_t *write;
+    uint32_t address = fill->address + fill->issued;
+    uint32_t size = fill->count - fill->issued;
+    if (size > target->maxTransferSize) {
+      size = target->maxTransferSize;
+    }
+    
+    write = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+    if (!write) {
+      perror("Failed to allocate memory for debug request");
+      fill->status = BINPROTO_STATUS_ERROR;
+      fill->failAddress = address;
+      fill->reason = "CommunicationError";
+      retval = -1;
+      break;
+    }
+    *write = *fill->req;
+    write->opcode = BINPROTO_OP_WRITE;
+    write->complete = completeFillWrite;
+    write->context = fill;
+    fill->issued += size;
+    fill->inFlight++;
+    if (target->iface->write(target->iface->data, write, address, fill->data + (address & 3), size) < 0) {
+      retval = -1;
+    }
+  }
+  
+  fill->issuing = 0;
+  if (fill->inFlight) {
+    return retval;
+  }
+  
+  // All writes have completed, so send the reply.
+  recordReply(fill->req, fill->status, fill->count);
+  if (isConnected(fill->req)) {
+    switch (fill->status) {
+      case BINPROTO_STATUS_OK:
+        sendBinaryReply(fill->req, BINPROTO_STATUS_OK, fill->address, fill->count, 0, 0, 0);
+        break;
+      case BINPROTO_STATUS_FAULT:
+        sendBinaryReply(fill->req, BINPROTO_STATUS_FAULT, fill->failAddress, 0, fill->faultCode, 0, 0);
+        break;
+      default:
+        sendBinaryReply(fill->req, BINPROTO_STATUS_ERROR, 0, 0, 0, (const unsigned char *)fill->reason, strlen(fill->reason));
+        break;
+    }
+  }
+  
+  free(fill->data);
+  free(fill->req);
+  free(fill);
+  return retval;
+}
+
+/**
+ * Handles the completion of a write issued for a Fill command: records the
+ * failure if there was one and issues the next write.
+ */
+static int completeFillWrite(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason) {
+  debugFill_t *fill = (debugFill_t*)req->context;
+  
+  free(req);
+  fill->inFlight--;
+  
+  // Error replies don't carry an address, so errors take precedence over
+  // faults regardless of where they occured.
+  if (status == BINPROTO_STATUS_ERROR) {
+    address = fill->address;
+  }
+  
+  if ((status != BINPROTO_STATUS_OK)
+    && ((fill->status == BINPROTO_STATUS_OK) || (address - fill->address < fill->failAddress - fill->address))
+  ) {
+    fill->status = status;
+    fill->failAddress = address;
+    fill->faultCode = faultCode;
+    fill->reason = reason ? reason : "CommunicationError";
+  }
+  
+  return issueFillWrites(fill);
+}
+
+/**
+ * Issues the reads of a Checksum command until PROTOCOL_CHECKSUM_WINDOW chunks
+ * are read but not combined yet. Once the whole range has been read or a read
+ * failed and no reads are in flight anymore, the reply is sent and the
+ * command is freed. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int issueChecksumReads(debugChecksum_t *checksum) {
+  debugTarget_t *target = checksum->req->target;
+  unsigned char crc[BINPROTO_CHECKSUM_REPLY_SIZE];
+  int retval = 0;
+  
+  // Reads which complete immediately call us again; the loop below takes
+  // care of issuing the next read in that case.
+  if (checksum->issuing) {
+    return 0;
+  }
+  checksum->issuing = 1;
+  
+  while ((checksum->issued - checksum->combined < PROTOCOL_CHECKSUM_WINDOW)
+    && ((uint64_t)checksum->issued * target->maxTransferSize < checksum->count)
+    && (checksum->status == BINPROTO_STATUS_OK)
+  ) {
+    debugRequest_t *read;
+    uint32_t offset = checksum->issued * target->maxTransferSize;
+    uint32_t size = checksum->count - offset;
+    if (size > target->maxTransferSize) {
+      size = target->maxTransferSize;
+    }
+    
+    read = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+    if (!read) {
+      perror("Failed to allocate memory for debug request");
+      checksum->status = BINPROTO_STATUS_ERROR;
+      checksum->failAddress = checksum->address + offset;
+      checksum->reason = "CommunicationError";
+      retval = -1;
+      break;
+    }
+    *read = *checksum->req;
+    read->opcode = BINPROTO_OP_READ;
+    read->complete = completeChecksumRead;
+    read->context = checksum;
+    read->index = checksum->issued++;
+    checksum->inFlight++;
+    if (target->iface->read(target->iface->data, read, checksum->address + offset, size) < 0) {
+      retval = -1;
+    }
+  }
+  
+  checksum->issuing = 0;
+  if (checksum->inFlight) {
+    return retval;
+  }
+  
+  // All reads have completed, so send the reply.
+  recordReply(checksum->req, checksum->status, checksum->count);
+  if (isConnected(checksum->req)) {
+    switch (checksum->status) {
+      case BINPROTO_STATUS_OK:
+        binProto_putU32(crc, checksum->crc);
+        sendBinaryReply(checksum->req, BINPROTO_STATUS_OK, checksum->address, checksum->count, 0, crc, BINPROTO_CHECKSUM_REPLY_SIZE);
+        break;
+      case BINPROTO_STATUS_FAULT:
+        sendBinaryReply(checksum->req, BINPROTO_STATUS_FAULT, checksum->failAddress, 0, checksum->faultCode, 0, 0);
+        break;
+      default:
+        sendBinaryReply(checksum->req, BINPROTO_STATUS_ERROR, 0, 0, 0, (const unsigned char *)checksum->reason, strlen(checksum->reason));
+        break;
+    }
+  }
+  
+  free(checksum->req);
+  free(checksum);
+  return retval;
+}
+
+/**
+ * Handles the completion of a read issued for a Checksum command: combines
+ * the CRCs of the chunks which have been read in order so far, or records the
+ * failure, and issues the next reads.
+ */
+static int completeChecksumRead(debugRequest_t *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason) {
+  debugChecksum_t *checksum = (debugChecksum_t*)req->context;
+  uint32_t chunkSize = req->target->maxTransferSize;
+  uint32_t chunk = req->index;
+  
+  free(req);
+  checksum->inFlight--;
+  
+  if (status == BINPROTO_STATUS_OK) {
+    checksum->chunkCrcs[chunk % PROTOCOL_CHECKSUM_WINDOW] = crc32_update(0, data, count);
+    checksum->chunkValid[chunk % PROTOCOL_CHECKSUM_WINDOW] = 1;
+    while (checksum->chunkValid[checksum->combined % PROTOCOL_CHECKSUM_WINDOW]) {
+      uint32_t offset = checksum->combined * chunkSize;
+      uint32_t size = (checksum->count - offset < chunkSize) ? checksum->count - offset : chunkSize;
+      checksum->chunkValid[checksum->combined % PROTOCOL_CHECKSUM_WINDOW] = 0;
+      checksum->crc = crc32_combine(checksum->crc, checksum->chunkCrcs[checksum->combined % PROTOCOL_CHECKSUM_WINDOW], size);
+      checksum->combined++;
+    }
+  } else if ((checksum->status == BINPROTO_STATUS_OK) || (chunk * chunkSize < checksum->failAddress - checksum->address)) {
+    checksum->status = status;
+    checksum->failAddress = checksum->address + chunk * chunkSize;
+    checksum->faultCode = faultCode;
+    checksum->reason = reason ? reason : "CommunicationError";
+  }
+  
+  return issueChecksumReads(checksum);
+}
+
+/**
+ * Completes a read request with the data that was read.
+ */
+int protocol_replyRead(debugRequest_t *req, uint32_t address, uint32_t count, const unsigned char *data) {
+  unsigned char str[64];
+  
+  if (req->complete) {
+    return req->complete(req, BINPROTO_STATUS_OK, address, 0, data, count, 0);
+  }
+  
+  // Note: we don't consider communication errors with the client as fatal
+  // errors; the client may just have disconnected.
+  recordReply(req, BINPROTO_STATUS_OK, count);
+  if (isConnected(req)) {
+    if (req->binary) {
+      sendBinaryReply(req, BINPROTO_STATUS_OK, address, count, 0, data, count);
+    } else {
+      sprintf((char *)str, "OK, Read, OK, %08X, %d, ", address, count);
+      if ((sendTagPrefix(req->target, req->clientID, req->tagged, req->tag) >= 0) && (tcpServer_sendStr(req->target->server, req->clientID, str) >= 0)) {
+        if (sendHex(req->target, req->clientID, data, count) >= 0) {
+          tcpServer_sendStr(req->target->server, req->clientID, (const unsigned char *)";\n");
+        }
+      }
+    }
+  }
+  
+  free(req);
+  return 0;
+}
+
+/**
+ * Completes a write request successfully.
+ */
+int protocol_replyWrite(debugRequest_t *req, uint32_t address, uint32_t count) {
+  unsigned char str[64];
+  
+  if (req->complete) {
+    return req->complete(req, BINPROTO_STATUS_OK, address, 0, 0, 0, 0);
+  }
+  
+  recordReply(req, BINPROTO_STATUS_OK, count);
+  if (isConnected(req)) {
+    if (req->binary) {
+      sendBinaryReply(req, BINPROTO_STATUS_OK, address, count, 0, 0, 0);
+    } else {
+      sprintf((char *)str, "OK, Write, OK, %08X, %d;\n", address, count);
+      if (sendTagPrefix(req->target, req->clientID, req->tagged, req->tag) >= 0) {
+        tcpServer_sendStr(req->target->server, req->clientID, str);
+      }
+    }
+  }
+  
+  free(req);
+  return 0;
+}
+
+/**
+ * Completes a read or write request with a bus fault.
+ */
+int protocol_replyFault(debugRequest_t *req, uint32_t address, uint32_t count, uint32_t faultCode) {
+  unsigned char str[64];
+  
+  if (req->complete) {
+    return req->complete(req, BINPROTO_STATUS_FAULT, address, faultCode, 0, 0, 0);
+  }
+  
+  recordReply(req, BINPROTO_STATUS_FAULT, count);
+  if (isConnected(req)) {
+    if (req->binary) {
+      sendBinaryReply(req, BINPROTO_STATUS_FAULT, address, count, faultCode, 0, 0);
+    } else {
+      sprintf((char *)str, "OK, %s, Fault, %08X, %d, %08X;\n", commandName(req->opcode), address, count, faultCode);
+      if (sendTagPrefix(req->target, req->clientID, req->tagged, req->tag) >= 0) {
+        tcpServer_sendStr(req->target->server, req->clientID, str);
+      }
+    }
+  }
+  
+  free(req);
+  return 0;
+}
+
+/**
+ * Completes a request with an error, such as "CommunicationError".
+ */
+int protocol_replyError(debugRequest_t *req, const char *reason) {
+  unsigned char str[128];
+  
+  if (req->complete) {
+    return req->complete(req, BINPROTO_STATUS_ERROR, 0, 0, 0, 0, reason);
+  }
+  
+  recordReply(req, BINPROTO_STATUS_ERROR, 0);
+  if (isConnected(req)) {
+    if (req->binary) {
+      sendBinaryReply(req, BINPROTO_STATUS_ERROR, 0, 0, 0, (const unsigned char *)reason, strlen(reason));
+    } else {
+      snprintf((char *)str, sizeof(str), "Error, %s, %s;\n", commandName(req->opcode), reason);
+      if (sendTagPrefix(req->target, req->clientID, req->tagged, req->tag) >= 0) {
+        tcpServer_sendStr(req->target->server, req->clientID, str);
+      }
+    }
+  }
+  
+  free(req);
+  return 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Request handling
+//-----------------------------------------------------------------------------
+
+/**
+ * Allocates a request structure for a command received from the given
+ * client. Returns null if allocation fails.
+ */
+static debugRequest_t *newRequest(debugTarget_t *target, int clientID, debugClient_t *client, int opcode, uint32_t tag, int tagged) {
+  debugRequest_t *req;
+  
+  req = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+  if (!req) {
+    perror("Failed to allocate memory for debug request");
+    return 0;
+  }
+  req->target = target;
+  req->startTime = stats_now();
+  req->clientID = clientID;
+  req->connection = client->connection;
+  req->binary = client->binary;
+  req->opcode = opcode;
+  req->tag = tag;
+  req->tagged = tagged;
+  req->complete = 0;
+  req->context = 0;
+  req->index = 0;
+  
+  return req;
+}
+
+/**
+ * Handles a Stats command: collects the statistics of the target and sends
+ * them to the client.
+ */
+static int replyStats(debugRequest_t *req) {
+  debugTarget_t *target = req->target;
+  statsBuffer_t buf;
+  
+  stats_init(&buf);
+  if (target->statsHandler) {
+    target->statsHandler(target->statsData, &buf);
+  } else {
+    protocol_stats(target, &buf);
+  }
+  if (buf.error || !buf.data) {
+    stats_free(&buf);
+    return protocol_replyError(req, "NoStats");
+  }
+  
+  if (req->binary) {
+    sendBinaryReply(req, BINPROTO_STATUS_OK, 0, buf.size, 0, (const unsigned char *)buf.data, buf.size);
+  } else if (sendTagPrefix(target, req->clientID, req->tagged, req->tag) >= 0) {
+    if (tcpServer_sendStr(target->server, req->clientID, (const unsigned char *)"OK, Stats, ") >= 0) {
+      if (tcpServer_sendBuf(target->server, req->clientID, (const unsigned char *)buf.data, buf.size) >= 0) {
+        tcpServer_sendStr(target->server, req->clientID, (const unsigned char *)";\n");
+      }
+    }
+  }
+  
+  stats_free(&buf);
+  free(req);
+  return 0;
+}
+
+/**
+ * Passes a read or write request to the backend.
+ */
+static int issueAccess(debugRequest_t *req, uint32_t address, uint32_t count, unsigned char *buffer) {
+  
+  if (req->opcode == BINPROTO_OP_WRITE) {
+    return req->target->iface->write(req->target->iface->data, req, address, buffer, count);
+  } else {
+    return req->target->iface->read(req->target->iface->data, req, address, count);
+  }
+  
+}
+
+/**
+ * Starts a WaitFor command. timeout is specified in milliseconds, interval in
+ * microseconds, with zero selecting the default interval. Returns -1 if an
+ * error occured, or 0 otherwise.
+ */
+static int startWait(debugRequest_t *req, uint32_t address, uint32_t mask, uint32_t value, uint32_t timeout, uint32_t interval) {
+  debugWait_t *wait;
+  
+  if (timeout > BINPROTO_MAX_WAIT_TIMEOUT) {
+    return protocol_replyError(req, "InvalidTimeout");
+  }
+  if (!interval) {
+    interval = BINPROTO_DEFAULT_WAIT_INTERVAL;
+  } else if (interval < BINPROTO_MIN_WAIT_INTERVAL) {
+    interval = BINPROTO_MIN_WAIT_INTERVAL;
+  } else if (interval > BINPROTO_MAX_WAIT_INTERVAL) {
+    interval = BINPROTO_MAX_WAIT_INTERVAL;
+  }
+  
+  wait = (debugWait_t*)malloc(sizeof(debugWait_t));
+  if (!wait) {
+    perror("Failed to allocate memory for WaitFor command");
+    free(req);
+    return -1;
+  }
+  wait->req = req;
+  wait->address = address;
+  wait->mask = mask;
+  wait->value = value & mask;
+  wait->start = startTimeout();
+  wait->timeout = timeout * 1000;
+  wait->interval = interval;
+  wait->timer = timeout_open(&onWaitTimer, wait);
+  if (!wait->timer) {
+    free(wait);
+    free(req);
+    return -1;
+  }
+  
+  return issueWaitPoll(wait);
+}
+
+/**
+ * Starts a TraceStream command, or stops the stream running on the client's
+ * connection if size is zero. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int startTrace(debugRequest_t *req, debugClient_t *client, uint32_t address, uint32_t size, uint32_t interval) {
+  debugTrace_t *trace;
+  
+  // Handle stop requests.
+  if (!size) {
+    trace = client->trace;
+    if (!trace) {
+      sendBinaryReply(req, BINPROTO_STATUS_OK, 0, 0, 0, 0, 0);
+      free(req);
+      return 0;
+    }
+    if (trace->stopReq) {
+      return protocol_replyError(req, "TraceStopping");
+    }
+    trace->stopReq = req;
+    if (!trace->reading) {
+      endTrace(trace, BINPROTO_STATUS_OK, 0, 0);
+    }
+    return 0;
+  }
+  
+  // Check the request.
+  if (client->trace) {
+    return protocol_replyError(req, "TraceActive");
+  }
+  if ((size & 1) || ((size >> 1) <= BINPROTO_TRACE_COUNTER_SIZE) || ((size >> 1) > req->target->maxTransferSize)) {
+    return protocol_replyError(req, "InvalidBufSize");
+  }
+  if (!interval) {
+    interval = BINPROTO_DEFAULT_TRACE_INTERVAL;
+  } else if (interval < BINPROTO_MIN_WAIT_INTERVAL) {
+    interval = BINPROTO_MIN_WAIT_INTERVAL;
+  } else if (interval > BINPROTO_MAX_WAIT_INTERVAL) {
+    interval = BINPROTO_MAX_WAIT_INTERVAL;
+  }
+  
+  trace = (debugTrace_t*)malloc(sizeof(debugTrace_t));
+  if (!trace) {
+    perror("Failed to allocate memory for TraceStream command");
+    free(req);
+    return -1;
+  }
+  trace->req = req;
+  trace->address = address;
+  trace->halfSize = size >> 1;
+  trace->half = 0;
+  trace->emptyReads = 0;
+  trace->interval = interval;
+  trace->reading = 0;
+  trace->stopReq = 0;
+  trace->timer = timeout_open(&onTraceTimer, trace);
+  if (!trace->timer) {
+    free(trace);
+    free(req);
+    return -1;
+  }
+  client->trace = trace;
+  
+  return issueTraceRead(trace);
+}
+
+/**
+ * Starts a Hash command: reads the range in chunks of the maximum transfer
+ * size, all of which are passed to the backend right away. Returns -1 if an
+ * error occured, or 0 otherwise.
+ */
+static int startHash(debugRequest_t *req, uint32_t address, uint32_t count, uint32_t pageSize) {
+  debugHash_t *hash;
+  uint32_t numPages, chunkPages, page;
+  int retval = 0;
+  
+  // Check the request. The page size must be a power of two, so it divides
+  // the maximum transfer size and every read covers whole pages.
+  if ((pageSize < BINPROTO_MIN_HASH_PAGE_SIZE) || (pageSize > req->target->maxTransferSize) || (pageSize & (pageSize - 1))) {
+    return protocol_replyError(req, "InvalidPageSize");
+  }
+  numPages = count / pageSize + ((count % pageSize) ? 1 : 0);
+  if ((numPages < 1) || (numPages > BINPROTO_MAX_HASH_PAGES)) {
+    return protocol_replyError(req, "InvalidBufSize");
+  }
+  
+  hash = (debugHash_t*)malloc(sizeof(debugHash_t));
+  if (!hash) {
+    perror("Failed to allocate memory for Hash command");
+    free(req);
+    return -1;
+  }
+  hash->crcsSize = numPages * 4;
+  hash->crcs = (unsigned char*)malloc(hash->crcsSize);
+  if (!hash->crcs) {
+    perror("Failed to allocate memory for Hash command");
+    free(hash);
+    free(req);
+    return -1;
+  }
+  hash->req = req;
+  hash->address = address;
+  hash->pageSize = pageSize;
+  hash->status = BINPROTO_STATUS_OK;
+  hash->failAddress = 0;
+  hash->faultCode = 0;
+  hash->reason = 0;
+  
+  // Hold an extra reference while issuing, so backends which complete
+  // requests immediately don't send the reply halfway through.
+  hash->remaining = 1;
+  
+  // Issue the reads.
+  chunkPages = req->target->maxTransferSize / pageSize;
+  for (page = 0; (page < numPages) && (retval >= 0); page += chunkPages) {
+    debugRequest_t *read;
+    uint32_t offset = page * pageSize;
+    uint32_t size = (count - offset < chunkPages * pageSize) ? count - offset : chunkPages * pageSize;
+    
+    read = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+    if (!read) {
+      perror("Failed to allocate memory for debug request");
+      retval = -1;
+      break;
+    }
+    *read = *req;
+    read->opcode = BINPROTO_OP_READ;
+    read->complete = completeHashRead;
+    read->context = hash;
+    read->index = page;
+    hash->remaining++;
+    if (req->target->iface->read(req->target->iface->data, read, address + offset, size) < 0) {
+      retval = -1;
+    }
+  }
+  
+  // Release the reference we held while issuing. If not everything could be
+  // issued, report an error for the rest.
+  if ((retval < 0) && (hash->status == BINPROTO_STATUS_OK)) {
+    hash->status = BINPROTO_STATUS_ERROR;
+    hash->reason = "CommunicationError";
+  }
+  releaseHash(hash);
+  
+  return retval;
+}
+
+/**
+ * Starts a Fill command. If the backend can fill memory by itself, the whole
+ * range is passed to it; otherwise, rvsrv writes the pattern in chunks of the
+ * maximum transfer size, keeping up to PROTOCOL_FILL_WINDOW writes in
+ * flight. Returns -1 if an error occured, or 0 otherwise.
+ */
+static int startFill(debugRequest_t *req, uint32_t address, uint32_t count, uint32_t pattern) {
+  debugTarget_t *target = req->target;
+  debugFill_t *fill;
+  uint32_t i;
+  
+  // Check the request.
+  if ((count < 1) || ((uint64_t)address + count > 0x100000000ull)) {
+    return protocol_replyError(req, "InvalidBufSize");
+  }
+  
+  // Let the backend handle it if it can.
+  if (target->iface->fill) {
+    return target->iface->fill(target->iface->data, req, address, pattern, count);
+  }
+  
+  fill = (debugFill_t*)malloc(sizeof(debugFill_t));
+  if (!fill) {
+    perror("Failed to allocate memory for Fill command");
+    free(req);
+    return -1;
+  }
+  fill->data = (unsigned char*)malloc(target->maxTransferSize + 3);
+  if (!fill->data) {
+    perror("Failed to allocate memory for Fill command");
+    free(fill);
+    free(req);
+    return -1;
+  }
+  for (i = 0; i < target->maxTransferSize + 3; i++) {
+    fill->data[i] = pattern >> (24 - 8 * (i & 3));
+  }
+  fill->req = req;
+  fill->address = address;
+  fill->count = count;
+  fill->issued = 0;
+  fill->inFlight = 0;
+  fill->issuing = 0;
+  fill->status = BINPROTO_STATUS_OK;
+  fill->failAddress = 0;
+  fill->faultCode = 0;
+  fill->reason = 0;
+  
+  return issueFillWrites(fill);
+}
+
+/**
+ * Starts a Checksum command: reads the range in chunks of the maximum transfer
+ * size, keeping up to PROTOCOL_CHECKSUM_WINDOW chunks in flight. Returns -1 if
+ * an error occured, or 0 otherwise.
+ */
+static int startChecksum(debugRequest_t *req, uint32_t address, uint32_t count) {
+  debugChecksum_t *checksum;
+  
+  // Check the request.
+  if ((count < 1) || ((uint64_t)address + count > 0x100000000ull)) {
+    return protocol_replyError(req, "InvalidBufSize");
+  }
+  
+  checksum = (debugChecksum_t*)malloc(sizeof(debugChecksum_t));
+  if (!checksum) {
+    perror("Failed to allocate memory for Checksum command");
+    free(req);
+    return -1;
+  }
+  memset(checksum, 0, sizeof(debugChecksum_t));
+  checksum->req = req;
+  checksum->address = address;
+  checksum->count = count;
+  checksum->status = BINPROTO_STATUS_OK;
+  
+  return issueChecksumReads(checksum);
+}
+
+/**
+ * Returns 1 if command starts with the specified text and is either followed
+ * by a comma or null, or 0 otherwise.
+ */
+static int checkCommand(const unsigned char *command, const unsigned char *text) {
+  
+  while (*text) {
+    if (*command++ != *text++) {
+      return 0;
+    }
+  }
+  
+  return (*command == 0) || (*command == ',');
+}
+
+/**
+ * Parses the optional "Tag,<1-8 hex chars>," prefix of a text command. If
+ * the prefix is present, *tagged is set, *tag is set to the tag and *command
+ * is advanced past the prefix. Returns 1 if the prefix is malformed, or 0
+ * otherwise.
+ */
+static int parseTag(unsigned char **command, uint32_t *tag, int *tagged) {
+  unsigned char *ptr = *command;
+  int i;
+  
+  *tag = 0;
+  *tagged = 0;
+  if (!checkCommand(ptr, (const unsigned char *)"Tag")) {
+    return 0;
+  }
+  ptr += 3;
+  if (*ptr++ != ',') {
+    return 1;
+  }
+  
+  // Scan the tag.
+  for (i = 0; i < 8; i++) {
+    unsigned char c = *ptr;
+    if ((c >= '0') && (c <= '9')) {
+      c -= '0';
+    } else if ((c >= 'A') && (c <= 'F')) {
+      c -= 'A' - 10;
+    } else if ((c >= 'a') && (c <= 'f')) {
+      c -= 'a' - 10;
+    } else {
+      break;
+    }
+    *tag = (*tag << 4) | c;
+    ptr++;
+  }
+  if ((i == 0) || (*ptr++ != ',')) {
+    return 1;
+  }
+  
+  *tagged = 1;
+  *command = ptr;
+  return 0;
+}
+
+/**
+ * Handles a text protocol command. Returns -1 if an error occured, or 0
+ * otherwise.
+ */
+static int handleTextCommand(debugTarget_t *target, unsigned char *command, int clientID, debugClient_t *client) {
+  unsigned char *ptr;
+  debugRequest_t *req;
+  unsigned char str[64];
+  uint32_t tag;
+  int tagged;
+  
+  // Handle the tag prefix.
+  if (parseTag(&command, &tag, &tagged)) {
+    if (tcpServer_sendStr(target->server, clientID, (const unsigned char *)"Error, Tag, Syntax;\n") < 0) {
+      return -1;
+    }
+    return 0;
+  }
+  
+  if (checkCommand(command, (const unsigned char *)"Stop")) {
+    
+    // Stop server command.
+    if (sendTagPrefix(target, clientID, tagged, tag) < 0) {
+      return -1;
+    }
+    if (tcpServer_sendStr(target->server, clientID, (const unsigned char *)"OK, Stop;\n") < 0) {
+      return -1;
+    }
+    printf("Client ID %d (debug access) requested the server to stop.\n", clientID);
+    stopRequested = 1;
+    return 0;
+    
+  } else if (checkCommand(command, (const unsigned char *)"Stats")) {
+    
+    // Statistics command.
+    req = newRequest(target, clientID, client, BINPROTO_OP_STATS, tag, tagged);
+    if (!req) {
+      return -1;
+    }
+    return replyStats(req);
+    
+  } else if (checkCommand(command, (const unsigned char *)"Binary")) {
+    
+    // Switch to the binary protocol. Everything after this command is
+    // interpreted as binary frames.
+    sprintf((char *)str, "OK, Binary, %d, %u;\n", BINPROTO_VERSION, target->maxTransferSize);
+    if (sendTagPrefix(target, clientID, tagged, tag) < 0) {
+      return -1;
+    }
+    if (tcpServer_sendStr(target->server, clientID, str) < 0) {
+      return -1;
+    }
+    client->binary = 1;
+    return 0;
+    
+  } else if (checkCommand(command, (const unsigned char *)"Read") || checkCommand(command, (const unsigned char *)"Write")) {
+
+    struct parse_rw_result res;
+    const char *reason;
+    int err;
+    
+    // Parse read/write command.
+    err = parseReadWrite(command, &res, &reason);
+    if (err < 0) {
+      return -1;
+    }
+    req = newRequest(target, clientID, client, res.is_write ? BINPROTO_OP_WRITE : BINPROTO_OP_READ, tag, tagged);
+    if (!req) {
+      free(res.buffer);
+      return -1;
+    }
+    if (err == 1) {
+      return protocol_replyError(req, reason);
+    }
+    
+    // Perform the write or read.
+    err = issueAccess(req, res.address, res.buf_size, res.buffer);
+    free(res.buffer);
+    return err;
+    
+  } else if (checkCommand(command, (const unsigned char *)"WaitFor")) {
+    
+    struct parse_wait_result res;
+    const char *reason;
+    
+    // Parse the command and start waiting.
+    req = newRequest(target, clientID, client, BINPROTO_OP_WAIT, tag, tagged);
+    if (!req) {
+      return -1;
+    }
+    if (parseWaitFor(command, &res, &reason)) {
+      return protocol_replyError(req, reason);
+    }
+    return startWait(req, res.address, res.mask, res.value, res.timeout, res.interval);
+    
+  }
+  
+  // Unknown command.
+  if (sendTagPrefix(target, clientID, tagged, tag) < 0) {
+    return -1;
+  }
+  if (tcpServer_sendStr(target->server, clientID, (const unsigned char *)"Error, ") < 0) {
+    return -1;
+  }
+  ptr = command;
+  while ((*ptr) && (*ptr != ',')) {
+    ptr++;
+  }
+  if (tcpServer_sendBuf(target->server, clientID, command, ptr - command) < 0) {
+    return -1;
+  }
+  if (tcpServer_sendStr(target->server, clientID, (const unsigned char *)", UnknownCommand;\n") < 0) {
+    return -1;
+  }
+  return 0;
+  
+}
+
+/**
+ * Handles a Batch request. The entries are validated first, so either all or
+ * none of them are passed to the backend. They are issued as tagged requests
+ * from the same client, so the backend may overlap reads, but keeps them
+ * ordered with respect to writes. Returns -1 if an error occured, or 0
+ * otherwise.
+ */
+static int handleBatch(debugRequest_t *req, const unsigned char *payload, uint32_t payloadSize, uint32_t numEntries) {
+  debugBatch_t *batch;
+  const unsigned char *ptr;
+  uint32_t i, pos, offset, readSize;
+  int retval = 0;
+  
+  // Validate the entries and compute the size of the reply payload.
+  if ((numEntries < 1) || (numEntries > BINPROTO_MAX_BATCH_ENTRIES) || (payloadSize > BINPROTO_MAX_BATCH_SIZE)) {
+    return protocol_replyError(req, "InvalidBatchSize");
+  }
+  pos = 0;
+  readSize = 0;
+  for (i = 0; i < numEntries; i++) {
+    uint32_t count;
+    
+    if (pos + BINPROTO_BATCH_ENTRY_SIZE > payloadSize) {
+      return protocol_replyError(req, "Syntax");
+    }
+    count = binProto_getU32(payload + pos + 8);
+    if ((count < 1) || (count > MAX_TRANSFER_SIZE)) {
+      return protocol_replyError(req, "InvalidBufSize");
+    }
+    if (payload[pos] == BINPROTO_OP_READ) {
+      readSize += count;
+      pos += BINPROTO_BATCH_ENTRY_SIZE;
+    } else if (payload[pos] == BINPROTO_OP_WRITE) {
+      pos += BINPROTO_BATCH_ENTRY_SIZE + count;
+    } else {
+      return protocol_replyError(req, "UnknownCommand");
+    }
+  }
+  if (pos != payloadSize) {
+    return protocol_replyError(req, "Syntax");
+  }
+  if (readSize > BINPROTO_MAX_BATCH_SIZE) {
+    return protocol_replyError(req, "InvalidBatchSize");
+  }
+  
+  // Allocate the batch.
+  batch = (debugBatch_t*)malloc(sizeof(debugBatch_t));
+  if (!batch) {
+    perror("Failed to allocate memory for debug batch");
+    free(req);
+    return -1;
+  }
+  batch->resultsSize = numEntries * BINPROTO_BATCH_RESULT_SIZE + readSize;
+  batch->results = (unsigned char*)calloc(batch->resultsSize, 1);
+  if (!batch->results) {
+    perror("Failed to allocate memory for debug batch");
+    free(batch);
+    free(req);
+    return -1;
+  }
+  batch->req = req;
+  batch->numEntries = numEntries;
+  
+  // Hold an extra reference while issuing, so backends which complete
+  // requests immediately don't send the reply halfway through.
+  batch->remaining = numEntries + 1;
+  
+  // Issue the entries.
+  ptr = payload;
+  offset = 0;
+  for (i = 0; i < numEntries; i++) {
+    debugRequest_t *entry;
+    uint32_t count = binProto_getU32(ptr + 8);
+    
+    // Once something went wrong, just mark the remaining entries as failed.
+    entry = 0;
+    if (retval >= 0) {
+      entry = (debugRequest_t*)malloc(sizeof(debugRequest_t));
+      if (!entry) {
+        perror("Failed to allocate memory for debug request");
+        retval = -1;
+      }
+    }
+    if (entry) {
+      *entry = *req;
+      entry->opcode = ptr[0];
+      entry->complete = completeBatchEntry;
+      entry->context = batch;
+      entry->index = offset;
+      if (issueAccess(entry, binProto_getU32(ptr + 4), count, (unsigned char *)ptr + BINPROTO_BATCH_ENTRY_SIZE) < 0) {
+        retval = -1;
+      }
+    } else {
+      batch->results[offset] = BINPROTO_STATUS_ERROR;
+      batch->remaining--;
+    }
+    
+    offset += BINPROTO_BATCH_RESULT_SIZE;
+    if (ptr[0] == BINPROTO_OP_READ) {
+      offset += count;
+      ptr += BINPROTO_BATCH_ENTRY_SIZE;
+    } else {
+      ptr += BINPROTO_BATCH_ENTRY_SIZE + count;
+    }
+  }
+  
+  // Release the reference we held while issuing.
+  releaseBatch(batch);
+  
+  return retval;
+}
+
+/**
+ * Handles a complete binary request frame. Returns -1 if an error occured, or
+ * 0 otherwise.
+ */
+static int handleBinaryFrame(debugTarget_t *target, const unsigned char *frame, uint32_t frameSize, int clientID, debugClient_t *client) {
+  debugRequest_t *req;
+  uint32_t address, count;
+  
+  req = newRequest(target, clientID, client, frame[4], binProto_getU32(frame + 8), 1);
+  if (!req) {
+    return -1;
+  }
+  address = binProto_getU32(frame + 12);
+  count = binProto_getU32(frame + 16);
+  
+  switch (req->opcode) {
+    
+    case BINPROTO_OP_STOP:
+      printf("Client ID %d (debug access) requested the server to stop.\n", clientID);
+      stopRequested = 1;
+      sendBinaryReply(req, BINPROTO_STATUS_OK, 0, 0, 0, 0, 0);
+      free(req);
+      return 0;
+      
+    case BINPROTO_OP_READ:
+    case BINPROTO_OP_WRITE:
+      
+      // Check the size.
+      if ((count < 1) || (count > target->maxTransferSize)) {
+        return protocol_replyError(req, "InvalidBufSize");
+      }
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE + ((req->opcode == BINPROTO_OP_WRITE) ? count : 0)) {
+        return protocol_replyError(req, "Syntax");
+      }
+      
+      return issueAccess(req, address, count, (unsigned char *)frame + BINPROTO_REQUEST_HEADER_SIZE);
+      
+    case BINPROTO_OP_BATCH:
+      return handleBatch(req, frame + BINPROTO_REQUEST_HEADER_SIZE, frameSize - BINPROTO_REQUEST_HEADER_SIZE, count);
+      
+    case BINPROTO_OP_TRACE:
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE + (count ? BINPROTO_TRACE_PAYLOAD_SIZE : 0)) {
+        return protocol_replyError(req, "Syntax");
+      }
+      return startTrace(req, client, address, count, count ? binProto_getU32(frame + BINPROTO_REQUEST_HEADER_SIZE) : 0);
+      
+    case BINPROTO_OP_STATS:
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE) {
+        return protocol_replyError(req, "Syntax");
+      }
+      return replyStats(req);
+      
+    case BINPROTO_OP_HASH:
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE + BINPROTO_HASH_PAYLOAD_SIZE) {
+        return protocol_replyError(req, "Syntax");
+      }
+      return startHash(req, address, count, binProto_getU32(frame + BINPROTO_REQUEST_HEADER_SIZE));
+      
+    case BINPROTO_OP_FILL:
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE + BINPROTO_FILL_PAYLOAD_SIZE) {
+        return protocol_replyError(req, "Syntax");
+      }
+      return startFill(req, address, count, binProto_getU32(frame + BINPROTO_REQUEST_HEADER_SIZE));
+      
+    case BINPROTO_OP_CHECKSUM:
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE) {
+        return protocol_replyError(req, "Syntax");
+      }
+      return startChecksum(req, address, count);
+      
+    case BINPROTO_OP_WAIT:
+      if (frameSize != BINPROTO_REQUEST_HEADER_SIZE + BINPROTO_WAIT_PAYLOAD_SIZE) {
+        return protocol_replyError(req, "Syntax");
+      }
+      frame += BINPROTO_REQUEST_HEADER_SIZE;
+      return startWait(req, address, binProto_getU32(frame + 0), binProto_getU32(frame + 4), count, binProto_getU32(frame + 8));
+      
+  }
+  
+  return protocol_replyError(req, "UnknownCommand");
+}
+
+/**
+ * Handles incoming text protocol data. Returns -1 if an error occured,
+ * otherwise the number of bytes consumed. Stops consuming data when the
+ * client switches to the binary protocol.
+ */
+static int handleTextData(debugTarget_t *target, const unsigned char *data, int size, int clientID, debugClient_t *client) {
+  int i;
+  
+  for (i = 0; (i < size) && !client->binary && !stopRequested; i++) {
+    unsigned char d = data[i];
+    
+    // Check if the buffer is full.
+    if (client->numBytes >= MAX_DEBUG_COMMAND_SIZE) {
+      
+      // Buffer is full; ignore everything except for the semicolon
+      // delimiter character.
+      if (d == ';') {
+        
+        // Send an error message.
+        tcpServer_sendStr(target->server, clientID, (const unsigned char *)"Error, PacketBufferOverrun;\n");
+        
+        // Reset the buffer.
+        client->numBytes = 0;
+        
+      }
+      
+    } else {
+      
+      // There is space left in the buffer, handle the byte.
+      if (d == ';') {
+        
+        // Delimiter character: we've received a full command.
+        // Null-terminate the command.
+        client->commandBuf[client->numBytes] = 0;
+        
+        // Reset the buffer.
+        client->numBytes = 0;
+        
+        // Handle the command.
+        if (handleTextCommand(target, client->commandBuf, clientID, client) < 0) {
+          return -1;
+        }
+        
+      } else if ((d == ',') || ((d >= 'a') && (d <= 'z')) || ((d >= 'A') && (d <= 'Z')) || ((d >= '0') && (d <= '9'))) {
+        
+        // Normal character, add it to the buffer.
+        client->commandBuf[client->numBytes++] = d;
+        
+      } else {
+        
+        // Ignore everything else.
+        
+      }
+      
+    }
+    
+  }
+  
+  return i;
+}
+
+/**
+ * Handles incoming binary protocol data. Returns -1 if an error occured,
+ * otherwise the number of bytes consumed.
+ */
+static int handleBinaryData(debugTarget_t *target, const unsigned char *data, int size, int clientID, debugClient_t *client) {
+  int consumed = 0;
+  
+  while ((consumed < size) && !stopRequested) {
+    uint32_t frameSize;
+    int count;
+    
+    // Figure out how many bytes we need: first the length field, then the
+    // rest of the frame.
+    if (client->numBytes < 4) {
+      frameSize = 4;
+    } else {
+      frameSize = binProto_getU32(client->commandBuf) + 4;
+    }
+    
+    // Append as much as we need to the frame buffer.
+    count = size - consumed;
+    if (count > frameSize - client->numBytes) {
+      count = frameSize - client->numBytes;
+    }
+    memcpy(client->commandBuf + client->numBytes, data + consumed, count);
+    client->numBytes += count;
+    consumed += count;
+    if (client->numBytes < frameSize) {
+      continue;
+    }
+    
+    // Check the frame size as soon as we know it. The length field is checked
+    // before adding the size of the field itself, so it can't wrap around.
+    if (frameSize == 4) {
+      uint32_t len = binProto_getU32(client->commandBuf);
+      if ((len < BINPROTO_REQUEST_HEADER_SIZE - 4) || (len > target->maxFrameSize - 4)) {
+        debugRequest_t *req;
+        
+        // We can't buffer this frame, and skipping it is not safe, because
+        // a bogus length means we probably lost track of the frame
+        // boundaries. Report an error with a zero tag, because we don't know
+        // the real one, and drop the connection.
+        client->numBytes = 0;
+        req = newRequest(target, clientID, client, 0, 0, 1);
+        if (!req) {
+          return -1;
+        }
+        if (protocol_replyError(req, "PacketBufferOverrun") < 0) {
+          return -1;
+        }
+        printf("Client ID %d sent a binary frame of invalid size %u, disconnecting.\n", clientID, len);
+        tcpServer_disconnect(target->server, clientID);
+        return size;
+      }
+      frameSize = len + 4;
+      
+      // Make sure the frame fits in the command buffer.
+      if (frameSize > client->bufSize) {
+        unsigned char *buf = (unsigned char*)realloc(client->commandBuf, frameSize);
+        if (!buf) {
+          perror("Failed to allocate memory for binary request frame");
+          return -1;
+        }
+        client->commandBuf = buf;
+        client->bufSize = frameSize;
+      }
+      continue;
+    }
+    
+    // We have a full frame.
+    client->numBytes = 0;
+    if (handleBinaryFrame(target, client->commandBuf, frameSize, clientID, client) < 0) {
+      return -1;
+    }
+    
+  }
+  
+  return consumed;
+}
+
+/**
+ * Receive handler for the debug server. Parses commands in either the text or
+ * the binary protocol and passes them to the backend.
+ */
+int protocol_handleData(tcpServer_t *server, int clientID) {
+  debugTarget_t *target = (debugTarget_t*)server->data;
+  debugClient_t *client;
+  unsigned char buf[TCP_BUFFER_SIZE];
+  int size, ptr, count;
+  
+  // Get the pointer to the client state.
+  client = tcpServer_getExtraData(server, clientID);
+  if (!client) {
+    return 0;
+  }
+  
+  // Handle all data which is available.
+  while ((size = tcpServer_receiveBuf(server, clientID, buf, sizeof(buf))) > 0) {
+    ptr = 0;
+    while ((ptr < size) && !stopRequested) {
+      if (client->binary) {
+        count = handleBinaryData(target, buf + ptr, size - ptr, clientID, client);
+      } else {
+        count = handleTextData(target, buf + ptr, size - ptr, clientID, client);
+      }
+      if (count < 0) {
+        return -1;
+      }
+      ptr += count;
+    }
+    
+    // Once a stop has been requested, ignore the rest.
+    if (stopRequested) {
+      return 0;
+    }
+  }
+  
+  return 0;
+}
@@ -0,0 +1,295 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+#include <stdint.h>
+
+#include "tcpserv.h"
+#include "rvex_iface.h"
+#include "stats.h"
+
+/**
+ * Maximum number of bytes which can be read or written with a single text
+ * protocol command or batch entry. Binary Read and Write requests may be as
+ * large as the maximum transfer size of the backend, which is at least this
+ * much.
+ */
+#define MAX_TRANSFER_SIZE 4096
+
+/**
+ * Maximum size of a debug command. Set to 8k plus a little extra so a write
+ * command can write a full 4kbyte page at once.
+ */
+#define MAX_DEBUG_COMMAND_SIZE 8448
+
+/**
+ * Maximum number of writes which rvsrv keeps in flight for a Fill command on
+ * a backend which cannot fill memory by itself.
+ */
+#define PROTOCOL_FILL_WINDOW 4
+
+/**
+ * Maximum number of reads which rvsrv keeps in flight for a Checksum command.
+ */
+#define PROTOCOL_CHECKSUM_WINDOW 4
+
+/**
+ * Read and write requests larger than this many bytes are counted as bulk
+ * transfers in the statistics.
+ */
+#define PROTOCOL_BULK_SIZE 64
+
+/**
+ * Kinds of requests for which latency statistics are kept.
+ */
+#define PROTOCOL_STATS_READ       0
+#define PROTOCOL_STATS_WRITE      1
+#define PROTOCOL_STATS_BULK_READ  2
+#define PROTOCOL_STATS_BULK_WRITE 3
+#define PROTOCOL_STATS_BATCH      4
+#define PROTOCOL_STATS_WAIT       5
+#define PROTOCOL_NUM_STATS        6
+
+/**
+ * Request statistics, kept for every target and every client.
+ */
+typedef struct {
+  
+  /**
+   * Latency from receiving a request to sending its reply, in microseconds,
+   * for each kind of request (PROTOCOL_STATS_*).
+   */
+  statsHistogram_t latency[PROTOCOL_NUM_STATS];
+  
+  /**
+   * Number of requests which completed with a bus fault or an error.
+   */
+  uint64_t faults;
+  uint64_t errors;
+  
+} protocolStats_t;
+
+/**
+ * Protocol state shared by all clients of the debug server of a single target.
+ */
+typedef struct debugTarget {
+  
+  /**
+   * Backend which requests are passed to.
+   */
+  const rvex_iface_t *iface;
+  
+  /**
+   * Debug server for this target. Replies are sent to its clients.
+   */
+  tcpServer_t *server;
+  
+  /**
+   * Maximum number of bytes which can be read or written with a single binary
+   * request, as reported to the clients.
+   */
+  uint32_t maxTransferSize;
+  
+  /**
+   * Maximum size of a binary request frame, including the header.
+   */
+  uint32_t maxFrameSize;
+  
+  /**
+   * Request statistics for all clients, including those which have
+   * disconnected.
+   */
+  protocolStats_t stats;
+  
+  /**
+   * Called to collect the statistics sent in reply to the Stats command. If
+   * null, only the statistics of the protocol handler are sent, see
+   * protocol_stats().
+   */
+  void (*statsHandler)(void *data, statsBuffer_t *buf);
+  void *statsData;
+  
+} debugTarget_t;
+
+/**
+ * Identifies a debug request which has been passed to the backend. The
+ * backend must complete every request it accepts by calling exactly one of the
+ * protocol_reply*() functions, which formats the reply in whatever protocol
+ * the client is using and frees the request.
+ */
+typedef struct debugRequest {
+  
+  /**
+   * Target which the request was sent to.
+   */
+  struct debugTarget *target;
+  
+  /**
+   * Debug server client ID which sent the request.
+   */
+  int clientID;
+  
+  /**
+   * Connection number of the client when the request was made. Client IDs are
+   * reused, so this is used to discard replies to clients which have
+   * disconnected in the meantime.
+   */
+  uint32_t connection;
+  
+  /**
+   * Time at which the request was received, as returned by stats_now().
+   */
+  uint64_t startTime;
+  
+  /**
+   * Nonzero if the reply should be sent as a binary frame.
+   */
+  int binary;
+  
+  /**
+   * Binary protocol opcode for the request (BINPROTO_OP_*). Also used to
+   * determine the command name for text replies.
+   */
+  int opcode;
+  
+  /**
+   * Request tag, echoed back in the reply. Binary requests always have one,
+   * text commands only when prefixed with "Tag,<hex>,".
+   */
+  uint32_t tag;
+  
+  /**
+   * Nonzero if the request has a tag. Backends may complete tagged requests
+   * out of order; untagged requests from the same client must be completed
+   * in the order in which they were received.
+   */
+  int tagged;
+  
+  /**
+   * Completion handler for requests which rvsrv issued itself as part of a
+   * command, such as the entries of a Batch command or the reads of a Hash
+   * command, or null for requests which are replied to directly. The
+   * protocol_reply*() functions pass the result to this handler instead of
+   * sending a reply; the handler must free the request. address is the
+   * address of the reply (zero for errors), data and count are the data that
+   * was read (null for writes, faults and errors), and reason is the error
+   * name for errors.
+   */
+  int (*complete)(struct debugRequest *req, int status, uint32_t address, uint32_t faultCode, const unsigned char *data, uint32_t count, const char *reason);
+  
+  /**
+   * State of the command which the completion handler belongs to, and the
+   * index of the part of the command this request performs, such as the
+   * offset of its result in a batch reply or the first page it hashes.
+   */
+  void *context;
+  uint32_t index;
+  
+} debugRequest_t;
+
+/**
+ * Sets up the protocol state for a target which passes requests to the given
+ * backend. The target structure is owned by the caller; it must be passed as
+ * the data pointer of the debug server, and the server must be stored in it
+ * once it has been opened.
+ */
+int protocol_init(debugTarget_t *target, const rvex_iface_t *iface);
+
+/**
+ * Appends the statistics of the protocol handler of the given target to buf:
+ * traffic and request statistics for the target as a whole and for each
+ * connected client.
+ */
+void protocol_stats(debugTarget_t *target, statsBuffer_t *buf);
+
+/**
+ * Allocates the per-client protocol state. Should be passed to
+ * tcpServer_open() as the onAlloc callback for the debug server.
+ */
+int protocol_clientAlloc(void **extra);
+
+/**
+ * Frees the per-client protocol state. Should be passed to tcpServer_open()
+ * as the onFree callback for the debug server.
+ */
+int protocol_clientFree(void **extra);
+
+/**
+ * Receive handler for the debug server. Parses commands in either the text or
+ * the binary protocol and passes them to the backend.
+ */
+int protocol_handleData(tcpServer_t *server, int clientID);
+
+/**
+ * Returns nonzero if a client requested the server to stop.
+ */
+int protocol_stopRequested(void);
+
+/**
+ * Completes a read request with the data that was read.
+ */
+int protocol_replyRead(debugRequest_t *req, uint32_t address, uint32_t count, const unsigned char *data);
+
+/**
+ * Completes a write request successfully.
+ */
+int protocol_replyWrite(debugRequest_t *req, uint32_t address, uint32_t count);
+
+/**
+ * Completes a read or write request with a bus fault.
+ */
+int protocol_replyFault(debugRequest_t *req, uint32_t address, uint32_t count, uint32_t faultCode);
+
+/**
+ * Completes a request with an error, such as "CommunicationError".
+ */
+int protocol_replyError(debugRequest_t *req, const char *reason);
+
+#endif
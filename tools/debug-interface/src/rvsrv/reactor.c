@@ -0,0 +1,306 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "reactor.h"
+
+/**
+ * Maximum number of events handled per call to epoll_wait().
+ */
+#define REACTOR_MAX_EVENTS 64
+
+/**
+ * Registration state for a single file descriptor.
+ */
+typedef struct {
+  
+  /**
+   * Handler function, or null if the descriptor is not registered.
+   */
+  reactorHandler_t handler;
+  
+  /**
+   * User data passed to the handler.
+   */
+  void *data;
+  
+  /**
+   * Incremented every time the descriptor is (re)registered. This is stored
+   * in the epoll event data along with the descriptor, so events which were
+   * already returned by epoll_wait() for a descriptor that has since been
+   * closed and reused can be recognized and discarded.
+   */
+  uint32_t generation;
+  
+} reactorEntry_t;
+
+/**
+ * epoll instance descriptor.
+ */
+static int epollDesc = -1;
+
+/**
+ * Registration table, indexed by file descriptor. Grows as needed, so there is
+ * no FD_SETSIZE-like limit on the descriptor values we can handle.
+ */
+static reactorEntry_t *entries = 0;
+
+/**
+ * Number of elements in entries.
+ */
+static int capacity = 0;
+
+/**
+ * Converts REACTOR_* flags to epoll event flags. All descriptors are
+ * registered in edge-triggered mode.
+ */
+static uint32_t toEpollEvents(int events) {
+  uint32_t e = EPOLLET;
+  if (events & REACTOR_READ) e |= EPOLLIN | EPOLLRDHUP;
+  if (events & REACTOR_WRITE) e |= EPOLLOUT;
+  return e;
+}
+
+/**
+ * Converts epoll event flags to REACTOR_* flags.
+ */
+static int fromEpollEvents(uint32_t e) {
+  int events = 0;
+  if (e & EPOLLIN) events |= REACTOR_READ;
+  if (e & EPOLLOUT) events |= REACTOR_WRITE;
+  if (e & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) events |= REACTOR_HANGUP | REACTOR_READ;
+  return events;
+}
+
+/**
+ * Makes sure the registration table can hold descriptor f.
+ */
+static int ensureCapacity(int f) {
+  int newCapacity;
+  reactorEntry_t *newEntries;
+  
+  if (f < capacity) {
+    return 0;
+  }
+  
+  // Double the capacity until f fits.
+  newCapacity = capacity ? capacity : 64;
+  while (newCapacity <= f) {
+    newCapacity *= 2;
+  }
+  newEntries = (reactorEntry_t*)realloc((void*)entries, sizeof(reactorEntry_t) * newCapacity);
+  if (!newEntries) {
+    perror("Failed to allocate memory for the reactor");
+    return -1;
+  }
+  memset((void*)(newEntries + capacity), 0, sizeof(reactorEntry_t) * (newCapacity - capacity));
+  entries = newEntries;
+  capacity = newCapacity;
+  
+  return 0;
+}
+
+/**
+ * Initializes the internal state of the reactor.
+ */
+int reactor_init(void) {
+  
+  // Create the epoll instance.
+  epollDesc = epoll_create1(EPOLL_CLOEXEC);
+  if (epollDesc < 0) {
+    perror("Failed to create epoll instance");
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Frees all resources used by the reactor. Descriptors that are still
+ * registered are not closed.
+ */
+void reactor_free(void) {
+  
+  if (epollDesc >= 0) {
+    close(epollDesc);
+    epollDesc = -1;
+  }
+  free(entries);
+  entries = 0;
+  capacity = 0;
+  
+}
+
+/**
+ * Registers a file descriptor with the reactor. events should be a
+ * combination of REACTOR_READ and REACTOR_WRITE. handler is called with data
+ * when the descriptor becomes ready.
+ */
+int reactor_register(int f, int events, reactorHandler_t handler, void *data) {
+  struct epoll_event ev;
+  
+  if ((f < 0) || !handler) {
+    return -1;
+  }
+  if (ensureCapacity(f) < 0) {
+    return -1;
+  }
+  
+  // Update the registration table.
+  entries[f].handler = handler;
+  entries[f].data = data;
+  entries[f].generation++;
+  
+  // Add the descriptor to the epoll set.
+  memset((void*)&ev, 0, sizeof(ev));
+  ev.events = toEpollEvents(events);
+  ev.data.u64 = ((uint64_t)entries[f].generation << 32) | (uint32_t)f;
+  if (epoll_ctl(epollDesc, EPOLL_CTL_ADD, f, &ev) < 0) {
+    perror("Failed to register file descriptor with epoll");
+    entries[f].handler = 0;
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Changes the set of events the given descriptor is monitored for.
+ */
+int reactor_modify(int f, int events) {
+  struct epoll_event ev;
+  
+  if ((f < 0) || (f >= capacity) || !entries[f].handler) {
+    return -1;
+  }
+  
+  memset((void*)&ev, 0, sizeof(ev));
+  ev.events = toEpollEvents(events);
+  ev.data.u64 = ((uint64_t)entries[f].generation << 32) | (uint32_t)f;
+  if (epoll_ctl(epollDesc, EPOLL_CTL_MOD, f, &ev) < 0) {
+    perror("Failed to modify epoll registration");
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Unregisters a file descriptor. This is safe to call from within a handler,
+ * also for descriptors other than the one being handled; pending events for
+ * an unregistered descriptor are discarded.
+ */
+int reactor_unregister(int f) {
+  
+  if ((f < 0) || (f >= capacity) || !entries[f].handler) {
+    return 0;
+  }
+  
+  // Clearing the handler is enough to discard events which epoll_wait() has
+  // already returned to us. Bumping the generation makes sure they are also
+  // discarded if the descriptor is reused in the meantime.
+  entries[f].handler = 0;
+  entries[f].data = 0;
+  entries[f].generation++;
+  
+  // Remove the descriptor from the epoll set. This fails harmlessly if the
+  // descriptor has already been closed.
+  epoll_ctl(epollDesc, EPOLL_CTL_DEL, f, 0);
+  
+  return 0;
+}
+
+/**
+ * Waits for registered descriptors to become ready and calls their handlers.
+ * When quick is nonzero, this only handles the descriptors which are ready
+ * right now and returns immediately. Otherwise it blocks until at least one
+ * descriptor is ready or a signal is received. Returns -1 if a handler or
+ * epoll itself failed, or the number of handled events otherwise.
+ */
+int reactor_wait(int quick) {
+  struct epoll_event events[REACTOR_MAX_EVENTS];
+  int numReady;
+  int i;
+  
+  // Wait for events. Interruption by a signal is not an error, we just
+  // return to the main loop so it can check what happened.
+  numReady = epoll_wait(epollDesc, events, REACTOR_MAX_EVENTS, quick ? 0 : -1);
+  if (numReady < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    perror("Call to epoll_wait failed");
+    return -1;
+  }
+  
+  // Dispatch the events to their handlers.
+  for (i = 0; i < numReady; i++) {
+    int f = (int)(uint32_t)events[i].data.u64;
+    uint32_t generation = (uint32_t)(events[i].data.u64 >> 32);
+    
+    // Skip events for descriptors which were unregistered by an earlier
+    // handler in this batch.
+    if ((f >= capacity) || !entries[f].handler || (entries[f].generation != generation)) {
+      continue;
+    }
+    
+    if (entries[f].handler(f, fromEpollEvents(events[i].events), entries[f].data) < 0) {
+      return -1;
+    }
+    
+  }
+  
+  return numReady;
+}
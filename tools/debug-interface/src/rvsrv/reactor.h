@@ -0,0 +1,118 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _REACTOR_H_
+#define _REACTOR_H_
+
+/**
+ * Event flags passed to reactor_register() and reactor_modify() and to the
+ * handler functions.
+ */
+#define REACTOR_READ  0x01
+#define REACTOR_WRITE 0x02
+
+/**
+ * Additional event flag passed to handlers when the other side hung up or the
+ * descriptor is in an error state. Handlers normally respond to this by
+ * attempting a read, which will then report the actual condition.
+ */
+#define REACTOR_HANGUP 0x04
+
+/**
+ * Event handler function. Called from reactor_wait() with the file descriptor
+ * which became ready, the REACTOR_* flags describing why, and the data pointer
+ * passed to reactor_register(). Should return -1 if an error occured or 0 if
+ * everything is OK.
+ *
+ * The reactor is edge-triggered: a handler is only called again for a
+ * descriptor after new data arrives or new buffer space becomes available, so
+ * handlers need to read or write until the operation would block, or remember
+ * that the descriptor is still ready.
+ */
+typedef int (*reactorHandler_t)(int f, int events, void *data);
+
+/**
+ * Initializes the internal state of the reactor.
+ */
+int reactor_init(void);
+
+/**
+ * Frees all resources used by the reactor. Descriptors that are still
+ * registered are not closed.
+ */
+void reactor_free(void);
+
+/**
+ * Registers a file descriptor with the reactor. events should be a
+ * combination of REACTOR_READ and REACTOR_WRITE. handler is called with data
+ * when the descriptor becomes ready.
+ */
+int reactor_register(int f, int events, reactorHandler_t handler, void *data);
+
+/**
+ * Changes the set of events the given descriptor is monitored for.
+ */
+int reactor_modify(int f, int events);
+
+/**
+ * Unregisters a file descriptor. This is safe to call from within a handler,
+ * also for descriptors other than the one being handled; pending events for
+ * an unregistered descriptor are discarded.
+ */
+int reactor_unregister(int f);
+
+/**
+ * Waits for registered descriptors to become ready and calls their handlers.
+ * When quick is nonzero, this only handles the descriptors which are ready
+ * right now and returns immediately. Otherwise it blocks until at least one
+ * descriptor is ready or a signal is received. Returns -1 if a handler or
+ * epoll itself failed, or the number of handled events otherwise.
+ */
+int reactor_wait(int quick);
+
+#endif
@@ -47,110 +47,88 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <errno.h>
-#include <string.h>
-#include <sys/select.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/uio.h>
 
-#include "select.h"
+#include "recorder.h"
+#include "binaryProtocol.h"
 
 /**
- * Contains the set of file descriptors currently registered.
+ * Size of a record header.
  */
-static fd_set registeredDescriptors;
+#define RECORD_HEADER_SIZE 12
 
 /**
- * Highest numbered file descriptor currently registered. For some reason
- * select() needs to know this.
+ * Opens the given recording file for appending. Returns the file descriptor
+ * for the recording, or -1 if something goes wrong.
  */
-static int maxRegisteredDescriptor;
-
-/**
- * Contains the set of file descriptors currently ready for reads.
- */
-static fd_set readyDescriptors;
-
-/**
- * Initializes the internal state of the select unit.
- */
-int select_init(void) {
-  
-  // Make sure the set of file descriptors is empty to begin with.
-  FD_ZERO(&registeredDescriptors);
-  maxRegisteredDescriptor = 0;
-  
-  return 0;
-}
-
-/**
- * Registers a file descriptor to be waited on by select_wait().
- */
-int select_register(int f) {
-  
-  // Add the descriptor to the set.
-  FD_SET(f, &registeredDescriptors);
+int recorder_open(const char *path) {
+  int recordDesc;
   
-  // Update the maximum value if necessary.
-  if (f > maxRegisteredDescriptor) {
-    maxRegisteredDescriptor = f;
+  recordDesc = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (recordDesc < 0) {
+    perror("Failed to open application stream recording");
+    return -1;
   }
   
-  return 0;
-}
-
-/**
- * Unregisters a file descriptor from the set used by select_wait().
- */
-int select_unregister(int f) {
-  
-  // Remove the descriptor from the set.
-  FD_CLR(f, &registeredDescriptors);
-  
-  return 0;
+  printf("Recording application stream to %s.\n", path);
+  return recordDesc;
 }
 
 /**
- * Makes the actual call to select. When quick is nonzero, the timeout is set
- * to 1 ms, which is useful for when operations are in progress and we want to
- * check for timeouts. When quick is 0, select_wait blocks until any of the
- * monitored streams are ready.
+ * Appends a record containing size bytes from data to the recording, if
+ * recording is enabled, i.e. *recordDesc is not negative.
  */
-int select_wait(int quick) {
-  struct timeval timeout;
-  struct timeval *ptimeout;
-  int numReady;
+void recorder_write(int *recordDesc, const unsigned char *data, int size) {
+  unsigned char header[RECORD_HEADER_SIZE];
+  struct iovec iov[2];
+  struct timeval tv;
+  uint64_t usec;
+  ssize_t count;
   
-  // Configure the timeout such that select returns after at most a ms if quick
-  // is set.
-  if (quick) {
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 10000;
-    ptimeout = &timeout;
-  } else {
-    ptimeout = 0;
+  if ((*recordDesc < 0) || (size <= 0)) {
+    return;
   }
   
-  // Copy the set of monitored descriptors into the set of ready descriptors
-  // so select() can freely modify it accordingly without breaking things.
-  readyDescriptors = registeredDescriptors;
+  // Construct the header.
+  gettimeofday(&tv, 0);
+  usec = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+  binProto_putU32(header + 0, usec >> 32);
+  binProto_putU32(header + 4, usec);
+  binProto_putU32(header + 8, size);
+  
+  // Write the header and the data in one go, so records are never
+  // interleaved with anything else appending to the file.
+  iov[0].iov_base = header;
+  iov[0].iov_len = RECORD_HEADER_SIZE;
+  iov[1].iov_base = (void*)data;
+  iov[1].iov_len = size;
+  do {
+    count = writev(*recordDesc, iov, 2);
+  } while ((count < 0) && (errno == EINTR));
   
-  // Call select.
-  while ((numReady = select(maxRegisteredDescriptor + 1, &readyDescriptors, 0, 0, ptimeout)) < 0) {
-    if (errno == EINTR) {
-      continue;
+  if (count != RECORD_HEADER_SIZE + size) {
+    if (count < 0) {
+      perror("Failed to write application stream recording");
+    } else {
+      printf("Failed to write application stream recording: short write\n");
     }
-    perror("Call to select failed");
-    return -1;
+    printf("Recording stopped.\n");
+    recorder_close(recordDesc);
   }
   
-  return numReady;
 }
 
 /**
- * Returns whether the given file descriptor is ready for read access in this
- * iteration.
+ * Closes the recording file and sets the descriptor to -1.
  */
-int select_isReady(int f) {
-  
-  return FD_ISSET(f, &readyDescriptors);
-  
+void recorder_close(int *recordDesc) {
+  if (*recordDesc >= 0) {
+    close(*recordDesc);
+    *recordDesc = -1;
+  }
 }
@@ -46,67 +46,39 @@
  * Copyright (C) 2008-2016 by TU Delft.
  */
 
-#ifndef _SREC_H_
-#define _SREC_H_
-
-#include "types.h"
-
-/**
- * Initializes an srec reader state object. If this returns null, an error
- * occured (which will have been printed). When the file has been read,
- * srecReadFree() must be called on the returned pointer, if non-null.
- */
-void *srecReadInit(void);
-
-/**
- * Reads from an srec file. state should be set to the pointer returned by
- * srecReadInit(). f is the file descriptor to read from, buffer is the buffer
- * to read to, and count is the maximum amount of characters to read. address
- * specifies the address corresponding to the start of the buffer in srec
- * address space; if this does not match the current address in the srec, no
- * bytes will be read and 0 is returned. When the end of the file has been
- * reached, 0 is returned as well. If an error occurs, -1 is returned and an
- * error is printed. Otherwise, this returns the number of bytes written to
- * the buffer.
- */
-int srecRead(void *state, int f, unsigned char *buffer, int count, uint32_t address);
-
-/**
- * Returns the number of bytes read from the file (as in, ASCII bytes, not the
- * data bytes described by the file) since the last call to this function. Can
- * be used for progress indication.
- */
-int srecReadProgressDelta(void *state);
-
-/**
- * Returns nonzero of the end of the file has been reached.
- */
-int srecReadEof(void *state);
-
-/**
- * Returns the expected address needed for the next read operation to succeed.
- */
-uint32_t srecReadExpectedAddress(void *state);
+#ifndef _RECORDER_H_
+#define _RECORDER_H_
 
 /**
- * Frees the state data structure allocated by srecReadInit().
+ * The recorder appends everything the application sends over the UART to a
+ * file, for later analysis. The file consists of records with the following
+ * format, with all integers big-endian:
+ *
+ *   8 bytes: time at which the data was received, in microseconds since the
+ *            epoch.
+ *   4 bytes: number of data bytes which follow.
+ *   n bytes: application data.
+ *
+ * pyrvd/apprecord.py can be used to print or extract recordings.
  */
-void srecReadFree(void *state);
 
 /**
- * Writes an srec file header.
+ * Opens the given recording file for appending. Returns the file descriptor
+ * for the recording, or -1 if something goes wrong.
  */
-int srecWriteHeader(int f);
+int recorder_open(const char *path);
 
 /**
- * Writes the given buffer, starting at the given address, to an srec output
- * file.
+ * Appends a record containing size bytes from data to the recording, if
+ * recording is enabled, i.e. *recordDesc is not negative. The data is written
+ * directly from the given buffer. Errors are reported and stop the recording,
+ * but are not fatal.
  */
-int srecWrite(int f, unsigned char *buffer, int count, uint32_t address);
+void recorder_write(int *recordDesc, const unsigned char *data, int size);
 
 /**
- * Writes an srec file footer.
+ * Closes the recording file and sets the descriptor to -1.
  */
-int srecWriteFooter(int f);
+void recorder_close(int *recordDesc);
 
 #endif
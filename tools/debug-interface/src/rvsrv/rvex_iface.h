@@ -51,25 +51,86 @@
 
 #include <stdint.h>
 
+#include "stats.h"
+
+struct debugRequest;
+
 typedef struct rvex_iface {
   /**
-   * Tries to handle a Read or Write command.
+   * Backend instance, passed as the first argument to all the functions
+   * below. rvsrv can serve multiple targets at once, so backends must keep
+   * their state here instead of in module statics.
+   */
+  void *data;
+
+  /**
+   * Tries to handle a Read or Write command. The backend takes ownership of
+   * req and must complete it by calling exactly one of the protocol_reply*()
+   * functions, either immediately or from a later update() call. The write
+   * buffer is only valid until write returns. Returns -1 if a fatal error
+   * occured, or 0 otherwise.
+   */
+  int (*read)(void *data, struct debugRequest *req, uint32_t address, uint32_t buf_size);
+  int (*write)(void *data, struct debugRequest *req, uint32_t address,
+      unsigned char *buffer, uint32_t buf_size);
+
+  /**
+   * Optional. Tries to handle a Fill command: sets buf_size bytes starting at
+   * address to the repeating 32-bit pattern, such that the byte at address a
+   * is byte (a & 3) of the big-endian pattern. buf_size is not limited to
+   * maxTransferSize. The request is completed like a write. If null, rvsrv
+   * performs fills as a series of writes. Returns -1 if a fatal error
+   * occured, or 0 otherwise.
+   */
+  int (*fill)(void *data, struct debugRequest *req, uint32_t address,
+      uint32_t pattern, uint32_t buf_size);
+
+  /**
+   * Optional. Starts the threads the backend needs. Called once after rvsrv
+   * has forked into daemon mode, because threads do not survive fork(), and
+   * before any requests are passed to the backend. Returns -1 if an error
+   * occured, or 0 otherwise.
+   */
+  int (*start)(void *data);
+
+  /**
+   * Updates the backend. Called by the main loop after every wakeup of the
+   * reactor. Returns -1 if an error occured, 0 if the backend is waiting for
+   * something the reactor will wake us up for (data or a timer registered with
+   * timeout_open()), or 1 if update should be called again without blocking.
+   */
+  int (*update)(void *data);
+
+  /**
+   * Frees all dynamically allocated memory by the interface, including the
+   * instance itself.
+   */
+  void (*free)(void *data);
+
+  /**
+   * Optional. Returns the file descriptor of a file which can be mapped to
+   * access the target memory directly, the offset within that file which
+   * corresponds to address 0 and the number of accessible bytes. Used to give
+   * local clients direct access. Returns -1 if an error occured, or 0
+   * otherwise.
    */
-  int (*read)(uint32_t address, uint32_t buf_size, int clientID);
-  int (*write)(uint32_t address, unsigned char *buffer, uint32_t buf_size,
-      int clientID);
+  int (*share)(void *data, int *fd, unsigned long *offset, unsigned long *length);
 
   /**
-   * Updates the backend. Returns -1 if an error occured, 0 if the system is
-   * idle, or 1 if we want update to be called quickly again to handle potential
-   * timeouts.
+   * Optional. Appends backend specific statistics, such as queue depths and
+   * link error counters, to buf using stats_put(). Names should be prefixed
+   * with the name of the backend.
    */
-  int (*update)(void);
+  void (*stats)(void *data, statsBuffer_t *buf);
 
   /**
-   * Frees all dynamically allocated memory by the interface.
+   * Maximum number of bytes which the backend can read or write with a single
+   * request. This is reported to binary protocol clients, so they can
+   * transfer large blocks of memory with fewer requests. Zero is interpreted
+   * as MAX_TRANSFER_SIZE. Larger values are rounded down to a power of two and
+   * limited to BINPROTO_MAX_TRANSFER_SIZE.
    */
-  void (*free)(void);
+  uint32_t maxTransferSize;
 } rvex_iface_t;
 
 #endif
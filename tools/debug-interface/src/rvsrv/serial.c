@@ -47,6 +47,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -54,9 +56,29 @@
 #include <unistd.h>
 
 #include "serial.h"
-#include "select.h"
+#include "baudrate.h"
+#include "reactor.h"
 
-#define SERIAL_BUFFER_SIZE 256
+/**
+ * Size of the application stream ring buffers and of the raw receive buffer.
+ */
+#define SERIAL_BUFFER_SIZE 4096
+
+/**
+ * Size of the raw transmit buffer. Everything which is encoded during a flush
+ * is collected here and written to the port at once, unless it runs full.
+ */
+#define SERIAL_TX_BUFFER_SIZE 16384
+
+/**
+ * Maximum size of a debug packet. The hardware has the same constraint.
+ */
+#define SERIAL_MAX_PACKET_SIZE 32
+
+/**
+ * Number of debug packets which can be buffered in each direction.
+ */
+#define SERIAL_PACKET_QUEUE_SIZE 64
 
 // When this is defined, any characters sent or received on the raw,
 // application or debug stream are logged to stdout/the log file.
@@ -70,11 +92,19 @@
 #define CHAR_ESCAPE    0xFC
 
 /**
- * Defines the state of a ring buffer of size SERIAL_BUFFER_SIZE.
+ * Returns nonzero if the given byte is one of the control characters, and thus
+ * needs to be escaped when it is sent as data.
+ */
+static inline int isControl(unsigned char b) {
+  return (b >= CHAR_ESCAPE) && (b != 0xFF);
+}
+
+/**
+ * Defines the state of a byte ring buffer of size SERIAL_BUFFER_SIZE.
  */
 typedef struct {
   
-  short data[SERIAL_BUFFER_SIZE];
+  unsigned char data[SERIAL_BUFFER_SIZE];
   int readPtr;
   int writePtr;
   int count;
@@ -96,45 +126,79 @@ static int ringBufEmpty(ringBuffer_t *buf) {
 }
 
 /**
- * Pushes a short into the ring buffer, if it is not full.
+ * Pushes up to size bytes into the ring buffer, as many as fit. Returns the
+ * number of bytes pushed.
  */
-static int ringBufPush(ringBuffer_t *buf, int data) {
+static int ringBufWrite(ringBuffer_t *buf, const unsigned char *data, int size) {
+  int count, total;
   
-  // Return -1 if buffer is full.
-  if (ringBufFull(buf)) {
-    return -1;
+  if (size > SERIAL_BUFFER_SIZE - buf->count) {
+    size = SERIAL_BUFFER_SIZE - buf->count;
   }
+  total = size;
   
-  // Push a short.
-  buf->data[buf->writePtr++] = data;
-  if (buf->writePtr >= SERIAL_BUFFER_SIZE) {
-    buf->writePtr = 0;
+  // Copy in at most two parts, because the free space may wrap around.
+  while (size) {
+    count = SERIAL_BUFFER_SIZE - buf->writePtr;
+    if (count > size) {
+      count = size;
+    }
+    memcpy(buf->data + buf->writePtr, data, count);
+    buf->writePtr += count;
+    if (buf->writePtr >= SERIAL_BUFFER_SIZE) {
+      buf->writePtr = 0;
+    }
+    data += count;
+    size -= count;
   }
-  buf->count++;
+  buf->count += total;
   
-  return 0;
+  return total;
 }
 
 /**
- * Pops a short from the ring buffer and returns it, or returns -1 if the
- * buffer is empty.
+ * Returns a pointer to the oldest bytes in the ring buffer and sets *size to
+ * the number of bytes which can be read from there without wrapping around.
+ * Use ringBufSkip() to remove them from the buffer afterwards.
  */
-static int ringBufPop(ringBuffer_t *buf) {
-  short retval;
-  
-  // Return -1 if buffer is empty.
-  if (ringBufEmpty(buf)) {
-    return -1;
+static const unsigned char *ringBufPeek(ringBuffer_t *buf, int *size) {
+  *size = SERIAL_BUFFER_SIZE - buf->readPtr;
+  if (*size > buf->count) {
+    *size = buf->count;
   }
+  return buf->data + buf->readPtr;
+}
+
+/**
+ * Removes size bytes from the ring buffer. size must not be larger than the
+ * number of bytes in the buffer.
+ */
+static void ringBufSkip(ringBuffer_t *buf, int size) {
+  buf->readPtr = (buf->readPtr + size) % SERIAL_BUFFER_SIZE;
+  buf->count -= size;
+}
+
+/**
+ * Pops up to size bytes from the ring buffer into data. Returns the number of
+ * bytes popped.
+ */
+static int ringBufRead(ringBuffer_t *buf, unsigned char *data, int size) {
+  const unsigned char *ptr;
+  int count, total = 0;
   
-  // Pop a short.
-  retval = buf->data[buf->readPtr++];
-  if (buf->readPtr >= SERIAL_BUFFER_SIZE) {
-    buf->readPtr = 0;
+  while (size && !ringBufEmpty(buf)) {
+    ptr = ringBufPeek(buf, &count);
+    if (count > size) {
+      count = size;
+    }
+    memcpy(data, ptr, count);
+    ringBufSkip(buf, count);
+    data += count;
+    size -= count;
+    total += count;
   }
-  buf->count--;
   
-  return retval;
+  return total;
 }
 
 /**
@@ -147,42 +211,276 @@ static void ringBufReset(ringBuffer_t *buf) {
 }
 
 /**
- * Receive and transmit buffers for the application data bytestream. This only
- * contains byte values (0-255).
+ * A debug packet.
+ */
+typedef struct {
+  
+  /**
+   * Packet contents.
+   */
+  unsigned char data[SERIAL_MAX_PACKET_SIZE];
+  
+  /**
+   * Number of bytes in the packet.
+   */
+  int len;
+  
+  /**
+   * Only used for transmission: the number of characters which must be sent
+   * before the next packet completes.
+   */
+  int delay;
+  
+} serialPacket_t;
+
+/**
+ * Defines the state of a packet queue of size SERIAL_PACKET_QUEUE_SIZE.
+ */
+typedef struct {
+  
+  serialPacket_t packets[SERIAL_PACKET_QUEUE_SIZE];
+  int readPtr;
+  int writePtr;
+  int count;
+  
+} packetQueue_t;
+
+/**
+ * Returns the packet at the head of the queue, or null if the queue is empty.
+ */
+static serialPacket_t *packetQueueHead(packetQueue_t *queue) {
+  if (!queue->count) {
+    return 0;
+  }
+  return &queue->packets[queue->readPtr];
+}
+
+/**
+ * Returns the packet slot at the tail of the queue, or null if the queue is
+ * full. packetQueuePush() must be called after filling in the slot.
+ */
+static serialPacket_t *packetQueueTail(packetQueue_t *queue) {
+  if (queue->count >= SERIAL_PACKET_QUEUE_SIZE) {
+    return 0;
+  }
+  return &queue->packets[queue->writePtr];
+}
+
+/**
+ * Adds the packet returned by packetQueueTail() to the queue.
+ */
+static void packetQueuePush(packetQueue_t *queue) {
+  queue->writePtr = (queue->writePtr + 1) % SERIAL_PACKET_QUEUE_SIZE;
+  queue->count++;
+}
+
+/**
+ * Removes the packet at the head of the queue.
+ */
+static void packetQueuePop(packetQueue_t *queue) {
+  queue->readPtr = (queue->readPtr + 1) % SERIAL_PACKET_QUEUE_SIZE;
+  queue->count--;
+}
+
+/**
+ * Resets/initializes a packet queue.
+ */
+static void packetQueueReset(packetQueue_t *queue) {
+  queue->readPtr = 0;
+  queue->writePtr = 0;
+  queue->count = 0;
+}
+
+/**
+ * State of a serial port. The buffers persist while the port is closed, so
+ * the debug command layer can keep referring to the port while we try to
+ * reopen it.
+ */
+struct serial {
+  
+  /**
+   * File descriptor for the port, or -1 if it is not open.
+   */
+  int fd;
+  
+  /**
+   * Receive and transmit buffers for the application data bytestream.
+   */
+  ringBuffer_t appRxBuf;
+  ringBuffer_t appTxBuf;
+  
+  /**
+   * Receive and transmit queues for debug packets.
+   */
+  packetQueue_t debugRxQueue;
+  packetQueue_t debugTxQueue;
+  
+  /**
+   * Raw transmit buffer, containing encoded data which has not been written
+   * to the port yet.
+   */
+  unsigned char txBuf[SERIAL_TX_BUFFER_SIZE];
+  int txSize;
+  int txPtr;
+  
+  /**
+   * Set while txBuf holds data which the port did not accept yet. The port
+   * is then registered for write events as well, so the reactor wakes us up
+   * to continue writing when the UART has drained.
+   */
+  int writeBlocked;
+  
+  /**
+   * Set by the reactor when the serial port has data available, cleared by
+   * serial_update() when a read would block. Because the reactor is
+   * edge-triggered we need to remember this ourselves while our raw receive
+   * buffer is full.
+   */
+  int readable;
+  
+  /**
+   * Raw receive buffer. This is used in the raw read() call, after which all
+   * data is routed into the application buffer and the debug packet queue.
+   * It may take more than one call to update to clear this buffer if either
+   * of those is full.
+   */
+  unsigned char rxBuf[SERIAL_BUFFER_SIZE];
+  int rxBufSize;
+  int rxBufPtr;
+  
+  /**
+   * Stream which is selected in the receive and transmit direction: 0 for
+   * the application stream, 1 for the debug stream.
+   */
+  int rxStream;
+  int txStream;
+  
+  /**
+   * When nonzero, the next received byte should be one's complemented
+   * because an escape character was received.
+   */
+  int escaping;
+  
+  /**
+   * Debug packet which is being received. Packets which are too long are
+   * dropped.
+   */
+  serialPacket_t rxPacket;
+  
+  /**
+   * Set when the packet at the head of the debug transmit queue is ready to
+   * be sent, i.e. its size has been subtracted from txDelay.
+   */
+  int packetReady;
+  
+  /**
+   * At least this many characters need to be sent before the next debug
+   * packet can begin. Note that this is all rather approximate; we can't
+   * trivially predict how much we're going to send and it doesn't need to be
+   * exact.
+   */
+  int txDelay;
+  
+};
+
+/**
+ * Reactor handler for the serial port.
+ */
+static int onSerialReady(int f, int events, void *data) {
+  
+  // Write events need no handling here; serial_flush() is called after every
+  // reactor wakeup and continues the write.
+  if (events & (REACTOR_READ | REACTOR_HANGUP)) {
+    ((serial_t*)data)->readable = 1;
+  }
+  return 0;
+}
+
+/**
+ * Returns the termios speed constant for the given baud rate, or B0 if there
+ * is none.
  */
-static ringBuffer_t appRxBuf;
-static ringBuffer_t appTxBuf;
+static speed_t getSpeed(int baud) {
+  switch (baud) {
+    case 50:      return B50;
+    case 75:      return B75;
+    case 110:     return B110;
+    case 134:     return B134;
+    case 150:     return B150;
+    case 200:     return B200;
+    case 300:     return B300;
+    case 600:     return B600;
+    case 1200:    return B1200;
+    case 1800:    return B1800;
+    case 2400:    return B2400;
+    case 4800:    return B4800;
+    case 9600:    return B9600;
+    case 19200:   return B19200;
+    case 38400:   return B38400;
+    case 57600:   return B57600;
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+  }
+  return B0;
+}
 
 /**
- * Receive and transmit buffers for debug data. Aside from 0-255 for normal
- * data bytes, values greater than 255 are used to delimit packets. The
- * receiving stream only inserts 256. For the transmitting stream, values
- * greater than 256 request that at least [value]-256 characters be sent before
- * the next debug packet completes, to give the expected hardware time to
- * finish transmitting the expected reply before it attempts to queue the next
- * reply (which would result in a dropped packet).
+ * Allocates the state for a serial port, which is initially closed. Returns
+ * null if no memory could be allocated.
  */
-static ringBuffer_t debugRxBuf;
-static ringBuffer_t debugTxBuf;
+serial_t *serial_alloc(void) {
+  serial_t *port;
+  
+  port = (serial_t*)malloc(sizeof(serial_t));
+  if (!port) {
+    perror("Failed to allocate serial port buffers");
+    return 0;
+  }
+  memset((void*)port, 0, sizeof(serial_t));
+  port->fd = -1;
+  
+  return port;
+}
 
 /**
  * Opens a serial port. Negative return values indicate failure, with errno set
  * to identify the last error. Positive return values are a file descriptor for
- * the open port. The port is opened in blocking mode.
+ * the open port. The port is opened in nonblocking mode and is registered
+ * with the reactor. Writes never block; whatever the port does not accept is
+ * written by serial_flush() when the reactor reports the port writable.
  */
-int serial_open(const char *name, const int baud) {
+int serial_open(serial_t *port, const char *name, const int baud) {
   int f;
   struct termios cfg;
   speed_t speed;
   
-  // Before anything else, initialize the ring buffers.
-  ringBufReset(&appRxBuf);
-  ringBufReset(&appTxBuf);
-  ringBufReset(&debugRxBuf);
-  ringBufReset(&debugTxBuf);
+  // Before anything else, initialize the buffers.
+  ringBufReset(&port->appRxBuf);
+  ringBufReset(&port->appTxBuf);
+  packetQueueReset(&port->debugRxQueue);
+  packetQueueReset(&port->debugTxQueue);
+  port->txSize = 0;
+  port->txPtr = 0;
+  port->writeBlocked = 0;
+  port->readable = 0;
+  port->rxBufSize = 0;
+  port->rxBufPtr = 0;
+  port->rxStream = 0;
+  port->txStream = 0;
+  port->escaping = 0;
+  port->rxPacket.len = 0;
+  port->packetReady = 0;
+  port->txDelay = 0;
+  
+  // Check the baud rate.
+  if (baud < 1) {
+    printf("Error while setting baud rate: invalid baud rate\n");
+    return -1;
+  }
   
   // Try to open the port.
-  f = open(name, O_RDWR | O_NOCTTY);
+  f = open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
   
   // If the result was negative, we couldn't open it.
   if (f < 0) {
@@ -201,34 +499,10 @@ int serial_open(const char *name, const int baud) {
   // Make sure we're in raw mode.
   cfmakeraw(&cfg);
   
-  // Set the speed.
-  switch (baud) {
-    case 50:      speed = B50;      break;
-    case 75:      speed = B75;      break;
-    case 110:     speed = B110;     break;
-    case 134:     speed = B134;     break;
-    case 150:     speed = B150;     break;
-    case 200:     speed = B200;     break;
-    case 300:     speed = B300;     break;
-    case 600:     speed = B600;     break;
-    case 1200:    speed = B1200;    break;
-    case 1800:    speed = B1800;    break;
-    case 2400:    speed = B2400;    break;
-    case 4800:    speed = B4800;    break;
-    case 9600:    speed = B9600;    break;
-    case 19200:   speed = B19200;   break;
-    case 38400:   speed = B38400;   break;
-    case 57600:   speed = B57600;   break;
-    case 115200:  speed = B115200;  break;
-    case 230400:  speed = B230400;  break;
-    case 460800:  speed = B460800;  break;
-    
-    default:
-      printf("Error while setting baud rate: invalid baud rate\n");
-      return -1;
-      
-  }
-  if (cfsetispeed(&cfg, speed) || cfsetospeed(&cfg, speed)) {
+  // Set the speed. Rates which don't have a termios constant are set
+  // separately after committing the rest of the configuration.
+  speed = getSpeed(baud);
+  if (cfsetispeed(&cfg, (speed != B0) ? speed : B38400) || cfsetospeed(&cfg, (speed != B0) ? speed : B38400)) {
     perror("Error while setting baud rate (cfset*speed)");
     close(f);
     return -1;
@@ -240,13 +514,22 @@ int serial_open(const char *name, const int baud) {
     close(f);
     return -1;
   }
+  if ((speed == B0) && (baudrate_setCustom(f, baud) < 0)) {
+    perror("Error while setting baud rate (custom rate)");
+    close(f);
+    return -1;
+  }
   
-  // Register with select_wait().
-  if (select_register(f) < 0) {
+  // Register with the reactor. The port may already have data available, so
+  // assume it is readable to begin with.
+  if (reactor_register(f, REACTOR_READ, &onSerialReady, port) < 0) {
     close(f);
     return -1;
   }
   
+  port->readable = 1;
+  port->fd = f;
+  
   // Return the file descriptor.
   printf("Successfully opened serial port %s with baud rate %d.\n", name, baud);
   return f;
@@ -254,448 +537,550 @@ int serial_open(const char *name, const int baud) {
 }
 
 /**
- * Closes a previously opened serial port.
+ * Closes a previously opened serial port. The buffers are kept until
+ * serial_free() is called.
  */
-void serial_close(int *f) {
+void serial_close(serial_t *port) {
   
-  // Don't do anything if the file descriptor is negative.
-  if (*f < 0) return;
+  // Don't do anything if the port is not open.
+  if (port->fd < 0) return;
   
-  // Unregister from select_wait().
-  select_unregister(*f);
+  // Unregister from the reactor.
+  reactor_unregister(port->fd);
+  port->readable = 0;
   
   // Attempt to close the file.
-  close(*f);
+  close(port->fd);
   
   // Set the descriptor to -1 now that we've at least tried to close it.
-  *f = -1;
+  port->fd = -1;
   
 }
 
 /**
- * Updates the serial port after a call to select_wait(). Reads data from the
- * port into our buffer.
+ * Returns nonzero if the serial port is open.
  */
-int serial_update(int f) {
+int serial_isOpen(const serial_t *port) {
+  return port->fd >= 0;
+}
 
-  // Raw receive buffer. This is used in the raw read() call, after which all
-  // data is pushed into the app and debug receive buffers. It may take more
-  // than one call to update to clear this buffer if appRxBuf or debugRxBuf
-  // are full.
-  static unsigned char buf[SERIAL_BUFFER_SIZE];
-  static int bufSize = 0;
-  static int bufPtr = 0;
-  
-  // Set to 0 when the application stream is selected, set to 1 when the debug
-  // stream is selected.
-  static int stream = 0;
-  
-  // When nonzero, the next byte should be one's complemented because an escape
-  // character was received.
-  static int escaping = 0;
-  
-  // This is set when the last character written to the debug stream was the
-  // special delimiter character (256).
-  static int debugPacketTerminated = 1;
-  
-  // If the raw buffer is ready for new data and data is available, pull new
-  // data into it.
-  if ((select_isReady(f)) && (bufPtr >= bufSize)) {
-    
-    // Reset the (fully drained) buffer.
-    bufPtr = 0;
-    
-    // Read into the buffer.
-    bufSize = read(f, (void*)buf, SERIAL_BUFFER_SIZE);
-    if (bufSize < 0) {
-      perror("Failed to read from serial port");
-      return -1;
-    } else if (bufSize == 0) {
-      printf("Failed to read from serial port: reached end of file\n");
-      return -1;
-    }
-    
-    // Unregister from select_wait() while the buffer is full.
-    select_unregister(f);
-  
-  }
+/**
+ * Closes the serial port if it is still open and frees its state.
+ */
+void serial_free(serial_t **port) {
+  if (!*port) return;
+  serial_close(*port);
+  free(*port);
+  *port = 0;
+}
+
+/**
+ * Updates the serial port after a call to reactor_wait(). Reads data from the
+ * port into our buffer and routes it into the application and debug streams.
+ * Returns -1 if the connection was lost, 0 if all available data has been
+ * routed, or 1 if data is still pending because the stream buffers are full,
+ * in which case this should be called again soon.
+ */
+int serial_update(serial_t *port) {
   
-  // Route raw data into the application and debug bytestreams if possible.
-  for (; bufPtr < bufSize; bufPtr++) {
-    short b = buf[bufPtr];
+  // Keep reading for as long as data is available and we can route it.
+  while (1) {
     
-#ifdef DEBUG_UART
-    printf("rx %02hhX\n", b);
-#endif
-    
-    // Stop if either destination buffer is full.
-    if (ringBufFull(&appRxBuf) || ringBufFull(&debugRxBuf)) {
-      break;
-    }
-    
-    if (b == CHAR_SEL_APP) {
-      
-      // Switch to application stream.
-      if (!debugPacketTerminated) {
-        ringBufPush(&debugRxBuf, 256);
-        debugPacketTerminated = 1;
-      }
-      stream = 0;
-      continue;
+    // If the raw buffer is ready for new data and data is available, pull new
+    // data into it.
+    if (port->readable && (port->rxBufPtr >= port->rxBufSize)) {
       
-    } else if (b == CHAR_SEL_DEBUG) {
+      // Reset the (fully drained) buffer.
+      port->rxBufPtr = 0;
       
-      // Switch to debug stream.
-      if (!debugPacketTerminated) {
-        ringBufPush(&debugRxBuf, 256);
-        debugPacketTerminated = 1;
+      // Read into the buffer.
+      port->rxBufSize = read(port->fd, (void*)port->rxBuf, SERIAL_BUFFER_SIZE);
+      if (port->rxBufSize < 0) {
+        port->rxBufSize = 0;
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+          
+          // Drained; wait for the reactor to tell us there is more.
+          port->readable = 0;
+          return 0;
+          
+        }
+        perror("Failed to read from serial port");
+        return -1;
+      } else if (port->rxBufSize == 0) {
+        printf("Failed to read from serial port: reached end of file\n");
+        return -1;
       }
-      stream = 1;
-      continue;
-      
-    } else if (b == CHAR_ESCAPE) {
       
-      // Set escaping flag and continue.
-      escaping = 1;
-      continue;
+#ifdef DEBUG_UART
+      {
+        int i;
+        for (i = 0; i < port->rxBufSize; i++) {
+          printf("rx %02hhX\n", port->rxBuf[i]);
+        }
+      }
+#endif
       
     }
-    if (escaping) {
+    
+    // Route raw data into the application and debug streams if possible.
+    while (port->rxBufPtr < port->rxBufSize) {
+      unsigned char b = port->rxBuf[port->rxBufPtr];
       
-      // Handle the escape flag.
-      escaping = 0;
-      b = (~b) & 0xFF;
+      if ((b == CHAR_SEL_APP) || (b == CHAR_SEL_DEBUG)) {
+        
+        // Switching streams terminates the debug packet being received.
+        if (port->rxPacket.len) {
+          if (port->rxPacket.len <= SERIAL_MAX_PACKET_SIZE) {
+            serialPacket_t *p = packetQueueTail(&port->debugRxQueue);
+            if (!p) {
+              break;
+            }
+            memcpy(p->data, port->rxPacket.data, port->rxPacket.len);
+            p->len = port->rxPacket.len;
+            packetQueuePush(&port->debugRxQueue);
+          }
+          port->rxPacket.len = 0;
+        }
+        port->rxStream = (b == CHAR_SEL_DEBUG);
+        port->rxBufPtr++;
+        
+      } else if (b == CHAR_ESCAPE) {
+        
+        // Set escaping flag and continue.
+        port->escaping = 1;
+        port->rxBufPtr++;
+        
+      } else if (port->rxStream == 0) {
+        int end = port->rxBufPtr + 1;
+        
+        // Push into the application stream. Unless we need to unescape the
+        // first byte, push everything up to the next control character at
+        // once.
+        if (port->escaping) {
+          b = ~b;
+          if (!ringBufWrite(&port->appRxBuf, &b, 1)) {
+            break;
+          }
+          port->escaping = 0;
+        } else {
+          while ((end < port->rxBufSize) && !isControl(port->rxBuf[end])) {
+            end++;
+          }
+          end = port->rxBufPtr + ringBufWrite(&port->appRxBuf, port->rxBuf + port->rxBufPtr, end - port->rxBufPtr);
+          if (end == port->rxBufPtr) {
+            break;
+          }
+        }
+        port->rxBufPtr = end;
+        
+      } else {
+        
+        // Append to the debug packet.
+        if (port->escaping) {
+          b = ~b;
+          port->escaping = 0;
+        }
+        if (port->rxPacket.len < SERIAL_MAX_PACKET_SIZE) {
+          port->rxPacket.data[port->rxPacket.len] = b;
+        }
+        if (port->rxPacket.len <= SERIAL_MAX_PACKET_SIZE) {
+          port->rxPacket.len++;
+        }
+        port->rxBufPtr++;
+        
+      }
       
     }
-    if (stream == 0) {
-      
-      // Push into the application stream.
-      ringBufPush(&appRxBuf, b);
-      
-    } else {
-      
-      // Push into the debug stream.
-      ringBufPush(&debugRxBuf, b);
-      debugPacketTerminated = 0;
-      
+    
+    // If the stream buffers filled up, report that we still have data pending.
+    if (port->rxBufPtr < port->rxBufSize) {
+      return 1;
+    }
+    
+    // Nothing left to do if we already know there is no more data.
+    if (!port->readable) {
+      return 0;
     }
     
   }
   
-  // Re-register with select_wait() if the buffer has been cleared.
-  if (bufPtr >= bufSize) {
-    select_register(f);
+}
+
+/**
+ * Registers the serial port for write events with the reactor while the raw
+ * transmit buffer holds data which the port did not accept yet, and
+ * unregisters it again once everything has been written.
+ */
+static int setWriteBlocked(serial_t *port, int blocked) {
+  if (port->writeBlocked == blocked) {
+    return 0;
   }
-  
+  if (reactor_modify(port->fd, blocked ? (REACTOR_READ | REACTOR_WRITE) : REACTOR_READ) < 0) {
+    perror("Could not update serial port events");
+    return -1;
+  }
+  port->writeBlocked = blocked;
   return 0;
-  
 }
 
 /**
- * Writes a byte to the serial port, buffering it as long as there's room.
+ * Writes as much of the raw transmit buffer to the serial port as it accepts
+ * without blocking. Whatever the port does not take is kept at the start of
+ * the buffer, and the reactor is told to wake us up when the port becomes
+ * writable, so serial_flush() can continue from there.
  */
-static int bufferedWriteRaw(int f, int data) {
-  
-  // Raw transmit buffer.
-  static unsigned char buf[SERIAL_BUFFER_SIZE];
-  static int bufSize = 0;
+static int writeRaw(serial_t *port) {
   
-  // See if we need to flush before we can append the byte or if a flush has
-  // been explicitely requested.
-  if ((bufSize >= SERIAL_BUFFER_SIZE) || (data < 0)) {
-    int idx = 0;
-    while (idx < bufSize) {
-      int amount;
-      
-      // Write to the serial port.
-      amount = write(f, buf + idx, bufSize - idx);
-      if (amount < 0) {
-        perror("Could not write to serial port");
-        return -1;
+  while (port->txPtr < port->txSize) {
+    int amount;
+    
+    // Write to the serial port.
+    amount = write(port->fd, port->txBuf + port->txPtr, port->txSize - port->txPtr);
+    if (amount < 0) {
+      if (errno == EINTR) {
+        continue;
       }
-      
-      idx += amount;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        break;
+      }
+      perror("Could not write to serial port");
+      return -1;
     }
-    bufSize = 0;
-  }
-  
-  // Append the byte to the buffer.
-  if (data >= 0) {
+    
 #ifdef DEBUG_UART
-    printf("tx %02hhX\n", data);
+    {
+      int i;
+      for (i = 0; i < amount; i++) {
+        printf("tx %02hhX\n", port->txBuf[port->txPtr + i]);
+      }
+    }
 #endif
-    buf[bufSize++] = data;
+    
+    port->txPtr += amount;
   }
   
-  return 0;
+  // Move the unwritten tail to the start of the buffer.
+  port->txSize -= port->txPtr;
+  if (port->txSize) {
+    memmove(port->txBuf, port->txBuf + port->txPtr, port->txSize);
+  }
+  port->txPtr = 0;
+  
+  return setWriteBlocked(port, port->txSize > 0);
 }
 
 /**
- * Writes a data byte to the serial port, escaping it if needed.
+ * Makes sure there is room for at least size bytes in the raw transmit
+ * buffer, writing its contents to the serial port if there is not. Returns 1
+ * if there is room, 0 if the port can't take more data right now, or -1 if
+ * an error occured.
  */
-static int bufferedWriteData(int f, int data) {
-  
-  data &= 0xFF;
-  
-  // Send escape character and one's complement byte if needed.
-  if ((data == CHAR_SEL_APP) || (data == CHAR_SEL_DEBUG) || (data == CHAR_ESCAPE)) {
-    if (bufferedWriteRaw(f, CHAR_ESCAPE) < 0) {
+static int reserveRaw(serial_t *port, int size) {
+  if (port->txSize + size > SERIAL_TX_BUFFER_SIZE) {
+    if (writeRaw(port) < 0) {
       return -1;
     }
-    data = (~data) & 0xFF;
   }
+  return port->txSize + size <= SERIAL_TX_BUFFER_SIZE;
+}
+
+/**
+ * Appends a control character to the raw transmit buffer. Room must have been
+ * reserved using reserveRaw().
+ */
+static void bufferedWriteRaw(serial_t *port, unsigned char data) {
+  port->txBuf[port->txSize++] = data;
+}
+
+/**
+ * Appends data bytes to the raw transmit buffer, escaping them where needed.
+ * Runs of bytes which don't need to be escaped are copied at once. Room for
+ * twice the size must have been reserved using reserveRaw(), as worst case
+ * every byte needs to be escaped.
+ */
+static void bufferedWriteData(serial_t *port, const unsigned char *data, int size) {
+  int run;
   
-  // Send the data byte.
-  if (bufferedWriteRaw(f, data) < 0) {
-    return -1;
+  while (size) {
+    
+    // Copy everything up to the next control character.
+    for (run = 0; (run < size) && !isControl(data[run]); run++);
+    memcpy(port->txBuf + port->txSize, data, run);
+    port->txSize += run;
+    data += run;
+    size -= run;
+    
+    // Send escape character and one's complement byte if needed.
+    if (size) {
+      port->txBuf[port->txSize++] = CHAR_ESCAPE;
+      port->txBuf[port->txSize++] = ~*data;
+      data++;
+      size--;
+    }
+    
   }
   
-  return 0;
 }
 
 /**
- * Writes all pending data in the transmit buffers to the serial port.
+ * Writes pending data in the transmit buffers to the serial port, as far as
+ * the port accepts it without blocking. Whatever remains is written when the
+ * reactor reports that the port has drained.
  */
-int serial_flush(int f) {
-  
-  // We can hardcode the packet buffer size to 32 because the hardware has the
-  // same constraint.
-  static unsigned char packetBuf[32];
-  static int packetBufSize = 0;
-  static int packetBufDelay = 0;
-  static int packetReady = 0;
+int serial_flush(serial_t *port) {
+  int retval;
   
-  // At least this many characters need to be sent before the next debug packet
-  // can begin. Note that this is all rather approximate; we can't trivially
-  // predict how much we're going to send and it doesn't need to be exact.
-  static int delay = 0;
-  
-  // Set to 0 when the application stream is selected, set to 1 when the debug
-  // stream is selected.
-  static int stream = 0;
+  // Continue writing whatever did not fit in the port last time.
+  if (writeRaw(port) < 0) {
+    return -1;
+  }
   
-  while (!ringBufEmpty(&appTxBuf) || !ringBufEmpty(&debugTxBuf)) {
+  while (!ringBufEmpty(&port->appTxBuf) || packetQueueHead(&port->debugTxQueue)) {
+    serialPacket_t *packet = packetQueueHead(&port->debugTxQueue);
     
-    // Read into the packet buffer.
-    while (!ringBufEmpty(&debugTxBuf) && !packetReady) {
-      
-      int d = ringBufPop(&debugTxBuf);
-      
-      if (d < 256) {
-        
-        // Append byte to packet buffer.
-        if (packetBufSize < 32) {
-          packetBuf[packetBufSize] = d;
-        }
-        packetBufSize++;
-        
-      } else {
-        if (packetBufSize <= 32) {
-          
-          // Queue packet.
-          packetBufDelay = d - 256;
-          packetReady = 1;
-          
-          // Sending the packet will take at least as many characters as the
-          // unescaped packet payload, plus one for the start-packet marker,
-          // so we can subtract this from the delay.
-          delay -= packetBufSize + 1;
-          if (delay < 0) delay = 0;
-          
-        } else {
-          
-          // Discard packet, because it's too long. This shouldn't happen.
-          printf("Error: tried to send a packet which is too large for the hardware to handle, dropped it.\n");
-          packetBufSize = 0;
-          
-        }
-      }
-      
+    // Sending the packet will take at least as many characters as the
+    // unescaped packet payload, plus one for the start-packet marker, so we
+    // can subtract this from the delay.
+    if (packet && !port->packetReady) {
+      port->packetReady = 1;
+      port->txDelay -= packet->len + 1;
+      if (port->txDelay < 0) port->txDelay = 0;
     }
     
     // Send application bytes either as padding or because no more debug
     // packets are available.
-    while (!ringBufEmpty(&appTxBuf) && (delay || !packetReady)) {
-    
+    while (!ringBufEmpty(&port->appTxBuf) && (port->txDelay || !port->packetReady)) {
+      const unsigned char *data;
+      int count, room;
+      
+      // Make sure there is room for a stream switch and at least one escaped
+      // byte. If there is not, stop here until the port has drained.
+      retval = reserveRaw(port, 3);
+      if (retval <= 0) {
+        return retval;
+      }
+      
       // First switch to the application stream if necessary.
-      if (stream != 0) {
-        if (bufferedWriteRaw(f, CHAR_SEL_APP) < 0) {
-          return -1;
-        }
-        stream = 0;
+      if (port->txStream != 0) {
+        bufferedWriteRaw(port, CHAR_SEL_APP);
+        port->txStream = 0;
         
         // We've sent a byte, so subtract 1 from the delay.
-        delay--;
-        if (delay < 0) delay = 0;
+        port->txDelay--;
+        if (port->txDelay < 0) port->txDelay = 0;
       }
       
-      // Send a byte.
-      if (bufferedWriteData(f, ringBufPop(&appTxBuf)) < 0) {
-        return -1;
+      // Send as many bytes as we can. If a packet is waiting, only send
+      // enough to cover the delay.
+      data = ringBufPeek(&port->appTxBuf, &count);
+      if (port->packetReady && (count > port->txDelay)) {
+        count = port->txDelay;
+      }
+      room = (SERIAL_TX_BUFFER_SIZE - port->txSize) / 2;
+      if (count > room) {
+        count = room;
+      }
+      if (count) {
+        bufferedWriteData(port, data, count);
+        ringBufSkip(&port->appTxBuf, count);
       }
       
-      // We've sent a byte, so subtract 1 from the delay.
-      delay--;
-      if (delay < 0) delay = 0;
+      // We've sent count bytes, so subtract that from the delay.
+      port->txDelay -= count;
+      if (port->txDelay < 0) port->txDelay = 0;
       
     }
     
     // Send the queued packet.
-    if (packetReady) {
-      int i;
+    if (port->packetReady) {
       
       // If we still need to delay at this point, our only option is to send
       // pad bytes. We can do that with the select-application-stream control
       // characters, because they're no-op when not followed 
-      while (packetReady && delay) {
+      while (port->txDelay) {
         
-        if (bufferedWriteRaw(f, CHAR_SEL_APP) < 0) {
-          return -1;
+        retval = reserveRaw(port, 1);
+        if (retval <= 0) {
+          return retval;
         }
-        stream = 0;
-        delay--;
-        if (delay < 0) delay = 0;
+        bufferedWriteRaw(port, CHAR_SEL_APP);
+        port->txStream = 0;
+        port->txDelay--;
         
       }
       
+      // The packet is encoded in one go, so reserve room for the start
+      // marker, the escaped payload and the stream switch after it.
+      retval = reserveRaw(port, packet->len * 2 + 2);
+      if (retval <= 0) {
+        return retval;
+      }
+      
       // Send the packet start marker.
-      if (stream != 1) {
-        if (bufferedWriteRaw(f, CHAR_SEL_DEBUG) < 0) {
-          return -1;
-        }
-        stream = 1;
+      if (port->txStream != 1) {
+        bufferedWriteRaw(port, CHAR_SEL_DEBUG);
+        port->txStream = 1;
       }
       
       // Send the packet.
-      for (i = 0; i < packetBufSize; i++) {
-        
-        if (bufferedWriteData(f, packetBuf[i]) < 0) {
-          return -1;
-        }
-        
-      }
+      bufferedWriteData(port, packet->data, packet->len);
       
-      // Set the delay and clear the packet queued marker.
-      delay = packetBufDelay;
-      packetReady = 0;
-      packetBufSize = 0;
+      // Set the delay and remove the packet from the queue.
+      port->txDelay = packet->delay;
+      port->packetReady = 0;
+      packetQueuePop(&port->debugTxQueue);
       
-      // If there are more bytes in the debug buffer, assume that we're going
-      // to be sending another debug packet soon. Otherwise, switch to the
-      // application stream (we need to do something here so the hardware knows
-      // that a complete packet has been received).
-      if (!ringBufEmpty(&debugTxBuf)) {
-        if (bufferedWriteRaw(f, CHAR_SEL_DEBUG) < 0) {
-          return -1;
-        }
-        stream = 1;
+      // If there are more debug packets, assume that we're going to be sending
+      // another one soon. Otherwise, switch to the application stream (we need
+      // to do something here so the hardware knows that a complete packet has
+      // been received).
+      if (packetQueueHead(&port->debugTxQueue)) {
+        bufferedWriteRaw(port, CHAR_SEL_DEBUG);
+        port->txStream = 1;
       } else {
-        if (bufferedWriteRaw(f, CHAR_SEL_APP) < 0) {
-          return -1;
-        }
-        stream = 0;
+        bufferedWriteRaw(port, CHAR_SEL_APP);
+        port->txStream = 0;
       }
-      delay--;
-      if (delay < 0) delay = 0;
+      port->txDelay--;
+      if (port->txDelay < 0) port->txDelay = 0;
       
     }
     
   }
   
-  // Flush the transmit buffer.
-  bufferedWriteRaw(f, -1);
-  
-  return 0;
+  // Write everything we encoded to the port.
+  return writeRaw(port);
   
 }
 
 /**
- * Returns a byte from the application receive FIFO, or -1 if the FIFO is empty.
+ * Pops up to size bytes from the application receive FIFO into buf. Returns
+ * the number of bytes popped, which is 0 if the FIFO is empty.
  */
-int serial_appReceive(int f) {
-  int data;
-  
-  // Return -1 if the buffer is empty.
-  if (ringBufEmpty(&appRxBuf)) {
-    return -1;
-  }
-  
-  // Return the popped byte.
-  data = ringBufPop(&appRxBuf);
-  data &= 0xFF;
+int serial_appReceive(serial_t *port, unsigned char *buf, int size) {
+  int count = ringBufRead(&port->appRxBuf, buf, size);
 #ifdef DEBUG_UART
-  printf("rxa %02hhX\n", data);
+  {
+    int i;
+    for (i = 0; i < count; i++) {
+      printf("rxa %02hhX\n", buf[i]);
+    }
+  }
 #endif
-  return data;
-  
+  return count;
 }
 
 /**
- * Pushes a byte onto the application transmit buffer.
+ * Returns how many bytes serial_appSend() can accept right now, flushing the
+ * buffers to the serial port first if the application transmit buffer is
+ * full. Returns 0 if the port can't keep up, or -1 if an error occured.
  */
-int serial_appSend(int f, int data) {
-  
-#ifdef DEBUG_UART
-  printf("txa %02hhX\n", data);
-#endif
-  
-  // Flush if the buffer is full.
-  if (ringBufFull(&appTxBuf)) {
-    if (serial_flush(f) < 0) {
+int serial_appRoom(serial_t *port) {
+  if (ringBufFull(&port->appTxBuf)) {
+    if (serial_flush(port) < 0) {
       return -1;
     }
   }
+  return SERIAL_BUFFER_SIZE - port->appTxBuf.count;
+}
+
+/**
+ * Pushes up to size bytes from buf onto the application transmit buffer.
+ * Returns the number of bytes pushed, which is less than size if the buffer
+ * runs full; use serial_appRoom() to find out how much fits.
+ */
+int serial_appSend(serial_t *port, const unsigned char *buf, int size) {
+  int count = ringBufWrite(&port->appTxBuf, buf, size);
   
-  // Push the byte into the buffer.
-  ringBufPush(&appTxBuf, data & 0xFF);
+#ifdef DEBUG_UART
+  {
+    int i;
+    for (i = 0; i < count; i++) {
+      printf("txa %02hhX\n", buf[i]);
+    }
+  }
+#endif
   
-  return 0;
+  return count;
 }
 
 /**
- * Returns a byte from the debug receive FIFO, or -1 if the FIFO is empty. 256
- * is returned as a packet delimiter.
+ * Pops a packet from the debug receive queue into buf, which must have room
+ * for at least 32 bytes. Returns the size of the packet, or -1 if the queue
+ * is empty.
  */
-int serial_debugReceive(int f) {
-  int data;
+int serial_debugReceive(serial_t *port, unsigned char *buf) {
+  serialPacket_t *packet = packetQueueHead(&port->debugRxQueue);
+  int len;
   
-  // Return -1 if the buffer is empty.
-  if (ringBufEmpty(&debugRxBuf)) {
+  // Return -1 if the queue is empty.
+  if (!packet) {
     return -1;
   }
   
-  // Return the popped byte.
-  data = ringBufPop(&debugRxBuf);
+  // Return the popped packet.
+  len = packet->len;
+  memcpy(buf, packet->data, len);
+  packetQueuePop(&port->debugRxQueue);
 #ifdef DEBUG_UART
-  printf("rxd %02hhX\n", data);
+  {
+    int i;
+    printf("rxd");
+    for (i = 0; i < len; i++) {
+      printf(" %02hhX", buf[i]);
+    }
+    printf("\n");
+  }
 #endif
-  return data;
+  return len;
   
 }
 
 /**
- * Pushes a byte onto the debug transmit buffer when data lies between 0 and
- * 255, or pushes a packet delimiter when data is greater than or equal to
- * 256. In the latter case, the serial unit will ensure that at least
- * data-256 bytes are sent before the next packet completes, to give the
- * hardware time to send the reply.
+ * Pushes a packet of at most 32 bytes onto the debug transmit queue. The
+ * serial unit will ensure that at least delay bytes are sent after this packet
+ * before the next packet completes, to give the hardware time to send the
+ * reply. If the queue is still full after flushing, because the port is not
+ * open or can't keep up, the packet is dropped; the debug link retransmits
+ * requests which are not answered.
  */
-int serial_debugSend(int f, int data) {
+int serial_debugSend(serial_t *port, const unsigned char *buf, int size, int delay) {
+  serialPacket_t *packet;
   
 #ifdef DEBUG_UART
-  printf("txd %02hhX\n", data);
+  {
+    int i;
+    printf("txd");
+    for (i = 0; i < size; i++) {
+      printf(" %02hhX", buf[i]);
+    }
+    printf("\n");
+  }
 #endif
   
-  // Flush if the buffer is full.
-  if (ringBufFull(&debugTxBuf)) {
-    if (serial_flush(f) < 0) {
+  // Make sure the packet fits. This shouldn't happen.
+  if ((size < 1) || (size > SERIAL_MAX_PACKET_SIZE)) {
+    printf("Error: tried to send a packet which is too large for the hardware to handle, dropped it.\n");
+    return 0;
+  }
+  
+  // Flush if the queue is full.
+  packet = packetQueueTail(&port->debugTxQueue);
+  if (!packet && (port->fd >= 0)) {
+    if (serial_flush(port) < 0) {
       return -1;
     }
+    packet = packetQueueTail(&port->debugTxQueue);
+  }
+  if (!packet) {
+    return 0;
   }
   
-  // Push the byte into the buffer.
-  ringBufPush(&debugTxBuf, data);
+  // Push the packet into the queue.
+  memcpy(packet->data, buf, size);
+  packet->len = size;
+  packet->delay = delay;
+  packetQueuePush(&port->debugTxQueue);
   
   return 0;
 }
-
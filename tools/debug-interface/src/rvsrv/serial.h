@@ -49,52 +49,94 @@
 #ifndef _SERIAL_H_
 #define _SERIAL_H_
 
+/**
+ * State of a serial port, including the application and debug stream
+ * buffers.
+ */
+typedef struct serial serial_t;
+
+/**
+ * Allocates the state for a serial port, which is initially closed. Returns
+ * null if no memory could be allocated.
+ */
+serial_t *serial_alloc(void);
+
 /**
  * Opens a serial port. Negative return values indicate failure as specified
  * by the documentation for open(), positive return values are a file
- * descriptor for the open port. The port is opened in blocking mode.
+ * descriptor for the open port. The port is opened in nonblocking mode and is
+ * registered with the reactor. Baud rates without a termios constant are set
+ * using baudrate_setCustom().
+ */
+int serial_open(serial_t *port, const char *name, const int baud);
+
+/**
+ * Closes a previously opened serial port. The buffers are kept until
+ * serial_free() is called.
+ */
+void serial_close(serial_t *port);
+
+/**
+ * Returns nonzero if the serial port is open.
+ */
+int serial_isOpen(const serial_t *port);
+
+/**
+ * Closes the serial port if it is still open and frees its state.
  */
-int serial_open(const char *name, const int baud);
+void serial_free(serial_t **port);
 
 /**
- * Closes a previously opened serial port.
+ * Updates the serial port after a call to reactor_wait(). Reads data from the
+ * port into our buffer and routes it into the application and debug streams.
+ * Returns -1 if the connection was lost, 0 if all available data has been
+ * routed, or 1 if data is still pending because the stream buffers are full,
+ * in which case this should be called again soon.
  */
-void serial_close(int *port);
+int serial_update(serial_t *port);
 
 /**
- * Updates the serial port after a call to select_wait(). Reads data from the
- * port into our buffer.
+ * Writes pending data in the transmit buffers to the serial port, as far as
+ * the port accepts it without blocking. Whatever remains is written when the
+ * reactor reports that the port has drained.
  */
-int serial_update(int f);
+int serial_flush(serial_t *port);
 
 /**
- * Writes all pending data in the transmit buffers to the serial port.
+ * Pops up to size bytes from the application receive FIFO into buf. Returns
+ * the number of bytes popped, which is 0 if the FIFO is empty.
  */
-int serial_flush(int f);
+int serial_appReceive(serial_t *port, unsigned char *buf, int size);
 
 /**
- * Returns a byte from the application receive FIFO, or -1 if the FIFO is empty.
+ * Returns how many bytes serial_appSend() can accept right now, flushing the
+ * buffers to the serial port first if the application transmit buffer is
+ * full. Returns 0 if the port can't keep up, or -1 if an error occured.
  */
-int serial_appReceive(int f);
+int serial_appRoom(serial_t *port);
 
 /**
- * Pushes a byte onto the application transmit buffer.
+ * Pushes up to size bytes from buf onto the application transmit buffer.
+ * Returns the number of bytes pushed, which is less than size if the buffer
+ * runs full; use serial_appRoom() to find out how much fits.
  */
-int serial_appSend(int f, int data);
+int serial_appSend(serial_t *port, const unsigned char *buf, int size);
 
 /**
- * Returns a byte from the debug receive FIFO, or -1 if the FIFO is empty. 256
- * is returned as a packet delimiter.
+ * Pops a packet from the debug receive queue into buf, which must have room
+ * for at least 32 bytes. Returns the size of the packet, or -1 if the queue
+ * is empty.
  */
-int serial_debugReceive(int f);
+int serial_debugReceive(serial_t *port, unsigned char *buf);
 
 /**
- * Pushes a byte onto the debug transmit buffer when data lies between 0 and
- * 255, or pushes a packet delimiter when data is greater than or equal to
- * 256. In the latter case, the serial unit will ensure that at least
- * data-256 bytes are sent before the next packet completes, to give the
- * hardware time to send the reply.
+ * Pushes a packet of at most 32 bytes onto the debug transmit queue. The
+ * serial unit will ensure that at least delay bytes are sent after this packet
+ * before the next packet completes, to give the hardware time to send the
+ * reply. If the queue is still full after flushing, because the port is not
+ * open or can't keep up, the packet is dropped; the debug link retransmits
+ * requests which are not answered.
  */
-int serial_debugSend(int f, int data);
+int serial_debugSend(serial_t *port, const unsigned char *buf, int size, int delay);
 
 #endif
@@ -0,0 +1,658 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include "sim.h"
+
+#include "../rvex_iface.h"
+#include "../protocol.h"
+#include "../timeout.h"
+#include "binaryProtocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * The image is stored as a two-level table of pages, which are allocated when
+ * they are first written. Unwritten memory reads as zero.
+ */
+#define SIM_PAGE_BITS  12
+#define SIM_PAGE_SIZE  (1 << SIM_PAGE_BITS)
+#define SIM_TABLE_BITS 10
+#define SIM_TABLE_SIZE (1 << SIM_TABLE_BITS)
+
+/**
+ * Kinds of accesses.
+ */
+#define SIM_READ  0
+#define SIM_WRITE 1
+#define SIM_FILL  2
+
+/**
+ * Maximum number of bus fault regions.
+ */
+#define SIM_MAX_FAULTS 16
+
+/**
+ * Location of the debug control registers (DCR) of the simulated contexts,
+ * see default-memory.map and core.map.
+ */
+#define SIM_CREG_CTXT    0xF0000200
+#define SIM_CTXT_STRIDE  0x400
+#define SIM_DCR_OFFSET   0x030
+#define SIM_NUM_CONTEXTS 16
+
+/**
+ * DCR flags.
+ */
+#define SIM_DCR_D 0x80000000
+#define SIM_DCR_J 0x40000000
+#define SIM_DCR_I 0x10000000
+#define SIM_DCR_E 0x08000000
+#define SIM_DCR_R 0x04000000
+#define SIM_DCR_S 0x02000000
+#define SIM_DCR_B 0x01000000
+
+/**
+ * Trap cause recorded in the DCR when a single step completes.
+ */
+#define SIM_CAUSE_STEP 0xFB
+
+/**
+ * An access waiting for the simulated bus.
+ */
+typedef struct simAccess {
+  
+  /**
+   * Next access in the queue.
+   */
+  struct simAccess *next;
+  
+  /**
+   * Request to complete.
+   */
+  debugRequest_t *req;
+  
+  /**
+   * Accessed region, and the kind of access (SIM_READ, SIM_WRITE or
+   * SIM_FILL).
+   */
+  uint32_t address;
+  uint32_t size;
+  int kind;
+  
+  /**
+   * Time at which the access completes, in microseconds.
+   */
+  uint64_t due;
+  
+  /**
+   * Data to write, or the big-endian pattern for fills. The buffer passed to
+   * write() is only valid until it returns, so it is copied here.
+   */
+  unsigned char data[];
+  
+} simAccess_t;
+
+/**
+ * State of a simulated target.
+ */
+typedef struct {
+  
+  /**
+   * Page table for the memory image.
+   */
+  unsigned char **pages[SIM_TABLE_SIZE];
+  
+  /**
+   * Debug control register state for each context. Bits 31..24 hold the
+   * flags, bits 23..16 the trap cause and bits 15..0 the breakpoint
+   * configuration.
+   */
+  uint32_t dcr[SIM_NUM_CONTEXTS];
+  
+  /**
+   * Time each access occupies the bus, in microseconds.
+   */
+  uint32_t latency;
+  
+  /**
+   * Regions in which accesses cause a bus fault.
+   */
+  uint32_t faultStart[SIM_MAX_FAULTS];
+  uint32_t faultLength[SIM_MAX_FAULTS];
+  int numFaults;
+  
+  /**
+   * Queue of accesses waiting for the bus, in order of completion.
+   */
+  simAccess_t *head;
+  simAccess_t *tail;
+  
+  /**
+   * Timer which expires when the access at the head of the queue is due.
+   */
+  timeout_t *timer;
+  
+  /**
+   * Buffer for read data, large enough for the maximum transfer size.
+   */
+  unsigned char *buffer;
+  
+} sim_t;
+
+/**
+ * Returns the current time in microseconds.
+ */
+static uint64_t sim_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Returns the page containing address, or null if it has not been written
+ * yet. If alloc is set, the page is allocated if necessary; null is then only
+ * returned if allocation fails.
+ */
+static unsigned char *sim_page(sim_t *sim, uint32_t address, int alloc) {
+  unsigned char **table;
+  uint32_t i = address >> (SIM_PAGE_BITS + SIM_TABLE_BITS);
+  uint32_t j = (address >> SIM_PAGE_BITS) & (SIM_TABLE_SIZE - 1);
+  
+  table = sim->pages[i];
+  if (!table) {
+    if (!alloc) {
+      return 0;
+    }
+    table = (unsigned char**)calloc(SIM_TABLE_SIZE, sizeof(unsigned char*));
+    if (!table) {
+      perror("sim: failed to allocate page table");
+      return 0;
+    }
+    sim->pages[i] = table;
+  }
+  if (!table[j] && alloc) {
+    table[j] = (unsigned char*)calloc(1, SIM_PAGE_SIZE);
+    if (!table[j]) {
+      perror("sim: failed to allocate page");
+    }
+  }
+  return table[j];
+}
+
+/**
+ * Returns the index of the context whose DCR contains address, or -1 if the
+ * address is not part of a DCR.
+ */
+static int sim_dcrContext(uint32_t address) {
+  uint32_t offset;
+  
+  if (address < SIM_CREG_CTXT) {
+    return -1;
+  }
+  offset = address - SIM_CREG_CTXT;
+  if ((offset / SIM_CTXT_STRIDE >= SIM_NUM_CONTEXTS)
+    || ((offset % SIM_CTXT_STRIDE) & ~3) != SIM_DCR_OFFSET
+  ) {
+    return -1;
+  }
+  return offset / SIM_CTXT_STRIDE;
+}
+
+/**
+ * Returns the value of the DCR of the given context as the hardware would
+ * report it.
+ */
+static uint32_t sim_dcrRead(sim_t *sim, int ctxt) {
+  uint32_t dcr = sim->dcr[ctxt];
+  
+  // I is the complement of E.
+  if (!(dcr & SIM_DCR_E)) {
+    dcr |= SIM_DCR_I;
+  }
+  return dcr;
+}
+
+/**
+ * Handles a write to byte index (0 being the most significant byte) of the
+ * DCR of the given context. Writing ones to the flags in the most significant
+ * byte issues commands, see config/cregs/cx02-0x220-debug.tex. The simulated
+ * contexts have no program to run, so a step completes immediately and a
+ * resumed context simply keeps running.
+ */
+static void sim_dcrWrite(sim_t *sim, int ctxt, int index, uint8_t value) {
+  uint32_t *dcr = &sim->dcr[ctxt];
+  uint32_t cmd = (uint32_t)value << 24;
+  
+  // The trap cause is read only.
+  if (index == 1) {
+    return;
+  }
+  
+  // Bits 15..0 hold the breakpoint configuration.
+  if (index > 1) {
+    *dcr &= ~(0xFFu << ((3 - index) * 8));
+    *dcr |= (uint32_t)value << ((3 - index) * 8);
+    return;
+  }
+  
+  // Context reset. This clears everything but the I, E, S and B flags,
+  // including the breakpoint configuration.
+  if (cmd & SIM_DCR_D) {
+    *dcr &= SIM_DCR_E | SIM_DCR_S | SIM_DCR_B;
+  }
+  
+  // Select internal or external debug mode.
+  if (cmd & SIM_DCR_I) {
+    *dcr &= ~SIM_DCR_E;
+  }
+  if (cmd & SIM_DCR_E) {
+    *dcr |= SIM_DCR_E;
+  }
+  
+  // Resume or step. Both clear the done flag; a step immediately traps
+  // again in external debug mode.
+  if (cmd & (SIM_DCR_R | SIM_DCR_S)) {
+    *dcr &= ~(SIM_DCR_D | SIM_DCR_B | 0x00FF0000);
+  }
+  if ((cmd & SIM_DCR_S) && (*dcr & SIM_DCR_E)) {
+    *dcr |= SIM_DCR_B | ((uint32_t)SIM_CAUSE_STEP << 16);
+  }
+  
+  // Break.
+  if (cmd & SIM_DCR_B) {
+    *dcr |= SIM_DCR_B;
+  }
+  
+}
+
+/**
+ * Returns nonzero and sets *faultAddress to the first faulting address if the
+ * given region overlaps with a fault region.
+ */
+static int sim_faults(sim_t *sim, uint32_t address, uint32_t size, uint32_t *faultAddress) {
+  uint64_t end = (uint64_t)address + size;
+  int i;
+  
+  for (i = 0; i < sim->numFaults; i++) {
+    uint64_t faultEnd = (uint64_t)sim->faultStart[i] + sim->faultLength[i];
+    if ((address < faultEnd) && (sim->faultStart[i] < end)) {
+      *faultAddress = (address > sim->faultStart[i]) ? address : sim->faultStart[i];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Performs an access and completes its request. Accesses overlapping a fault
+ * region complete with a fault, using the first faulting address as the fault
+ * code.
+ */
+static int sim_perform(sim_t *sim, debugRequest_t *req, uint32_t address, uint32_t size, int kind, const unsigned char *data) {
+  uint32_t faultAddress;
+  uint32_t i, count;
+  int ctxt;
+  
+  if ((uint64_t)address + size > 0x100000000ull) {
+    return protocol_replyError(req, "OutOfMappedRange");
+  }
+  if (sim_faults(sim, address, size, &faultAddress)) {
+    return protocol_replyFault(req, address, size, faultAddress);
+  }
+  
+  // Copy a page at a time. Only the control register region needs to be
+  // handled a byte at a time, because it contains the DCRs.
+  for (i = 0; i < size; i += count) {
+    uint32_t pos = address + i;
+    unsigned char *page;
+    count = SIM_PAGE_SIZE - (pos & (SIM_PAGE_SIZE - 1));
+    if (count > size - i) {
+      count = size - i;
+    }
+    if (pos + count > SIM_CREG_CTXT) {
+      count = 1;
+    }
+    ctxt = sim_dcrContext(pos);
+    if (kind == SIM_FILL) {
+      uint32_t j;
+      if (ctxt >= 0) {
+        sim_dcrWrite(sim, ctxt, pos & 3, data[pos & 3]);
+        continue;
+      }
+      
+      // Unwritten memory reads as zero already, so zero fills don't need to
+      // allocate pages.
+      page = sim_page(sim, pos, data[0] || data[1] || data[2] || data[3]);
+      if (!page) {
+        if (data[0] || data[1] || data[2] || data[3]) {
+          return protocol_replyError(req, "OutOfMemory");
+        }
+        continue;
+      }
+      page += pos & (SIM_PAGE_SIZE - 1);
+      for (j = 0; j < count; j++) {
+        page[j] = data[(pos + j) & 3];
+      }
+    } else if (kind == SIM_WRITE) {
+      if (ctxt >= 0) {
+        sim_dcrWrite(sim, ctxt, pos & 3, data[i]);
+        continue;
+      }
+      page = sim_page(sim, pos, 1);
+      if (!page) {
+        return protocol_replyError(req, "OutOfMemory");
+      }
+      memcpy(page + (pos & (SIM_PAGE_SIZE - 1)), data + i, count);
+    } else {
+      if (ctxt >= 0) {
+        sim->buffer[i] = sim_dcrRead(sim, ctxt) >> ((3 - (pos & 3)) * 8);
+        continue;
+      }
+      page = sim_page(sim, pos, 0);
+      if (page) {
+        memcpy(sim->buffer + i, page + (pos & (SIM_PAGE_SIZE - 1)), count);
+      } else {
+        memset(sim->buffer + i, 0, count);
+      }
+    }
+  }
+  
+  if (kind != SIM_READ) {
+    return protocol_replyWrite(req, address, size);
+  }
+  return protocol_replyRead(req, address, size, sim->buffer);
+}
+
+/**
+ * Completes all accesses which are due and arms the timer for the next one.
+ */
+static int sim_onTimer(void *data) {
+  sim_t *sim = (sim_t*)data;
+  simAccess_t *access;
+  uint64_t now = sim_now();
+  
+  while (sim->head && (sim->head->due <= now)) {
+    
+    // Take the access off the queue before completing it, because
+    // completing it may queue another.
+    access = sim->head;
+    sim->head = access->next;
+    if (!sim->head) {
+      sim->tail = 0;
+    }
+    if (sim_perform(sim, access->req, access->address, access->size, access->kind, access->data) < 0) {
+      free(access);
+      return -1;
+    }
+    free(access);
+    
+  }
+  
+  if (sim->head) {
+    return timeout_arm(sim->timer, sim->head->due - now);
+  }
+  return 0;
+}
+
+/**
+ * Queues an access. Each access occupies the simulated bus for the configured
+ * latency after the previous access has completed, so clients see both the
+ * latency and the limited throughput of a real bus. Without latency, accesses
+ * complete immediately.
+ */
+static int sim_access(sim_t *sim, debugRequest_t *req, uint32_t address, uint32_t size, int kind, const unsigned char *data) {
+  simAccess_t *access;
+  uint32_t dataSize;
+  uint64_t start;
+  
+  if (!sim->latency && !sim->head) {
+    return sim_perform(sim, req, address, size, kind, data);
+  }
+  
+  switch (kind) {
+    case SIM_WRITE: dataSize = size; break;
+    case SIM_FILL:  dataSize = 4;    break;
+    default:        dataSize = 0;    break;
+  }
+  access = (simAccess_t*)malloc(sizeof(simAccess_t) + dataSize);
+  if (!access) {
+    perror("sim: failed to allocate access");
+    protocol_replyError(req, "CommunicationError");
+    return -1;
+  }
+  access->next = 0;
+  access->req = req;
+  access->address = address;
+  access->size = size;
+  access->kind = kind;
+  if (dataSize) {
+    memcpy(access->data, data, dataSize);
+  }
+  start = sim_now();
+  if (sim->tail && (sim->tail->due > start)) {
+    start = sim->tail->due;
+  }
+  access->due = start + sim->latency;
+  
+  if (sim->tail) {
+    sim->tail->next = access;
+  } else {
+    sim->head = access;
+    if (timeout_arm(sim->timer, sim->latency) < 0) {
+      return -1;
+    }
+  }
+  sim->tail = access;
+  
+  return 0;
+}
+
+/**
+ * Tries to handle a Read command sent by a TCP client connected to
+ * the debug server.
+ */
+static int sim_read(void *data, debugRequest_t *req, uint32_t address, uint32_t buf_size) {
+  return sim_access((sim_t*)data, req, address, buf_size, SIM_READ, 0);
+}
+
+/**
+ * Tries to handle a Write command sent by a TCP client connected to
+ * the debug server.
+ */
+static int sim_write(void *data, debugRequest_t *req, uint32_t address,
+    unsigned char *buffer, uint32_t buf_size) {
+  return sim_access((sim_t*)data, req, address, buf_size, SIM_WRITE, buffer);
+}
+
+/**
+ * Tries to handle a Fill command sent by a TCP client connected to the debug
+ * server. The fill occupies the simulated bus for the same latency as any
+ * other access, regardless of its size.
+ */
+static int sim_fill(void *data, debugRequest_t *req, uint32_t address,
+    uint32_t pattern, uint32_t buf_size) {
+  unsigned char buffer[4];
+  binProto_putU32(buffer, pattern);
+  return sim_access((sim_t*)data, req, address, buf_size, SIM_FILL, buffer);
+}
+
+/**
+ * Updates the backend. Accesses are completed from the timer handler, so
+ * there is nothing to do here.
+ */
+static int sim_update(void *data) {
+  return 0;
+}
+
+/**
+ * Appends the number of queued accesses and allocated pages to buf.
+ */
+static void sim_stats(void *data, statsBuffer_t *buf) {
+  sim_t *sim = (sim_t*)data;
+  simAccess_t *access;
+  uint64_t queued = 0, pages = 0;
+  int i, j;
+  
+  for (access = sim->head; access; access = access->next) {
+    queued++;
+  }
+  for (i = 0; i < SIM_TABLE_SIZE; i++) {
+    if (sim->pages[i]) {
+      for (j = 0; j < SIM_TABLE_SIZE; j++) {
+        pages += sim->pages[i][j] != NULL;
+      }
+    }
+  }
+  stats_put(buf, "sim.", "queued", queued);
+  stats_put(buf, "sim.", "pages", pages);
+}
+
+/**
+ * Frees all dynamically allocated memory by the interface.
+ */
+static void sim_free(void *data) {
+  sim_t *sim = (sim_t*)data;
+  int i, j;
+  
+  // Drop the accesses which are still waiting.
+  while (sim->head) {
+    simAccess_t *access = sim->head;
+    sim->head = access->next;
+    free(access->req);
+    free(access);
+  }
+  timeout_close(&sim->timer);
+  
+  // Free the memory image.
+  for (i = 0; i < SIM_TABLE_SIZE; i++) {
+    if (sim->pages[i]) {
+      for (j = 0; j < SIM_TABLE_SIZE; j++) {
+        free(sim->pages[i][j]);
+      }
+      free(sim->pages[i]);
+    }
+  }
+  
+  free(sim->buffer);
+  free(sim);
+  
+}
+
+int init_sim_iface(const char *spec, rvex_iface_t *iface) {
+  sim_t *sim;
+  const char *ptr;
+  char *end;
+  
+  // Allocate the instance.
+  sim = (sim_t*)calloc(1, sizeof(sim_t));
+  if (!sim) {
+    perror("sim: failed to allocate state");
+    return -1;
+  }
+  
+  // Parse the specification.
+  sim->latency = strtoul(spec, &end, 0);
+  ptr = end;
+  while (*ptr == ':') {
+    if (sim->numFaults >= SIM_MAX_FAULTS) {
+      printf("sim: at most %d fault regions are supported\n", SIM_MAX_FAULTS);
+      sim_free(sim);
+      return -1;
+    }
+    sim->faultStart[sim->numFaults] = strtoul(ptr + 1, &end, 0);
+    if ((end == ptr + 1) || (*end != ':')) {
+      break;
+    }
+    ptr = end;
+    sim->faultLength[sim->numFaults] = strtoul(ptr + 1, &end, 0);
+    if (end == ptr + 1) {
+      break;
+    }
+    ptr = end;
+    sim->numFaults++;
+  }
+  if ((ptr == spec) || *ptr) {
+    printf("sim: specification \"%s\" is malformed\n", spec);
+    sim_free(sim);
+    return -1;
+  }
+  
+  // Set up the timer which completes queued accesses.
+  sim->timer = timeout_open(&sim_onTimer, sim);
+  if (!sim->timer) {
+    sim_free(sim);
+    return -1;
+  }
+  
+  // Allocate the read buffer.
+  sim->buffer = (unsigned char*)malloc(BINPROTO_MAX_TRANSFER_SIZE);
+  if (!sim->buffer) {
+    perror("sim: failed to allocate read buffer");
+    sim_free(sim);
+    return -1;
+  }
+  
+  printf("Simulating target with %u us access latency and %d fault region(s).\n",
+    sim->latency, sim->numFaults);
+  
+  *iface = (rvex_iface_t) {
+    .data   = sim,
+    .read   = sim_read,
+    .write  = sim_write,
+    .fill   = sim_fill,
+    .update = sim_update,
+    .free   = sim_free,
+    .stats  = sim_stats,
+    .maxTransferSize = BINPROTO_MAX_TRANSFER_SIZE,
+  };
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+/**
+ * Returns the current time in microseconds, from an arbitrary starting point.
+ */
+uint64_t stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Returns the index of the bucket for the given value.
+ */
+static int bucketIndex(uint32_t value) {
+  int msb;
+  
+  if (value < STATS_LINEAR_BUCKETS) {
+    return value;
+  }
+  msb = 31 - __builtin_clz(value);
+  return STATS_LINEAR_BUCKETS
+    + (msb - STATS_SUB_BITS - 1) * STATS_SUB_BUCKETS
+    + (value >> (msb - STATS_SUB_BITS)) - STATS_SUB_BUCKETS;
+}
+
+/**
+ * Returns the largest value which falls in the given bucket.
+ */
+static uint32_t bucketEnd(int index) {
+  int shift;
+  
+  if (index < STATS_LINEAR_BUCKETS) {
+    return index;
+  }
+  index -= STATS_LINEAR_BUCKETS;
+  shift = index / STATS_SUB_BUCKETS + 1;
+  return (((uint64_t)(STATS_SUB_BUCKETS + index % STATS_SUB_BUCKETS + 1)) << shift) - 1;
+}
+
+/**
+ * Adds a value to a histogram.
+ */
+void stats_record(statsHistogram_t *hist, uint64_t value) {
+  if (value > UINT32_MAX) {
+    value = UINT32_MAX;
+  }
+  hist->buckets[bucketIndex(value)]++;
+  hist->count++;
+  hist->sum += value;
+  if (value > hist->max) {
+    hist->max = value;
+  }
+}
+
+/**
+ * Returns the value below which the given fraction of the values in the
+ * histogram lie, rounded up to the end of its bucket.
+ */
+uint32_t stats_percentile(const statsHistogram_t *hist, double fraction) {
+  uint64_t target, seen = 0;
+  int i;
+  
+  target = (uint64_t)(fraction * hist->count + 0.999999);
+  if (target < 1) {
+    target = 1;
+  }
+  for (i = 0; i < STATS_NUM_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= target) {
+      return (bucketEnd(i) < hist->max) ? bucketEnd(i) : hist->max;
+    }
+  }
+  return hist->max;
+}
+
+/**
+ * Initializes an empty statistics buffer.
+ */
+void stats_init(statsBuffer_t *buf) {
+  buf->data = 0;
+  buf->size = 0;
+  buf->capacity = 0;
+  buf->error = 0;
+}
+
+/**
+ * Frees the memory used by a statistics buffer.
+ */
+void stats_free(statsBuffer_t *buf) {
+  free(buf->data);
+  stats_init(buf);
+}
+
+/**
+ * Appends a name=value pair to the buffer. The name is the concatenation of
+ * prefix, which may be null, and name.
+ */
+void stats_put(statsBuffer_t *buf, const char *prefix, const char *name, uint64_t value) {
+  int count;
+  
+  if (buf->error) {
+    return;
+  }
+  
+  // Make sure there is enough room for the longest possible entry.
+  count = (prefix ? strlen(prefix) : 0) + strlen(name) + 32;
+  if (buf->size + count > buf->capacity) {
+    char *data = (char*)realloc(buf->data, buf->capacity + count + 1024);
+    if (!data) {
+      perror("Failed to allocate memory for statistics");
+      buf->error = 1;
+      return;
+    }
+    buf->data = data;
+    buf->capacity += count + 1024;
+  }
+  
+  buf->size += sprintf(buf->data + buf->size, "%s%s%s=%llu",
+    buf->size ? ", " : "", prefix ? prefix : "", name, (unsigned long long)value);
+}
+
+/**
+ * Appends the count, mean, 50th, 90th, 99th and 99.9th percentiles and the
+ * maximum of the histogram, named <prefix><name>.count etc. Nothing is
+ * appended if the histogram is empty.
+ */
+void stats_putHistogram(statsBuffer_t *buf, const char *prefix, const char *name, const statsHistogram_t *hist) {
+  char fullName[64];
+  int len;
+  
+  if (!hist->count) {
+    return;
+  }
+  len = snprintf(fullName, sizeof(fullName) - 8, "%s%s.", prefix ? prefix : "", name);
+  if ((len < 0) || (len >= sizeof(fullName) - 8)) {
+    return;
+  }
+  stats_put(buf, fullName, "count", hist->count);
+  stats_put(buf, fullName, "mean", hist->sum / hist->count);
+  stats_put(buf, fullName, "p50", stats_percentile(hist, 0.5));
+  stats_put(buf, fullName, "p90", stats_percentile(hist, 0.9));
+  stats_put(buf, fullName, "p99", stats_percentile(hist, 0.99));
+  stats_put(buf, fullName, "p999", stats_percentile(hist, 0.999));
+  stats_put(buf, fullName, "max", hist->max);
+}
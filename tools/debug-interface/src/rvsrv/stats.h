@@ -0,0 +1,147 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+
+/**
+ * Latency histograms use HDR-style buckets: values below
+ * STATS_LINEAR_BUCKETS have a bucket each, and every power of two above that
+ * is split into STATS_SUB_BUCKETS buckets of equal width. This keeps the
+ * relative error below 1/STATS_SUB_BUCKETS for any value up to 2^32.
+ */
+#define STATS_SUB_BITS       3
+#define STATS_SUB_BUCKETS    (1 << STATS_SUB_BITS)
+#define STATS_LINEAR_BUCKETS (2 * STATS_SUB_BUCKETS)
+#define STATS_NUM_BUCKETS    (STATS_LINEAR_BUCKETS + (32 - STATS_SUB_BITS - 1) * STATS_SUB_BUCKETS)
+
+/**
+ * Histogram of latencies in microseconds.
+ */
+typedef struct {
+  
+  /**
+   * Number of values in each bucket.
+   */
+  uint32_t buckets[STATS_NUM_BUCKETS];
+  
+  /**
+   * Number of values, their sum and the largest value.
+   */
+  uint64_t count;
+  uint64_t sum;
+  uint32_t max;
+  
+} statsHistogram_t;
+
+/**
+ * Growable buffer in which statistics are formatted as a comma-separated list
+ * of name=value pairs, as sent in reply to the Stats command.
+ */
+typedef struct {
+  
+  /**
+   * Formatted text, which is always null-terminated unless data is null.
+   */
+  char *data;
+  
+  /**
+   * Number of characters in data and the allocated size.
+   */
+  int size;
+  int capacity;
+  
+  /**
+   * Set when a memory allocation failed. The text is then incomplete.
+   */
+  int error;
+  
+} statsBuffer_t;
+
+/**
+ * Returns the current time in microseconds, from an arbitrary starting point.
+ */
+uint64_t stats_now(void);
+
+/**
+ * Adds a value to a histogram.
+ */
+void stats_record(statsHistogram_t *hist, uint64_t value);
+
+/**
+ * Returns the value below which the given fraction of the values in the
+ * histogram lie, rounded up to the end of its bucket.
+ */
+uint32_t stats_percentile(const statsHistogram_t *hist, double fraction);
+
+/**
+ * Initializes an empty statistics buffer.
+ */
+void stats_init(statsBuffer_t *buf);
+
+/**
+ * Frees the memory used by a statistics buffer.
+ */
+void stats_free(statsBuffer_t *buf);
+
+/**
+ * Appends a name=value pair to the buffer. The name is the concatenation of
+ * prefix, which may be null, and name.
+ */
+void stats_put(statsBuffer_t *buf, const char *prefix, const char *name, uint64_t value);
+
+/**
+ * Appends the count, mean, 50th, 90th, 99th and 99.9th percentiles and the
+ * maximum of the histogram, named <prefix><name>.count etc. Nothing is
+ * appended if the histogram is empty.
+ */
+void stats_putHistogram(statsBuffer_t *buf, const char *prefix, const char *name, const statsHistogram_t *hist);
+
+#endif
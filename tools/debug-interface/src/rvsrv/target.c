@@ -0,0 +1,446 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "target.h"
+#include "recorder.h"
+
+#include "pcie/pcie.h"
+#include "mmio/mmio.h"
+#include "uart/uart.h"
+#include "sim/sim.h"
+
+/**
+ * Interval between attempts to reopen the serial port after the connection
+ * was lost, in microseconds.
+ */
+#define RECONNECT_INTERVAL_USEC 5000000
+
+/**
+ * Size of the blocks in which application data is broadcast.
+ */
+#define APP_BLOCK_SIZE 4096
+
+/**
+ * Appends the statistics of the target to buf. Installed as the Stats command
+ * handler of the debug server. data points to the target.
+ */
+static void handleStats(void *data, statsBuffer_t *buf) {
+  target_t *target = (target_t*)data;
+  
+  stats_put(buf, "", "uptime", (stats_now() - target->openTime) / 1000000);
+  stats_put(buf, "app.", "connections", target->appServer->connections);
+  stats_put(buf, "app.", "rxBytes", target->appServer->rxBytes);
+  stats_put(buf, "app.", "txBytes", target->appServer->txBytes);
+  stats_put(buf, "app.", "droppedBytes", target->appServer->droppedBytes);
+  protocol_stats(&target->debug, buf);
+  if (target->iface.stats) {
+    target->iface.stats(target->iface.data, buf);
+  }
+}
+
+/**
+ * Timer handler which prints the statistics of the target, along with the
+ * throughput of both servers since the last time, if there was any traffic.
+ * data points to the target.
+ */
+static int onStatsTimer(void *data) {
+  target_t *target = (target_t*)data;
+  uint64_t traffic[4], rate[4];
+  uint64_t now, elapsed;
+  statsBuffer_t buf;
+  int i;
+  
+  if (timeout_arm(target->statsTimer, target->common->statsInterval * 1000000) < 0) {
+    return -1;
+  }
+  
+  traffic[0] = target->appServer->rxBytes;
+  traffic[1] = target->appServer->txBytes;
+  traffic[2] = target->debug.server->rxBytes;
+  traffic[3] = target->debug.server->txBytes;
+  if (!memcmp(traffic, target->lastTraffic, sizeof(traffic))) {
+    return 0;
+  }
+  now = stats_now();
+  elapsed = now - target->lastStatsTime;
+  if (!elapsed) {
+    elapsed = 1;
+  }
+  for (i = 0; i < 4; i++) {
+    rate[i] = (traffic[i] - target->lastTraffic[i]) * 1000000 / elapsed;
+  }
+  
+  stats_init(&buf);
+  handleStats(target, &buf);
+  printf("Stats for debug port %d: app %llu/%llu bytes/s rx/tx, debug %llu/%llu bytes/s rx/tx, %s\n",
+    target->args->debugPort,
+    (unsigned long long)rate[0], (unsigned long long)rate[1],
+    (unsigned long long)rate[2], (unsigned long long)rate[3],
+    buf.data ? buf.data : "");
+  stats_free(&buf);
+  
+  memcpy(target->lastTraffic, traffic, sizeof(traffic));
+  target->lastStatsTime = now;
+  return 0;
+}
+
+/**
+ * Receive handler for the application server. Forwards data received from a
+ * client to the rvex application.
+ */
+static int handleApplicationClientData(tcpServer_t *server, int clientID) {
+  target_t *target = (target_t*)server->data;
+  unsigned char buf[4096];
+  int count;
+  
+  // Receive bytes from the client and stick them in the application serial
+  // TX buffer. If the serial port is not connected, the data is dropped.
+  while (1) {
+    int room = sizeof(buf);
+    
+    if (target->serial && serial_isOpen(target->serial)) {
+      
+      // Only pull as much as the serial port can take. If it can't keep up,
+      // leave the rest in the receive buffer; target_update() resumes the
+      // server once the port has drained.
+      room = serial_appRoom(target->serial);
+      if (room < 0) {
+        return -1;
+      } else if (room == 0) {
+        target->appStalled = 1;
+        return 0;
+      } else if (room > (int)sizeof(buf)) {
+        room = sizeof(buf);
+      }
+      
+    }
+    
+    count = tcpServer_receiveBuf(server, clientID, buf, room);
+    if (count <= 0) {
+      return 0;
+    }
+    if (target->serial && serial_isOpen(target->serial)) {
+      serial_appSend(target->serial, buf, count);
+    }
+  }
+  
+}
+
+/**
+ * Broadcasts data from the rvex application to all clients connected to the
+ * application TCP server, and records it if recording is enabled.
+ */
+static int handleApplicationData(target_t *target) {
+  tcpBlock_t *block;
+  int count;
+  
+  while (1) {
+    
+    // Pull a block of data from the application serial RX buffer.
+    block = tcpServer_allocBlock(APP_BLOCK_SIZE);
+    if (!block) {
+      return -1;
+    }
+    count = serial_appReceive(target->serial, block->data, APP_BLOCK_SIZE);
+    if (count <= 0) {
+      tcpServer_releaseBlock(block);
+      return 0;
+    }
+    
+    // Record it and hand it to all clients. The clients keep their own
+    // references to the block until they've sent it.
+    recorder_write(&target->recordDesc, block->data, count);
+    if (tcpServer_broadcastBlock(target->appServer, block, count) < 0) {
+      tcpServer_releaseBlock(block);
+      return -1;
+    }
+    tcpServer_releaseBlock(block);
+    
+  }
+  
+}
+
+/**
+ * Timer handler which tries to reopen the serial port. data points to the
+ * target.
+ */
+static int onReconnectTimer(void *data) {
+  target_t *target = (target_t*)data;
+  
+  printf("Trying to reopen serial port %s...\n", target->args->port);
+  if (serial_open(target->serial, target->args->port, target->args->baudrate) < 0) {
+    return timeout_arm(target->reconnectTimer, RECONNECT_INTERVAL_USEC);
+  }
+  
+  return 0;
+}
+
+/**
+ * Opens the serial port, backend and servers for a target. Returns -1 if
+ * something went wrong, in which case the target must still be closed with
+ * target_close(), or 0 on success.
+ */
+int target_open(target_t *target, const targetArgs_t *args, const commandLineArgs_t *common) {
+  
+  // Make sure target_close() knows what has been opened.
+  memset((void*)target, 0, sizeof(target_t));
+  target->args = args;
+  target->common = common;
+  target->recordDesc = -1;
+  target->openTime = stats_now();
+  target->lastStatsTime = target->openTime;
+  
+  // Try to open the serial port. This is only fatal when the target is
+  // connected through the UART; the other backends only use the serial port
+  // for the application stream, so we just try again later.
+  if (args->port) {
+    target->serial = serial_alloc();
+    if (!target->serial) {
+      return -1;
+    }
+    target->reconnectTimer = timeout_open(&onReconnectTimer, target);
+    if (!target->reconnectTimer) {
+      return -1;
+    }
+    if (serial_open(target->serial, args->port, args->baudrate) < 0) {
+      if (!args->pcieCdev && !args->mmioFile && !args->sim) {
+        return -1;
+      }
+      if (timeout_arm(target->reconnectTimer, RECONNECT_INTERVAL_USEC) < 0) {
+        return -1;
+      }
+    }
+  }
+  
+  // Try to initalize the rvex interface.
+  if (args->pcieCdev) {
+    if (init_pcie_iface(args->pcieCdev, &target->iface) < 0) {
+      return -1;
+    }
+  } else if (args->mmioFile) {
+    if (init_mmio_iface(args->mmioFile, args->mmioOffset, args->mmioLength, &target->iface) < 0) {
+      return -1;
+    }
+  } else if (args->sim) {
+    if (init_sim_iface(args->sim, &target->iface) < 0) {
+      return -1;
+    }
+  } else {
+    if (init_uart_iface(target->serial, &target->iface) < 0) {
+      return -1;
+    }
+  }
+  if (protocol_init(&target->debug, &target->iface) < 0) {
+    return -1;
+  }
+  
+  // Try to open the TCP servers.
+  target->appServer = tcpServer_open(
+    args->appPort,
+    "application",
+    0,
+    0,
+    &handleApplicationClientData,
+    target
+  );
+  if (!target->appServer) {
+    return -1;
+  }
+  tcpServer_setOverflow(target->appServer, common->appLag, common->appOverflow);
+  target->debug.server = tcpServer_open(
+    args->debugPort,
+    "debug",
+    &protocol_clientAlloc,
+    &protocol_clientFree,
+    &protocol_handleData,
+    &target->debug
+  );
+  if (!target->debug.server) {
+    return -1;
+  }
+  target->debug.statsHandler = &handleStats;
+  target->debug.statsData = target;
+  if (args->localPath) {
+    target->localServer = localServer_open(args->localPath, &target->iface);
+    if (!target->localServer) {
+      return -1;
+    }
+  }
+  if (args->recordPath) {
+    target->recordDesc = recorder_open(args->recordPath);
+    if (target->recordDesc < 0) {
+      return -1;
+    }
+  }
+  
+  // Start printing statistics periodically.
+  if (common->statsInterval) {
+    target->statsTimer = timeout_open(&onStatsTimer, target);
+    if (!target->statsTimer) {
+      return -1;
+    }
+    if (timeout_arm(target->statsTimer, common->statsInterval * 1000000) < 0) {
+      return -1;
+    }
+  }
+  
+  return 0;
+}
+
+/**
+ * Starts the threads of the backend of a target, if it has any. Must be
+ * called after forking into daemon mode. Returns -1 if something went wrong,
+ * or 0 on success.
+ */
+int target_start(target_t *target) {
+  
+  if (target->iface.start) {
+    return target->iface.start(target->iface.data);
+  }
+  
+  return 0;
+}
+
+/**
+ * Moves data between the serial port, the backend and the servers of the
+ * target. Should be called after every reactor_wait(). Returns -1 if an error
+ * occured, 1 if there is still work pending, or 0 otherwise.
+ */
+int target_update(target_t *target) {
+  int busy = 0;
+  int retval;
+  
+  // Update the serial port (perform reads into our buffer).
+  if (target->serial && serial_isOpen(target->serial)) {
+    retval = serial_update(target->serial);
+    if (retval == -1) {
+      
+      // USB serial port connection lost. Close the port file immediately.
+      printf("Lost serial port %s.\n", target->args->port);
+      serial_close(target->serial);
+      
+      // Terminate if we shouldn't try to reconnect, otherwise try to reopen
+      // the port every few seconds.
+      if (target->common->noReconnect) {
+        target->lost = 1;
+      } else if (timeout_arm(target->reconnectTimer, RECONNECT_INTERVAL_USEC) < 0) {
+        return -1;
+      }
+      
+    } else if (retval == 1) {
+      
+      // Data is still waiting to be routed.
+      busy = 1;
+      
+    }
+  }
+  
+  // Handle debug command issue and replies.
+  retval = target->iface.update(target->iface.data);
+  if (retval < 0) {
+    return -1;
+  } else if (retval) {
+    busy = 1;
+  }
+  
+  if (target->serial && serial_isOpen(target->serial)) {
+    
+    // Handle application data.
+    if (handleApplicationData(target) < 0) {
+      return -1;
+    }
+    
+    // Flush the serial port (write pending data to the serial port).
+    serial_flush(target->serial);
+    
+  }
+  
+  // Continue forwarding application data from the clients if we stopped
+  // because the serial port could not keep up, or the port was lost.
+  if (target->appStalled) {
+    if (!target->serial || !serial_isOpen(target->serial) || (serial_appRoom(target->serial) > 0)) {
+      target->appStalled = 0;
+      if (tcpServer_resume(target->appServer) < 0) {
+        return -1;
+      }
+    }
+  }
+  
+  // Flush the TCP servers (write pending data to the sockets).
+  tcpServer_flush(target->appServer);
+  tcpServer_flush(target->debug.server);
+  
+  return busy;
+}
+
+/**
+ * Closes everything opened by target_open().
+ */
+void target_close(target_t *target) {
+  
+  // Free memory used by the debug command queues.
+  if (target->iface.free) {
+    target->iface.free(target->iface.data);
+    target->iface.free = 0;
+  }
+  
+  // Close the serial port connection.
+  serial_free(&target->serial);
+  timeout_close(&target->reconnectTimer);
+  timeout_close(&target->statsTimer);
+  
+  // Close TCP servers, the local socket and the recording.
+  tcpServer_close(&target->appServer);
+  tcpServer_close(&target->debug.server);
+  localServer_close(&target->localServer);
+  recorder_close(&target->recordDesc);
+  
+}
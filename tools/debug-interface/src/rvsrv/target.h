@@ -0,0 +1,166 @@
+/* Debug interface for standalone r-VEX processor
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ * All Rights Reserved.
+ * 
+ * THIS IS A LEGAL DOCUMENT, BY USING r-VEX,
+ * YOU ARE AGREEING TO THESE TERMS AND CONDITIONS.
+ * 
+ * No portion of this work may be used by any commercial entity, or for any
+ * commercial purpose, without the prior, written permission of TU Delft.
+ * Nonprofit and noncommercial use is permitted as described below.
+ * 
+ * 1. r-VEX is provided AS IS, with no warranty of any kind, express
+ * or implied. The user of the code accepts full responsibility for the
+ * application of the code and the use of any results.
+ * 
+ * 2. Nonprofit and noncommercial use is encouraged. r-VEX may be
+ * downloaded, compiled, synthesized, copied, and modified solely for nonprofit,
+ * educational, noncommercial research, and noncommercial scholarship
+ * purposes provided that this notice in its entirety accompanies all copies.
+ * Copies of the modified software can be delivered to persons who use it
+ * solely for nonprofit, educational, noncommercial research, and
+ * noncommercial scholarship purposes provided that this notice in its
+ * entirety accompanies all copies.
+ * 
+ * 3. ALL COMMERCIAL USE, AND ALL USE BY FOR PROFIT ENTITIES, IS EXPRESSLY
+ * PROHIBITED WITHOUT A LICENSE FROM TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * 4. No nonprofit user may place any restrictions on the use of this software,
+ * including as modified by the user, by any other authorized user.
+ * 
+ * 5. Noncommercial and nonprofit users may distribute copies of r-VEX
+ * in compiled or binary form as set forth in Section 2, provided that
+ * either: (A) it is accompanied by the corresponding machine-readable source
+ * code, or (B) it is accompanied by a written offer, with no time limit, to
+ * give anyone a machine-readable copy of the corresponding source code in
+ * return for reimbursement of the cost of distribution. This written offer
+ * must permit verbatim duplication by anyone, or (C) it is distributed by
+ * someone who received only the executable form, and is accompanied by a
+ * copy of the written offer of source code.
+ * 
+ * 6. r-VEX was developed by Stephan Wong, Thijs van As, Fakhar Anjam,
+ * Roel Seedorf, Anthony Brandon, Jeroen van Straten. r-VEX is currently
+ * maintained by TU Delft (J.S.S.M.Wong@tudelft.nl).
+ * 
+ * Copyright (C) 2008-2016 by TU Delft.
+ */
+
+#ifndef _TARGET_H_
+#define _TARGET_H_
+
+#include "entry.h"
+#include "serial.h"
+#include "rvex_iface.h"
+#include "tcpserv.h"
+#include "protocol.h"
+#include "localserv.h"
+#include "timeout.h"
+
+/**
+ * State of a single target: a board connected through one of the backends,
+ * together with the servers through which clients access it. rvsrv serves any
+ * number of targets from a single reactor.
+ */
+typedef struct {
+  
+  /**
+   * Command line parameters for this target, and the ones shared by all
+   * targets.
+   */
+  const targetArgs_t *args;
+  const commandLineArgs_t *common;
+  
+  /**
+   * Serial port carrying the application stream, and for the UART backend
+   * also the debug stream. Null if the target does not have a serial port.
+   */
+  serial_t *serial;
+  
+  /**
+   * Backend used to access the target.
+   */
+  rvex_iface_t iface;
+  
+  /**
+   * TCP server for sending data to and receiving data from the application
+   * code running on the target.
+   */
+  tcpServer_t *appServer;
+  
+  /**
+   * Set when data from the application clients was left in their receive
+   * buffers because the serial port could not keep up.
+   */
+  int appStalled;
+  
+  /**
+   * Protocol state for the debug server, which also holds the server itself.
+   */
+  debugTarget_t debug;
+  
+  /**
+   * Local server sharing the target memory, or null if local access is
+   * disabled.
+   */
+  localServer_t *localServer;
+  
+  /**
+   * File descriptor for the application stream recording, or -1 if we're not
+   * recording.
+   */
+  int recordDesc;
+  
+  /**
+   * Timer used to periodically try to reopen the serial port.
+   */
+  timeout_t *reconnectTimer;
+  
+  /**
+   * Time at which the target was opened, as returned by stats_now().
+   */
+  uint64_t openTime;
+  
+  /**
+   * Timer used to periodically print the statistics, and the time and
+   * traffic counters at the last time they were printed.
+   */
+  timeout_t *statsTimer;
+  uint64_t lastStatsTime;
+  uint64_t lastTraffic[4];
+  
+  /**
+   * Set when the serial port was lost and we should not try to reconnect.
+   * The daemon terminates when this happens.
+   */
+  int lost;
+  
+} target_t;
+
+/**
+ * Opens the serial port, backend and servers for a target. Returns -1 if
+ * something went wrong, in which case the target must still be closed with
+ * target_close(), or 0 on success.
+ */
+int target_open(target_t *target, const targetArgs_t *args, const commandLineArgs_t *common);
+
+/**
+ * Starts the threads of the backend of a target, if it has any. Must be
+ * called after forking into daemon mode. Returns -1 if something went wrong,
+ * or 0 on success.
+ */
+int target_start(target_t *target);
+
+/**
+ * Moves data between the serial port, the backend and the servers of the
+ * target. Should be called after every reactor_wait(). Returns -1 if an error
+ * occured, 1 if there is still work pending, or 0 otherwise.
+ */
+int target_update(target_t *target);
+
+/**
+ * Closes everything opened by target_open().
+ */
+void target_close(target_t *target);
+
+#endif
@@ -51,20 +51,103 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
 #include "tcpserv.h"
-#include "select.h"
+#include "reactor.h"
+
+/**
+ * Maximum number of chunks written to a socket with a single system call.
+ */
+#define TCP_MAX_IOV 64
+
+static int onListenReady(int listenDesc, int events, void *data);
+
+/**
+ * Allocates a transmit block with room for capacity bytes. The caller holds
+ * the only reference to it. Returns null if we're out of memory.
+ */
+tcpBlock_t *tcpServer_allocBlock(int capacity) {
+  tcpBlock_t *block;
+  
+  block = (tcpBlock_t*)malloc(sizeof(tcpBlock_t) + capacity);
+  if (!block) {
+    perror("Failed to allocate memory for transmit block");
+    return 0;
+  }
+  block->refs = 1;
+  block->capacity = capacity;
+  
+  return block;
+}
+
+/**
+ * Releases a reference to the given block, freeing it when this was the last
+ * one.
+ */
+void tcpServer_releaseBlock(tcpBlock_t *block) {
+  if (block && !--block->refs) {
+    free(block);
+  }
+}
+
+/**
+ * Frees the given transmit queue entry and releases its block.
+ */
+static void freeChunk(tcpChunk_t *chunk) {
+  tcpServer_releaseBlock(chunk->block);
+  free(chunk);
+}
+
+/**
+ * Removes the chunk at the head of the transmit queue of the given client. It
+ * is kept as the spare chunk if possible.
+ */
+static void popChunk(tcpClient_t *client) {
+  tcpChunk_t *chunk = client->txHead;
+  
+  client->txHead = chunk->next;
+  if (!client->txHead) {
+    client->txTail = 0;
+  }
+  if (!client->txSpare && (chunk->block->refs == 1) && (chunk->block->capacity == TCP_CHUNK_SIZE)) {
+    client->txSpare = chunk;
+  } else {
+    freeChunk(chunk);
+  }
+  
+}
+
+/**
+ * Frees the transmit queue of the given client.
+ */
+static void freeQueue(tcpClient_t *client) {
+  tcpChunk_t *chunk;
+  
+  while ((chunk = client->txHead)) {
+    client->txHead = chunk->next;
+    freeChunk(chunk);
+  }
+  client->txTail = 0;
+  client->txQueued = 0;
+  if (client->txSpare) {
+    freeChunk(client->txSpare);
+    client->txSpare = 0;
+  }
+  
+}
 
 /**
  * Tries to open a TCP server socket at the given port. Returns null if
  * something goes wrong. Otherwise, returns a pointer to the newly allocated
  * server state structure.
  */
-tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData onAlloc, tcpServer_extraData onFree) {
+tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData onAlloc, tcpServer_extraData onFree, tcpServer_receiveHandler onReceive, void *data) {
   tcpServer_t *server;
   struct sockaddr_in addr;
   int i;
@@ -88,9 +171,14 @@ tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData on
   server->access = access;
   server->onAlloc = onAlloc;
   server->onFree = onFree;
+  server->onReceive = onReceive;
+  server->data = data;
+  server->maxQueued = TCP_MAX_QUEUED;
+  server->overflow = TCP_OVERFLOW_DISCONNECT;
   
-  // Create the socket.
-  server->listenDesc = socket(AF_INET, SOCK_STREAM, 0);
+  // Create the socket. It is nonblocking so we can accept connections until
+  // there are none left when the reactor tells us there are some.
+  server->listenDesc = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
   if (server->listenDesc < 0) {
     perror("Failed to open socket");
     tcpServer_close(&server);
@@ -123,8 +211,8 @@ tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData on
     return 0;
   }
   
-  // Register the listen descriptor with the select wrapper.
-  if (select_register(server->listenDesc) < 0) {
+  // Register the listen descriptor with the reactor.
+  if (reactor_register(server->listenDesc, REACTOR_READ, &onListenReady, server) < 0) {
     tcpServer_close(&server);
     return 0;
   }
@@ -135,6 +223,15 @@ tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData on
   
 }
 
+/**
+ * Sets the maximum number of bytes which may be queued for a single client of
+ * the given server, and what to do when a client exceeds it.
+ */
+void tcpServer_setOverflow(tcpServer_t *server, int maxQueued, int overflow) {
+  server->maxQueued = maxQueued;
+  server->overflow = overflow;
+}
+
 /**
  * Tries to close the server specified by server, deallocates all memory, and
  * sets the pointer to the server structure to null.
@@ -152,20 +249,21 @@ void tcpServer_close(tcpServer_t **server) {
     tcpClient_t *client = (*server)->clients[i];
     if (client) {
       if (client->clientDesc > 0) {
-        select_unregister(client->clientDesc);
+        reactor_unregister(client->clientDesc);
         close(client->clientDesc);
         printf("Client ID %d forcefully closed (%s access).\n", i, (*server)->access);
       }
       if ((*server)->onFree) {
         (*server)->onFree(&(client->extraData));
       }
+      freeQueue(client);
       free(client);
     }
   }
   
   // Close the listening socket.
   if ((*server)->listenDesc > 0) {
-    select_unregister((*server)->listenDesc);
+    reactor_unregister((*server)->listenDesc);
     close((*server)->listenDesc);
     printf("Server for %s access closed.\n", (*server)->access);
   }
@@ -178,14 +276,323 @@ void tcpServer_close(tcpServer_t **server) {
 }
 
 /**
- * Updates the server after a call to select_wait(). Accepts new incoming
- * connections and reads data from clients into our buffer where applicable.
+ * Removes a client from the list of clients with pending transmit data.
+ */
+static void unlinkDirty(tcpServer_t *server, tcpClient_t *client) {
+  tcpClient_t **link;
+  
+  if (!client->dirty) {
+    return;
+  }
+  for (link = &server->dirtyList; *link; link = &(*link)->nextDirty) {
+    if (*link == client) {
+      *link = client->nextDirty;
+      break;
+    }
+  }
+  client->nextDirty = 0;
+  client->dirty = 0;
+  
+}
+
+/**
+ * Adds a client to the list of clients with pending transmit data if it is
+ * not in there already.
+ */
+static void markDirty(tcpServer_t *server, tcpClient_t *client) {
+  
+  if (client->dirty) {
+    return;
+  }
+  client->nextDirty = server->dirtyList;
+  server->dirtyList = client;
+  client->dirty = 1;
+  
+}
+
+/**
+ * Closes the connection to the given client and frees its state.
+ */
+static void closeClient(tcpServer_t *server, int clientID) {
+  tcpClient_t *client = server->clients[clientID];
+  
+  // Close our end of the port and unregister it.
+  reactor_unregister(client->clientDesc);
+  close(client->clientDesc);
+  
+  // Free the client state memory structure.
+  unlinkDirty(server, client);
+  if (server->onFree) {
+    server->onFree(&(client->extraData));
+  }
+  freeQueue(client);
+  free(client);
+  server->clients[clientID] = 0;
+  
+  // Report that the client closed the connection.
+  printf("Client ID %d closed connection (%s access).\n", clientID, server->access);
+  
+}
+
+/**
+ * Registers the client socket for writability events when there is data
+ * waiting to be sent, or unregisters it when there is not. When force is set,
+ * the registration is renewed even if it did not change, which makes the
+ * reactor report the socket again if it is readable.
+ */
+static int setEvents(tcpClient_t *client, int force) {
+  int events = REACTOR_READ;
+  
+  if (client->txQueued) {
+    events |= REACTOR_WRITE;
+  }
+  if (!force && (events == client->events)) {
+    return 0;
+  }
+  client->events = events;
+  return reactor_modify(client->clientDesc, events);
+  
+}
+
+/**
+ * Applies the overflow policy of the server when size more bytes would not
+ * fit in the transmit queue of the given client. Returns 1 if the data should
+ * be queued or 0 if it should be dropped.
+ */
+static int makeRoom(tcpServer_t *server, tcpClient_t *client, int size) {
+  tcpChunk_t *chunk;
+  int count;
+  
+  // Drop data for clients which are about to be closed.
+  if (client->closing) {
+    return 0;
+  }
+  
+  // Nothing to do if the data fits.
+  if (client->txQueued + size <= server->maxQueued) {
+    return 1;
+  }
+  
+  // Disconnect the client if that's the policy.
+  if (server->overflow == TCP_OVERFLOW_DISCONNECT) {
+    printf("Client ID %d (%s access) is not reading its data, disconnecting.\n", client->clientID, server->access);
+    freeQueue(client);
+    client->closing = 1;
+    markDirty(server, client);
+    return 0;
+  }
+  
+  // Otherwise, drop the oldest data to bound how far behind the client is.
+  if (!client->txDropped) {
+    printf("Client ID %d (%s access) is falling behind, dropping data.\n", client->clientID, server->access);
+  }
+  while ((chunk = client->txHead) && (client->txQueued + size > server->maxQueued)) {
+    count = chunk->end - chunk->start;
+    if (count > client->txQueued + size - server->maxQueued) {
+      count = client->txQueued + size - server->maxQueued;
+    }
+    chunk->start += count;
+    client->txQueued -= count;
+    client->txDropped += count;
+    server->droppedBytes += count;
+    if (chunk->start >= chunk->end) {
+      popChunk(client);
+    }
+  }
+  
+  return 1;
+}
+
+/**
+ * Appends the given chunk to the transmit queue of the given client.
+ */
+static void appendChunk(tcpServer_t *server, tcpClient_t *client, tcpChunk_t *chunk) {
+  
+  chunk->next = 0;
+  if (client->txTail) {
+    client->txTail->next = chunk;
+  } else {
+    client->txHead = chunk;
+  }
+  client->txTail = chunk;
+  markDirty(server, client);
+  
+}
+
+/**
+ * Appends size bytes from buf to the transmit queue of the given client.
+ * Returns -1 if we ran out of memory.
+ */
+static int queueData(tcpServer_t *server, tcpClient_t *client, const unsigned char *buf, int size) {
+  tcpChunk_t *chunk;
+  int count;
+  
+  if (!makeRoom(server, client, size)) {
+    return 0;
+  }
+  
+  while (size) {
+    
+    // Start a new chunk if we can't append to the last one, because it is
+    // full or because its block is shared with other clients.
+    chunk = client->txTail;
+    if (!chunk || (chunk->block->refs > 1) || (chunk->end >= chunk->block->capacity)) {
+      if (client->txSpare) {
+        chunk = client->txSpare;
+        client->txSpare = 0;
+      } else {
+        chunk = (tcpChunk_t*)malloc(sizeof(tcpChunk_t));
+        if (!chunk) {
+          perror("Failed to allocate memory for client transmit queue");
+          return -1;
+        }
+        chunk->block = tcpServer_allocBlock(TCP_CHUNK_SIZE);
+        if (!chunk->block) {
+          free(chunk);
+          return -1;
+        }
+      }
+      chunk->start = 0;
+      chunk->end = 0;
+      appendChunk(server, client, chunk);
+    }
+    
+    // Append as much as fits in the chunk.
+    count = chunk->block->capacity - chunk->end;
+    if (count > size) {
+      count = size;
+    }
+    memcpy(chunk->block->data + chunk->end, buf, count);
+    chunk->end += count;
+    client->txQueued += count;
+    buf += count;
+    size -= count;
+    
+  }
+  markDirty(server, client);
+  
+  return 0;
+}
+
+/**
+ * Appends a reference to the first size bytes of the given block to the
+ * transmit queue of the given client. Returns -1 if we ran out of memory.
+ */
+static int queueBlock(tcpServer_t *server, tcpClient_t *client, tcpBlock_t *block, int size) {
+  tcpChunk_t *chunk;
+  
+  if (!size || !makeRoom(server, client, size)) {
+    return 0;
+  }
+  
+  chunk = (tcpChunk_t*)malloc(sizeof(tcpChunk_t));
+  if (!chunk) {
+    perror("Failed to allocate memory for client transmit queue");
+    return -1;
+  }
+  chunk->block = block;
+  block->refs++;
+  chunk->start = 0;
+  chunk->end = size;
+  appendChunk(server, client, chunk);
+  client->txQueued += size;
+  
+  return 0;
+}
+
+/**
+ * Reactor handler for client connections. Reads data from the client into
+ * our buffer and passes it to the receive handler until the socket is
+ * drained.
+ */
+static int onClientReady(int f, int events, void *data) {
+  tcpClient_t *client = (tcpClient_t*)data;
+  tcpServer_t *server = client->server;
+  int clientID = client->clientID;
+  
+  // Continue sending queued data if the socket became writable.
+  if (events & REACTOR_WRITE) {
+    if (tcpServer_flushClient(server, clientID) < 0) {
+      return -1;
+    }
+    if (server->clients[clientID] != client) {
+      return 0;
+    }
+  }
+  if (!(events & (REACTOR_READ | REACTOR_HANGUP))) {
+    return 0;
+  }
+  
+  while (1) {
+    
+    // Don't read more if the receive handler did not consume everything.
+    if (client->rxBufPtr < client->rxBufSize) {
+      return 0;
+    }
+    
+    // Don't read more if the client is not reading its replies. Reading is
+    // resumed by tcpServer_flushClient() when the queue has drained.
+    if (client->closing) {
+      return 0;
+    }
+    if (client->txQueued >= TCP_HIGH_WATER) {
+      client->paused = 1;
+      return 0;
+    }
+    
+    // Reset the (fully drained) buffer.
+    client->rxBufPtr = 0;
+    
+    // Read into the buffer.
+    client->rxBufSize = recv(client->clientDesc, (void*)client->rxBuffer, TCP_BUFFER_SIZE, MSG_DONTWAIT);
+    if (client->rxBufSize < 0) {
+      client->rxBufSize = 0;
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        return 0;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      
+      // Treat a broken connection the same way as a closed one.
+      perror("Failed to read from client");
+    }
+    
+    // Check if the client closed the connection.
+    if (client->rxBufSize == 0) {
+      closeClient(server, clientID);
+      return 0;
+    }
+    client->rxBytes += client->rxBufSize;
+    server->rxBytes += client->rxBufSize;
+    
+    // Let the owner of the server handle the data.
+    if (server->onReceive) {
+      if (server->onReceive(server, clientID) < 0) {
+        return -1;
+      }
+    } else {
+      client->rxBufPtr = client->rxBufSize;
+    }
+    
+    // The handler may have closed the server or the connection.
+    if (server->clients[clientID] != client) {
+      return 0;
+    }
+    
+  }
+  
+}
+
+/**
+ * Reactor handler for the listening socket. Accepts all pending incoming
+ * connections.
  */
-int tcpServer_update(tcpServer_t *server) {
+static int onListenReady(int listenDesc, int events, void *data) {
+  tcpServer_t *server = (tcpServer_t*)data;
   int i;
   
-  // Accept new connections if necessary.
-  if (select_isReady(server->listenDesc)) {
+  while (1) {
     struct sockaddr_in addr;
     unsigned int addrSize = sizeof(addr);
     int clientDesc;
@@ -195,10 +602,27 @@ int tcpServer_update(tcpServer_t *server) {
     // Accept the incoming connection.
     clientDesc = accept(server->listenDesc, (struct sockaddr *)&addr, &addrSize);
     if (clientDesc < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        return 0;
+      }
+      if ((errno == EINTR) || (errno == ECONNABORTED)) {
+        continue;
+      }
       perror("Failed to accept incoming connection");
       return -1;
     }
     
+    // Make the connection nonblocking, so a slow client can't stall us, and
+    // disable Nagle's algorithm, because we only flush at the end of each
+    // main loop iteration anyway.
+    if (fcntl(clientDesc, F_SETFL, fcntl(clientDesc, F_GETFL) | O_NONBLOCK) < 0) {
+      perror("Failed to make client socket nonblocking");
+      close(clientDesc);
+      continue;
+    }
+    i = 1;
+    setsockopt(clientDesc, IPPROTO_TCP, TCP_NODELAY, &i, sizeof(int));
+    
     // Find an empty spot for the pointer to the client structure.
     f = -1;
     for (i = 0; i < server->capacity; i++) {
@@ -232,6 +656,7 @@ int tcpServer_update(tcpServer_t *server) {
     if (server->onAlloc) {
       if (server->onAlloc(&(server->clients[f]->extraData)) < 0) {
         free(server->clients[f]);
+        server->clients[f] = 0;
         close(clientDesc);
         return -1;
       }
@@ -239,16 +664,30 @@ int tcpServer_update(tcpServer_t *server) {
     
     // Initialize the client state.
     server->clients[f]->clientDesc = clientDesc;
+    server->clients[f]->server = server;
+    server->clients[f]->clientID = f;
     server->clients[f]->rxBufSize = 0;
     server->clients[f]->rxBufPtr = 0;
-    server->clients[f]->txBufSize = 0;
+    server->clients[f]->txHead = 0;
+    server->clients[f]->txTail = 0;
+    server->clients[f]->txSpare = 0;
+    server->clients[f]->txQueued = 0;
+    server->clients[f]->txDropped = 0;
+    server->clients[f]->rxBytes = 0;
+    server->clients[f]->txBytes = 0;
+    server->clients[f]->paused = 0;
+    server->clients[f]->closing = 0;
+    server->clients[f]->events = REACTOR_READ;
+    server->clients[f]->nextDirty = 0;
+    server->clients[f]->dirty = 0;
     
-    // Register the new client with select_wait().
-    if (select_register(clientDesc) < 0) {
+    // Register the new client with the reactor.
+    if (reactor_register(clientDesc, REACTOR_READ, &onClientReady, server->clients[f]) < 0) {
       return -1;
     }
     
     // Report that we have a new connection.
+    server->connections++;
     haddr = ntohl(addr.sin_addr.s_addr);
     printf(
       "Accepted connection from %d.%d.%d.%d for %s access, local ID = %d.\n",
@@ -258,61 +697,6 @@ int tcpServer_update(tcpServer_t *server) {
     
   }
   
-  // Read from clients where applicable.
-  for (i = 0; i < server->capacity; i++) {
-    tcpClient_t *client = server->clients[i];
-    
-    // Skip nonexistant clients.
-    if ((!client) || (client->clientDesc < 0)) {
-      continue;
-    }
-    
-    // Skip clients which are not ready or still have data in their buffer.
-    if ((!select_isReady(client->clientDesc)) || (client->rxBufPtr < client->rxBufSize)) {
-      continue;
-    }
-    
-    // Reset the (fully drained) buffer.
-    client->rxBufPtr = 0;
-    
-    // Read into the buffer.
-    client->rxBufSize = read(client->clientDesc, (void*)client->rxBuffer, TCP_BUFFER_SIZE);
-    if (client->rxBufSize < 0) {
-      perror("Failed to read from client");
-      return -1;
-    }
-    
-    // Check if the client closed the connection.
-    if (client->rxBufSize == 0) {
-      
-      // Close our end of the port and unregister it.
-      close(client->clientDesc);
-      select_unregister(client->clientDesc);
-      
-      // Free the client state memory structure.
-      if (server->onFree) {
-        server->onFree(&(client->extraData));
-      }
-      free(client);
-      client = 0;
-      server->clients[i] = 0;
-      
-      // Report that the client closed the connection.
-      printf("Client ID %d closed connection (%s access).\n", i, server->access);
-      
-    } else {
-      
-      // We have a filled buffer, so we should unregister from the select call
-      // because we can't handle any further reads until the buffer is
-      // depleted.
-      select_unregister(client->clientDesc);
-      
-    }
-    
-  }
-  
-  return 0;
-  
 }
 
 /**
@@ -361,16 +745,109 @@ int tcpServer_receive(tcpServer_t *server, int clientID) {
     return -1;
   }
   
-  // If the buffer contains exactly one byte, re-register with select_wait().
-  if (server->clients[clientID]->rxBufPtr == server->clients[clientID]->rxBufSize - 1) {
-    if (select_register(server->clients[clientID]->clientDesc) < 0) {
+  // Pop the byte.
+  return server->clients[clientID]->rxBuffer[server->clients[clientID]->rxBufPtr++];
+  
+}
+
+/**
+ * Pulls at most maxSize bytes from the receive buffer for the specified client
+ * into buf. Returns the number of bytes copied, which is 0 if there are no
+ * bytes available, or -1 if the client does not exist.
+ */
+int tcpServer_receiveBuf(tcpServer_t *server, int clientID, unsigned char *buf, int maxSize) {
+  tcpClient_t *client;
+  int count;
+  
+  // Make sure this client exists and is connected.
+  if ((clientID >= server->capacity) || (clientID < 0)) {
+    return -1;
+  }
+  client = server->clients[clientID];
+  if ((!client) || (client->clientDesc < 0)) {
+    return -1;
+  }
+  
+  // Copy as much as we can.
+  count = client->rxBufSize - client->rxBufPtr;
+  if (count > maxSize) {
+    count = maxSize;
+  }
+  if (count > 0) {
+    memcpy(buf, client->rxBuffer + client->rxBufPtr, count);
+    client->rxBufPtr += count;
+  } else {
+    count = 0;
+  }
+  
+  return count;
+}
+
+/**
+ * Passes data left in the receive buffers of the clients to the receive
+ * handler again, and resumes reading from the clients whose buffer it then
+ * drains. Meant for owners whose receive handler stopped pulling data
+ * because they could not take more at the time.
+ */
+int tcpServer_resume(tcpServer_t *server) {
+  int clientID = -1;
+  
+  while ((clientID = tcpServer_nextClient(server, clientID)) >= 0) {
+    tcpClient_t *client = server->clients[clientID];
+    
+    if (client->rxBufPtr >= client->rxBufSize) {
+      continue;
+    }
+    
+    // Let the owner of the server handle the data.
+    if (server->onReceive) {
+      if (server->onReceive(server, clientID) < 0) {
+        return -1;
+      }
+    } else {
+      client->rxBufPtr = client->rxBufSize;
+    }
+    
+    // The handler may have closed the connection.
+    if (server->clients[clientID] != client) {
+      continue;
+    }
+    
+    // Renew the reactor registration if the buffer was drained, because the
+    // edge-triggered reactor won't report data which was already waiting.
+    if ((client->rxBufPtr >= client->rxBufSize) && (setEvents(client, 1) < 0)) {
       return -1;
     }
+    
   }
   
-  // Pop the byte.
-  return server->clients[clientID]->rxBuffer[server->clients[clientID]->rxBufPtr++];
+  return 0;
+}
+
+/**
+ * Disconnects the specified client once the data queued for it so far has
+ * been sent, as far as possible without blocking, when the server is
+ * flushed. Data received from the client which has not been pulled yet is
+ * dropped, and so is data sent to the client from now on. Returns -1 if the
+ * client does not exist, or 0 otherwise.
+ */
+int tcpServer_disconnect(tcpServer_t *server, int clientID) {
+  tcpClient_t *client;
+  
+  // Make sure this client exists and is connected.
+  if ((clientID >= server->capacity) || (clientID < 0)) {
+    return -1;
+  }
+  client = server->clients[clientID];
+  if ((!client) || (client->clientDesc < 0)) {
+    return -1;
+  }
+  
+  client->rxBufPtr = client->rxBufSize;
+  client->closing = 1;
+  markDirty(server, client);
   
+  return 0;
 }
 
 /**
@@ -392,9 +869,10 @@ void *tcpServer_getExtraData(tcpServer_t *server, int clientID) {
 }
 
 /**
- * Sends byte b to the connection at index id.
+ * Returns the number of bytes waiting in the transmit queue of the given
+ * client, or -1 if the client does not exist.
  */
-int tcpServer_send(tcpServer_t *server, int clientID, int b) {
+int tcpServer_getQueued(tcpServer_t *server, int clientID) {
   
   // Make sure this client exists and is connected.
   if ((clientID >= server->capacity) || (clientID < 0)) {
@@ -404,17 +882,26 @@ int tcpServer_send(tcpServer_t *server, int clientID, int b) {
     return -1;
   }
   
-  // If the tx buffer is full, flush first.
-  if (server->clients[clientID]->txBufSize >= TCP_BUFFER_SIZE) {
-    if (tcpServer_flushClient(server, clientID) < 0) {
-      return -1;
-    }
-  }
+  return server->clients[clientID]->txQueued;
   
-  // Append the byte to the buffer.
-  server->clients[clientID]->txBuffer[server->clients[clientID]->txBufSize++] = b;
+}
+
+/**
+ * Sends byte b to the connection at index id.
+ */
+int tcpServer_send(tcpServer_t *server, int clientID, int b) {
+  unsigned char c = b;
   
-  return 0;
+  // Make sure this client exists and is connected.
+  if ((clientID >= server->capacity) || (clientID < 0)) {
+    return -1;
+  }
+  if ((!server->clients[clientID]) || (server->clients[clientID]->clientDesc < 0)) {
+    return -1;
+  }
+  
+  // Append the byte to the queue.
+  return queueData(server, server->clients[clientID], &c, 1);
 }
 
 /**
@@ -436,6 +923,13 @@ int tcpServer_broadcast(tcpServer_t *server, int b) {
  * Sends null-terminated string s to the connection at index clientID.
  */
 int tcpServer_sendStr(tcpServer_t *server, int clientID, const unsigned char *s) {
+  return tcpServer_sendBuf(server, clientID, s, strlen((const char*)s));
+}
+
+/**
+ * Sends size bytes from buf to the connection at index clientID.
+ */
+int tcpServer_sendBuf(tcpServer_t *server, int clientID, const unsigned char *buf, int size) {
   
   // Make sure this client exists and is connected.
   if ((clientID >= server->capacity) || (clientID < 0)) {
@@ -445,31 +939,34 @@ int tcpServer_sendStr(tcpServer_t *server, int clientID, const unsigned char *s)
     return -1;
   }
   
-  while (*s) {
-    
-    // If the tx buffer is full, flush.
-    if (server->clients[clientID]->txBufSize >= TCP_BUFFER_SIZE) {
-      if (tcpServer_flushClient(server, clientID) < 0) {
-        return -1;
-      }
+  // Append the data to the queue.
+  return queueData(server, server->clients[clientID], buf, size);
+}
+
+/**
+ * Broadcasts null-terminated string s to all connected clients.
+ */
+int tcpServer_broadcastStr(tcpServer_t *server, const unsigned char *s) {
+  int clientID;
+  
+  for (clientID = tcpServer_nextClient(server, -1); clientID >= 0; clientID = tcpServer_nextClient(server, clientID)) {
+    if (tcpServer_sendStr(server, clientID, s) < 0) {
+      return -1;
     }
-    
-    // Append the next byte to the buffer.
-    server->clients[clientID]->txBuffer[server->clients[clientID]->txBufSize++] = *s++;
-    
   }
   
   return 0;
 }
 
 /**
- * Broadcasts null-terminated string s to all connected clients.
+ * Queues the first size bytes of the given block for transmission to all
+ * connected clients, without copying the data.
  */
-int tcpServer_broadcastStr(tcpServer_t *server, const unsigned char *s) {
+int tcpServer_broadcastBlock(tcpServer_t *server, tcpBlock_t *block, int size) {
   int clientID;
   
   for (clientID = tcpServer_nextClient(server, -1); clientID >= 0; clientID = tcpServer_nextClient(server, clientID)) {
-    if (tcpServer_sendStr(server, clientID, s) < 0) {
+    if (queueBlock(server, server->clients[clientID], block, size) < 0) {
       return -1;
     }
   }
@@ -478,11 +975,16 @@ int tcpServer_broadcastStr(tcpServer_t *server, const unsigned char *s) {
 }
 
 /**
- * Flushes the write buffer for the specified client.
+ * Writes as much of the transmit queue for the specified client to its
+ * socket as it will accept without blocking. The rest is sent when the socket
+ * becomes writable again. Clients whose connection has failed are closed.
  */
 int tcpServer_flushClient(tcpServer_t *server, int clientID) {
   tcpClient_t *client;
-  int idx;
+  tcpChunk_t *chunk;
+  struct iovec iov[TCP_MAX_IOV];
+  struct msghdr msg;
+  int num, count;
   
   // Make sure this client exists and is connected. If it isn't, that's fine;
   // it just means there's nothing to flush.
@@ -493,44 +995,92 @@ int tcpServer_flushClient(tcpServer_t *server, int clientID) {
   if ((!client) || (client->clientDesc < 0)) {
     return 0;
   }
-
-  // Enable TCP_NODELAY to significantly increase local transmission speed
-  int flag = 1;
-  setsockopt(client->clientDesc, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int));
   
-  idx = 0;
-  while (idx < client->txBufSize) {
-    int num;
+  while (client->txHead) {
+    
+    // Gather the queued chunks.
+    count = 0;
+    for (chunk = client->txHead; chunk && (count < TCP_MAX_IOV); chunk = chunk->next) {
+      iov[count].iov_base = chunk->block->data + chunk->start;
+      iov[count].iov_len = chunk->end - chunk->start;
+      count++;
+    }
     
-    // Write as much as possible to the socket.
-    num = write(client->clientDesc, client->txBuffer + idx, client->txBufSize - idx);
+    // Write as much as possible to the socket. We use sendmsg() instead of
+    // writev() so we can ask not to be killed by SIGPIPE.
+    memset((void*)&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    num = sendmsg(client->clientDesc, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
     if (num < 0) {
-      return -1;
+      if (errno == EINTR) {
+        continue;
+      }
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+        break;
+      }
+      
+      // Treat a broken connection the same way as a closed one.
+      perror("Failed to write to client");
+      closeClient(server, clientID);
+      return 0;
     }
     
-    // Keep track of how much we've sent already.
-    idx += num;
+    // Pop what we've sent from the queue.
+    client->txBytes += num;
+    server->txBytes += num;
+    client->txQueued -= num;
+    while (num) {
+      chunk = client->txHead;
+      count = chunk->end - chunk->start;
+      if (count > num) {
+        chunk->start += num;
+        break;
+      }
+      num -= count;
+      popChunk(client);
+    }
     
   }
   
-  // Reset the buffer.
-  client->txBufSize = 0;
-
-  // Disable TCP_NODELAY
-  flag = 0;
-  setsockopt(client->clientDesc, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int));
+  // Close the connection if it failed earlier or the owner asked for it to
+  // be closed. Data which could not be sent right away is lost.
+  if (client->closing) {
+    closeClient(server, clientID);
+    return 0;
+  }
   
-  return 0;
+  // Report how much data a client which fell behind has missed once it has
+  // caught up.
+  if (!client->txQueued && client->txDropped) {
+    printf("Client ID %d (%s access) caught up, %d bytes were dropped.\n", clientID, server->access, client->txDropped);
+    client->txDropped = 0;
+  }
+  
+  // Resume reading from the client if the queue has drained far enough, and
+  // wait for the socket to become writable if it hasn't drained completely.
+  if (client->paused && (client->txQueued <= TCP_LOW_WATER)) {
+    client->paused = 0;
+    return setEvents(client, 1);
+  }
+  return setEvents(client, 0);
 }
 
 /**
- * Write all buffered data to the clients.
+ * Write all buffered data to the clients, as far as possible without
+ * blocking. Only clients which actually have data pending are visited.
  */
 int tcpServer_flush(tcpServer_t *server) {
-  int clientID;
+  tcpClient_t *client;
   
-  for (clientID = 0; clientID < server->capacity; clientID++) {
-    if (tcpServer_flushClient(server, clientID) < 0) {
+  while ((client = server->dirtyList)) {
+    
+    // Take the client off the list first, flushing may fail.
+    server->dirtyList = client->nextDirty;
+    client->nextDirty = 0;
+    client->dirty = 0;
+    
+    if (tcpServer_flushClient(server, client->clientID) < 0) {
       return -1;
     }
   }
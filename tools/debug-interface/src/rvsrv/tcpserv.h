@@ -49,24 +49,121 @@
 #ifndef _TCPSERV_H_
 #define _TCPSERV_H_
 
+#include <stdint.h>
+
+/**
+ * Size of the per-client receive buffer.
+ */
 #define TCP_BUFFER_SIZE 1024
 
+/**
+ * Size of the blocks allocated for data which is sent to a single client.
+ */
+#define TCP_CHUNK_SIZE 16384
+
+/**
+ * When more than TCP_HIGH_WATER bytes are queued for transmission to a client,
+ * we stop reading from it until the queue drains below TCP_LOW_WATER, so a
+ * client which doesn't read its replies can't make us buffer without bound.
+ * The high-water mark must be larger than the largest single reply.
+ */
+#define TCP_HIGH_WATER (4 * 1024 * 1024)
+#define TCP_LOW_WATER  (1024 * 1024)
+
+/**
+ * Default limit for the number of bytes queued for a client, see
+ * tcpServer_setOverflow(). This only matters for data which is pushed to
+ * clients without them asking for it, i.e. the application stream.
+ */
+#define TCP_MAX_QUEUED (64 * 1024 * 1024)
+
+/**
+ * What to do when a client exceeds its queue limit, see
+ * tcpServer_setOverflow(). TCP_OVERFLOW_DISCONNECT closes the connection,
+ * TCP_OVERFLOW_DROP discards the oldest queued data so the client catches up.
+ */
+#define TCP_OVERFLOW_DISCONNECT 0
+#define TCP_OVERFLOW_DROP       1
+
+/**
+ * Reference-counted block of transmit data. A block can be queued for any
+ * number of clients without copying it, see tcpServer_broadcastBlock().
+ */
+typedef struct tcpBlock {
+  
+  /**
+   * Number of references to this block. The block is freed when this drops
+   * to zero.
+   */
+  int refs;
+  
+  /**
+   * Number of bytes allocated for data.
+   */
+  int capacity;
+  
+  /**
+   * Block contents.
+   */
+  unsigned char data[];
+  
+} tcpBlock_t;
+
+/**
+ * An entry in a client transmit queue, referring to part of a block.
+ */
+typedef struct tcpChunk {
+  
+  /**
+   * Next chunk in the queue.
+   */
+  struct tcpChunk *next;
+  
+  /**
+   * Block containing the data. The chunk holds a reference to it.
+   */
+  tcpBlock_t *block;
+  
+  /**
+   * Range of block->data which still needs to be sent.
+   */
+  int start;
+  int end;
+  
+} tcpChunk_t;
+
 /**
  * Called when a client state structure is allocated or deallocated, to allow
  * server-specific data to be created per client connection.
  */
 typedef int (*tcpServer_extraData)(void **extra);
 
+struct tcpServer;
+
+/**
+ * Called when new data has been received from a client. The handler should
+ * pull all available bytes from the receive buffer using tcpServer_receive().
+ * Should return -1 if an error occured or 0 if everything is OK.
+ */
+typedef int (*tcpServer_receiveHandler)(struct tcpServer *server, int clientID);
+
 /**
  * Represents the state of a client connection to a server.
  */
-typedef struct {
+typedef struct tcpClient {
   
   /**
    * File descriptor for communicating with the client.
    */
   int clientDesc;
   
+  /**
+   * Server this client is connected to, and the client ID within that server.
+   * Used by the reactor handler.
+   */
+  struct tcpServer *server;
+  int clientID;
+  
   /**
    * Read buffer. When data is available and the buffer is empty, a socket
    * read is performed to fill this as far as possible.
@@ -84,14 +181,61 @@ typedef struct {
   int rxBufPtr;
   
   /**
-   * Write buffer.
+   * Transmit queue. Data is appended to the tail and written to the socket
+   * from the head when the server is flushed or when the socket becomes
+   * writable again.
+   */
+  tcpChunk_t *txHead;
+  tcpChunk_t *txTail;
+  
+  /**
+   * Fully sent chunk with a private block, which is kept around to avoid
+   * allocating a new one for every reply.
+   */
+  tcpChunk_t *txSpare;
+  
+  /**
+   * Number of bytes currently in the transmit queue.
+   */
+  int txQueued;
+  
+  /**
+   * Number of bytes which were dropped because the client fell behind, since
+   * the last time its queue was empty. See TCP_OVERFLOW_DROP.
    */
-  unsigned char txBuffer[TCP_BUFFER_SIZE];
+  int txDropped;
   
   /**
-   * Number of bytes currently in the write buffer.
+   * Number of bytes received from and sent to the client.
    */
-  int txBufSize;
+  uint64_t rxBytes;
+  uint64_t txBytes;
+  
+  /**
+   * Set when we stopped reading from the client because too much data is
+   * queued for it, see TCP_HIGH_WATER.
+   */
+  int paused;
+  
+  /**
+   * Set when the connection has failed, the client has fallen too far
+   * behind with overflow policy TCP_OVERFLOW_DISCONNECT or the owner called
+   * tcpServer_disconnect(). Data sent to the client is dropped, and the
+   * connection is closed when the server is flushed.
+   */
+  int closing;
+  
+  /**
+   * REACTOR_* events the socket is currently registered for.
+   */
+  int events;
+  
+  /**
+   * Next client in the server's list of clients with pending transmit data,
+   * and whether this client is currently in that list.
+   */
+  struct tcpClient *nextDirty;
+  int dirty;
   
   /**
    * Contains extra data necessary to represent the state for a client.
@@ -103,7 +247,7 @@ typedef struct {
 /**
  * TCP server state.
  */
-typedef struct {
+typedef struct tcpServer {
   
   /**
    * File descriptor for listening for incoming connections.
@@ -136,6 +280,39 @@ typedef struct {
    */
   tcpServer_extraData onFree;
   
+  /**
+   * When not null, this is called when data has been received from a client.
+   */
+  tcpServer_receiveHandler onReceive;
+  
+  /**
+   * Linked list of clients with data in their transmit buffer, so
+   * tcpServer_flush() does not need to visit every client.
+   */
+  tcpClient_t *dirtyList;
+  
+  /**
+   * Maximum number of bytes queued for a single client, and what to do when a
+   * client exceeds it. See tcpServer_setOverflow().
+   */
+  int maxQueued;
+  int overflow;
+  
+  /**
+   * Statistics for all clients, including those which have disconnected:
+   * number of connections accepted, bytes received and sent, and bytes
+   * dropped because a client fell behind.
+   */
+  uint64_t connections;
+  uint64_t rxBytes;
+  uint64_t txBytes;
+  uint64_t droppedBytes;
+  
+  /**
+   * Data belonging to the owner of the server, for use by the handlers.
+   */
+  void *data;
+  
 } tcpServer_t;
 
 /**
@@ -143,20 +320,24 @@ typedef struct {
  * something goes wrong. Otherwise, returns a pointer to the newly allocated
  * server state structure. access should be "debug" or "application". onAlloc
  * and onFree are called when a client state structure is allocated or freed.
+ * onReceive is called from reactor_wait() when a client has sent data. data
+ * is stored in the server structure for use by these handlers.
  */
-tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData onAlloc, tcpServer_extraData onFree);
+tcpServer_t *tcpServer_open(int port, const char *access, tcpServer_extraData onAlloc, tcpServer_extraData onFree, tcpServer_receiveHandler onReceive, void *data);
 
 /**
- * Tries to close the server specified by server, deallocates all memory, and
- * sets the pointer to the server structure to null.
+ * Sets the maximum number of bytes which may be queued for a single client of
+ * the given server, and what to do when a client exceeds it:
+ * TCP_OVERFLOW_DISCONNECT or TCP_OVERFLOW_DROP. Defaults to TCP_MAX_QUEUED
+ * and TCP_OVERFLOW_DISCONNECT.
  */
-void tcpServer_close(tcpServer_t **server);
+void tcpServer_setOverflow(tcpServer_t *server, int maxQueued, int overflow);
 
 /**
- * Updates the server after a call to select_wait(). Accepts new incoming
- * connections and reads data from clients into our buffer where applicable.
+ * Tries to close the server specified by server, deallocates all memory, and
+ * sets the pointer to the server structure to null.
  */
-int tcpServer_update(tcpServer_t *server);
+void tcpServer_close(tcpServer_t **server);
 
 /**
  * Used for iterating over client IDs which resolve to established connections.
@@ -171,12 +352,42 @@ int tcpServer_nextClient(tcpServer_t *server, int clientID);
  */
 int tcpServer_receive(tcpServer_t *server, int clientID);
 
+/**
+ * Pulls at most maxSize bytes from the receive buffer for the specified client
+ * into buf. Returns the number of bytes copied, which is 0 if there are no
+ * bytes available, or -1 if the client does not exist.
+ */
+int tcpServer_receiveBuf(tcpServer_t *server, int clientID, unsigned char *buf, int maxSize);
+
+/**
+ * Passes data left in the receive buffers of the clients to the receive
+ * handler again, and resumes reading from the clients whose buffer it then
+ * drains. Meant for owners whose receive handler stopped pulling data
+ * because they could not take more at the time.
+ */
+int tcpServer_resume(tcpServer_t *server);
+
+/**
+ * Disconnects the specified client once the data queued for it so far has
+ * been sent, as far as possible without blocking, when the server is
+ * flushed. Data received from the client which has not been pulled yet is
+ * dropped, and so is data sent to the client from now on. Returns -1 if the
+ * client does not exist, or 0 otherwise.
+ */
+int tcpServer_disconnect(tcpServer_t *server, int clientID);
+
 /**
  * Returns the extra data structure for the given client, or null if there is
  * none.
  */
 void *tcpServer_getExtraData(tcpServer_t *server, int clientID);
 
+/**
+ * Returns the number of bytes waiting in the transmit queue of the given
+ * client, or -1 if the client does not exist.
+ */
+int tcpServer_getQueued(tcpServer_t *server, int clientID);
+
 /**
  * Sends byte b to the connection at index clientID.
  */
@@ -192,18 +403,45 @@ int tcpServer_broadcast(tcpServer_t *server, int b);
  */
 int tcpServer_sendStr(tcpServer_t *server, int clientID, const unsigned char *s);
 
+/**
+ * Sends size bytes from buf to the connection at index clientID.
+ */
+int tcpServer_sendBuf(tcpServer_t *server, int clientID, const unsigned char *buf, int size);
+
 /**
  * Broadcasts null-terminated string s to all connected clients.
  */
 int tcpServer_broadcastStr(tcpServer_t *server, const unsigned char *s);
 
 /**
- * Flushes the write buffer for the specified client.
+ * Allocates a transmit block with room for capacity bytes. The caller holds
+ * the only reference to it. Returns null if we're out of memory.
+ */
+tcpBlock_t *tcpServer_allocBlock(int capacity);
+
+/**
+ * Releases a reference to the given block, freeing it when this was the last
+ * one.
+ */
+void tcpServer_releaseBlock(tcpBlock_t *block);
+
+/**
+ * Queues the first size bytes of the given block for transmission to all
+ * connected clients, without copying the data. The clients take their own
+ * references, so the caller should still release its reference afterwards.
+ */
+int tcpServer_broadcastBlock(tcpServer_t *server, tcpBlock_t *block, int size);
+
+/**
+ * Writes as much of the transmit queue for the specified client to its
+ * socket as it will accept without blocking. The rest is sent when the socket
+ * becomes writable again. Clients whose connection has failed are closed.
  */
 int tcpServer_flushClient(tcpServer_t *server, int clientID);
 
 /**
- * Write all buffered data to the clients.
+ * Write all buffered data to the clients, as far as possible without
+ * blocking. Only clients which actually have data pending are visited.
  */
 int tcpServer_flush(tcpServer_t *server);
 
@@ -46,8 +46,16 @@
  * Copyright (C) 2008-2016 by TU Delft.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
+
 #include "timeout.h"
+#include "reactor.h"
 
 // Because of the incredible amount of platform dependence related to C
 // functions returning time accurately, I decided to put these in their own
@@ -72,3 +80,112 @@ int isTimedOut(int start, int timeout) {
   int dif = now - start;
   return dif > timeout;
 }
+
+/**
+ * Reactor handler for timer descriptors. Acknowledges the expiration and calls
+ * the user handler.
+ */
+static int onTimerReady(int f, int events, void *data) {
+  timeout_t *timer = (timeout_t*)data;
+  uint64_t expirations;
+  
+  // Read the expiration count to rearm the edge. If there is nothing to read,
+  // the timer was rearmed or canceled after it expired, so ignore it.
+  if (read(f, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+    if (errno == EAGAIN) {
+      return 0;
+    }
+    perror("Failed to read from timer");
+    return -1;
+  }
+  
+  if (timer->handler) {
+    return timer->handler(timer->data);
+  }
+  return 0;
+}
+
+/**
+ * Creates a disarmed timer and registers it with the reactor. Returns null if
+ * something goes wrong.
+ */
+timeout_t *timeout_open(timeoutHandler_t handler, void *data) {
+  timeout_t *timer;
+  
+  timer = (timeout_t*)malloc(sizeof(timeout_t));
+  if (!timer) {
+    perror("Failed to allocate timer");
+    return 0;
+  }
+  timer->handler = handler;
+  timer->data = data;
+  
+  // Create the timer descriptor.
+  timer->timerDesc = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer->timerDesc < 0) {
+    perror("Failed to create timer");
+    free(timer);
+    return 0;
+  }
+  
+  // Register it with the reactor.
+  if (reactor_register(timer->timerDesc, REACTOR_READ, &onTimerReady, timer) < 0) {
+    close(timer->timerDesc);
+    free(timer);
+    return 0;
+  }
+  
+  return timer;
+}
+
+/**
+ * Closes a timer, deallocates its memory and sets the pointer to null.
+ */
+void timeout_close(timeout_t **timer) {
+  
+  if (!timer || !*timer) {
+    return;
+  }
+  reactor_unregister((*timer)->timerDesc);
+  close((*timer)->timerDesc);
+  free(*timer);
+  *timer = 0;
+  
+}
+
+/**
+ * (Re)arms the timer such that it expires once, the specified amount of
+ * microseconds from now.
+ */
+int timeout_arm(timeout_t *timer, int timeout) {
+  struct itimerspec spec;
+  
+  // A zero it_value would disarm the timer, so expire after at least 1 us.
+  if (timeout < 1) {
+    timeout = 1;
+  }
+  spec.it_interval.tv_sec = 0;
+  spec.it_interval.tv_nsec = 0;
+  spec.it_value.tv_sec = timeout / 1000000;
+  spec.it_value.tv_nsec = (timeout % 1000000) * 1000;
+  if (timerfd_settime(timer->timerDesc, 0, &spec, 0) < 0) {
+    perror("Failed to arm timer");
+    return -1;
+  }
+  
+  return 0;
+}
+
+/**
+ * Disarms the timer.
+ */
+int timeout_cancel(timeout_t *timer) {
+  struct itimerspec spec = {{0, 0}, {0, 0}};
+  
+  if (timerfd_settime(timer->timerDesc, 0, &spec, 0) < 0) {
+    perror("Failed to cancel timer");
+    return -1;
+  }
+  
+  return 0;
+}
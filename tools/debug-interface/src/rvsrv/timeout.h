@@ -65,4 +65,56 @@ int startTimeout(void);
  */
 int isTimedOut(int start, int timeout);
 
+/**
+ * Called from reactor_wait() when a timer set up with timeout_open() expires.
+ * Should return -1 if an error occured or 0 if everything is OK.
+ */
+typedef int (*timeoutHandler_t)(void *data);
+
+/**
+ * State for a one-shot timer backed by a timerfd, which is registered with the
+ * reactor so the main loop wakes up exactly when the timer expires.
+ */
+typedef struct {
+  
+  /**
+   * timerfd descriptor.
+   */
+  int timerDesc;
+  
+  /**
+   * Function called when the timer expires, or null if the timer only needs
+   * to wake up the main loop.
+   */
+  timeoutHandler_t handler;
+  
+  /**
+   * User data passed to the handler.
+   */
+  void *data;
+  
+} timeout_t;
+
+/**
+ * Creates a disarmed timer and registers it with the reactor. Returns null if
+ * something goes wrong.
+ */
+timeout_t *timeout_open(timeoutHandler_t handler, void *data);
+
+/**
+ * Closes a timer, deallocates its memory and sets the pointer to null.
+ */
+void timeout_close(timeout_t **timer);
+
+/**
+ * (Re)arms the timer such that it expires once, the specified amount of
+ * microseconds from now.
+ */
+int timeout_arm(timeout_t *timer, int timeout);
+
+/**
+ * Disarms the timer.
+ */
+int timeout_cancel(timeout_t *timer);
+
 #endif
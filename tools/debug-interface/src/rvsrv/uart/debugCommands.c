@@ -52,7 +52,6 @@
 #include <string.h>
 
 #include "debugCommands.h"
-#include "uart_internal.h"
 #include "../serial.h"
 #include "../timeout.h"
 
@@ -61,29 +60,199 @@
 //#define PRINT_PACKETS
 
 //-----------------------------------------------------------------------------
-// Lowlevel packet handling
+// Link state
 //-----------------------------------------------------------------------------
 
 /**
- * CRC polynomial used for the debug packets.
+ * Defines an operation queue.
  */
-#define CRC_POLYNOMIAL 0x07
+typedef struct {
+  
+  /**
+  * Head (next operation to be executed) and tail of the operation queue.
+  */
+  operation_t *head;
+  operation_t *tail;
+  
+} operationQueue_t;
 
 /**
- * Updates an 8 bit CRC.  Code is based on one of the CRC methods from
- * http://www.zorc.breitbandkatze.de/crc.html.
+ * State of the debug link with a single rvex platform.
  */
-static void updateCrc(unsigned char *crc, const unsigned char data) {
-  unsigned char bit;
-  int i;
+struct debugLink {
   
-  for (i = 0x80; i; i >>= 1) {
-    bit = *crc & 0x80;
-    *crc <<= 1;
-    if (data & i) bit ^= 0x80;
-    if (bit) *crc ^= CRC_POLYNOMIAL;
-  }
+  /**
+   * Serial port which the hardware is connected to.
+   */
+  serial_t *port;
+  
+  /**
+   * Link statistics, see debugCommands_getStats().
+   */
+  debugStats_t stats;
+  
+  /**
+   * List of active streams, in the order in which they were opened.
+   */
+  debugStream_t *streamHead;
+  debugStream_t *streamTail;
+  
+  /**
+   * Stream which currently holds the hardware state lock (see OT_ACQUIRE),
+   * and the number of times it has acquired it.
+   */
+  debugStream_t *lockOwner;
+  int lockDepth;
+  
+  /**
+   * Operations for which we did not receive a reply which need to be issued
+   * again.
+   */
+  operationQueue_t reissueQueue;
+  
+  /**
+   * Contains the packet which was scheduled using the indexed sequence
+   * number. Valid only when slotsValid is set.
+   */
+  operation_t slots[16];
+  
+  /**
+   * Set to 1 when a slot is valid (has been sent, but with no reply yet) or
+   * 0 otherwise.
+   */
+  unsigned char slotsValid[16];
+  
+  /**
+   * Value returned by startTimeout() when the packet in the indexed slot was
+   * sent. Valid only when slotsValid is set.
+   */
+  int slotsSendTime[16];
+  
+  /**
+   * Transmit sequence counter. This is set to the next sequence number which
+   * should be used to send a command.
+   */
+  int txSeqCounter;
+  
+  /**
+   * Receive sequence counter. This is set to the sequence number which we're
+   * expecting to receive next, or 1 + the sequence number of the packet
+   * which we last received.
+   */
+  int rxSeqCounter;
+  
+  /**
+   * Current number of issued packets (sent, but no reply yet). This is the
+   * number of valid slots.
+   */
+  int numIssuedPackets;
+  
+  /**
+   * Current issue window, i.e. the maximum number of packets to be issued at
+   * the same time. This is halved whenever a packet is lost and grows by one
+   * after every window's worth of packets which did arrive.
+   */
+  int issueWindow;
+  
+  /**
+   * Number of replies received since the issue window was last changed.
+   */
+  int issueWindowCredit;
+  
+  /**
+   * Smoothed round trip time and round trip time variation in microseconds,
+   * and the retransmission timeout derived from them. These are maintained
+   * the same way TCP does (RFC 6298). The smoothed values are zero until the
+   * first measurement.
+   */
+  int smoothedRtt;
+  int rttVariation;
+  int retransmitTimeout;
+  
+  /**
+   * Timer which wakes up the main loop when the packets currently in flight
+   * time out.
+   */
+  timeout_t *retransmitTimer;
+  
+  /**
+   * Number of consecutive timeouts which occured without receiving anything
+   * from the hardware. When this exceeds TIMEOUT_RETRIES the link is assumed
+   * to be down, and the streams with commands in flight fail without waiting
+   * for each of their commands to run out of retries separately.
+   */
+  int silentTimeouts;
+  
+  /**
+   * Page which was last set using COMCODE_SET_PAGE, used to skip redundant
+   * page switches. Only valid when hwPageValid is set.
+   */
+  uint32_t hwPage;
+  int hwPageValid;
+  
+  /**
+   * Value returned by startTimeout() when the link last became busy, i.e.
+   * when we started waiting for replies. Only valid while busy is set.
+   */
+  int busySince;
+  int busy;
   
+  /**
+   * Copy of the statistics at the time of the last link summary, used to
+   * report on each busy period separately.
+   */
+  debugStats_t lastReport;
+  
+};
+
+//-----------------------------------------------------------------------------
+// Lowlevel packet handling
+//-----------------------------------------------------------------------------
+
+/**
+ * Lookup table for the 8 bit CRC used for the debug packets, with polynomial
+ * 0x07 (x^8 + x^2 + x + 1). Entry i is the CRC of the single byte i.
+ */
+static const unsigned char crcTable[256] = {
+  0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+  0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+  0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65,
+  0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+  0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5,
+  0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+  0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85,
+  0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+  0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2,
+  0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+  0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2,
+  0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+  0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32,
+  0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+  0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42,
+  0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+  0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C,
+  0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+  0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC,
+  0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+  0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C,
+  0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+  0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C,
+  0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+  0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B,
+  0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+  0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B,
+  0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+  0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB,
+  0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+  0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB,
+  0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3
+};
+
+/**
+ * Updates an 8 bit CRC.
+ */
+static inline void updateCrc(unsigned char *crc, const unsigned char data) {
+  *crc = crcTable[*crc ^ data];
 }
 
 /**
@@ -139,61 +308,42 @@ void printPacket(const packet_t *p) {
  * checksum are ignored. Return value is 1 if a packet was received and was
  * placed in packet, 0 if no packet is available, or -1 if an error occured.
  */
-static int receivePacket(packet_t *packet) {
-  int d, i;
+static int receivePacket(debugLink_t *link, packet_t *packet) {
+  unsigned char buffer[32];
+  int len, i;
   
-  // Receive buffer.
-  static unsigned char buffer[32];
-  
-  // Number of characters received already.
-  static int bufPtr = 0;
-  
-  // Pull data from the receive buffer until it's empty (we'll break if we
+  // Pull packets from the receive queue until it's empty (we'll return if we
   // find a valid packet).
-  while ((d = serial_debugReceive(tty)) >= 0) {
+  while ((len = serial_debugReceive(link->port, buffer)) >= 0) {
     
-    if (d > 255) {
-      
-      // End of packet marker. Make sure the packet is at least two bytes long
-      // and shorter than the size of the receive buffer.
-      if ((bufPtr < 2) || (bufPtr > 32)) {
-        bufPtr = 0;
-        continue;
-      }
-      
-      // Assemble the packet.
-      packet->commandCode = buffer[0];
-      packet->crc = buffer[bufPtr - 1];
-      packet->len = bufPtr - 2;
-      for (i = 0; i < packet->len; i++) {
-        packet->data[i] = buffer[i + 1];
-      }
-      
-      // Reset the receive buffer.
-      bufPtr = 0;
-      
-      // Return the packet if the CRC is correct.
-      if (crcPacket(packet) == packet->crc) {
+    // Make sure the packet is at least two bytes long. The serial unit already
+    // drops packets which are too long.
+    if (len < 2) {
+      link->stats.crcDrops++;
+      continue;
+    }
+    
+    // Assemble the packet.
+    packet->commandCode = buffer[0];
+    packet->crc = buffer[len - 1];
+    packet->len = len - 2;
+    for (i = 0; i < packet->len; i++) {
+      packet->data[i] = buffer[i + 1];
+    }
+    
+    // Return the packet if the CRC is correct.
+    if (crcPacket(packet) == packet->crc) {
 #ifdef PRINT_PACKETS
-        printf("rxp ");
-        printPacket(packet);
+      printf("rxp ");
+      printPacket(packet);
 #endif
-        return 1;
-      } else {
+      return 1;
+    } else {
 #ifdef PRINT_PACKETS
-        printf("rxp discard ");
-        printPacket(packet);
+      printf("rxp discard ");
+      printPacket(packet);
 #endif
-      }
-      
-    } else {
-      
-      // Append the byte to the buffer.
-      if (bufPtr < 32) {
-        buffer[bufPtr] = d;
-      }
-      bufPtr++;
-      
+      link->stats.crcDrops++;
     }
     
   }
@@ -207,8 +357,8 @@ static int receivePacket(packet_t *packet) {
  * Transmits a packet. Returns -1 if transmitting failed, or 0 if the transmit
  * was successful.
  */
-static int transmitPacket(packet_t *packet) {
-  int i;
+static int transmitPacket(debugLink_t *link, packet_t *packet) {
+  unsigned char buffer[32];
   
   // Compute the CRC of the packet.
   packet->crc = crcPacket(packet);
@@ -218,21 +368,11 @@ static int transmitPacket(packet_t *packet) {
   printPacket(packet);
 #endif
   
-  // Transmit the packet.
-  if (serial_debugSend(tty, packet->commandCode) < 0) {
-    return -1;
-  }
-  for (i = 0; i < packet->len; i++) {
-    if (serial_debugSend(tty, packet->data[i]) < 0) {
-      return -1;
-    }
-  }
-  if (serial_debugSend(tty, packet->crc) < 0) {
-    return -1;
-  }
-  
-  // Send the end-of-packet marker.
-  if (serial_debugSend(tty, 256) < 0) {
+  // Assemble the packet and transmit it in one go.
+  buffer[0] = packet->commandCode;
+  memcpy(buffer + 1, packet->data, packet->len);
+  buffer[packet->len + 1] = packet->crc;
+  if (serial_debugSend(link->port, buffer, packet->len + 2, 0) < 0) {
     return -1;
   }
   
@@ -246,19 +386,6 @@ static int transmitPacket(packet_t *packet) {
 // Operation queue
 //-----------------------------------------------------------------------------
 
-/**
- * Defines an operation queue.
- */
-typedef struct {
-  
-  /**
-  * Head (next operation to be executed) and tail of the operation queue.
-  */
-  operation_t *head;
-  operation_t *tail;
-  
-} operationQueue_t;
-
 /**
  * Pushes the given operation into the queue. Returns -1 if something goes
  * wrong.
@@ -353,88 +480,325 @@ static void opQueueFree(operationQueue_t *queue) {
 //-----------------------------------------------------------------------------
 
 /**
- * Incoming operations which need to be schedueled.
+ * Operation stream.
  */
-static operationQueue_t opQueue = {0, 0};
+struct debugStream {
+  
+  /**
+   * Link which the stream belongs to.
+   */
+  debugLink_t *link;
+  
+  /**
+   * Operations which still need to be scheduled.
+   */
+  operationQueue_t queue;
+  
+  /**
+   * Client which the stream belongs to, see debugCommands_openStream().
+   */
+  uint32_t owner;
+  
+  /**
+   * Whether this stream is ordered with respect to all other streams from the
+   * same owner.
+   */
+  int ordered;
+  
+  /**
+   * Number of commands from this stream which have been issued, but for
+   * which we did not receive a reply yet. This includes commands waiting in
+   * the reissue queue.
+   */
+  int pending;
+  
+  /**
+   * Set when the stream issued a command which later operations depend on, so
+   * the stream should not continue until all its pending commands have
+   * completed.
+   */
+  int drain;
+  
+  /**
+   * Set by debugCommands_closeStream().
+   */
+  int closed;
+  
+  /**
+   * Next stream in the list of active streams.
+   */
+  struct debugStream *next;
+  
+};
 
 /**
- * Operations for which we did not receive a reply which need to be issued
- * again.
+ * Removes the given stream from the stream list and frees it. The operation
+ * queue should be empty.
  */
-static operationQueue_t reissueQueue = {0, 0};
+static void freeStream(debugStream_t *stream) {
+  debugLink_t *link = stream->link;
+  debugStream_t **ptr;
+  
+  // Find the pointer which points to the stream and unlink it.
+  ptr = &link->streamHead;
+  link->streamTail = 0;
+  while (*ptr) {
+    if (*ptr == stream) {
+      *ptr = stream->next;
+    } else {
+      link->streamTail = *ptr;
+      ptr = &((*ptr)->next);
+    }
+  }
+  
+  // Release the lock if the stream still held it.
+  if (link->lockOwner == stream) {
+    link->lockOwner = 0;
+    link->lockDepth = 0;
+  }
+  
+  opQueueFree(&stream->queue);
+  free(stream);
+}
 
 /**
- * Contains the packet which was scheduled using the indexed sequence number.
- * Valid only when slotsValid is set.
+ * Minimum and maximum number of packets to be issued at the same time. The
+ * maximum must stay well below the number of sequence numbers, so late
+ * replies to packets which have already been reissued can't be mistaken for
+ * replies to newer packets.
  */
-static operation_t slots[16];
+#define MIN_NUM_ISSUED_PACKETS 1
+#define MAX_NUM_ISSUED_PACKETS 8
 
 /**
- * Set to 1 when a slot is valid (has been sent, but with no reply yet) or
- * 0 otherwise.
+ * Initial, minimum and maximum retransmission timeout in microseconds.
  */
-static unsigned char slotsValid[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#define TIMEOUT_USEC     50000
+#define MIN_TIMEOUT_USEC 5000
+#define MAX_TIMEOUT_USEC 200000
 
 /**
- * Transmit sequence counter. This is set to the next sequence number which
- * should be used to send a command.
+ * Number of times to retry a command after not receiving a reply before
+ * returning an error to the next layer of abstraction. Only the stream which
+ * the command belongs to fails, and retries are cheap because the timeout
+ * adapts to the link, so this can be fairly generous.
  */
-static int txSeqCounter = 0;
+#define TIMEOUT_RETRIES 8
 
 /**
- * Receive sequence counter. This is set to the sequence number which we're
- * expecting to receive next, or 1 + the sequence number of the packet which
- * we last received.
+ * Minimum busy time in microseconds for which a summary of the link
+ * statistics is logged when the link becomes idle again.
  */
-static int rxSeqCounter = 0;
+#define REPORT_USEC 1000000
 
 /**
- * Current number of issued packets (sent, but no reply yet).
+ * Updates the round trip time estimate using the given measurement in
+ * microseconds.
  */
-static int numIssuedPackets = 0;
+static void updateRtt(debugLink_t *link, int rtt) {
+  int delta;
+  
+  if (rtt < 0) {
+    return;
+  }
+  
+  if (!link->smoothedRtt) {
+    
+    // First measurement.
+    link->smoothedRtt = rtt;
+    link->rttVariation = rtt / 2;
+    
+  } else {
+    
+    // rttVariation = 3/4 rttVariation + 1/4 |smoothedRtt - rtt|
+    // smoothedRtt  = 7/8 smoothedRtt  + 1/8 rtt
+    delta = link->smoothedRtt - rtt;
+    if (delta < 0) delta = -delta;
+    link->rttVariation += (delta - link->rttVariation) / 4;
+    link->smoothedRtt += (rtt - link->smoothedRtt) / 8;
+    
+  }
+  
+  // Derive the retransmission timeout.
+  link->retransmitTimeout = link->smoothedRtt + 4 * link->rttVariation;
+  if (link->retransmitTimeout < MIN_TIMEOUT_USEC) link->retransmitTimeout = MIN_TIMEOUT_USEC;
+  if (link->retransmitTimeout > MAX_TIMEOUT_USEC) link->retransmitTimeout = MAX_TIMEOUT_USEC;
+  
+}
 
 /**
- * Maximum number of packets to be issued at the same time.
+ * Removes all operations belonging to the given stream from the given queue,
+ * without calling their callback functions.
  */
-#define MAX_NUM_ISSUED_PACKETS 4
+static void opQueueRemoveStream(operationQueue_t *queue, const debugStream_t *stream) {
+  operation_t **ptr, *op;
+  
+  ptr = &queue->head;
+  queue->tail = 0;
+  while ((op = *ptr)) {
+    if (op->stream == stream) {
+      *ptr = op->next;
+      free(op);
+    } else {
+      queue->tail = op;
+      ptr = &op->next;
+    }
+  }
+}
 
 /**
- * Value returned by startTimeout() when we last received a valid packet from
- * the hardware.
+ * Fails all remaining operations of the given stream after one of its
+ * commands exceeded the retry limit, and frees the stream. Commands from
+ * other streams are not affected. Returns -1 if a callback function fails.
  */
-static int timeoutTime = 0;
+static int failStream(debugStream_t *stream) {
+  debugLink_t *link = stream->link;
+  operation_t *op;
+  int i;
+  
+  // Forget about the commands which are still in flight or waiting to be
+  // reissued.
+  for (i = 0; i < 16; i++) {
+    if (link->slotsValid[i] && (link->slots[i].stream == stream)) {
+      link->slotsValid[i] = 0;
+      link->numIssuedPackets--;
+    }
+  }
+  opQueueRemoveStream(&link->reissueQueue, stream);
+  stream->pending = 0;
+  
+  // We don't know whether a page switch from this stream made it to the
+  // hardware.
+  link->hwPageValid = 0;
+  
+  // Call the callback functions of the remaining operations with failure
+  // specified.
+  while ((op = opQueuePeek(&stream->queue))) {
+    if (op->cb) {
+      if (op->cb(0, ((op->t == OT_COMMAND) ? &op->p : 0), 0, op->cbData) < 0) {
+        return -1;
+      }
+    }
+    opQueuePop(&stream->queue);
+  }
+  freeStream(stream);
+  
+  return 0;
+}
 
 /**
- * Timeout in microseconds.
+ * Takes the packet in the given slot out of flight and puts it in the reissue
+ * queue, or fails its stream if it has been retried too often already. This
+ * is called when the packet was lost, so the issue window shrinks as well.
+ * Returns -1 if a callback function fails.
  */
-#define TIMEOUT_USEC 50000
+static int requeueSlot(debugLink_t *link, int sequence) {
+  
+  if (!link->slotsValid[sequence]) {
+    return 0;
+  }
+  link->slotsValid[sequence] = 0;
+  link->numIssuedPackets--;
+  
+  // Halve the issue window.
+  link->issueWindow /= 2;
+  if (link->issueWindow < MIN_NUM_ISSUED_PACKETS) link->issueWindow = MIN_NUM_ISSUED_PACKETS;
+  link->issueWindowCredit = 0;
+  
+  // Give up on the stream if we've tried often enough.
+  if (++link->slots[sequence].retries > TIMEOUT_RETRIES) {
+    link->stats.failedCommands++;
+    return failStream(link->slots[sequence].stream);
+  }
+  
+  link->stats.retransmits++;
+  return opQueuePush(&link->reissueQueue, &(link->slots[sequence]));
+}
 
 /**
- * Number of times where we had a timeout occur without receiving *anything*
- * from the hardware.
+ * Puts the packets from the current expected sequence number to the given
+ * sequence number (exclusive) in the reissue queue, so they get resent.
+ * Returns -1 if a callback function fails.
  */
-static int timeoutCount = 0;
+static int requeueUntil(debugLink_t *link, int sequence) {
+  while (link->rxSeqCounter != sequence) {
+    if (requeueSlot(link, link->rxSeqCounter) < 0) {
+      return -1;
+    }
+    link->rxSeqCounter++;
+    link->rxSeqCounter &= 0xF;
+  }
+  return 0;
+}
 
 /**
- * Number of times to retry after not receiving a reply before returning an
- * error to the next layer of abstraction.
+ * Requeues the packets which have been in flight for longer than the
+ * retransmission timeout. Returns -1 if a callback function fails.
  */
-#define TIMEOUT_RETRIES 3
+static int handleTimeouts(debugLink_t *link) {
+  int i, now, timedOut = 0;
+  
+  now = startTimeout();
+  for (i = 0; i < 16; i++) {
+    if (link->slotsValid[i] && (now - link->slotsSendTime[i] > link->retransmitTimeout)) {
+      link->stats.timeouts++;
+      timedOut = 1;
+      if (requeueSlot(link, i) < 0) {
+        return -1;
+      }
+    }
+  }
+  
+  if (!timedOut) {
+    return 0;
+  }
+  
+  // Back off when packets time out, in case the link is slower than we think.
+  link->retransmitTimeout *= 2;
+  if (link->retransmitTimeout > MAX_TIMEOUT_USEC) link->retransmitTimeout = MAX_TIMEOUT_USEC;
+  
+  // If we haven't heard from the hardware in a long time, fail all commands
+  // which are still waiting for a reply.
+  if (++link->silentTimeouts > TIMEOUT_RETRIES) {
+    link->silentTimeouts = 0;
+    for (i = 0; i < 16; i++) {
+      if (link->slotsValid[i]) {
+        link->stats.failedCommands++;
+        if (failStream(link->slots[i].stream) < 0) {
+          return -1;
+        }
+      }
+    }
+    while (opQueuePeek(&link->reissueQueue)) {
+      link->stats.failedCommands++;
+      if (failStream(opQueuePeek(&link->reissueQueue)->stream) < 0) {
+        return -1;
+      }
+    }
+  }
+  
+  return 0;
+}
 
 /**
- * Puts the packets from the current expected sequence number to the given
- * sequence number (exclusive) in the reissue queue, so they get resent.
+ * Returns the number of microseconds until the first packet in flight times
+ * out, or -1 if there are no packets in flight.
  */
-static void requeueUntil(int sequence) {
-  while (rxSeqCounter != sequence) {
-    if (slotsValid[rxSeqCounter]) {
-      slotsValid[rxSeqCounter] = 0;
-      opQueuePush(&reissueQueue, &(slots[rxSeqCounter]));
+static int nextTimeout(debugLink_t *link) {
+  int i, now, remain, first = -1;
+  
+  now = startTimeout();
+  for (i = 0; i < 16; i++) {
+    if (link->slotsValid[i]) {
+      remain = link->retransmitTimeout - (now - link->slotsSendTime[i]);
+      if (remain < 0) remain = 0;
+      if ((first < 0) || (remain < first)) {
+        first = remain;
+      }
     }
-    rxSeqCounter++;
-    rxSeqCounter &= 0xF;
-    numIssuedPackets--;
   }
+  
+  return first;
 }
 
 /**
@@ -442,37 +806,70 @@ static void requeueUntil(int sequence) {
  * on failure, 0 if no packets were available, or 1 if at least one packet
  * has been handled.
  */
-static int receivePackets(void) {
+static int receivePackets(debugLink_t *link) {
   int retval;
   packet_t receivedPacket;
   int sequence;
   int receivedAnything = 0;
   
   // Handle received packets.
-  while ((retval = receivePacket(&receivedPacket))) {
+  while ((retval = receivePacket(link, &receivedPacket))) {
     if (retval < 0) {
       return -1;
     }
     
     // Update sequencing.
     sequence = getPacketSequence(&receivedPacket);
+    link->silentTimeouts = 0;
+    
+    // Ignore replies for packets which are not in flight anymore; these are
+    // late replies to packets which we've already reissued.
+    if (!link->slotsValid[sequence]) {
+      link->stats.staleReplies++;
+      continue;
+    }
     
     // If this is not the packet we were expecting, put all the packets which
-    // were skipped in the re-issue queue.
-    requeueUntil(sequence);
+    // were skipped in the re-issue queue. The hardware replies in order, so
+    // these must have been lost.
+    if (requeueUntil(link, sequence) < 0) {
+      return -1;
+    }
+    if (!link->slotsValid[sequence]) {
+      continue;
+    }
     
-    // Call the appropriate callback function.
-    if (slotsValid[sequence] && slots[sequence].cb) {
-      if (slots[sequence].cb(1, &slots[sequence].p, &receivedPacket, slots[sequence].cbData) < 0) {
-        return -1;
+    // Mark the slot as free before calling the callback function.
+    link->slotsValid[sequence] = 0;
+    link->rxSeqCounter = (sequence + 1) & 0xF;
+    link->numIssuedPackets--;
+    
+    // Only packets which were not retransmitted give an unambiguous round
+    // trip time measurement.
+    if (!link->slots[sequence].retries) {
+      updateRtt(link, startTimeout() - link->slotsSendTime[sequence]);
+    }
+    
+    // Grow the issue window by one after a window's worth of replies.
+    if (++link->issueWindowCredit >= link->issueWindow) {
+      link->issueWindowCredit = 0;
+      if (link->issueWindow < MAX_NUM_ISSUED_PACKETS) {
+        link->issueWindow++;
       }
     }
     
-    // Mark the packet which was sent with the same sequence number as valid.
-    slotsValid[sequence] = 0;
-    rxSeqCounter++;
-    rxSeqCounter &= 0xF;
-    numIssuedPackets--;
+    // Update statistics.
+    link->stats.completedCommands++;
+    link->stats.payloadBytes += link->slots[sequence].p.len + receivedPacket.len;
+    
+    // Call the appropriate callback function and let the stream know that the
+    // command has completed.
+    link->slots[sequence].stream->pending--;
+    if (link->slots[sequence].cb) {
+      if (link->slots[sequence].cb(1, &link->slots[sequence].p, &receivedPacket, link->slots[sequence].cbData) < 0) {
+        return -1;
+      }
+    }
     
     // Remember that we've handled a packet.
     receivedAnything = 1;
@@ -487,59 +884,189 @@ static int receivePackets(void) {
  * Returns nonzero if the re-issue queue is empty and we're not waiting for any
  * ack packets.
  */
-static int isIdle(void) {
-  return (!numIssuedPackets) && (!opQueuePeek(&reissueQueue));
+static int isIdle(debugLink_t *link) {
+  return (!link->numIssuedPackets) && (!opQueuePeek(&link->reissueQueue));
 }
 
 /**
  * Tries to send a packet using the next available sequence number. Returns 1
  * if the packet was issued, 0 if not, or -1 if an error occured.
  */
-static int issueCommandOperation(operation_t *operation) {
+static int issueCommandOperation(debugLink_t *link, operation_t *operation) {
   
   // Make sure we're not issuing too much.
-  if (numIssuedPackets >= MAX_NUM_ISSUED_PACKETS) {
+  if (link->numIssuedPackets >= link->issueWindow) {
     return 0;
   }
   
   // Make sure the slot is clear.
-  if (slotsValid[txSeqCounter]) {
+  if (link->slotsValid[link->txSeqCounter]) {
     return 0;
   }
   
   // Set the sequence number.
-  setPacketSequence(&(operation->p), txSeqCounter);
+  setPacketSequence(&(operation->p), link->txSeqCounter);
   
   // Transmit the packet.
-  if (transmitPacket(&(operation->p)) < -1) {
+  if (transmitPacket(link, &(operation->p)) < 0) {
     return -1;
   }
+  link->stats.packetsSent++;
   
   // Update sequencing logic.
-  slots[txSeqCounter] = *operation;
-  slotsValid[txSeqCounter] = 1;
-  txSeqCounter++;
-  txSeqCounter &= 0xF;
+  link->slots[link->txSeqCounter] = *operation;
+  link->slotsValid[link->txSeqCounter] = 1;
+  link->slotsSendTime[link->txSeqCounter] = startTimeout();
+  link->txSeqCounter++;
+  link->txSeqCounter &= 0xF;
   
   // Increment the number of issued packets.
-  numIssuedPackets++;
+  link->numIssuedPackets++;
   
   // Packet has been issued.
   return 1;
 }
 
 /**
- * Tries to (re)issue as much commands as possible.
+ * Returns nonzero if the given stream is allowed to issue operations, i.e.
+ * if there are no earlier streams from the same owner which it should be
+ * ordered with.
  */
-static int transmitPackets(void) {
+static int streamMayIssue(const debugStream_t *stream) {
+  debugLink_t *link = stream->link;
+  const debugStream_t *s;
+  
+  for (s = link->streamHead; s != stream; s = s->next) {
+    if ((s->owner == stream->owner) && (s->ordered || stream->ordered)) {
+      return 0;
+    }
+  }
+  
+  return 1;
+}
+
+/**
+ * Tries to execute the next operation in the given stream. Returns 1 if an
+ * operation was executed, 0 if the stream is blocked or empty, or -1 if an
+ * error occured.
+ */
+static int stepStream(debugStream_t *stream) {
+  debugLink_t *link = stream->link;
   operation_t *op;
+  uint32_t page;
   int retval;
   
+  // Wait for the commands which the next operation depends on.
+  if (stream->drain) {
+    if (stream->pending) {
+      return 0;
+    }
+    stream->drain = 0;
+  }
+  
+  op = opQueuePeek(&stream->queue);
+  if (!op) {
+    return 0;
+  }
+  
+  // Try to execute the operation.
+  switch (op->t) {
+    
+    case OT_COMMAND:
+      
+      // Try to issue the packet.
+      retval = issueCommandOperation(link, op);
+      if (retval <= 0) {
+        return retval;
+      }
+      stream->pending++;
+      break;
+    
+    case OT_SET_PAGE:
+      
+      // Skip the command if the hardware is already on the requested page.
+      page = ((uint32_t)op->p.data[0] << 24) | ((uint32_t)op->p.data[1] << 16) | ((uint32_t)(op->p.data[2] & 0xF0) << 8);
+      if (link->hwPageValid && (link->hwPage == page)) {
+        link->stats.pageSwitchesSkipped++;
+        if (op->cb) {
+          if (op->cb(1, 0, 0, op->cbData) < 0) {
+            opQueuePop(&stream->queue);
+            return -1;
+          }
+        }
+        break;
+      }
+      
+      // We can't change the page while any previous writes may not have been
+      // completed, and later writes must wait until the page has changed.
+      if (stream->pending) {
+        return 0;
+      }
+      retval = issueCommandOperation(link, op);
+      if (retval <= 0) {
+        return retval;
+      }
+      stream->pending++;
+      stream->drain = 1;
+      link->hwPage = page;
+      link->hwPageValid = 1;
+      break;
+    
+    case OT_BARRIER:
+    case OT_ACQUIRE:
+    case OT_RELEASE:
+      
+      // Barrier-like operations wait until all previous commands in the
+      // stream have completed.
+      if (stream->pending) {
+        return 0;
+      }
+      
+      // Handle the lock.
+      if (op->t == OT_ACQUIRE) {
+        if (link->lockOwner && (link->lockOwner != stream)) {
+          return 0;
+        }
+        link->lockOwner = stream;
+        link->lockDepth++;
+      } else if (op->t == OT_RELEASE) {
+        if ((link->lockOwner == stream) && !--link->lockDepth) {
+          link->lockOwner = 0;
+        }
+      }
+      
+      // Call the callback function.
+      if (op->cb) {
+        if (op->cb(1, 0, 0, op->cbData) < 0) {
+          
+          // We can't call the callback twice, so we need to pop here.
+          opQueuePop(&stream->queue);
+          return -1;
+        }
+      }
+      break;
+      
+  }
+  
+  // Operation executed, pop it from the queue.
+  opQueuePop(&stream->queue);
+  
+  return 1;
+}
+
+/**
+ * Tries to (re)issue as much commands as possible.
+ */
+static int transmitPackets(debugLink_t *link) {
+  operation_t *op;
+  debugStream_t *stream, *next;
+  int retval, progress;
+  
   // Try to re-issue commands which failed before.
-  while ((op = opQueuePeek(&reissueQueue))) {
+  while ((op = opQueuePeek(&link->reissueQueue))) {
     
     // Try to issue the packet.
-    retval = issueCommandOperation(op);
+    retval = issueCommandOperation(link, op);
     if (retval < 0) {
       return -1;
     } else if (retval == 0) {
@@ -547,167 +1074,300 @@ static int transmitPackets(void) {
     }
     
     // Packet issued, pop it from the queue.
-    opQueuePop(&reissueQueue);
+    opQueuePop(&link->reissueQueue);
     
   }
   
-  // Try to issue new commands.
-  while ((op = opQueuePeek(&opQueue))) {
-    
-    // Try to execute the operation.
-    switch (op->t) {
+  // Try to issue new commands. We execute one operation per stream at a time
+  // in a round-robin fashion, so a large request from one client doesn't
+  // starve the others.
+  do {
+    progress = 0;
+    for (stream = link->streamHead; stream; stream = next) {
       
-      case OT_COMMAND:
-        
-        // Try to issue the packet.
-        retval = issueCommandOperation(op);
+      // Try to execute an operation from this stream.
+      if (streamMayIssue(stream)) {
+        retval = stepStream(stream);
         if (retval < 0) {
           return -1;
-        } else if (retval == 0) {
-          return 0;
+        } else if (retval > 0) {
+          progress = 1;
         }
-        break;
+      }
+      
+      // Free the stream once it has completed.
+      next = stream->next;
+      if (stream->closed && !stream->pending && !opQueuePeek(&stream->queue)) {
+        freeStream(stream);
+      }
       
-      case OT_BARRIER:
-        
-        // Pop the barrier command only when we're idle.
-        if (!isIdle()) {
-          return 0;
-        }
-        
-        // Call the callback function.
-        if (op->cb) {
-          if (op->cb(1, 0, 0, op->cbData) < 0) {
-            
-            // We can't call the callback twice, so we need to pop here.
-            opQueuePop(&opQueue);
-            return -1;
-          }
-        }
-        break;
-        
     }
-    
-    // Operation executed, pop it from the queue.
-    opQueuePop(&opQueue);
-    
-  }
+  } while (progress);
   
   return 0;
 }
 
 /**
- * Resets and frees the queues and issue slots. Should be called when the
- * application terminates and when the maximum retry count has been reached
- * for a command.
+ * Resets and frees the queues, streams and issue slots. Should be called when
+ * the application terminates and when the maximum retry count has been
+ * reached for a command.
  */
-static int resetQueue(void) {
+static int resetQueue(debugLink_t *link) {
   int i;
   operation_t *op;
+  debugStream_t *stream;
   
   // Clear the list of currently issued commands.
   for (i = 0; i < 16; i++) {
-    slotsValid[i] = 0;
+    link->slotsValid[i] = 0;
   }
-  rxSeqCounter = txSeqCounter;
-  numIssuedPackets = 0;
+  link->rxSeqCounter = link->txSeqCounter;
+  link->numIssuedPackets = 0;
+  link->silentTimeouts = 0;
+  link->hwPageValid = 0;
   
   // Clear the retransmission queue.
-  opQueueFree(&reissueQueue);
+  opQueueFree(&link->reissueQueue);
   
-  // Clear the operation queue, while calling the callback functions with
-  // failure specified.
-  while ((op = opQueuePeek(&opQueue))) {
-    
-    // Call the callback function.
-    if (op->cb) {
-      if (op->cb(0, ((op->t == OT_COMMAND) ? &op->p : 0), 0, op->cbData) < 0) {
-        return -1;
+  // Clear the streams, while calling the callback functions with failure
+  // specified.
+  while ((stream = link->streamHead)) {
+    while ((op = opQueuePeek(&stream->queue))) {
+      
+      // Call the callback function.
+      if (op->cb) {
+        if (op->cb(0, ((op->t == OT_COMMAND) ? &op->p : 0), 0, op->cbData) < 0) {
+          return -1;
+        }
       }
+      
+      // Pop the operation.
+      opQueuePop(&stream->queue);
+      
     }
-    
-    // Pop the operation.
-    opQueuePop(&opQueue);
-    
+    freeStream(stream);
   }
   
   return 0;
 }
 
 /**
- * Returns nonzero if all pending commands have been issued.
+ * Initializes the debug command system for the hardware connected to the
+ * given serial port. Must be called after reactor_init(). Returns null if an
+ * error occurs.
  */
-static int isDone(void) {
-  return (!opQueuePeek(&opQueue) && isIdle());
+debugLink_t *debugCommands_init(serial_t *port) {
+  debugLink_t *link;
+  
+  link = (debugLink_t*)malloc(sizeof(debugLink_t));
+  if (!link) {
+    perror("Failed to allocate debug link");
+    return 0;
+  }
+  memset((void*)link, 0, sizeof(debugLink_t));
+  link->port = port;
+  link->issueWindow = 4;
+  link->retransmitTimeout = TIMEOUT_USEC;
+  
+  // Create the retransmission timer. It doesn't need a handler, because the
+  // main loop calls debugCommands_update() after every wakeup.
+  link->retransmitTimer = timeout_open(0, 0);
+  if (!link->retransmitTimer) {
+    free(link);
+    return 0;
+  }
+  
+  return link;
 }
 
 /**
- * Updates the debug command system. Returns -1 if an error occured, 0 if the
- * system is idle, or 1 if we want update to be called quickly again to handle
- * potential timeouts.
+ * Keeps track of the time during which the link is busy and logs a summary of
+ * the link statistics when the link becomes idle after a long busy period.
  */
-int debugCommands_update(void) {
-  int receivedAnything;
+static void updateBusy(debugLink_t *link) {
+  int now = startTimeout();
+  uint64_t busyUsec;
+  debugStats_t d;
+  
+  if (!link->busy && !isIdle(link)) {
+    link->busy = 1;
+    link->busySince = now;
+    return;
+  }
+  if (!link->busy || !isIdle(link)) {
+    return;
+  }
+  
+  // The link just became idle.
+  link->busy = 0;
+  link->stats.busyUsec += (uint32_t)(now - link->busySince);
+  busyUsec = link->stats.busyUsec - link->lastReport.busyUsec;
+  if (busyUsec < REPORT_USEC) {
+    return;
+  }
+  
+  // Report on everything which happened since the last report.
+  d = link->stats;
+  d.completedCommands -= link->lastReport.completedCommands;
+  d.payloadBytes -= link->lastReport.payloadBytes;
+  d.retransmits -= link->lastReport.retransmits;
+  d.timeouts -= link->lastReport.timeouts;
+  d.crcDrops -= link->lastReport.crcDrops;
+  d.staleReplies -= link->lastReport.staleReplies;
+  d.failedCommands -= link->lastReport.failedCommands;
+  printf("UART link: %llu commands, %llu bytes/s, %llu retransmits (%llu timeouts), "
+    "%llu CRC drops, %llu stale replies, %llu failed, RTT %d us, RTO %d us, window %d\n",
+    (unsigned long long)d.completedCommands,
+    (unsigned long long)(d.payloadBytes * 1000000 / busyUsec),
+    (unsigned long long)d.retransmits, (unsigned long long)d.timeouts,
+    (unsigned long long)d.crcDrops, (unsigned long long)d.staleReplies,
+    (unsigned long long)d.failedCommands,
+    link->smoothedRtt, link->retransmitTimeout, link->issueWindow);
+  link->lastReport = link->stats;
+  
+}
+
+/**
+ * Updates the debug command system. Returns -1 if an error occured or 0
+ * otherwise. Retransmission timeouts are handled by a timer registered with
+ * the reactor, which wakes up the main loop when it expires.
+ */
+int debugCommands_update(debugLink_t *link) {
+  int timeout;
   
   // Receive and handle incoming packets.
-  receivedAnything = receivePackets();
-  if (receivedAnything < 0) {
+  if (receivePackets(link) < 0) {
     return -1;
   }
   
-  // Reset the timeout and retry count if we've received a packet or if there
-  // are no packets in the queue.
-  if (receivedAnything || isIdle()) {
-    timeoutTime = startTimeout();
-    timeoutCount = 0;
-  } else {
-    
-    // Handle timeouts.
-    if (isTimedOut(timeoutTime, TIMEOUT_USEC)) {
-      
-      // Increment the number of times we've tried.
-      timeoutCount++;
-      
-      // Either retry or fail depending on the amount of times we've failed
-      // already.
-      if (timeoutCount >= TIMEOUT_RETRIES) {
-        
-        // Fail completely.
-        if (resetQueue() < 0) {
-          return -1;
-        }
-        
-      } else {
-        
-        // Try to resend the commands currently in the pipeline.
-        requeueUntil(txSeqCounter);
-        
-      }
-      
-    }
-    
+  // Requeue the packets which have timed out.
+  if (handleTimeouts(link) < 0) {
+    return -1;
   }
   
   // Try to issue new commands.
-  if (transmitPackets() < 0) {
+  if (transmitPackets(link) < 0) {
     return -1;
   }
+  updateBusy(link);
+  
+  // If we're waiting for replies, make sure we get woken up when the first
+  // one times out. When new commands are waiting to be issued we're waiting
+  // for replies as well, so that case is covered too.
+  if (link->retransmitTimer) {
+    timeout = nextTimeout(link);
+    if (timeout < 0) {
+      if (timeout_cancel(link->retransmitTimer) < 0) {
+        return -1;
+      }
+    } else {
+      if (timeout_arm(link->retransmitTimer, timeout + 1) < 0) {
+        return -1;
+      }
+    }
+  }
   
-  // Return 1 if we're not done yet, so update will be called again soon
-  // whether new data is available or not.
-  return !isDone();
+  return 0;
 }
 
 /**
- * Queues an operation. Returns -1 if an error occurs, or 0 on success.
+ * Opens a new operation stream on the given link. owner identifies the client
+ * which the stream belongs to. Streams with the same owner are ordered with
+ * respect to each other when either of them has ordered set: such a stream
+ * does not start issuing until all earlier streams of the same owner have
+ * completed, and later streams of the same owner wait for it. Returns null if
+ * an error occurs.
  */
-int debugCommands_queue(const operation_t *op) {
-  return opQueuePush(&opQueue, op);
+debugStream_t *debugCommands_openStream(debugLink_t *link, uint32_t owner, int ordered) {
+  debugStream_t *stream;
+  
+  stream = (debugStream_t*)malloc(sizeof(debugStream_t));
+  if (!stream) {
+    perror("Failed to allocate operation stream");
+    return 0;
+  }
+  stream->link = link;
+  stream->queue.head = 0;
+  stream->queue.tail = 0;
+  stream->owner = owner;
+  stream->ordered = ordered;
+  stream->pending = 0;
+  stream->drain = 0;
+  stream->closed = 0;
+  stream->next = 0;
+  
+  // Append the stream to the list.
+  if (link->streamTail) {
+    link->streamTail->next = stream;
+  } else {
+    link->streamHead = stream;
+  }
+  link->streamTail = stream;
+  
+  return stream;
 }
 
 /**
- * Frees all dynamically allocated memory by the debugCommands unit.
+ * Queues an operation in the given stream. Returns -1 if an error occurs, or
+ * 0 on success.
  */
-void debugCommands_free(void) {
-  resetQueue();
+int debugCommands_queue(debugStream_t *stream, const operation_t *op) {
+  if (opQueuePush(&stream->queue, op) < 0) {
+    return -1;
+  }
+  stream->queue.tail->stream = stream;
+  stream->queue.tail->retries = 0;
+  return 0;
+}
+
+/**
+ * Marks that no more operations will be queued in the given stream. The
+ * stream is freed automatically once all its operations have completed.
+ */
+void debugCommands_closeStream(debugStream_t *stream) {
+  stream->closed = 1;
+}
+
+/**
+ * Copies the current link statistics into result.
+ */
+void debugCommands_getStats(debugLink_t *link, debugStats_t *result) {
+  debugStream_t *stream;
+  operation_t *op;
+  
+  *result = link->stats;
+  if (link->busy) {
+    result->busyUsec += (uint32_t)(startTimeout() - link->busySince);
+  }
+  result->smoothedRtt = link->smoothedRtt;
+  result->retransmitTimeout = link->retransmitTimeout;
+  result->issueWindow = link->issueWindow;
+  result->issuedPackets = link->numIssuedPackets;
+  
+  // Count the queued operations.
+  result->reissueQueued = 0;
+  for (op = link->reissueQueue.head; op; op = op->next) {
+    result->reissueQueued++;
+  }
+  result->streamQueued = 0;
+  result->activeStreams = 0;
+  for (stream = link->streamHead; stream; stream = stream->next) {
+    result->activeStreams++;
+    for (op = stream->queue.head; op; op = op->next) {
+      result->streamQueued++;
+    }
+  }
+}
+
+/**
+ * Fails all pending operations and frees the given link.
+ */
+void debugCommands_free(debugLink_t **link) {
+  if (!*link) {
+    return;
+  }
+  resetQueue(*link);
+  timeout_close(&(*link)->retransmitTimer);
+  free(*link);
+  *link = 0;
 }
@@ -49,6 +49,10 @@
 #ifndef _DEBUG_COMMANDS_H_
 #define _DEBUG_COMMANDS_H_
 
+#include <stdint.h>
+
+#include "../serial.h"
+
 /**
  * Command codes (with sequence number zero) for all known debug commands
  * supported by the hardware.
@@ -96,14 +100,48 @@ typedef enum {
    */
   OT_COMMAND,
   
+  /**
+   * Defines a COMCODE_SET_PAGE command. This behaves like a barrier followed
+   * by the command followed by another barrier, except that nothing is done
+   * when the hardware is known to be on the requested page already. Must only
+   * be used while holding the lock taken by OT_ACQUIRE.
+   */
+  OT_SET_PAGE,
+  
   /**
    * Defines a barrier. This operation does not do anything except wait until
-   * all previous commands have been executed.
+   * all previous commands in the same stream have been executed.
    */
   OT_BARRIER,
   
+  /**
+   * Barrier which also acquires exclusive access to the hardware state shared
+   * between commands, i.e. the bulk write page and the prepared volatile
+   * command. Other streams can still issue commands which do not depend on
+   * this state, such as bulk reads. Acquiring is reentrant within a stream.
+   */
+  OT_ACQUIRE,
+  
+  /**
+   * Barrier which releases one level of the lock taken by OT_ACQUIRE.
+   */
+  OT_RELEASE,
+  
 } operationType_t;
 
+/**
+ * Operation stream. Operations within a stream are issued in order, and
+ * barriers only wait for operations in their own stream, so streams belonging
+ * to different requests can complete out of order.
+ */
+typedef struct debugStream debugStream_t;
+
+/**
+ * State of the debug link with a single rvex platform. Every link has its own
+ * serial port, streams, sequence numbers and statistics.
+ */
+typedef struct debugLink debugLink_t;
+
 /**
  * Operation callback function type. success is set to 1 when the operation has
  * been executed successfully, or to 0 if a transmission error occured for this
@@ -138,6 +176,17 @@ typedef struct operation_t_ {
    */
   void *cbData;
   
+  /**
+   * Stream which the operation belongs to. Set by debugCommands_queue().
+   */
+  debugStream_t *stream;
+  
+  /**
+   * Number of times the command has been reissued because no reply was
+   * received. Set to zero by debugCommands_queue().
+   */
+  int retries;
+  
   /**
    * Next operation in the queue.
    */
@@ -146,21 +195,125 @@ typedef struct operation_t_ {
 } operation_t;
 
 /**
- * Updates the debug command system. Returns -1 if an error occured, 0 if the
- * system is idle, or 1 if we want update to be called quickly again to handle
- * potential timeouts.
+ * Statistics for the UART debug link.
+ */
+typedef struct {
+  
+  /**
+   * Number of packets sent, including retransmissions.
+   */
+  uint64_t packetsSent;
+  
+  /**
+   * Number of commands which completed successfully.
+   */
+  uint64_t completedCommands;
+  
+  /**
+   * Number of commands which were reissued because no reply was received,
+   * either because the retransmission timeout expired (also counted in
+   * timeouts) or because a reply to a later command arrived first.
+   */
+  uint64_t retransmits;
+  uint64_t timeouts;
+  
+  /**
+   * Number of commands which failed because they exceeded the retry limit
+   * or because the link went silent. Each of these fails the stream which
+   * the command belongs to.
+   */
+  uint64_t failedCommands;
+  
+  /**
+   * Number of received packets which were dropped because of a CRC mismatch
+   * or because they were too short.
+   */
+  uint64_t crcDrops;
+  
+  /**
+   * Number of received replies to commands which had already been reissued.
+   */
+  uint64_t staleReplies;
+  
+  /**
+   * Number of COMCODE_SET_PAGE commands which were skipped because the
+   * hardware was already on the requested page.
+   */
+  uint64_t pageSwitchesSkipped;
+  
+  /**
+   * Number of payload bytes in completed commands and their replies, and the
+   * time in microseconds during which we were waiting for replies. Together
+   * these give the effective throughput of the link.
+   */
+  uint64_t payloadBytes;
+  uint64_t busyUsec;
+  
+  /**
+   * Current smoothed round trip time and retransmission timeout in
+   * microseconds, and the current issue window in packets.
+   */
+  int smoothedRtt;
+  int retransmitTimeout;
+  int issueWindow;
+  
+  /**
+   * Current number of issued packets (sent, but no reply yet), operations
+   * waiting in the reissue queue, operations waiting in the queues of the
+   * active streams and number of active streams.
+   */
+  int issuedPackets;
+  int reissueQueued;
+  int streamQueued;
+  int activeStreams;
+  
+} debugStats_t;
+
+/**
+ * Initializes the debug command system for the hardware connected to the
+ * given serial port. Must be called after reactor_init(). Returns null if an
+ * error occurs.
+ */
+debugLink_t *debugCommands_init(serial_t *port);
+
+/**
+ * Updates the debug command system. Returns -1 if an error occured or 0
+ * otherwise. Retransmission timeouts are handled by a timer registered with
+ * the reactor, which wakes up the main loop when it expires.
+ */
+int debugCommands_update(debugLink_t *link);
+
+/**
+ * Opens a new operation stream on the given link. owner identifies the client
+ * which the stream belongs to. Streams with the same owner are ordered with
+ * respect to each other when either of them has ordered set: such a stream
+ * does not start issuing until all earlier streams of the same owner have
+ * completed, and later streams of the same owner wait for it. Returns null if
+ * an error occurs.
+ */
+debugStream_t *debugCommands_openStream(debugLink_t *link, uint32_t owner, int ordered);
+
+/**
+ * Queues an operation in the given stream. Returns -1 if an error occurs, or
+ * 0 on success.
+ */
+int debugCommands_queue(debugStream_t *stream, const operation_t *op);
+
+/**
+ * Marks that no more operations will be queued in the given stream. The
+ * stream is freed automatically once all its operations have completed.
  */
-int debugCommands_update(void);
+void debugCommands_closeStream(debugStream_t *stream);
 
 /**
- * Queues an operation. Returns -1 if an error occurs, or 0 on success.
+ * Copies the current link statistics into result.
  */
-int debugCommands_queue(const operation_t *op);
+void debugCommands_getStats(debugLink_t *link, debugStats_t *result);
 
 /**
- * Frees all dynamically allocated memory by the debugCommands unit.
+ * Fails all pending operations and frees the given link.
  */
-void debugCommands_free(void);
+void debugCommands_free(debugLink_t **link);
 
 
 #endif
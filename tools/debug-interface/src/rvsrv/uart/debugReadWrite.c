@@ -54,8 +54,7 @@
 
 #include "debugReadWrite.h"
 #include "debugCommands.h"
-#include "../tcpserv.h"
-#include "../main.h"
+#include "../protocol.h"
 
 /**
  * Stores data needed by the callback functions.
@@ -63,9 +62,10 @@
 typedef struct {
   
   /**
-   * TCP client ID which requested the operation.
+   * Request which is being serviced. Completed and freed by
+   * onReadWriteComplete().
    */
-  int clientID;
+  debugRequest_t *req;
   
   /**
    * Hardware address where readBuffer starts.
@@ -207,85 +207,22 @@ static int onVolatileComplete(int success, packet_t *tx, packet_t *rx, void *dat
  * Formats and returns the operation result to the TCP client.
  */
 static int onReadWriteComplete(int success, packet_t *tx, packet_t *rx, void *data) {
-  unsigned char str[32];
-  int i;
   callbackData_t *cbData = (callbackData_t*)data;
   if (!cbData) {
     printf("onReadWriteComplete() was called without parameter data, this should never happen...\n");
     return -1;
   }
   
-  // Return a communication error if success is 0.
+  // Complete the request. Note that we don't consider communication errors
+  // with the TCP client as fatal errors.
   if (!success) {
-    if (tcpServer_sendStr(debugServer, cbData->clientID, (const unsigned char *)(cbData->buffer ? "Error, Read, CommunicationError;\n" : "Error, Write, CommunicationError;\n")) < 0) {
-      if (cbData->buffer) free(cbData->buffer);
-      free(cbData);
-      return 0;
-    }
-    if (cbData->buffer) free(cbData->buffer);
-    free(cbData);
-    return 0;
-  }
-  
-  // Write the result tokens which are always present.
-  if (tcpServer_sendStr(debugServer, cbData->clientID, (const unsigned char *)(cbData->buffer ? "OK, Read, " : "OK, Write, ")) < 0) {
-    if (cbData->buffer) free(cbData->buffer);
-    free(cbData);
-    return 0;
-  }
-  if (tcpServer_sendStr(debugServer, cbData->clientID, (const unsigned char *)(cbData->lastFault ? "Fault, " : "OK, ")) < 0) {
-    if (cbData->buffer) free(cbData->buffer);
-    free(cbData);
-    return 0;
-  }
-  sprintf((char *)str, "%08X, %d", cbData->address, cbData->bufSize);
-  if (tcpServer_sendStr(debugServer, cbData->clientID, str) < 0) {
-    if (cbData->buffer) free(cbData->buffer);
-    free(cbData);
-    return 0;
-  }
-  
-  // Write the result-specific tokens.
-  if (cbData->lastFault) {
-    
-    // Write fault code.
-    sprintf((char *)str, ", %08X;\n", cbData->lastFaultCode);
-    if (tcpServer_sendStr(debugServer, cbData->clientID, str) < 0) {
-      if (cbData->buffer) free(cbData->buffer);
-      free(cbData);
-      return 0;
-    }
-    
+    protocol_replyError(cbData->req, "CommunicationError");
+  } else if (cbData->lastFault) {
+    protocol_replyFault(cbData->req, cbData->address, cbData->bufSize, cbData->lastFaultCode);
   } else if (cbData->buffer) {
-    
-    // Dump the data buffer.
-    if (tcpServer_sendStr(debugServer, cbData->clientID, (const unsigned char *)", ") < 0) {
-      free(cbData->buffer);
-      free(cbData);
-      return 0;
-    }
-    for (i = 0; i < cbData->bufSize; i++) {
-      sprintf((char *)str, "%02hhX", cbData->buffer[i]);
-      if (tcpServer_sendStr(debugServer, cbData->clientID, str) < 0) {
-        free(cbData->buffer);
-        free(cbData);
-        return 0;
-      }
-    }
-    if (tcpServer_sendStr(debugServer, cbData->clientID, (const unsigned char *)";\n") < 0) {
-      free(cbData->buffer);
-      free(cbData);
-      return 0;
-    }
-    
+    protocol_replyRead(cbData->req, cbData->address, cbData->bufSize, cbData->buffer);
   } else {
-    
-    // No special token for writes.
-    if (tcpServer_sendStr(debugServer, cbData->clientID, (const unsigned char *)";\n") < 0) {
-      free(cbData);
-      return 0;
-    }
-    
+    protocol_replyWrite(cbData->req, cbData->address, cbData->bufSize);
   }
   
   if (cbData->buffer) free(cbData->buffer);
@@ -296,15 +233,16 @@ static int onReadWriteComplete(int success, packet_t *tx, packet_t *rx, void *da
 /**
  * Queues the operations needed to perform a volatile bus command.
  */
-static int queueVolatile(uint32_t address, uint32_t writeData, int flags, callbackData_t *cbData) {
+static int queueVolatile(debugStream_t *stream, uint32_t address, uint32_t writeData, int flags, callbackData_t *cbData) {
   operation_t op;
   op.cbData = (void*)cbData;
   
   // We should wait with issuing the prepare command before all other bus
-  // operations have completed.
-  op.t = OT_BARRIER;
+  // operations have completed. We also need exclusive access to the prepared
+  // command register until the command has been executed.
+  op.t = OT_ACQUIRE;
   op.cb = 0;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
   
@@ -322,7 +260,7 @@ static int queueVolatile(uint32_t address, uint32_t writeData, int flags, callba
   op.p.data[8] = flags;
   op.p.len = 9;
   op.cb = 0;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
       
@@ -330,7 +268,7 @@ static int queueVolatile(uint32_t address, uint32_t writeData, int flags, callba
   // before sending the command to execute it.
   op.t = OT_BARRIER;
   op.cb = 0;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
   
@@ -339,15 +277,15 @@ static int queueVolatile(uint32_t address, uint32_t writeData, int flags, callba
   op.p.commandCode = COMCODE_VOLATILE_EXECUTE;
   op.p.len = 0;
   op.cb = &onVolatileComplete;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
   
   // We need to make sure that the command has been executed before giving any
   // commands which might override the prepared command.
-  op.t = OT_BARRIER;
+  op.t = OT_RELEASE;
   op.cb = 0;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
   
@@ -367,8 +305,9 @@ static int queueVolatile(uint32_t address, uint32_t writeData, int flags, callba
  * Bus faults are only checked for the last bus operation; if there are any bus
  * errors prior, these bus operations silently fail in hardware.
  */
-int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
+int handleRead(debugLink_t *link, debugRequest_t *req, uint32_t address, uint32_t buf_size) {
   callbackData_t *cbData;
+  debugStream_t *stream;
   operation_t op;
 
   // Allocate memory for the callback data structure.
@@ -377,7 +316,7 @@ int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
     perror("handleRead: Failed to allocate memory to service debug read command");
     return -1;
   }
-  cbData->clientID = clientID;
+  cbData->req = req;
   cbData->address = address;
   cbData->bufSize = buf_size;
   cbData->buffer = malloc(buf_size);
@@ -390,6 +329,14 @@ int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
     return -1;
   }
   
+  // Open a stream for the operations, so they can complete independently of
+  // those of other requests. Untagged requests can't be told apart by the
+  // client, so those are completed in order.
+  stream = debugCommands_openStream(link, req->connection, !req->tagged);
+  if (!stream) {
+    return -1;
+  }
+  
   // All operations which will use callback data, will use the same callback
   // data. So we just set the pointer here once.
   op.cbData = (void*)cbData;
@@ -434,7 +381,7 @@ int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
       op.p.data[4] = (curAddress + (numWords*4)) & 0xFF;
       op.p.len = 5;
       op.cb = &onBulkRead;
-      if (debugCommands_queue(&op) < 0) {
+      if (debugCommands_queue(stream, &op) < 0) {
         return -1;
       }
 
@@ -454,7 +401,7 @@ int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
       alignedAddress = curAddress & 0xFFFFFFFC;
 
       // Queue the volatile bus operation.
-      if (queueVolatile(alignedAddress, 0, 0, op.cbData) < 0) {
+      if (queueVolatile(stream, alignedAddress, 0, 0, op.cbData) < 0) {
         return -1;
       }
 
@@ -478,10 +425,13 @@ int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
   // Insert a barrier with a callback to detect when we're done.
   op.t = OT_BARRIER;
   op.cb = onReadWriteComplete;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
   
+  // That's all the operations for this request.
+  debugCommands_closeStream(stream);
+  
   // Queued successfully.
   return 0;
 }
@@ -498,9 +448,10 @@ int handleRead(uint32_t address, uint32_t buf_size, int clientID) {
  * Bus faults are only checked for the last bus operation; if there are any bus
  * errors prior, these bus operations silently fail in hardware.
  */
-int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
-    int clientID) {
+int handleWrite(debugLink_t *link, debugRequest_t *req, uint32_t address, unsigned char *buffer,
+    uint32_t buf_size) {
   callbackData_t *cbData;
+  debugStream_t *stream;
   operation_t op;
 
   // Allocate memory for the callback data structure.
@@ -509,17 +460,32 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
     perror("handleRead: Failed to allocate memory to service debug read command");
     return -1;
   }
-  cbData->clientID = clientID;
+  cbData->req = req;
   cbData->address = address;
   cbData->bufSize = buf_size;
   cbData->buffer = 0;
   cbData->lastFault = 0;
   cbData->lastFaultCode = 0;
   
+  // Open a stream for the operations. Writes are ordered with respect to all
+  // other requests from the same client.
+  stream = debugCommands_openStream(link, req->connection, 1);
+  if (!stream) {
+    return -1;
+  }
+  
   // All operations which will use callback data, will use the same callback
   // data. So we just set the pointer here once.
   op.cbData = (void*)cbData;
   
+  // Writes depend on the bulk write page register in the hardware, so we need
+  // exclusive access to it for the duration of the write.
+  op.t = OT_ACQUIRE;
+  op.cb = 0;
+  if (debugCommands_queue(stream, &op) < 0) {
+    return -1;
+  }
+  
   // Queue the necessary debug operations for handling this command.
   uint32_t curAddress = cbData->address;
   int remain = cbData->bufSize;
@@ -555,32 +521,19 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
       // Determine the page which this would belong to.
       page = curAddress >> 12;
 
-      // Switch page if needed.
+      // Switch page if needed. The page switch is skipped entirely when the
+      // hardware is still on this page from an earlier write.
       if (page != curPage) {
 
-        // We don't want to change the page while any previous writes may not
-        // have been completed, so we need a barrier.
-        op.t = OT_BARRIER;
-        op.cb = 0;
-        if (debugCommands_queue(&op) < 0) {
-          return -1;
-        }
-
         // Insert the set page command.
-        op.t = OT_COMMAND;
+        op.t = OT_SET_PAGE;
         op.p.commandCode = COMCODE_SET_PAGE;
         op.p.data[0] = (curAddress >> 24) & 0xFF;
         op.p.data[1] = (curAddress >> 16) & 0xFF;
         op.p.data[2] = (curAddress >>  8) & 0xF0;
         op.p.len = 3;
-        if (debugCommands_queue(&op) < 0) {
-          return -1;
-        }
-
-        // We don't want to change write until we're sure that the page
-        // command has been executed, so we need another barrier.
-        op.t = OT_BARRIER;
-        if (debugCommands_queue(&op) < 0) {
+        op.cb = 0;
+        if (debugCommands_queue(stream, &op) < 0) {
           return -1;
         }
 
@@ -596,7 +549,7 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
       memcpy(&(op.p.data[1]), bufPtr, numWords*4);
       op.p.len = numWords*4+1;
       printf("Write to address %x, len %d\n", curAddress, op.p.len);
-      if (debugCommands_queue(&op) < 0) {
+      if (debugCommands_queue(stream, &op) < 0) {
         return -1;
       }
 
@@ -618,7 +571,7 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
       writeData <<= 8;
       writeData |= *(bufPtr+3);
       printf("Write to address %x, len %d\n", curAddress, 4);
-      if (queueVolatile(curAddress & 0xFFFFFFFC, writeData, 0xF8, op.cbData) < 0) {
+      if (queueVolatile(stream, curAddress & 0xFFFFFFFC, writeData, 0xF8, op.cbData) < 0) {
         return -1;
       }
 
@@ -640,7 +593,7 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
       writeData <<= 8;
       writeData |= *(bufPtr+1);
       printf("Write to address %x, len %d\n", curAddress, 2);
-      if (queueVolatile(curAddress & 0xFFFFFFFC, writeData, (curAddress & 0x2) ? 0x38 : 0xC8, op.cbData) < 0) {
+      if (queueVolatile(stream, curAddress & 0xFFFFFFFC, writeData, (curAddress & 0x2) ? 0x38 : 0xC8, op.cbData) < 0) {
         return -1;
       }
 
@@ -669,7 +622,7 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
       writeData <<= 8;
       writeData |= *bufPtr;
       printf("Write to address %x, len %d\n", curAddress, 1);
-      if (queueVolatile(curAddress & 0xFFFFFFFC, writeData, (mask << 4) | 0x08, op.cbData) < 0) {
+      if (queueVolatile(stream, curAddress & 0xFFFFFFFC, writeData, (mask << 4) | 0x08, op.cbData) < 0) {
         return -1;
       }
 
@@ -682,13 +635,23 @@ int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
 
   }
 
+  // Release the lock on the page register.
+  op.t = OT_RELEASE;
+  op.cb = 0;
+  if (debugCommands_queue(stream, &op) < 0) {
+    return -1;
+  }
+  
   // Insert a barrier with a callback to detect when we're done.
   op.t = OT_BARRIER;
   op.cb = onReadWriteComplete;
-  if (debugCommands_queue(&op) < 0) {
+  if (debugCommands_queue(stream, &op) < 0) {
     return -1;
   }
   
+  // That's all the operations for this request.
+  debugCommands_closeStream(stream);
+  
   // Queued successfully.
   return 0;
 }
@@ -51,12 +51,16 @@
 
 #include <stdint.h>
 
+#include "../protocol.h"
+#include "debugCommands.h"
+
 /**
  * Tries to handle a Read or Write command sent by a TCP client connected to
- * the debug server. command should be null-terminated.
+ * the debug server, by queueing the debug commands needed to perform it on
+ * the given link.
  */
-int handleRead(uint32_t address, uint32_t buf_size, int clientID);
-int handleWrite(uint32_t address, unsigned char *buffer, uint32_t buf_size,
-    int clientID);
+int handleRead(debugLink_t *link, debugRequest_t *req, uint32_t address, uint32_t buf_size);
+int handleWrite(debugLink_t *link, debugRequest_t *req, uint32_t address, unsigned char *buffer,
+    uint32_t buf_size);
 
 #endif
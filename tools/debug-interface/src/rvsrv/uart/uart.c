@@ -54,18 +54,80 @@
 #include "../rvex_iface.h"
 
 /**
- * File descriptor for the serial port.
+ * Tries to handle a Read command sent by a TCP client connected to the debug
+ * server.
  */
-int tty = 0;
+static int uart_read(void *data, debugRequest_t *req, uint32_t address,
+    uint32_t buf_size) {
+  return handleRead((debugLink_t*)data, req, address, buf_size);
+}
+
+/**
+ * Tries to handle a Write command sent by a TCP client connected to the debug
+ * server.
+ */
+static int uart_write(void *data, debugRequest_t *req, uint32_t address,
+    unsigned char *buffer, uint32_t buf_size) {
+  return handleWrite((debugLink_t*)data, req, address, buffer, buf_size);
+}
+
+/**
+ * Handles received packets, timeouts and command issue for the link.
+ */
+static int uart_update(void *data) {
+  return debugCommands_update((debugLink_t*)data);
+}
+
+/**
+ * Frees the link and everything still queued on it.
+ */
+static void uart_free(void *data) {
+  debugLink_t *link = (debugLink_t*)data;
+  debugCommands_free(&link);
+}
+
+/**
+ * Appends the link statistics to buf.
+ */
+static void uart_stats(void *data, statsBuffer_t *buf) {
+  debugStats_t s;
+  
+  debugCommands_getStats((debugLink_t*)data, &s);
+  stats_put(buf, "uart.", "packetsSent", s.packetsSent);
+  stats_put(buf, "uart.", "completedCommands", s.completedCommands);
+  stats_put(buf, "uart.", "retransmits", s.retransmits);
+  stats_put(buf, "uart.", "timeouts", s.timeouts);
+  stats_put(buf, "uart.", "failedCommands", s.failedCommands);
+  stats_put(buf, "uart.", "crcDrops", s.crcDrops);
+  stats_put(buf, "uart.", "staleReplies", s.staleReplies);
+  stats_put(buf, "uart.", "pageSwitchesSkipped", s.pageSwitchesSkipped);
+  stats_put(buf, "uart.", "payloadBytes", s.payloadBytes);
+  stats_put(buf, "uart.", "busyUsec", s.busyUsec);
+  stats_put(buf, "uart.", "rtt", s.smoothedRtt);
+  stats_put(buf, "uart.", "rto", s.retransmitTimeout);
+  stats_put(buf, "uart.", "issueWindow", s.issueWindow);
+  stats_put(buf, "uart.", "issued", s.issuedPackets);
+  stats_put(buf, "uart.", "reissueQueued", s.reissueQueued);
+  stats_put(buf, "uart.", "opQueued", s.streamQueued);
+  stats_put(buf, "uart.", "streams", s.activeStreams);
+}
+
+int init_uart_iface(serial_t *port, rvex_iface_t *iface) {
+  debugLink_t *link;
 
-int init_uart_iface(int tty, rvex_iface_t *iface) {
-  tty = tty;
+  link = debugCommands_init(port);
+  if (!link) {
+    return -1;
+  }
 
   *iface = (rvex_iface_t) {
-    .read = handleRead,
-    .write = handleWrite,
-    .update = debugCommands_update,
-    .free = debugCommands_free,
+    .data = link,
+    .read = uart_read,
+    .write = uart_write,
+    .update = uart_update,
+    .free = uart_free,
+    .stats = uart_stats,
+    .maxTransferSize = MAX_TRANSFER_SIZE,
   };
 
   return 0;
@@ -49,15 +49,18 @@
 #ifndef _UART_H_
 #define _UART_H_
 
+#include "../serial.h"
+
 typedef struct rvex_iface rvex_iface_t;
 
 /**
  * Initialize the uart interface with the rVEX.
  *
- * tty is an initialized serial connection with an softcore that has a debug
- * peripheral.
+ * port is the serial port state for a connection with a softcore that has a
+ * debug peripheral. The port may be closed while the interface is in use, in
+ * which case debug packets are dropped until it is reopened.
  * Returns 0 on success, -1 on error.
  */
-int init_uart_iface(int tty, rvex_iface_t *iface);
+int init_uart_iface(serial_t *port, rvex_iface_t *iface);
 
 #endif